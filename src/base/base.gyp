@@ -109,6 +109,7 @@
         'text_normalizer.cc',
         'thread.cc',
         'thread2.cc',
+        'thread_pool.cc',
         'util.cc',
       ],
       'dependencies': [
@@ -29,9 +29,15 @@
 
 #include "base/hash.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "base/port.h"
+#include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace {
@@ -77,65 +83,92 @@ uint32_t Hash::Fingerprint32(absl::string_view str) {
   return Fingerprint32WithSeed(str, kFingerPrint32Seed);
 }
 
-uint32_t Hash::Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
+namespace {
+
 #define U32(x) static_cast<uint32_t>(x)
 #define ToUint32(a, b, c, d) \
   (U32(a) + (U32(b) << 8) + (U32(c) << 16) + (U32(d) << 24))
 
-  const uint32_t str_len = U32(str.size());
-  uint32_t a = 0x9e3779b9;
-  uint32_t b = a;
-  uint32_t c = seed;
+constexpr size_t kBlockSize = 12;
 
-  while (str.size() >= 12) {
-    a += ToUint32(str[0], str[1], str[2], str[3]);
-    b += ToUint32(str[4], str[5], str[6], str[7]);
-    c += ToUint32(str[8], str[9], str[10], str[11]);
+struct State {
+  explicit State(uint32_t seed) : a(0x9e3779b9), b(0x9e3779b9), c(seed) {}
+
+  void Update(const char* block) {
+    a += ToUint32(block[0], block[1], block[2], block[3]);
+    b += ToUint32(block[4], block[5], block[6], block[7]);
+    c += ToUint32(block[8], block[9], block[10], block[11]);
     Mix(a, b, c);
-    str.remove_prefix(12);
   }
 
-  c += U32(str_len);
-  switch (str.size()) {
-    case 11:
-      c += U32(str[10]) << 24;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 10:
-      c += U32(str[9]) << 16;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 9:
-      c += U32(str[8]) << 8;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 8:
-      b += U32(str[7]) << 24;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 7:
-      b += U32(str[6]) << 16;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 6:
-      b += U32(str[5]) << 8;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 5:
-      b += U32(str[4]);
-      ABSL_FALLTHROUGH_INTENDED;
-    case 4:
-      a += U32(str[3]) << 24;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 3:
-      a += U32(str[2]) << 16;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 2:
-      a += U32(str[1]) << 8;
-      ABSL_FALLTHROUGH_INTENDED;
-    case 1:
-      a += U32(str[0]);
-      break;
+  // |tail| is the last |tail_size| (< 12) bytes of the |total_size| bytes.
+  uint32_t Finish(const char* tail, size_t tail_size, uint32_t total_size) {
+    c += total_size;
+    switch (tail_size) {
+      case 11:
+        c += U32(tail[10]) << 24;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 10:
+        c += U32(tail[9]) << 16;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 9:
+        c += U32(tail[8]) << 8;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 8:
+        b += U32(tail[7]) << 24;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 7:
+        b += U32(tail[6]) << 16;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 6:
+        b += U32(tail[5]) << 8;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 5:
+        b += U32(tail[4]);
+        ABSL_FALLTHROUGH_INTENDED;
+      case 4:
+        a += U32(tail[3]) << 24;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 3:
+        a += U32(tail[2]) << 16;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 2:
+        a += U32(tail[1]) << 8;
+        ABSL_FALLTHROUGH_INTENDED;
+      case 1:
+        a += U32(tail[0]);
+        break;
+    }
+    Mix(a, b, c);
+    return c;
   }
-  Mix(a, b, c);
 
-  return c;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+};
+
 #undef ToUint32
 #undef U32
+
+uint64_t Combine(uint32_t hi, uint32_t lo) {
+  uint64_t result = static_cast<uint64_t>(hi) << 32 | static_cast<uint64_t>(lo);
+  if ((hi == 0) && (lo < 2)) {
+    result ^= 0x130f9bef94a0a928uLL;
+  }
+  return result;
+}
+
+}  // namespace
+
+uint32_t Hash::Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
+  const uint32_t str_len = static_cast<uint32_t>(str.size());
+  State state(seed);
+  while (str.size() >= kBlockSize) {
+    state.Update(str.data());
+    str.remove_prefix(kBlockSize);
+  }
+  return state.Finish(str.data(), str.size(), str_len);
 }
 
 uint64_t Hash::Fingerprint(absl::string_view str) {
@@ -145,11 +178,38 @@ uint64_t Hash::Fingerprint(absl::string_view str) {
 uint64_t Hash::FingerprintWithSeed(absl::string_view str, uint32_t seed) {
   const uint32_t hi = Fingerprint32WithSeed(str, seed);
   const uint32_t lo = Fingerprint32WithSeed(str, kFingerPrintSeed1);
-  uint64_t result = static_cast<uint64_t>(hi) << 32 | static_cast<uint64_t>(lo);
-  if ((hi == 0) && (lo < 2)) {
-    result ^= 0x130f9bef94a0a928uLL;
+  return Combine(hi, lo);
+}
+
+uint64_t Hash::FingerprintConcatWithSeed(
+    absl::Span<const absl::string_view> pieces, uint32_t seed) {
+  State hi(seed);
+  State lo(kFingerPrintSeed1);
+  char block[kBlockSize];
+  size_t block_size = 0;
+  uint32_t total_size = 0;
+  for (absl::string_view piece : pieces) {
+    total_size += static_cast<uint32_t>(piece.size());
+    while (!piece.empty()) {
+      if (block_size == 0 && piece.size() >= kBlockSize) {
+        hi.Update(piece.data());
+        lo.Update(piece.data());
+        piece.remove_prefix(kBlockSize);
+        continue;
+      }
+      const size_t n = std::min(kBlockSize - block_size, piece.size());
+      memcpy(block + block_size, piece.data(), n);
+      block_size += n;
+      piece.remove_prefix(n);
+      if (block_size == kBlockSize) {
+        hi.Update(block);
+        lo.Update(block);
+        block_size = 0;
+      }
+    }
   }
-  return result;
+  return Combine(hi.Finish(block, block_size, total_size),
+                 lo.Finish(block, block_size, total_size));
 }
 
 }  // namespace mozc
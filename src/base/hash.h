@@ -35,6 +35,7 @@
 
 #include "base/port.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -47,6 +48,11 @@ class Hash {
   static uint64_t Fingerprint(absl::string_view str);
   static uint64_t FingerprintWithSeed(absl::string_view str, uint32_t seed);
 
+  // Calculates the same fingerprint as FingerprintWithSeed() of the
+  // concatenation of |pieces| without building the concatenated string.
+  static uint64_t FingerprintConcatWithSeed(
+      absl::Span<const absl::string_view> pieces, uint32_t seed);
+
   // Calculates 32-bit fingerprint.
   static uint32_t Fingerprint32(absl::string_view str);
   static uint32_t Fingerprint32WithSeed(absl::string_view str, uint32_t seed);
@@ -29,11 +29,15 @@
 
 #include "base/hash.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "testing/gunit.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 namespace {
@@ -58,6 +62,30 @@ TEST(HashTest, Basic) {
   EXPECT_EQ(Hash::FingerprintWithSeed(s, 0xdeadbeef), 0xe3fd29979d4f0b39);
 }
 
+TEST(HashTest, FingerprintConcatWithSeed) {
+  const uint32_t seed = 0xdeadbeef;
+  const std::string s =
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.";
+  // Splits |s| into pieces of every length to cover all the block boundaries.
+  for (size_t len = 0; len <= 25; ++len) {
+    std::vector<absl::string_view> pieces;
+    for (size_t pos = 0; pos < s.size(); pos += std::max<size_t>(len, 1)) {
+      pieces.push_back(absl::string_view(s).substr(pos, len));
+    }
+    std::string concat;
+    for (absl::string_view piece : pieces) {
+      concat.append(piece.data(), piece.size());
+    }
+    EXPECT_EQ(Hash::FingerprintConcatWithSeed(pieces, seed),
+              Hash::FingerprintWithSeed(concat, seed))
+        << len;
+  }
+  EXPECT_EQ(Hash::FingerprintConcatWithSeed({}, seed),
+            Hash::FingerprintWithSeed("", seed));
+  EXPECT_EQ(Hash::FingerprintConcatWithSeed({"goo", "", "gle"}, seed),
+            0x1f8cbc0cafa6beed);
+}
+
 TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   const uint32_t seed = 0xabcdef;
   {
@@ -29,10 +29,13 @@
 
 #include "base/mmap.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/strings/zstring_view.h"
@@ -275,8 +278,9 @@ void Unmap(void *ptr, size_t size) {
 
 }  // namespace
 
-absl::StatusOr<Mmap> Mmap::Map(zstring_view filename, size_t offset,
-                               std::optional<size_t> size, Mode mode) {
+absl::StatusOr<Mmap> Mmap::MapImpl(zstring_view filename, size_t offset,
+                                   std::optional<size_t> size, Mode mode,
+                                   bool lock) {
   absl::StatusOr<SyscallParams> params = GetSyscallParams(mode);
   if (!params.ok()) {
     return std::move(params).status();
@@ -321,7 +325,9 @@ absl::StatusOr<Mmap> Mmap::Map(zstring_view filename, size_t offset,
     return std::move(ptr).status();
   }
 
-  MaybeMLock(*ptr, map_size);
+  if (lock) {
+    MaybeMLock(*ptr, map_size);
+  }
 
   Mmap mmap;
   mmap.data_ = absl::MakeSpan(static_cast<char *>(*ptr) + adjust, *size);
@@ -388,4 +394,90 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) { return -1; }
 
 #undef MOZC_HAVE_MLOCK
 
+#ifdef _WIN32
+
+absl::StatusOr<std::vector<std::pair<size_t, size_t>>> Mmap::GetMappedRanges(
+    const void *addr, size_t len) {
+  return absl::UnimplementedError("/proc/self/pagemap is not available");
+}
+
+absl::Status Mmap::Prefetch(const void *addr, size_t len) {
+  return absl::UnimplementedError("madvise() is not available");
+}
+
+#else  // _WIN32
+
+#if defined(__linux__)
+absl::StatusOr<std::vector<std::pair<size_t, size_t>>> Mmap::GetMappedRanges(
+    const void *addr, size_t len) {
+  absl::StatusOr<size_t> page_size = GetPageSize();
+  if (!page_size.ok()) {
+    return std::move(page_size).status();
+  }
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin - begin % *page_size;
+  const size_t num_pages =
+      (begin + len - aligned_begin + *page_size - 1) / *page_size;
+
+  // /proc/self/pagemap has a 64-bit entry for each virtual page, whose bit 63
+  // is set if the page is mapped in the page table of this process.  Unlike
+  // mincore(), it doesn't report the pages which are only in the page cache,
+  // e.g. read ahead by Prefetch() or by the other processes.
+  const int fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return absl::ErrnoToStatus(errno, "open(/proc/self/pagemap) failed");
+  }
+  FdCloser closer(fd);
+  std::vector<uint64_t> entries(num_pages);
+  const size_t size = num_pages * sizeof(uint64_t);
+  const off_t offset = aligned_begin / *page_size * sizeof(uint64_t);
+  if (num_pages > 0 &&
+      ::pread(fd, entries.data(), size, offset) != static_cast<ssize_t>(size)) {
+    return absl::ErrnoToStatus(errno, "pread(/proc/self/pagemap) failed");
+  }
+
+  constexpr uint64_t kPresentBit = uint64_t{1} << 63;
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (size_t i = 0; i < num_pages; ++i) {
+    if ((entries[i] & kPresentBit) == 0) {
+      continue;
+    }
+    // Clip the page to [begin, begin + len).
+    const uintptr_t page_begin =
+        std::max<uintptr_t>(aligned_begin + i * *page_size, begin);
+    const uintptr_t page_end =
+        std::min<uintptr_t>(aligned_begin + (i + 1) * *page_size, begin + len);
+    const size_t range_offset = page_begin - begin;
+    if (!ranges.empty() &&
+        ranges.back().first + ranges.back().second == range_offset) {
+      ranges.back().second += page_end - page_begin;
+    } else {
+      ranges.emplace_back(range_offset, page_end - page_begin);
+    }
+  }
+  return ranges;
+}
+#else   // __linux__
+absl::StatusOr<std::vector<std::pair<size_t, size_t>>> Mmap::GetMappedRanges(
+    const void *addr, size_t len) {
+  return absl::UnimplementedError("/proc/self/pagemap is not available");
+}
+#endif  // __linux__
+
+absl::Status Mmap::Prefetch(const void *addr, size_t len) {
+  absl::StatusOr<size_t> page_size = GetPageSize();
+  if (!page_size.ok()) {
+    return std::move(page_size).status();
+  }
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin - begin % *page_size;
+  if (madvise(reinterpret_cast<void *>(aligned_begin),
+              begin + len - aligned_begin, MADV_WILLNEED) == -1) {
+    return absl::ErrnoToStatus(errno, "madvise() failed");
+  }
+  return absl::OkStatus();
+}
+
+#endif  // _WIN32
+
 }  // namespace mozc
@@ -32,8 +32,11 @@
 
 #include <cstddef>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "base/strings/zstring_view.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 
@@ -58,7 +61,16 @@ class Mmap final {
   // mapped.
   static absl::StatusOr<Mmap> Map(zstring_view filename, size_t offset,
                                   std::optional<size_t> size,
-                                  Mode mode = READ_ONLY);
+                                  Mode mode = READ_ONLY) {
+    return MapImpl(filename, offset, size, mode, /*lock=*/true);
+  }
+
+  // Same as Map() but doesn't mlock the mapping. The pages are read on demand
+  // or by Prefetch(), so GetMappedRanges() reports only the touched pages.
+  static absl::StatusOr<Mmap> MapWithoutLock(zstring_view filename,
+                                             Mode mode = READ_ONLY) {
+    return MapImpl(filename, 0, std::nullopt, mode, /*lock=*/false);
+  }
 
   Mmap() = default;
 
@@ -87,6 +99,20 @@ class Mmap final {
   static int MaybeMLock(const void *addr, size_t len);
   static int MaybeMUnlock(const void *addr, size_t len);
 
+  // Following functions give paging hints for mapped memory, and are used to
+  // prefetch the data touched at start-up. GetMappedRanges() is implemented
+  // on Linux, and Prefetch() on the platforms with madvise(). They return an
+  // Unimplemented error on the other platforms. The range [addr, addr + len)
+  // doesn't need to be aligned to the page boundaries.
+  //
+  // Returns the byte ranges (offset from addr, length) of the pages in
+  // [addr, addr + len) which this process has touched, i.e. which are mapped
+  // in its page table. Adjacent pages are merged into one range.
+  static absl::StatusOr<std::vector<std::pair<size_t, size_t>>>
+  GetMappedRanges(const void *addr, size_t len);
+  // Asks the OS to read the pages in [addr, addr + len) ahead.
+  static absl::Status Prefetch(const void *addr, size_t len);
+
   constexpr char &operator[](size_t i) { return data_[i]; }
   constexpr char operator[](size_t i) const { return data_[i]; }
   constexpr char *begin() { return data_.begin(); }
@@ -102,6 +128,10 @@ class Mmap final {
   constexpr size_t size() const { return data_.size(); }
 
  private:
+  static absl::StatusOr<Mmap> MapImpl(zstring_view filename, size_t offset,
+                                      std::optional<size_t> size, Mode mode,
+                                      bool lock);
+
   absl::Span<char> data_;
   size_t adjust_ = 0;
 };
@@ -143,6 +143,58 @@ TEST(MmapTest, MaybeMLockTest) {
   }
 }
 
+#ifndef _WIN32
+TEST(MmapTest, Prefetch) {
+  constexpr size_t kFileSize = 3 * 65536 + 123;
+  const std::string &filename = GetRandomFilename();
+  ASSERT_OK(FileUtil::SetContents(filename, std::string(kFileSize, 'a')));
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename, Mmap::READ_ONLY);
+  ASSERT_OK(mmap);
+
+  EXPECT_OK(Mmap::Prefetch(mmap->data() + 10, kFileSize - 20));
+  EXPECT_EQ(absl::c_count(mmap->span(), 'a'), kFileSize);
+}
+#endif  // _WIN32
+
+#ifdef __linux__
+TEST(MmapTest, GetMappedRanges) {
+  constexpr size_t kFileSize = 3 * 65536 + 123;
+  const std::string &filename = GetRandomFilename();
+  ASSERT_OK(FileUtil::SetContents(filename, std::string(kFileSize, 'a')));
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename, Mmap::READ_ONLY);
+  ASSERT_OK(mmap);
+
+  // Touch all the pages.
+  EXPECT_EQ(absl::c_count(mmap->span(), 'a'), kFileSize);
+
+  absl::StatusOr<std::vector<std::pair<size_t, size_t>>> ranges =
+      Mmap::GetMappedRanges(mmap->data() + 10, kFileSize - 20);
+  ASSERT_OK(ranges);
+  EXPECT_THAT(*ranges, ::testing::ElementsAre(std::make_pair(
+                           size_t{0}, size_t{kFileSize - 20})));
+}
+
+TEST(MmapTest, MapWithoutLock) {
+  constexpr size_t kFileSize = 64 * 65536;
+  const std::string &filename = GetRandomFilename();
+  ASSERT_OK(FileUtil::SetContents(filename, std::string(kFileSize, 'a')));
+  absl::StatusOr<Mmap> mmap = Mmap::MapWithoutLock(filename, Mmap::READ_ONLY);
+  ASSERT_OK(mmap);
+
+  // Only the pages around the touched one are mapped.
+  EXPECT_EQ((*mmap)[0], 'a');
+  absl::StatusOr<std::vector<std::pair<size_t, size_t>>> ranges =
+      Mmap::GetMappedRanges(mmap->data(), kFileSize);
+  ASSERT_OK(ranges);
+  size_t mapped_size = 0;
+  for (const auto &[offset, length] : *ranges) {
+    mapped_size += length;
+  }
+  EXPECT_GT(mapped_size, 0);
+  EXPECT_LT(mapped_size, kFileSize);
+}
+#endif  // __linux__
+
 class MmapEntireFileTest : public ::testing::TestWithParam<size_t> {};
 
 TEST_P(MmapEntireFileTest, Read) {
@@ -0,0 +1,133 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/thread_pool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/thread2.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace {
+
+// State of RunAll() shared with the scheduled tasks.  A task may be dequeued
+// by a worker after RunAll() returns, so the state is reference counted.
+struct RunAllState {
+  explicit RunAllState(absl::Span<const std::function<void()>> tasks)
+      : tasks(tasks), claimed(tasks.size()), done(tasks.size()) {}
+
+  // Runs the |index|-th task unless another thread has already claimed it.
+  void MaybeRun(size_t index) {
+    if (claimed[index].exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    tasks[index]();
+    done.DecrementCount();
+  }
+
+  // Valid until all the tasks are done.
+  const absl::Span<const std::function<void()>> tasks;
+  std::vector<std::atomic<bool>> claimed;
+  absl::BlockingCounter done;
+};
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+  DCHECK_GT(num_threads, 0);
+  workers_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+  }
+  for (Thread2 &worker : workers_) {
+    worker.Join();
+  }
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  absl::MutexLock lock(&mutex_);
+  DCHECK(!shutdown_);
+  queue_.push_back(std::move(task));
+}
+
+void ThreadPool::RunAll(absl::Span<const std::function<void()>> tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+  auto state = std::make_shared<RunAllState>(tasks);
+  {
+    absl::MutexLock lock(&mutex_);
+    for (size_t i = 1; i < tasks.size(); ++i) {
+      queue_.push_back([state, i] { state->MaybeRun(i); });
+    }
+  }
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    state->MaybeRun(i);
+  }
+  state->done.Wait();
+}
+
+bool ThreadPool::HasTaskOrShutdown() const {
+  return shutdown_ || !queue_.empty();
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &ThreadPool::HasTaskOrShutdown));
+      if (queue_.empty()) {
+        // Shut down and no more task.
+        return;
+      }
+      task = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace mozc
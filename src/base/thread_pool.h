@@ -0,0 +1,87 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_THREAD_POOL_H_
+#define MOZC_BASE_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "base/thread2.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+
+// A fixed number of worker threads which run scheduled tasks in FIFO order.
+//
+// Usage:
+//   ThreadPool pool(2);
+//   std::vector<Result> results1, results2;
+//   const std::function<void()> tasks[] = {
+//       [&] { Aggregate1(&results1); },
+//       [&] { Aggregate2(&results2); },
+//   };
+//   pool.RunAll(tasks);  // Returns when both of the tasks are done.
+class ThreadPool {
+ public:
+  // |num_threads| must be positive.
+  explicit ThreadPool(int num_threads);
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Runs all the scheduled tasks and joins the worker threads.
+  ~ThreadPool();
+
+  // Schedules |task| to run on one of the worker threads.
+  void Schedule(std::function<void()> task);
+
+  // Runs |tasks| concurrently and returns when all of them are done.  The
+  // calling thread runs the tasks which no worker has started yet by itself,
+  // so it's safe to call RunAll() from a task running on the same pool.
+  void RunAll(absl::Span<const std::function<void()>> tasks);
+
+  int num_threads() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  bool HasTaskOrShutdown() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void WorkerLoop();
+
+  absl::Mutex mutex_;
+  std::deque<std::function<void()>> queue_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<Thread2> workers_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_THREAD_POOL_H_
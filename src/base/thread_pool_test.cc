@@ -0,0 +1,105 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "testing/gunit.h"
+#include "absl/synchronization/blocking_counter.h"
+
+namespace mozc {
+namespace {
+
+TEST(ThreadPoolTest, Schedule) {
+  std::atomic<int> count = 0;
+  {
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.num_threads(), 3);
+    absl::BlockingCounter done(100);
+    for (int i = 0; i < 100; ++i) {
+      pool.Schedule([&count, &done] {
+        ++count;
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+    EXPECT_EQ(count, 100);
+
+    // The destructor runs the remaining tasks.
+    for (int i = 0; i < 100; ++i) {
+      pool.Schedule([&count] { ++count; });
+    }
+  }
+  EXPECT_EQ(count, 200);
+}
+
+TEST(ThreadPoolTest, RunAll) {
+  ThreadPool pool(2);
+  pool.RunAll({});
+
+  std::vector<int> results(10);
+  std::vector<std::function<void()>> tasks;
+  for (int i = 0; i < results.size(); ++i) {
+    tasks.push_back([&results, i] { results[i] = i * i; });
+  }
+  for (int trial = 0; trial < 100; ++trial) {
+    std::fill(results.begin(), results.end(), -1);
+    pool.RunAll(tasks);
+    for (int i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i], i * i);
+    }
+  }
+}
+
+TEST(ThreadPoolTest, NestedRunAll) {
+  // Tasks running on the only worker call RunAll() of the same pool.
+  ThreadPool pool(1);
+  std::atomic<int> count = 0;
+  const std::function<void()> inner_tasks[] = {
+      [&count] { ++count; },
+      [&count] { ++count; },
+      [&count] { ++count; },
+  };
+  const std::function<void()> outer_tasks[] = {
+      [&] { pool.RunAll(inner_tasks); },
+      [&] { pool.RunAll(inner_tasks); },
+      [&] { pool.RunAll(inner_tasks); },
+  };
+  for (int trial = 0; trial < 100; ++trial) {
+    pool.RunAll(outer_tasks);
+  }
+  EXPECT_EQ(count, 100 * 9);
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,127 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "client/candidate_window_cache.h"
+
+#include "base/logging.h"
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace client {
+
+bool CandidateWindowCache::Apply(commands::Output *output) {
+  DCHECK(output);
+  if (!output->has_candidate_window_version()) {
+    // No candidate window is shown.
+    Clear();
+    return true;
+  }
+
+  const uint64_t version = output->candidate_window_version();
+  output->clear_candidate_window_version();
+  if (!output->has_candidate_window_delta()) {
+    // Full candidate lists.
+    version_ = version;
+    lists_.Clear();
+    if (output->has_candidates()) {
+      *lists_.mutable_candidates() = output->candidates();
+    }
+    if (output->has_all_candidate_words()) {
+      *lists_.mutable_all_candidate_words() = output->all_candidate_words();
+    }
+    if (output->has_incognito_candidate_words()) {
+      *lists_.mutable_incognito_candidate_words() =
+          output->incognito_candidate_words();
+    }
+    return true;
+  }
+
+  commands::CandidateWindowDelta delta;
+  delta.Swap(output->mutable_candidate_window_delta());
+  output->clear_candidate_window_delta();
+  if (version != version_) {
+    LOG(ERROR) << "The candidate lists of version " << version
+               << " are not held.  The held version: " << version_;
+    Clear();
+    return false;
+  }
+
+  if (output->has_candidates()) {
+    // The page is changed.
+    *lists_.mutable_candidates() = output->candidates();
+  } else if (lists_.has_candidates()) {
+    commands::Candidates *candidates = lists_.mutable_candidates();
+    if (delta.has_focused_index()) {
+      candidates->set_focused_index(delta.focused_index());
+    } else {
+      candidates->clear_focused_index();
+    }
+    if (candidates->has_usages()) {
+      if (delta.has_usages_focused_index()) {
+        candidates->mutable_usages()->set_focused_index(
+            delta.usages_focused_index());
+      } else {
+        candidates->mutable_usages()->clear_focused_index();
+      }
+    }
+    if (delta.has_footer()) {
+      candidates->mutable_footer()->Swap(delta.mutable_footer());
+    } else {
+      candidates->clear_footer();
+    }
+    *output->mutable_candidates() = *candidates;
+  }
+
+  if (lists_.has_all_candidate_words()) {
+    commands::CandidateList *all_candidate_words =
+        lists_.mutable_all_candidate_words();
+    if (delta.has_all_candidate_words_focused_index()) {
+      all_candidate_words->set_focused_index(
+          delta.all_candidate_words_focused_index());
+    } else {
+      all_candidate_words->clear_focused_index();
+    }
+    *output->mutable_all_candidate_words() = *all_candidate_words;
+  }
+
+  if (lists_.has_incognito_candidate_words()) {
+    *output->mutable_incognito_candidate_words() =
+        lists_.incognito_candidate_words();
+  }
+  return true;
+}
+
+void CandidateWindowCache::Clear() {
+  version_ = 0;
+  lists_.Clear();
+}
+
+}  // namespace client
+}  // namespace mozc
@@ -0,0 +1,73 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Client side state of the candidate window delta mode.  See
+// commands::Capability::candidate_window_delta.
+
+#ifndef MOZC_CLIENT_CANDIDATE_WINDOW_CACHE_H_
+#define MOZC_CLIENT_CANDIDATE_WINDOW_CACHE_H_
+
+#include <cstdint>
+
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace client {
+
+// Holds the candidate lists last sent by the server, and restores the lists
+// omitted from the outputs carrying a candidate window delta.
+class CandidateWindowCache {
+ public:
+  CandidateWindowCache() = default;
+  CandidateWindowCache(const CandidateWindowCache &) = delete;
+  CandidateWindowCache &operator=(const CandidateWindowCache &) = delete;
+
+  // Updates the cache with |output| and fills the candidate lists omitted
+  // from |output|, so that |output| looks the same as the one sent without the
+  // delta mode.  Returns false if |output| has a delta for the lists which the
+  // cache doesn't hold.  In that case, the candidate lists are not filled.
+  bool Apply(commands::Output *output);
+
+  // Discards the candidate lists held.
+  void Clear();
+
+  // Returns the version of the candidate lists held, or 0 if nothing is held.
+  // The client sends it with the next input.
+  uint64_t version() const { return version_; }
+
+ private:
+  uint64_t version_ = 0;
+  // Holds only candidates, all_candidate_words and incognito_candidate_words.
+  commands::Output lists_;
+};
+
+}  // namespace client
+}  // namespace mozc
+
+#endif  // MOZC_CLIENT_CANDIDATE_WINDOW_CACHE_H_
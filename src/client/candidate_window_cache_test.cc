@@ -0,0 +1,146 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "client/candidate_window_cache.h"
+
+#include <cstdint>
+#include <string>
+
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace client {
+namespace {
+
+constexpr uint64_t kVersion = 10;
+
+// Returns an output with the full candidate lists of three candidates.
+commands::Output FullOutput(uint32_t focused_index) {
+  commands::Output output;
+  output.set_candidate_window_version(kVersion);
+  commands::Candidates *candidates = output.mutable_candidates();
+  candidates->set_focused_index(focused_index);
+  candidates->set_size(3);
+  candidates->set_position(0);
+  commands::CandidateList *all_candidate_words =
+      output.mutable_all_candidate_words();
+  all_candidate_words->set_focused_index(focused_index);
+  for (uint32_t i = 0; i < 3; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value(std::to_string(i));
+    commands::CandidateWord *word = all_candidate_words->add_candidates();
+    word->set_index(i);
+    word->set_value(std::to_string(i));
+  }
+  return output;
+}
+
+// Returns an output with the delta which moves the focus to |focused_index|.
+commands::Output DeltaOutput(uint64_t version, uint32_t focused_index) {
+  commands::Output output;
+  output.set_candidate_window_version(version);
+  commands::CandidateWindowDelta *delta =
+      output.mutable_candidate_window_delta();
+  delta->set_focused_index(focused_index);
+  delta->set_all_candidate_words_focused_index(focused_index);
+  return output;
+}
+
+TEST(CandidateWindowCacheTest, ApplyDelta) {
+  CandidateWindowCache cache;
+  EXPECT_EQ(cache.version(), 0);
+
+  commands::Output output = FullOutput(0);
+  EXPECT_TRUE(cache.Apply(&output));
+  EXPECT_EQ(cache.version(), kVersion);
+  EXPECT_FALSE(output.has_candidate_window_version());
+  EXPECT_EQ(output.candidates().candidate_size(), 3);
+
+  output = DeltaOutput(kVersion, 2);
+  EXPECT_TRUE(cache.Apply(&output));
+  // The output looks the same as the full one.
+  commands::Output expected = FullOutput(2);
+  expected.clear_candidate_window_version();
+  EXPECT_EQ(output.SerializeAsString(), expected.SerializeAsString());
+  EXPECT_EQ(cache.version(), kVersion);
+}
+
+TEST(CandidateWindowCacheTest, ApplyDeltaWithPage) {
+  CandidateWindowCache cache;
+  commands::Output output = FullOutput(0);
+  EXPECT_TRUE(cache.Apply(&output));
+
+  // The new page is sent with the delta and is used from then.
+  output = DeltaOutput(kVersion, 1);
+  output.mutable_candidates()->set_size(3);
+  output.mutable_candidates()->set_position(0);
+  output.mutable_candidates()->set_focused_index(1);
+  output.mutable_candidates()->add_candidate()->set_value("page");
+  EXPECT_TRUE(cache.Apply(&output));
+  EXPECT_EQ(output.candidates().candidate_size(), 1);
+  EXPECT_EQ(output.all_candidate_words().candidates_size(), 3);
+  EXPECT_EQ(output.all_candidate_words().focused_index(), 1);
+
+  output = DeltaOutput(kVersion, 2);
+  EXPECT_TRUE(cache.Apply(&output));
+  EXPECT_EQ(output.candidates().candidate_size(), 1);
+  EXPECT_EQ(output.candidates().candidate(0).value(), "page");
+  EXPECT_EQ(output.candidates().focused_index(), 2);
+}
+
+TEST(CandidateWindowCacheTest, DeltaForUnknownVersion) {
+  CandidateWindowCache cache;
+  commands::Output output = FullOutput(0);
+  EXPECT_TRUE(cache.Apply(&output));
+
+  output = DeltaOutput(kVersion + 1, 1);
+  EXPECT_FALSE(cache.Apply(&output));
+  EXPECT_FALSE(output.has_candidates());
+  EXPECT_FALSE(output.has_all_candidate_words());
+  EXPECT_FALSE(output.has_candidate_window_delta());
+  EXPECT_EQ(cache.version(), 0);
+}
+
+TEST(CandidateWindowCacheTest, ClearWithoutCandidateWindow) {
+  CandidateWindowCache cache;
+  commands::Output output = FullOutput(0);
+  EXPECT_TRUE(cache.Apply(&output));
+
+  output.Clear();
+  EXPECT_TRUE(cache.Apply(&output));
+  EXPECT_EQ(cache.version(), 0);
+  EXPECT_FALSE(output.has_candidates());
+}
+
+}  // namespace
+}  // namespace client
+}  // namespace mozc
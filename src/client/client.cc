@@ -98,6 +98,7 @@ constexpr absl::Duration kDeleteSessionOnDestructorTimeout = absl::Seconds(1);
 
 Client::Client()
     : id_(0),
+      use_persistent_connection_(false),
       server_launcher_(new ServerLauncher),
       timeout_(kDefaultTimeout),
       server_status_(SERVER_UNKNOWN),
@@ -136,8 +137,14 @@ void Client::InitRequestForSvsJapanese(bool use_svs) {
       variation_types);
 }
 
+void Client::set_persistent_connection(bool enable) {
+  use_persistent_connection_ = enable;
+  persistent_client_.reset();
+}
+
 void Client::SetIPCClientFactory(IPCClientFactoryInterface *client_factory) {
   client_factory_ = client_factory;
+  persistent_client_.reset();
 }
 
 void Client::SetServerLauncher(ServerLauncherInterface *server_launcher) {
@@ -401,6 +408,8 @@ bool Client::EnsureCallCommand(commands::Input *input,
 
   // see the result of Call
   if (server_status_ >= SERVER_TIMEOUT) {
+    // The server may have sent candidate lists which are lost.
+    candidate_window_cache_.Clear();
     return false;
   }
 
@@ -434,6 +443,14 @@ bool Client::EnsureCallCommand(commands::Input *input,
     }
   }
 
+  if (client_capability_.candidate_window_delta() &&
+      !candidate_window_cache_.Apply(output)) {
+    // The candidate window of |output| can't be restored and is not shown.
+    // The cleared cache makes the next input carry version 0, for which the
+    // server sends the full candidate lists again.
+    LOG(WARNING) << "Discarded the candidate window delta";
+    candidate_window_cache_.Clear();
+  }
   PushHistory(*input, *output);
   return true;
 }
@@ -465,6 +482,7 @@ void Client::set_client_capability(const commands::Capability &capability) {
 
 bool Client::CreateSession() {
   id_ = 0;
+  candidate_window_cache_.Clear();
   commands::Input input;
   input.set_type(commands::Input::CREATE_SESSION);
 
@@ -665,8 +683,14 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
   input.SerializeToString(&request);
 
   // Call IPC
-  std::unique_ptr<IPCClientInterface> client(client_factory_->NewClient(
-      kServerAddress, server_launcher_->server_program()));
+  std::unique_ptr<IPCClientInterface> client;
+  if (persistent_client_ != nullptr && persistent_client_->Connected()) {
+    client = std::move(persistent_client_);
+  } else {
+    persistent_client_.reset();
+    client.reset(client_factory_->NewClient(kServerAddress,
+                                            server_launcher_->server_program()));
+  }
 
   // set client protocol version.
   // When an error occurs inside Connected() function,
@@ -704,6 +728,12 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
     return false;
   }
 
+  // The handshake is done only once per connection. When the server declines
+  // it, the connection serves this call and is closed as usual.
+  const bool persistent =
+      use_persistent_connection_ &&
+      client->EnablePersistentConnection(timeout_);
+
   // Drop DebugString() as it raises segmentation fault.
   // http://b/2126375
   // TODO(taku): Investigate the error in detail.
@@ -726,6 +756,10 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
     return false;
   }
 
+  if (persistent) {
+    persistent_client_ = std::move(client);
+  }
+
   DCHECK(server_status_ == SERVER_OK ||
          server_status_ == SERVER_INVALID_SESSION ||
          server_status_ == SERVER_SHUTDOWN ||
@@ -755,6 +789,9 @@ void Client::InitInput(commands::Input *input) const {
   if (preferences_ != nullptr) {
     *input->mutable_config() = *preferences_;
   }
+  if (client_capability_.candidate_window_delta()) {
+    input->set_candidate_window_version(candidate_window_cache_.version());
+  }
 }
 
 bool Client::CheckVersionOrRestartServerInternal(const commands::Input &input,
@@ -37,6 +37,7 @@
       'target_name': 'client',
       'type': 'static_library',
       'sources': [
+        'candidate_window_cache.cc',
         'client.cc',
         'server_launcher.cc',
       ],
@@ -37,6 +37,7 @@
 #include <string>
 #include <vector>
 
+#include "client/candidate_window_cache.h"
 #include "client/client_interface.h"
 #include "composer/key_event_util.h"
 #include "ipc/ipc.h"
@@ -97,6 +98,11 @@ class Client : public ClientInterface {
   // This function should be called before EnsureSession.
   void InitRequestForSvsJapanese(bool use_svs);
 
+  // Keeps the IPC connection to the server open across the calls if the
+  // server accepts persistent connections. Otherwise every call opens a new
+  // connection as usual.
+  void set_persistent_connection(bool enable);
+
   void SetIPCClientFactory(IPCClientFactoryInterface *client_factory) override;
 
   // set ServerLauncher.
@@ -244,6 +250,9 @@ class Client : public ClientInterface {
 
   uint64_t id_;
   IPCClientFactoryInterface *client_factory_;
+  // The connection reused across the calls. See set_persistent_connection().
+  bool use_persistent_connection_;
+  std::unique_ptr<IPCClientInterface> persistent_client_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<config::Config> preferences_;
   std::unique_ptr<commands::Request> request_;
@@ -259,6 +268,8 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+  // Candidate lists held for Capability::candidate_window_delta.
+  CandidateWindowCache candidate_window_cache_;
 };
 
 }  // namespace client
@@ -27,6 +27,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 
@@ -39,22 +40,27 @@
 #include <unistd.h>
 #endif  // _WIN32
 
+#include <atomic>
 #include <memory>
 #include <ostream>
+#include <string>
 #include <vector>
 
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/thread2.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_client.h"
 #include "session/random_keyevents_generator.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 
 // TODO(taku)
-// 1. multi-thread testing
-// 2. change/config the senario
+// 1. change/config the senario
 
 ABSL_FLAG(int32_t, max_keyevents, 100000,
           "test at most |max_keyevents| key sequences");
@@ -62,12 +68,116 @@ ABSL_FLAG(std::string, server_path, "", "specify server path");
 ABSL_FLAG(int32_t, key_duration, 10, "key duration (msec)");
 ABSL_FLAG(bool, test_renderer, false, "test renderer");
 ABSL_FLAG(bool, test_testsendkey, true, "test TestSendKey");
+ABSL_FLAG(std::string, throughput_clients, "",
+          "comma separated numbers of concurrent clients, e.g. \"1,2,4,8\". "
+          "If set, measures the throughput of SendKey with each number of "
+          "clients instead of running the stress test.");
+ABSL_FLAG(int32_t, throughput_keyevents, 1000,
+          "number of key events sent by each client in the throughput test");
+ABSL_FLAG(bool, throughput_persistent, false,
+          "keep the IPC connection of each client open in the throughput "
+          "test. The server needs --ipc_workers to accept it.");
+
+namespace mozc {
+namespace {
+
+struct ThroughputResult {
+  int64_t keyevents = 0;
+  int64_t failures = 0;
+  absl::Duration elapsed;
+  absl::Duration max_latency;
+};
+
+// Sends key events from |num_clients| clients, each with its own session, at
+// the same time without waiting between the key events.
+ThroughputResult MeasureThroughput(int num_clients) {
+  const int32_t keyevents_per_client =
+      absl::GetFlag(FLAGS_throughput_keyevents);
+  std::atomic<int64_t> failures = 0;
+  std::vector<absl::Duration> max_latencies(num_clients);
+  std::vector<Thread2> threads;
+  threads.reserve(num_clients);
+
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < num_clients; ++i) {
+    threads.emplace_back([i, keyevents_per_client, &failures,
+                          &max_latencies] {
+      client::Client client;
+      if (!absl::GetFlag(FLAGS_server_path).empty()) {
+        client.set_server_program(absl::GetFlag(FLAGS_server_path));
+      }
+      client.set_persistent_connection(
+          absl::GetFlag(FLAGS_throughput_persistent));
+      CHECK(client.EnsureSession()) << "EnsureSession failed";
+
+      session::RandomKeyEventsGenerator key_events_generator;
+      std::vector<commands::KeyEvent> keys;
+      commands::Output output;
+      int32_t sent = 0;
+      while (sent < keyevents_per_client) {
+        key_events_generator.GenerateSequence(&keys);
+        for (const commands::KeyEvent &key : keys) {
+          if (sent++ >= keyevents_per_client) {
+            break;
+          }
+          const absl::Time begin = absl::Now();
+          if (!client.SendKey(key, &output)) {
+            ++failures;
+          }
+          max_latencies[i] = std::max(max_latencies[i], absl::Now() - begin);
+        }
+      }
+    });
+  }
+  for (Thread2 &thread : threads) {
+    thread.Join();
+  }
+
+  ThroughputResult result;
+  result.elapsed = absl::Now() - start;
+  result.keyevents = static_cast<int64_t>(num_clients) * keyevents_per_client;
+  result.failures = failures;
+  for (const absl::Duration latency : max_latencies) {
+    result.max_latency = std::max(result.max_latency, latency);
+  }
+  return result;
+}
+
+int RunThroughputTest() {
+  std::cout << "clients\tkeyevents\tfailures\telapsed_ms\tkeyevents_per_sec"
+               "\tmax_latency_ms"
+            << std::endl;
+  for (const absl::string_view count :
+       absl::StrSplit(absl::GetFlag(FLAGS_throughput_clients), ',',
+                      absl::SkipEmpty())) {
+    int num_clients = 0;
+    if (!absl::SimpleAtoi(count, &num_clients) || num_clients <= 0) {
+      LOG(ERROR) << "Invalid number of clients: " << count;
+      return 1;
+    }
+    const ThroughputResult result = MeasureThroughput(num_clients);
+    std::cout << num_clients << "\t" << result.keyevents << "\t"
+              << result.failures << "\t"
+              << absl::ToInt64Milliseconds(result.elapsed) << "\t"
+              << result.keyevents / absl::ToDoubleSeconds(result.elapsed)
+              << "\t" << absl::ToDoubleMilliseconds(result.max_latency)
+              << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv);
 
   absl::SetFlag(&FLAGS_logtostderr, true);
 
+  if (!absl::GetFlag(FLAGS_throughput_clients).empty()) {
+    return mozc::RunThroughputTest();
+  }
+
   mozc::client::Client client;
   if (!absl::GetFlag(FLAGS_server_path).empty()) {
     client.set_server_program(absl::GetFlag(FLAGS_server_path));
@@ -271,6 +271,47 @@ TEST_F(ClientTest, SendKey) {
   EXPECT_EQ(input.type(), commands::Input::SEND_KEY);
 }
 
+TEST_F(ClientTest, CandidateWindowDeltaForUnknownVersion) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+  commands::Capability capability;
+  capability.set_candidate_window_delta(true);
+  client_->set_client_capability(capability);
+
+  commands::KeyEvent key_event;
+  key_event.set_key_code('a');
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_candidate_window_version(1);
+  mock_output.mutable_candidates()->set_size(0);
+  mock_output.mutable_candidates()->set_position(0);
+  SetMockOutput(mock_output);
+  commands::Output output;
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  EXPECT_TRUE(output.has_candidates());
+
+  // The delta is for the lists which the client doesn't hold.
+  mock_output.Clear();
+  mock_output.set_id(mock_id);
+  mock_output.set_candidate_window_version(2);
+  mock_output.mutable_candidate_window_delta();
+  SetMockOutput(mock_output);
+  output.Clear();
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  EXPECT_FALSE(output.has_candidates());
+  EXPECT_FALSE(output.has_candidate_window_delta());
+
+  // The next input asks the server for the full lists.
+  mock_output.Clear();
+  mock_output.set_id(mock_id);
+  SetMockOutput(mock_output);
+  output.Clear();
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  commands::Input input;
+  GetGeneratedInput(&input);
+  EXPECT_EQ(input.candidate_window_version(), 0);
+}
+
 TEST_F(ClientTest, SendKeyWithContext) {
   const int mock_id = 123;
   EXPECT_TRUE(SetupConnection(mock_id));
@@ -37,6 +37,7 @@
       'target_name': 'client_test',
       'type': 'executable',
       'sources': [
+        'candidate_window_cache_test.cc',
         'client_test.cc',
       ],
       'dependencies': [
@@ -31,6 +31,7 @@
 
 #include "composer/composer.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <set>
@@ -44,6 +45,7 @@
 #include "base/logging.h"
 #include "base/strings/unicode.h"
 #include "base/util.h"
+#include "composer/internal/char_chunk.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
 #include "composer/internal/mode_switching_handler.h"
@@ -57,6 +59,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "transliteration/transliteration.h"
+#include "usage_stats/latency_stats.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -755,6 +758,10 @@ void Composer::GetStringForSubmission(std::string *output) const {
 }
 
 void Composer::GetQueryForConversion(std::string *output) const {
+  static const usage_stats::LatencyStats::StageId kStage =
+      usage_stats::LatencyStats::RegisterStage(
+          "Composer.GetQueryForConversion");
+  usage_stats::ScopedLatencyRecorder recorder(kStage);
   std::string base_output;
   composition_.GetStringWithTrimMode(FIX, &base_output);
   TransformCharactersForNumbers(&base_output);
@@ -820,6 +827,10 @@ std::string *GetBaseQueryForPrediction(std::string *asis_query,
 }  // namespace
 
 void Composer::GetQueryForPrediction(std::string *output) const {
+  static const usage_stats::LatencyStats::StageId kStage =
+      usage_stats::LatencyStats::RegisterStage(
+          "Composer.GetQueryForPrediction");
+  usage_stats::ScopedLatencyRecorder recorder(kStage);
   std::string asis_query;
   composition_.GetStringWithTrimMode(ASIS, &asis_query);
 
@@ -889,6 +900,47 @@ void Composer::GetTypeCorrectedQueriesForPrediction(
   }
 }
 
+std::vector<std::string> Composer::GetPendingCompletions(
+    const size_t max_size) const {
+  std::vector<std::string> completions;
+  if (table_ == nullptr || position_ != GetLength() ||
+      composition_.chunks().empty()) {
+    return completions;
+  }
+  const std::string &pending = composition_.chunks().back()->pending();
+  if (pending.empty()) {
+    return completions;
+  }
+  std::vector<const Entry *> entries;
+  table_->LookUpPredictiveAll(pending, &entries);
+
+  // Inputs fixing the pending characters, e.g. "a" of "ka", precede the
+  // others, e.g. "y" of "kya".
+  std::vector<std::pair<bool, std::string>> nexts;
+  for (const Entry *entry : entries) {
+    const absl::string_view input = entry->input();
+    if (input.size() <= pending.size()) {
+      continue;
+    }
+    const bool fixes_pending =
+        (input.size() == pending.size() + 1 && entry->pending().empty());
+    nexts.emplace_back(
+        !fixes_pending,
+        Util::Utf8SubString(input.substr(pending.size()), 0, 1));
+  }
+  std::sort(nexts.begin(), nexts.end());
+  for (const auto &[unused, next] : nexts) {
+    if (completions.size() >= max_size) {
+      break;
+    }
+    if (std::find(completions.begin(), completions.end(), next) ==
+        completions.end()) {
+      completions.push_back(next);
+    }
+  }
+  return completions;
+}
+
 size_t Composer::GetLength() const { return composition_.GetLength(); }
 
 size_t Composer::GetCursor() const { return position_; }
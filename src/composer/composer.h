@@ -133,6 +133,12 @@ class Composer final {
   void GetTypeCorrectedQueriesForPrediction(
       std::vector<TypeCorrectedQuery> *queries) const;
 
+  // Returns the next inputs completing the pending characters at the end of
+  // the composition, e.g. "a", "e", "i", ... for the pending "k".  The inputs
+  // fixing the pending characters come first, and each group is sorted.  At
+  // most |max_size| inputs are returned.
+  std::vector<std::string> GetPendingCompletions(size_t max_size) const;
+
   size_t GetLength() const;
   size_t GetCursor() const;
   void EditErase();
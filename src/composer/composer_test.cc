@@ -48,6 +48,7 @@
 #include "data_manager/testing/mock_data_manager.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "absl/strings/string_view.h"
 
@@ -62,6 +63,7 @@ using KeyEvent = ::mozc::commands::KeyEvent;
 using ProbableKeyEvent = ::mozc::commands::KeyEvent::ProbableKeyEvent;
 using ProbableKeyEvents = ::mozc::protobuf::RepeatedPtrField<ProbableKeyEvent>;
 using Request = ::mozc::commands::Request;
+using ::testing::ElementsAre;
 
 bool InsertKey(const absl::string_view key_string, Composer *composer) {
   commands::KeyEvent key;
@@ -599,6 +601,27 @@ TEST_F(ComposerTest, GetQueriesForPredictionRoman) {
   }
 }
 
+TEST_F(ComposerTest, GetPendingCompletions) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("ki", "き", "");
+  table_->AddRule("kk", "っ", "k");
+  table_->AddRule("kya", "きゃ", "");
+  table_->AddRule("ku", "く", "");
+  table_->AddRule("a", "あ", "");
+
+  composer_->InsertCharacter("a");
+  EXPECT_TRUE(composer_->GetPendingCompletions(10).empty());
+
+  composer_->InsertCharacter("k");
+  EXPECT_THAT(composer_->GetPendingCompletions(10),
+              ElementsAre("a", "i", "u", "k", "y"));
+  EXPECT_THAT(composer_->GetPendingCompletions(2), ElementsAre("a", "i"));
+
+  // No completion when the cursor isn't at the end.
+  composer_->MoveCursorToBeginning();
+  EXPECT_TRUE(composer_->GetPendingCompletions(10).empty());
+}
+
 TEST_F(ComposerTest, GetQueriesForPredictionMobile) {
   table_->AddRule("_", "", "い");
   table_->AddRule("い*", "", "ぃ");
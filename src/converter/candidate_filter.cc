@@ -35,9 +35,11 @@
 #include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <iterator>
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -49,6 +51,7 @@
 #include "protocol/commands.pb.h"
 #include "request/conversion_request.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 using mozc::dictionary::PosMatcher;
 using mozc::dictionary::SuppressionDictionary;
@@ -215,9 +218,20 @@ bool IsStrictModeEnabled(const ConversionRequest &request) {
   return request.request().mixed_conversion();
 }
 
-std::string CandidateId(const Segment::Candidate &candidate) {
-  return absl::StrCat(candidate.value, "\t", candidate.lid, "\t",
-                      candidate.rid);
+// Returns the id of a candidate in the seen set.  Candidates are identified
+// by value, lid and rid, where the value is the concatenation of
+// |value_pieces|.  The id of a candidate and that of the node path it is built
+// from are the same.
+uint64_t CandidateId(absl::Span<const absl::string_view> value_pieces,
+                     uint16_t lid, uint16_t rid) {
+  return Hash::FingerprintConcatWithSeed(
+      value_pieces, (static_cast<uint32_t>(lid) << 16) | rid);
+}
+
+uint64_t CandidateId(const Segment::Candidate &candidate) {
+  const absl::string_view value = candidate.value;
+  return CandidateId(absl::MakeConstSpan(&value, 1), candidate.lid,
+                     candidate.rid);
 }
 
 }  // namespace
@@ -244,6 +258,49 @@ void CandidateFilter::Reset() {
   top_candidate_ = nullptr;
 }
 
+bool CandidateFilter::IsSeen(uint64_t id) const {
+  return std::binary_search(seen_.begin(), seen_.end(), id);
+}
+
+bool CandidateFilter::InsertSeen(uint64_t id) {
+  const auto it = std::lower_bound(seen_.begin(), seen_.end(), id);
+  if (it != seen_.end() && *it == id) {
+    return false;
+  }
+  seen_.insert(it, id);
+  return true;
+}
+
+bool CandidateFilter::IsDuplicatePath(
+    const ConversionRequest &request, uint32_t attributes,
+    const std::vector<const Node *> &nodes) const {
+  DCHECK(!nodes.empty());
+  if (seen_.empty()) {
+    return false;
+  }
+  if (request.request_type() != ConversionRequest::REVERSE_CONVERSION) {
+    // Mirror the checks of FilterCandidateInternal() that run before the
+    // "already seen" rule and may accept the candidate or stop the
+    // enumeration.  Everything else rejects the candidate anyway.
+    if (top_candidate_ == nullptr ||
+        (attributes & (Segment::Candidate::CONTEXT_SENSITIVE |
+                       Segment::Candidate::USER_DICTIONARY)) ||
+        seen_.size() + 1 >= kMaxCandidatesSize) {
+      return false;
+    }
+  }
+  absl::string_view value_pieces[8];
+  if (nodes.size() > std::size(value_pieces)) {
+    // Long paths are rare.  Leave them to FilterCandidate().
+    return false;
+  }
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    value_pieces[i] = nodes[i]->value;
+  }
+  return IsSeen(CandidateId(absl::MakeConstSpan(value_pieces, nodes.size()),
+                            nodes.front()->lid, nodes.back()->rid));
+}
+
 CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
     const ConversionRequest &request, const std::string &original_key,
     const Segment::Candidate *candidate,
@@ -355,7 +412,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // The candidate is already seen.
-  if (seen_.find(CandidateId(*candidate)) != seen_.end()) {
+  if (IsSeen(CandidateId(*candidate))) {
     MOZC_CANDIDATE_LOG(candidate, "already seen");
     return CandidateFilter::BAD_CANDIDATE;
   }
@@ -627,15 +684,15 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     // In reverse conversion, only remove duplicates because the filtering
     // criteria of FilterCandidateInternal() are completely designed for
     // (forward) conversion.
-    const bool inserted = seen_.insert(CandidateId(*candidate)).second;
-    return inserted ? GOOD_CANDIDATE : BAD_CANDIDATE;
+    return InsertSeen(CandidateId(*candidate)) ? GOOD_CANDIDATE
+                                                : BAD_CANDIDATE;
   } else {
     const ResultType result = FilterCandidateInternal(
         request, original_key, candidate, top_nodes, nodes);
     if (result != GOOD_CANDIDATE) {
       return result;
     }
-    seen_.insert(CandidateId(*candidate));
+    InsertSeen(CandidateId(*candidate));
     return result;
   }
 }
@@ -30,7 +30,7 @@
 #ifndef MOZC_CONVERTER_CANDIDATE_FILTER_H_
 #define MOZC_CONVERTER_CANDIDATE_FILTER_H_
 
-#include <set>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -74,7 +74,16 @@ class CandidateFilter {
                              const std::vector<const Node *> &top_nodes,
                              const std::vector<const Node *> &nodes);
 
-  // Resets the internal state.
+  // Returns true if the candidate built from |nodes| is a duplicate of an
+  // already accepted candidate and FilterCandidate() is known to reject it.
+  // |attributes| are the candidate attributes derived from |nodes|.  This
+  // check only looks at the node values and POS ids, so the caller can skip
+  // building the candidate strings for such paths.
+  bool IsDuplicatePath(const ConversionRequest &request, uint32_t attributes,
+                       const std::vector<const Node *> &nodes) const;
+
+  // Resets the internal state.  The memory for the seen set is kept so that
+  // the filter can be reused for the next segment without reallocation.
   void Reset();
 
  private:
@@ -84,11 +93,18 @@ class CandidateFilter {
                                      const std::vector<const Node *> &top_nodes,
                                      const std::vector<const Node *> &nodes);
 
+  bool IsSeen(uint64_t id) const;
+  // Returns false if |id| is already in the set.
+  bool InsertSeen(uint64_t id);
+
   const dictionary::SuppressionDictionary *suppression_dictionary_;
   const dictionary::PosMatcher *pos_matcher_;
   const SuggestionFilter *suggestion_filter_;
 
-  std::set<std::string> seen_;
+  // Fingerprints of the accepted candidates (value, lid and rid), kept sorted.
+  // The set holds at most a few hundred entries, for which a flat sorted
+  // vector is faster than a node-based set and can be reused across segments.
+  std::vector<uint64_t> seen_;
   const Segment::Candidate *top_candidate_;
   bool apply_suggestion_filter_for_exact_match_;
 };
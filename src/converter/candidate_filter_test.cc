@@ -48,6 +48,7 @@
 #include "request/conversion_request.h"
 #include "session/request_test_util.h"
 #include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 
 namespace mozc {
@@ -301,6 +302,49 @@ TEST_P(CandidateFilterTestWithParam, DeduplicationTest) {
   }
 }
 
+TEST_P(CandidateFilterTestWithParam, IsDuplicatePath) {
+  std::unique_ptr<CandidateFilter> filter(CreateCandidateFilter(true));
+
+  ConversionRequest::RequestType type = GetParam();
+  request_->set_request_type(type);
+
+  std::vector<const Node *> n;
+  GetDefaultNodes(&n);
+
+  // Nothing is seen yet.
+  EXPECT_FALSE(filter->IsDuplicatePath(*request_, 0, n));
+
+  Segment::Candidate *cand = NewCandidate();
+  cand->lid = n.front()->lid;
+  cand->rid = n.back()->rid;
+  cand->key = "てすとてすと";
+  cand->value = "てすとてすと";
+  EXPECT_EQ(filter->FilterCandidate(*request_, "てすとてすと", cand, n, n),
+            CandidateFilter::GOOD_CANDIDATE);
+  EXPECT_TRUE(filter->IsDuplicatePath(*request_, 0, n));
+
+  // The path is identified by the concatenated value, lid and rid, regardless
+  // of its segmentation.
+  {
+    Node *node = NewNode();
+    node->value = "てすとてすと";
+    node->lid = n.front()->lid;
+    node->rid = n.back()->rid;
+    EXPECT_TRUE(filter->IsDuplicatePath(*request_, 0, {node}));
+    node->rid = n.front()->rid;
+    EXPECT_FALSE(filter->IsDuplicatePath(*request_, 0, {node}));
+  }
+
+  // User dictionary and context sensitive candidates are not deduplicated.
+  EXPECT_FALSE(filter->IsDuplicatePath(
+      *request_, Segment::Candidate::USER_DICTIONARY, n));
+  EXPECT_FALSE(filter->IsDuplicatePath(
+      *request_, Segment::Candidate::CONTEXT_SENSITIVE, n));
+
+  filter->Reset();
+  EXPECT_FALSE(filter->IsDuplicatePath(*request_, 0, n));
+}
+
 TEST_P(CandidateFilterTestWithParam, KatakanaT13N) {
   ConversionRequest::RequestType type = GetParam();
   request_->set_request_type(type);
@@ -1099,10 +1143,10 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterConversion) {
     nodes.push_back(n);
 
     Segment::Candidate *c = NewCandidate();
-    c->key = n->key;
-    c->value = n->value;
-    c->content_key = n->key;
-    c->content_value = n->value;
+    c->key = std::string(n->key);
+    c->value = std::string(n->value);
+    c->content_key = std::string(n->key);
+    c->content_value = std::string(n->value);
     c->cost = 1000;
     c->structure_cost = 2000;
 
@@ -1127,10 +1171,10 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterSuggestion) {
     nodes.push_back(n);
 
     Segment::Candidate *c = NewCandidate();
-    c->key = n->key;
-    c->value = n->value;
-    c->content_key = n->key;
-    c->content_value = n->value;
+    c->key = std::string(n->key);
+    c->value = std::string(n->value);
+    c->content_key = std::string(n->key);
+    c->content_value = std::string(n->value);
     c->cost = 1000;
     c->structure_cost = 2000;
 
@@ -1139,7 +1183,7 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterSuggestion) {
               CandidateFilter::BAD_CANDIDATE);
     filter->Reset();
     // Test case where "フィルター" is suggested from key "ふぃるたー".
-    EXPECT_EQ(filter->FilterCandidate(*request_, n->key, c, nodes, nodes),
+    EXPECT_EQ(filter->FilterCandidate(*request_, c->key, c, nodes, nodes),
               CandidateFilter::BAD_CANDIDATE);
   }
   // Next test bigram case.
@@ -1159,8 +1203,8 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterSuggestion) {
     nodes.push_back(n2);
 
     Segment::Candidate *c = NewCandidate();
-    c->key.assign(n1->key).append(n2->key);
-    c->value.assign(n1->value).append(n2->value);
+    c->key = absl::StrCat(n1->key, n2->key);
+    c->value = absl::StrCat(n1->value, n2->value);
     c->content_key = c->key;
     c->content_value = c->value;
     c->cost = 1000;
@@ -1198,8 +1242,8 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterSuggestion) {
     nodes.push_back(n3);
 
     Segment::Candidate *c = NewCandidate();
-    c->key.assign(n1->key).append(n2->key).append(n3->key);
-    c->value.assign(n1->value).append(n2->value).append(n3->value);
+    c->key = absl::StrCat(n1->key, n2->key, n3->key);
+    c->value = absl::StrCat(n1->value, n2->value, n3->value);
     c->content_key = c->key;
     c->content_value = c->value;
     c->cost = 1000;
@@ -1231,10 +1275,10 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterSuggestionMobile) {
     nodes.push_back(n);
 
     Segment::Candidate *c = NewCandidate();
-    c->key = n->key;
-    c->value = n->value;
-    c->content_key = n->key;
-    c->content_value = n->value;
+    c->key = std::string(n->key);
+    c->value = std::string(n->value);
+    c->content_key = std::string(n->key);
+    c->content_value = std::string(n->value);
     c->cost = 1000;
     c->structure_cost = 2000;
 
@@ -1243,7 +1287,7 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterSuggestionMobile) {
               CandidateFilter::BAD_CANDIDATE);
     filter->Reset();
     // Test case where "フィルター" is suggested from key "ふぃるたー".
-    EXPECT_EQ(filter->FilterCandidate(*request_, n->key, c, nodes, nodes),
+    EXPECT_EQ(filter->FilterCandidate(*request_, c->key, c, nodes, nodes),
               CandidateFilter::GOOD_CANDIDATE);
   }
 }
@@ -1264,10 +1308,10 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterPrediction) {
     nodes.push_back(n);
 
     Segment::Candidate *c = NewCandidate();
-    c->key = n->key;
-    c->value = n->value;
-    c->content_key = n->key;
-    c->content_value = n->value;
+    c->key = std::string(n->key);
+    c->value = std::string(n->value);
+    c->content_key = std::string(n->key);
+    c->content_value = std::string(n->value);
     c->cost = 1000;
     c->structure_cost = 2000;
 
@@ -1278,7 +1322,7 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterPrediction) {
     // difference from the case of SUGGESTION, now words in suggestion filter
     // are good if its key is equal to the original key.
     filter->Reset();
-    EXPECT_EQ(filter->FilterCandidate(*request_, n->key, c, nodes, nodes),
+    EXPECT_EQ(filter->FilterCandidate(*request_, c->key, c, nodes, nodes),
               CandidateFilter::GOOD_CANDIDATE);
   }
   // Next test bigram case.
@@ -1298,8 +1342,8 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterPrediction) {
     nodes.push_back(n2);
 
     Segment::Candidate *c = NewCandidate();
-    c->key.assign(n1->key).append(n2->key);
-    c->value.assign(n1->value).append(n2->value);
+    c->key = absl::StrCat(n1->key, n2->key);
+    c->value = absl::StrCat(n1->value, n2->value);
     c->content_key = c->key;
     c->content_value = c->value;
     c->cost = 1000;
@@ -1338,8 +1382,8 @@ TEST_F(CandidateFilterTest, CapabilityOfSuggestionFilterPrediction) {
     nodes.push_back(n3);
 
     Segment::Candidate *c = NewCandidate();
-    c->key.assign(n1->key).append(n2->key).append(n3->key);
-    c->value.assign(n1->value).append(n2->value).append(n3->value);
+    c->key = absl::StrCat(n1->key, n2->key, n3->key);
+    c->value = absl::StrCat(n1->value, n2->value, n3->value);
     c->content_key = c->key;
     c->content_value = c->value;
     c->cost = 1000;
@@ -1376,8 +1420,8 @@ TEST_F(CandidateFilterTest, ReverseConversion) {
 
   {
     Segment::Candidate *c = NewCandidate();
-    c->key.assign(n1->key);
-    c->value.assign(n1->value);
+    c->key = std::string(n1->key);
+    c->value = std::string(n1->value);
     c->content_key = c->key;
     c->content_value = c->value;
     c->cost = 1000;
@@ -1391,8 +1435,8 @@ TEST_F(CandidateFilterTest, ReverseConversion) {
   {
     // White space should be valid candidate.
     Segment::Candidate *c = NewCandidate();
-    c->key.assign(n2->key);
-    c->value.assign(n2->value);
+    c->key = std::string(n2->key);
+    c->value = std::string(n2->value);
     c->content_key = c->key;
     c->content_value = c->value;
     c->cost = 1000;
@@ -40,11 +40,16 @@
 #include "base/util.h"
 #include "data_manager/data_manager_interface.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
+ABSL_FLAG(int32_t, connector_dense_row_size, 0,
+          "Number of rows of the connection matrix decoded into a dense table "
+          "at startup. -1 decodes the whole matrix.");
 
 namespace mozc {
 namespace {
@@ -52,6 +57,8 @@ namespace {
 constexpr uint32_t kInvalidCacheKey = 0xFFFFFFFF;
 constexpr uint16_t kConnectorMagicNumber = 0xCDAB;
 constexpr uint8_t kInvalid1ByteCostValue = 255;
+// Value in the dense table indicating that the default cost of the row is used.
+constexpr uint16_t kDenseDefaultValue = 0xFFFF;
 
 inline uint32_t GetHashValue(uint16_t rid, uint16_t lid, uint32_t hash_mask) {
   return (3 * static_cast<uint32_t>(rid) + lid) & hash_mask;
@@ -177,13 +184,16 @@ absl::StatusOr<std::unique_ptr<Connector>> Connector::CreateFromDataManager(
   const char *connection_data = nullptr;
   size_t connection_data_size = 0;
   data_manager.GetConnectorData(&connection_data, &connection_data_size);
-  return Create(connection_data, connection_data_size, kCacheSize);
+  return Create(connection_data, connection_data_size, kCacheSize,
+                absl::GetFlag(FLAGS_connector_dense_row_size));
 }
 
 absl::StatusOr<std::unique_ptr<Connector>> Connector::Create(
-    const char *connection_data, size_t connection_size, int cache_size) {
+    const char *connection_data, size_t connection_size, int cache_size,
+    int dense_row_size) {
   auto connector = std::make_unique<Connector>();
-  auto status = connector->Init(connection_data, connection_size, cache_size);
+  auto status = connector->Init(connection_data, connection_size, cache_size,
+                                dense_row_size);
   if (!status.ok()) {
     return status;
   }
@@ -191,7 +201,8 @@ absl::StatusOr<std::unique_ptr<Connector>> Connector::Create(
 }
 
 absl::Status Connector::Init(const char *connection_data,
-                             size_t connection_size, int cache_size) {
+                             size_t connection_size, int cache_size,
+                             int dense_row_size) {
   // Check if the cache_size is the power of 2.
   if ((cache_size & (cache_size - 1)) != 0) {
     return absl::InvalidArgumentError(absl::StrCat(
@@ -297,14 +308,54 @@ absl::Status Connector::Init(const char *connection_data,
   }
   VALIDATE_SIZE(ptr, 0, "Data end");
   ClearCache();
-  return absl::Status();
+  return InitDenseRows(rsize, metadata->lsize, dense_row_size);
 
 #undef VALIDATE_ALIGNMENT
 #undef VALIDATE_SIZE
 }
 
+absl::Status Connector::InitDenseRows(uint16_t rsize, uint16_t lsize,
+                                      int dense_row_size) {
+  if (dense_row_size == kAllRows) {
+    dense_row_size = rsize;
+  }
+  if (dense_row_size < 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "connector.cc: Invalid dense row size: ", dense_row_size));
+  }
+  dense_row_size_ = std::min<size_t>(dense_row_size, rsize);
+  lsize_ = lsize;
+  if (dense_row_size_ == 0) {
+    dense_values_.reset();
+    return absl::Status();
+  }
+
+  // The table stores the values before being multiplied by the resolution, so
+  // that every cost fits in 16 bits.
+  dense_values_ = std::make_unique<uint16_t[]>(dense_row_size_ * lsize_);
+  uint16_t *values = dense_values_.get();
+  for (size_t rid = 0; rid < dense_row_size_; ++rid) {
+    for (size_t lid = 0; lid < lsize_; ++lid) {
+      uint16_t value;
+      if (!rows_[rid].GetValue(lid, &value)) {
+        value = kDenseDefaultValue;
+      } else if (value == kDenseDefaultValue) {
+        return absl::FailedPreconditionError(absl::StrCat(
+            "connector.cc: Cost value collides with the dense table marker: "
+            "rid=",
+            rid, ", lid=", lid));
+      }
+      *values++ = value;
+    }
+  }
+  return absl::Status();
+}
+
 
 int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
+  if (rid < dense_row_size_) {
+    return LookupDenseCost(rid, lid);
+  }
   const uint32_t index = EncodeKey(rid, lid);
   const uint32_t bucket = GetHashValue(rid, lid, cache_hash_mask_);
   if (cache_key_[bucket] == index) {
@@ -316,6 +367,20 @@ int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
   return value;
 }
 
+void Connector::GetTransitionCosts(uint16_t rid,
+                                   absl::Span<const uint16_t> lids,
+                                   int *costs) const {
+  if (rid < dense_row_size_) {
+    for (const uint16_t lid : lids) {
+      *costs++ = LookupDenseCost(rid, lid);
+    }
+    return;
+  }
+  for (const uint16_t lid : lids) {
+    *costs++ = GetTransitionCost(rid, lid);
+  }
+}
+
 int Connector::GetResolution() const { return resolution_; }
 
 void Connector::ClearCache() {
@@ -330,4 +395,12 @@ int Connector::LookupCost(uint16_t rid, uint16_t lid) const {
   return value * resolution_;
 }
 
+int Connector::LookupDenseCost(uint16_t rid, uint16_t lid) const {
+  const uint16_t value = dense_values_[rid * lsize_ + lid];
+  if (value == kDenseDefaultValue) {
+    return default_cost_[rid];
+  }
+  return value * resolution_;
+}
+
 }  // namespace mozc
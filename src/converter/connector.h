@@ -38,6 +38,7 @@
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -45,11 +46,25 @@ class Connector final {
  public:
   static constexpr int16_t kInvalidCost = 30000;
 
+  // Value for |dense_row_size| to decode the whole matrix.
+  static constexpr int kAllRows = -1;
+
+  // Creates a connector from the connection data of |data_manager|.  The
+  // number of dense rows is taken from --connector_dense_row_size.
   static absl::StatusOr<std::unique_ptr<Connector>> CreateFromDataManager(
       const DataManagerInterface &data_manager);
 
+  // Creates a connector from |connection_data|.  |cache_size| must be 2^n.
+  //
+  // The first |dense_row_size| rows of the matrix, i.e., rid in [0,
+  // dense_row_size), are decoded into a dense table at creation time so that
+  // their costs are looked up in O(1) without decoding the compact format.
+  // Frequent POSs have smaller IDs, so a few hundred rows cover most of the
+  // lookups.  The table takes 2 * lsize bytes per row (about 14MB for the
+  // whole OSS matrix).  Pass kAllRows to decode all the rows.
   static absl::StatusOr<std::unique_ptr<Connector>> Create(
-      const char *connection_data, size_t connection_size, int cache_size);
+      const char *connection_data, size_t connection_size, int cache_size,
+      int dense_row_size = 0);
 
   Connector() = default;
 
@@ -57,6 +72,13 @@ class Connector final {
   Connector &operator=(const Connector &) = delete;
 
   int GetTransitionCost(uint16_t rid, uint16_t lid) const;
+
+  // Stores the transition costs from |rid| to each of |lids| to |costs|, i.e.,
+  // costs[i] = GetTransitionCost(rid, lids[i]).
+  // REQUIRES: |costs| has at least lids.size() elements.
+  void GetTransitionCosts(uint16_t rid, absl::Span<const uint16_t> lids,
+                          int *costs) const;
+
   int GetResolution() const;
 
   void ClearCache();
@@ -65,13 +87,21 @@ class Connector final {
   class Row;
 
   absl::Status Init(const char *connection_data, size_t connection_size,
-                    int cache_size);
+                    int cache_size, int dense_row_size);
+  absl::Status InitDenseRows(uint16_t rsize, uint16_t lsize,
+                             int dense_row_size);
 
   int LookupCost(uint16_t rid, uint16_t lid) const;
+  int LookupDenseCost(uint16_t rid, uint16_t lid) const;
 
   std::unique_ptr<Row[]> rows_;
   const uint16_t *default_cost_ = nullptr;
   int resolution_ = 0;
+  // Decoded values of the first |dense_row_size_| rows in row-major order.
+  // See LookupDenseCost() for the encoding.
+  std::unique_ptr<uint16_t[]> dense_values_;
+  size_t dense_row_size_ = 0;
+  size_t lsize_ = 0;
   int cache_size_ = 0;
   uint32_t cache_hash_mask_ = 0;
   mutable std::unique_ptr<uint32_t[]> cache_key_;
@@ -92,6 +92,67 @@ TEST(ConnectorTest, CompareWithRawData) {
   }
 }
 
+TEST(ConnectorTest, DenseRows) {
+  const std::string path = testing::GetSourceFileOrDie(
+      {"data_manager", "testing", "connection.data"});
+  absl::StatusOr<Mmap> cmmap = Mmap::Map(path);
+  ASSERT_OK(cmmap) << cmmap.status();
+  absl::StatusOr<std::unique_ptr<Connector>> compact =
+      Connector::Create(cmmap->begin(), cmmap->size(), 256);
+  ASSERT_OK(compact) << compact.status();
+
+  const std::string connection_text_path = testing::GetSourceFileOrDie(
+      {"data_manager", "testing", "connection_single_column.txt"});
+  std::vector<ConnectionDataEntry> data;
+  for (ConnectionFileReader reader(connection_text_path); !reader.done();
+       reader.Next()) {
+    data.push_back({static_cast<uint16_t>(reader.rid_of_left_node()),
+                    static_cast<uint16_t>(reader.lid_of_right_node()),
+                    reader.cost()});
+  }
+
+  for (int dense_row_size : {1, 10, Connector::kAllRows}) {
+    SCOPED_TRACE(dense_row_size);
+    absl::StatusOr<std::unique_ptr<Connector>> dense = Connector::Create(
+        cmmap->begin(), cmmap->size(), 256, dense_row_size);
+    ASSERT_OK(dense) << dense.status();
+    for (const ConnectionDataEntry &entry : data) {
+      const int cost = (*dense)->GetTransitionCost(entry.rid, entry.lid);
+      EXPECT_EQ(cost, entry.cost);
+      EXPECT_EQ(cost, (*compact)->GetTransitionCost(entry.rid, entry.lid));
+    }
+  }
+
+  EXPECT_FALSE(
+      Connector::Create(cmmap->begin(), cmmap->size(), 256, -2).ok());
+}
+
+TEST(ConnectorTest, GetTransitionCosts) {
+  const std::string path = testing::GetSourceFileOrDie(
+      {"data_manager", "testing", "connection.data"});
+  absl::StatusOr<Mmap> cmmap = Mmap::Map(path);
+  ASSERT_OK(cmmap) << cmmap.status();
+
+  std::vector<uint16_t> lids;
+  for (uint16_t lid = 0; lid < 100; ++lid) {
+    lids.push_back(lid);
+  }
+  std::vector<int> costs(lids.size());
+
+  for (int dense_row_size : {0, 5}) {
+    SCOPED_TRACE(dense_row_size);
+    absl::StatusOr<std::unique_ptr<Connector>> connector = Connector::Create(
+        cmmap->begin(), cmmap->size(), 256, dense_row_size);
+    ASSERT_OK(connector) << connector.status();
+    for (uint16_t rid = 0; rid < 10; ++rid) {
+      (*connector)->GetTransitionCosts(rid, lids, costs.data());
+      for (size_t i = 0; i < lids.size(); ++i) {
+        EXPECT_EQ(costs[i], (*connector)->GetTransitionCost(rid, lids[i]));
+      }
+    }
+  }
+}
+
 TEST(ConnectorTest, BrokenData) {
   const std::string path = testing::GetSourceFileOrDie(
       {"data_manager", "testing", "connection.data"});
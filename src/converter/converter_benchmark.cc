@@ -0,0 +1,242 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/converter_benchmark.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/stopwatch.h"
+#include "base/thread2.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/benchmark_util.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif  // _WIN32
+
+namespace mozc {
+namespace {
+
+struct ThreadResult {
+  std::vector<absl::Duration> latencies;
+  size_t num_failures = 0;
+};
+
+bool Convert(const ConverterInterface &converter,
+             const ConversionRequest &conversion_request,
+             ConversionRequest::RequestType type, Segments *segments) {
+  switch (type) {
+    case ConversionRequest::PREDICTION:
+      return converter.StartPredictionForRequest(conversion_request, segments);
+    case ConversionRequest::SUGGESTION:
+      return converter.StartSuggestionForRequest(conversion_request, segments);
+    default:
+      return converter.StartConversionForRequest(conversion_request, segments);
+  }
+}
+
+void RunThread(const ConverterInterface &converter,
+               absl::Span<const std::string> keys,
+               const commands::Request &request, const config::Config &config,
+               const ConverterBenchmark::Options &options,
+               ThreadResult *result) {
+  result->latencies.reserve(keys.size() * options.iterations);
+  for (int i = 0; i < options.iterations; ++i) {
+    for (const std::string &key : keys) {
+      composer::Composer composer(&composer::Table::GetDefaultTable(),
+                                  &request, &config);
+      composer.SetPreeditTextForTestOnly(key);
+      ConversionRequest conversion_request(&composer, &request, &config);
+      conversion_request.set_request_type(options.request_type);
+      Segments segments;
+
+      const Stopwatch stopwatch = Stopwatch::StartNew();
+      if (!Convert(converter, conversion_request, options.request_type,
+                   &segments)) {
+        ++result->num_failures;
+      }
+      result->latencies.push_back(stopwatch.GetElapsed());
+    }
+  }
+}
+
+// |latencies| must be sorted.
+absl::Duration Percentile(const std::vector<absl::Duration> &latencies,
+                          int percent) {
+  if (latencies.empty()) {
+    return absl::ZeroDuration();
+  }
+  const size_t rank = (latencies.size() * percent + 99) / 100;
+  return latencies[std::max<size_t>(rank, 1) - 1];
+}
+
+}  // namespace
+
+std::string ConverterBenchmark::Result::ToString() const {
+  return absl::StrFormat(
+      "requests: %d\n"
+      "failures: %d\n"
+      "elapsed: %s\n"
+      "requests/sec: %.1f\n"
+      "latency p50: %.1f us\n"
+      "latency p95: %.1f us\n"
+      "latency p99: %.1f us\n"
+      "latency max: %.1f us\n"
+      "peak RSS: %d KB\n"
+      "allocations: %d (%.1f per request)\n",
+      num_requests, num_failures, absl::FormatDuration(elapsed),
+      requests_per_second, absl::ToDoubleMicroseconds(latency_p50),
+      absl::ToDoubleMicroseconds(latency_p95),
+      absl::ToDoubleMicroseconds(latency_p99),
+      absl::ToDoubleMicroseconds(latency_max), peak_rss_kb, allocations,
+      num_requests == 0 ? 0.0
+                        : static_cast<double>(allocations) / num_requests);
+}
+
+absl::StatusOr<std::vector<std::string>> ConverterBenchmark::ReadKeys(
+    const std::string &filename, int column) {
+  absl::StatusOr<std::vector<std::vector<std::string>>> rows =
+      testing::ReadTsv(filename);
+  if (!rows.ok()) {
+    return std::move(rows).status();
+  }
+  std::vector<std::string> keys;
+  keys.reserve(rows->size());
+  for (std::vector<std::string> &row : *rows) {
+    if (column < 0 || static_cast<size_t>(column) >= row.size()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "No column ", column, " in: ", absl::StrJoin(row, "\t")));
+    }
+    keys.push_back(std::move(row[column]));
+  }
+  return keys;
+}
+
+absl::StatusOr<ConversionRequest::RequestType>
+ConverterBenchmark::ParseRequestType(absl::string_view name) {
+  if (name == "conversion") {
+    return ConversionRequest::CONVERSION;
+  } else if (name == "prediction") {
+    return ConversionRequest::PREDICTION;
+  } else if (name == "suggestion") {
+    return ConversionRequest::SUGGESTION;
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown request type: ", name));
+}
+
+ConverterBenchmark::Result ConverterBenchmark::Run(
+    absl::Span<const ConverterInterface *const> converters,
+    absl::Span<const std::string> keys, const commands::Request &request,
+    const config::Config &config, const Options &options) {
+  // Build the default table before the measurement.
+  composer::Table::GetDefaultTable();
+
+  std::vector<ThreadResult> thread_results(converters.size());
+  const int64_t allocations_before = testing::GetAllocationCount();
+  const Stopwatch stopwatch = Stopwatch::StartNew();
+  if (converters.size() == 1) {
+    RunThread(*converters[0], keys, request, config, options,
+              &thread_results[0]);
+  } else {
+    std::vector<Thread2> threads;
+    threads.reserve(converters.size());
+    for (size_t i = 0; i < converters.size(); ++i) {
+      threads.emplace_back([&, i] {
+        RunThread(*converters[i], keys, request, config, options,
+                  &thread_results[i]);
+      });
+    }
+    for (Thread2 &thread : threads) {
+      thread.Join();
+    }
+  }
+
+  Result result;
+  result.elapsed = stopwatch.GetElapsed();
+  result.allocations = testing::GetAllocationCount() - allocations_before;
+  result.peak_rss_kb = GetPeakRssKb();
+
+  std::vector<absl::Duration> latencies;
+  for (const ThreadResult &thread_result : thread_results) {
+    latencies.insert(latencies.end(), thread_result.latencies.begin(),
+                     thread_result.latencies.end());
+    result.num_failures += thread_result.num_failures;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  result.num_requests = latencies.size();
+  if (result.elapsed > absl::ZeroDuration()) {
+    result.requests_per_second =
+        result.num_requests / absl::ToDoubleSeconds(result.elapsed);
+  }
+  result.latency_p50 = Percentile(latencies, 50);
+  result.latency_p95 = Percentile(latencies, 95);
+  result.latency_p99 = Percentile(latencies, 99);
+  result.latency_max =
+      latencies.empty() ? absl::ZeroDuration() : latencies.back();
+  return result;
+}
+
+int64_t ConverterBenchmark::GetPeakRssKb() {
+#ifdef _WIN32
+  return 0;
+#else   // _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  // ru_maxrss is in bytes on macOS.
+  return usage.ru_maxrss / 1024;
+#else   // __APPLE__
+  return usage.ru_maxrss;
+#endif  // __APPLE__
+#endif  // _WIN32
+}
+
+}  // namespace mozc
@@ -0,0 +1,107 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_CONVERTER_CONVERTER_BENCHMARK_H_
+#define MOZC_CONVERTER_CONVERTER_BENCHMARK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "converter/converter_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+
+// Batch benchmark of the converter used by converter_main and
+// quality_regression_main.  It converts a list of readings and reports the
+// throughput, the latency percentiles, the peak RSS and the number of heap
+// allocations.
+//
+// The allocations are counted by //testing:benchmark_util, which replaces the
+// global operator new of the binary.
+class ConverterBenchmark {
+ public:
+  struct Options {
+    // CONVERSION, PREDICTION or SUGGESTION.
+    ConversionRequest::RequestType request_type = ConversionRequest::CONVERSION;
+    // The number of times each thread converts all the keys.
+    int iterations = 1;
+  };
+
+  struct Result {
+    size_t num_requests = 0;
+    size_t num_failures = 0;
+    absl::Duration elapsed;
+    double requests_per_second = 0;
+    absl::Duration latency_p50;
+    absl::Duration latency_p95;
+    absl::Duration latency_p99;
+    absl::Duration latency_max;
+    // In KB.  0 if it is not available on the platform.
+    int64_t peak_rss_kb = 0;
+    // The number of the calls of operator new during the run.
+    int64_t allocations = 0;
+
+    // Returns the result in "name: value" lines.
+    std::string ToString() const;
+  };
+
+  // Reads the keys from the |column|-th column of the TSV file.  Empty lines
+  // and lines starting with '#' are skipped.
+  static absl::StatusOr<std::vector<std::string>> ReadKeys(
+      const std::string &filename, int column);
+
+  // Parses "conversion", "prediction" or "suggestion".
+  static absl::StatusOr<ConversionRequest::RequestType> ParseRequestType(
+      absl::string_view name);
+
+  // Converts |keys| with each of |converters| on its own thread at the same
+  // time.  Pass converters of separate engines to measure the scalability
+  // over threads.  The history is cleared for every key.
+  static Result Run(absl::Span<const ConverterInterface *const> converters,
+                    absl::Span<const std::string> keys,
+                    const commands::Request &request,
+                    const config::Config &config, const Options &options);
+
+  // Returns the peak resident set size of the process in KB, or 0 if it is not
+  // available.
+  static int64_t GetPeakRssKb();
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_CONVERTER_BENCHMARK_H_
@@ -0,0 +1,117 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/converter_benchmark.h"
+
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "config/config_handler.h"
+#include "converter/converter_interface.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/gmock.h"
+#include "testing/googletest.h"
+#include "testing/gunit.h"
+#include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Return;
+
+TEST(ConverterBenchmarkTest, ReadKeys) {
+  const std::string filename = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "converter_benchmark_test.tsv");
+  ASSERT_OK(FileUtil::SetContents(filename,
+                                  "# label\tkey\tvalue\n"
+                                  "test\twatashi\t私\n"
+                                  "\n"
+                                  "test\tkonnichiha\tこんにちは\n"));
+  absl::StatusOr<std::vector<std::string>> keys =
+      ConverterBenchmark::ReadKeys(filename, 1);
+  ASSERT_OK(keys);
+  EXPECT_THAT(*keys, ElementsAre("watashi", "konnichiha"));
+
+  EXPECT_FALSE(ConverterBenchmark::ReadKeys(filename, 3).ok());
+  EXPECT_FALSE(ConverterBenchmark::ReadKeys(filename + ".missing", 0).ok());
+}
+
+TEST(ConverterBenchmarkTest, ParseRequestType) {
+  EXPECT_EQ(*ConverterBenchmark::ParseRequestType("conversion"),
+            ConversionRequest::CONVERSION);
+  EXPECT_EQ(*ConverterBenchmark::ParseRequestType("prediction"),
+            ConversionRequest::PREDICTION);
+  EXPECT_EQ(*ConverterBenchmark::ParseRequestType("suggestion"),
+            ConversionRequest::SUGGESTION);
+  EXPECT_FALSE(ConverterBenchmark::ParseRequestType("reverse").ok());
+}
+
+TEST(ConverterBenchmarkTest, Run) {
+  const std::vector<std::string> keys = {"a", "b", "c"};
+  MockConverter converter1;
+  MockConverter converter2;
+  // Each converter converts all the keys for each iteration.
+  EXPECT_CALL(converter1, StartPredictionForRequest(_, _))
+      .Times(6)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(converter2, StartPredictionForRequest(_, _))
+      .Times(6)
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(converter1, StartConversionForRequest(_, _)).Times(0);
+  const ConverterInterface *converters[] = {&converter1, &converter2};
+
+  const commands::Request request;
+  const config::Config config = config::ConfigHandler::DefaultConfig();
+  ConverterBenchmark::Options options;
+  options.request_type = ConversionRequest::PREDICTION;
+  options.iterations = 2;
+  const ConverterBenchmark::Result result =
+      ConverterBenchmark::Run(converters, keys, request, config, options);
+
+  EXPECT_EQ(result.num_requests, 12);
+  EXPECT_EQ(result.num_failures, 6);
+  EXPECT_GT(result.requests_per_second, 0);
+  EXPECT_LE(result.latency_p50, result.latency_p95);
+  EXPECT_LE(result.latency_p95, result.latency_p99);
+  EXPECT_LE(result.latency_p99, result.latency_max);
+  // Composer and Segments are allocated for every request.
+  EXPECT_GT(result.allocations, 0);
+  EXPECT_FALSE(result.ToString().empty());
+}
+
+}  // namespace
+}  // namespace mozc
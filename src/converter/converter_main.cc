@@ -27,6 +27,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
@@ -47,6 +48,7 @@
 #include "composer/composer.h"
 #include "composer/table.h"
 #include "config/config_handler.h"
+#include "converter/converter_benchmark.h"
 #include "converter/converter_interface.h"
 #include "converter/lattice.h"
 #include "converter/pos_id_printer.h"
@@ -87,6 +89,19 @@ ABSL_FLAG(std::string, id_def, "",
           "id.def file for POS IDs. If provided, show human readable "
           "POS instead of ID number");
 
+// Batch benchmark.  If --benchmark_file is given, the readings in the file are
+// converted without the interactive commands and the performance is reported.
+ABSL_FLAG(std::string, benchmark_file, "",
+          "TSV file of readings to convert in the benchmark mode");
+ABSL_FLAG(int32_t, benchmark_key_column, 0,
+          "Column of the readings in --benchmark_file");
+ABSL_FLAG(std::string, benchmark_request_type, "conversion",
+          "Request type of the benchmark: (conversion|prediction|suggestion)");
+ABSL_FLAG(int32_t, benchmark_threads, 1,
+          "Number of threads of the benchmark. Each thread has its own engine");
+ABSL_FLAG(int32_t, benchmark_iterations, 1,
+          "Number of times each thread converts all the readings");
+
 namespace mozc {
 namespace {
 
@@ -418,6 +433,53 @@ bool IsConsistentEngineNameAndType(const std::string &engine_name,
          kConsistentPairs->end();
 }
 
+std::unique_ptr<EngineInterface> CreateEngine() {
+  absl::StatusOr<std::unique_ptr<DataManager>> data_manager =
+      absl::GetFlag(FLAGS_magic).empty()
+          ? DataManager::CreateFromFile(absl::GetFlag(FLAGS_engine_data_path))
+          : DataManager::CreateFromFile(absl::GetFlag(FLAGS_engine_data_path),
+                                        absl::GetFlag(FLAGS_magic));
+  CHECK_OK(data_manager);
+
+  if (absl::GetFlag(FLAGS_engine_type) == "desktop") {
+    return Engine::CreateDesktopEngine(*std::move(data_manager)).value();
+  } else if (absl::GetFlag(FLAGS_engine_type) == "mobile") {
+    return Engine::CreateMobileEngine(*std::move(data_manager)).value();
+  }
+  LOG(FATAL) << "Invalid type: --engine_type="
+             << absl::GetFlag(FLAGS_engine_type);
+  return nullptr;
+}
+
+int RunBenchmark(const commands::Request &request,
+                 const config::Config &config) {
+  absl::StatusOr<std::vector<std::string>> keys = ConverterBenchmark::ReadKeys(
+      absl::GetFlag(FLAGS_benchmark_file),
+      absl::GetFlag(FLAGS_benchmark_key_column));
+  CHECK_OK(keys);
+  ConverterBenchmark::Options options;
+  absl::StatusOr<ConversionRequest::RequestType> request_type =
+      ConverterBenchmark::ParseRequestType(
+          absl::GetFlag(FLAGS_benchmark_request_type));
+  CHECK_OK(request_type);
+  options.request_type = *request_type;
+  options.iterations = absl::GetFlag(FLAGS_benchmark_iterations);
+
+  const int num_threads = std::max(absl::GetFlag(FLAGS_benchmark_threads), 1);
+  std::vector<std::unique_ptr<EngineInterface>> engines;
+  std::vector<const ConverterInterface *> converters;
+  for (int i = 0; i < num_threads; ++i) {
+    engines.push_back(CreateEngine());
+    converters.push_back(engines.back()->GetConverter());
+  }
+  std::cout << "Readings: " << keys->size()
+            << "\nThreads: " << converters.size() << std::endl;
+  const ConverterBenchmark::Result result =
+      ConverterBenchmark::Run(converters, *keys, request, config, options);
+  std::cout << result.ToString();
+  return 0;
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -451,31 +513,18 @@ int main(int argc, char **argv) {
             << "\nData file: " << absl::GetFlag(FLAGS_engine_data_path)
             << "\nid.def: " << absl::GetFlag(FLAGS_id_def) << std::endl;
 
-  absl::StatusOr<std::unique_ptr<mozc::DataManager>> data_manager =
-      absl::GetFlag(FLAGS_magic).empty()
-          ? mozc::DataManager::CreateFromFile(
-                absl::GetFlag(FLAGS_engine_data_path))
-          : mozc::DataManager::CreateFromFile(
-                absl::GetFlag(FLAGS_engine_data_path),
-                absl::GetFlag(FLAGS_magic));
-  CHECK_OK(data_manager);
-
   mozc::config::Config config = mozc::config::ConfigHandler::DefaultConfig();
   mozc::commands::Request request;
-  std::unique_ptr<mozc::EngineInterface> engine;
-  if (absl::GetFlag(FLAGS_engine_type) == "desktop") {
-    engine =
-        mozc::Engine::CreateDesktopEngine(*std::move(data_manager)).value();
-  } else if (absl::GetFlag(FLAGS_engine_type) == "mobile") {
-    engine = mozc::Engine::CreateMobileEngine(*std::move(data_manager)).value();
+  if (absl::GetFlag(FLAGS_engine_type) == "mobile") {
     mozc::commands::RequestForUnitTest::FillMobileRequest(&request);
     config.set_use_kana_modifier_insensitive_conversion(true);
-  } else {
-    LOG(FATAL) << "Invalid type: --engine_type="
-               << absl::GetFlag(FLAGS_engine_type);
-    return 0;
   }
 
+  if (!absl::GetFlag(FLAGS_benchmark_file).empty()) {
+    return mozc::RunBenchmark(request, config);
+  }
+
+  std::unique_ptr<mozc::EngineInterface> engine = mozc::CreateEngine();
   mozc::ConverterInterface *converter = engine->GetConverter();
   CHECK(converter);
 
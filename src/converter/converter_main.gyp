@@ -37,6 +37,7 @@
       'target_name': 'converter_main',
       'type': 'executable',
       'sources': [
+        'converter_benchmark.cc',
         'converter_main.cc',
        ],
       'dependencies': [
@@ -49,6 +50,7 @@
         '../engine/engine.gyp:oss_engine_factory',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
+        '../testing/testing.gyp:benchmark_util',
         'converter.gyp:converter',
         'converter_base.gyp:pos_id_printer',
         'converter_base.gyp:segments',
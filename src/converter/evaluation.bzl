@@ -41,7 +41,11 @@ def evaluation(
         base_file,
         visibility = None,
         **kwargs):
-    """Generates a dictionary evaluation tsv file."""
+    """Generates a dictionary evaluation tsv file.
+
+    The targets are testonly, as quality_regression_main links the benchmark
+    utilities which replace the global operator new.
+    """
     evaluation_name = name + "_result"
     evaluation_out = evaluation_name + ".tsv"
     test_file_locations = ["$(location %s)" % file for file in test_files]
@@ -65,6 +69,7 @@ def evaluation(
             engine_type = engine_type,
         ),
         tags = ["manual"],
+        testonly = True,
         tools = ["//converter:quality_regression_main"],
         visibility = ["//visibility:private"],
     )
@@ -89,6 +94,7 @@ def evaluation(
             base_file = base_file,
             evaluation_name = evaluation_name,
         ),
+        testonly = True,
         tools = ["//converter:quality_regression"],
         visibility = visibility,
         **kwargs
@@ -61,6 +61,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "usage_stats/latency_stats.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -106,7 +107,8 @@ class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
       return TRAVERSE_NEXT_KEY;
     }
     Node *node = NewNodeFromToken(token);
-    node->key.assign(original_lookup_key_.data() + pos_, offset);
+    node->key =
+        allocator_->CopyString(original_lookup_key_.substr(pos_, offset));
     node->wcost += KeyCorrector::GetCorrectedCostPenalty(node->key);
 
     // Push back |node| to the end.
@@ -170,8 +172,9 @@ bool ContainsWhiteSpacesOnly(const absl::string_view s) {
   return true;
 }
 
-void DecomposeNumberAndSuffix(const std::string &input, std::string *number,
-                              std::string *suffix) {
+void DecomposeNumberAndSuffix(absl::string_view input,
+                              absl::string_view *number,
+                              absl::string_view *suffix) {
   const char *begin = input.data();
   const char *end = input.data() + input.size();
   size_t pos = 0;
@@ -183,12 +186,13 @@ void DecomposeNumberAndSuffix(const std::string &input, std::string *number,
     }
     break;
   }
-  number->assign(input, 0, pos);
-  suffix->assign(input, pos, input.size() - pos);
+  *number = input.substr(0, pos);
+  *suffix = input.substr(pos);
 }
 
-void DecomposePrefixAndNumber(const std::string &input, std::string *prefix,
-                              std::string *number) {
+void DecomposePrefixAndNumber(absl::string_view input,
+                              absl::string_view *prefix,
+                              absl::string_view *number) {
   const char *begin = input.data();
   const char *end = input.data() + input.size() - 1;
   size_t pos = input.size();
@@ -200,8 +204,8 @@ void DecomposePrefixAndNumber(const std::string &input, std::string *prefix,
     }
     break;
   }
-  prefix->assign(input, 0, pos);
-  number->assign(input, pos, input.size() - pos);
+  *prefix = input.substr(0, pos);
+  *number = input.substr(pos);
 }
 
 void NormalizeHistorySegments(Segments *segments) {
@@ -276,6 +280,32 @@ Lattice *GetLattice(Segments *segments, bool is_prediction) {
   return lattice;
 }
 
+// Returns true if |lattice| has the nodes for the history segments of
+// |segments|, which were inserted by the previous prediction.
+bool HasHistoryNodes(const Segments &segments, const Lattice &lattice) {
+  size_t pos = 0;
+  for (size_t s = 0; s < segments.history_segments_size(); ++s) {
+    const Segment &segment = segments.segment(s);
+    if (segment.candidates_size() == 0) {
+      return false;
+    }
+    const Segment::Candidate &candidate = segment.candidate(0);
+    const Node *node = lattice.begin_nodes(pos);
+    for (; node != nullptr; node = node->bnext) {
+      if (node->node_type == Node::HIS_NODE && node->lid == candidate.lid &&
+          node->rid == candidate.rid && node->key == segment.key() &&
+          node->value == candidate.value) {
+        break;
+      }
+    }
+    if (node == nullptr) {
+      return false;
+    }
+    pos += segment.key().size();
+  }
+  return pos == lattice.history_end_pos();
+}
+
 }  // namespace
 
 ImmutableConverterImpl::ImmutableConverterImpl(
@@ -445,8 +475,10 @@ bool ImmutableConverterImpl::ResegmentArabicNumberAndSuffix(
         pos_matcher_->IsNumber(compound_node->lid) &&
         !pos_matcher_->IsNumber(compound_node->rid) &&
         IsNumber(compound_node->value[0]) && IsNumber(compound_node->key[0])) {
-      std::string number_value, number_key;
-      std::string suffix_value, suffix_key;
+      // The decomposed strings are views of the compound node's strings, so
+      // they can be set to the new nodes without copying.
+      absl::string_view number_value, number_key;
+      absl::string_view suffix_value, suffix_key;
       DecomposeNumberAndSuffix(compound_node->value, &number_value,
                                &suffix_value);
       DecomposeNumberAndSuffix(compound_node->key, &number_key, &suffix_key);
@@ -521,8 +553,8 @@ bool ImmutableConverterImpl::ResegmentPrefixAndArabicNumber(
         !IsNumber(compound_node->key[0]) &&
         IsNumber(compound_node->value[compound_node->value.size() - 1]) &&
         IsNumber(compound_node->key[compound_node->key.size() - 1])) {
-      std::string number_value, number_key;
-      std::string prefix_value, prefix_key;
+      absl::string_view number_value, number_key;
+      absl::string_view prefix_value, prefix_key;
       DecomposePrefixAndNumber(compound_node->value, &prefix_value,
                                &number_value);
       DecomposePrefixAndNumber(compound_node->key, &prefix_key, &number_key);
@@ -632,7 +664,7 @@ bool ImmutableConverterImpl::ResegmentPersonalName(size_t pos,
              rnode != nullptr; rnode = rnode->bnext) {
           if ((lnode->value.size() + rnode->value.size()) ==
                   compound_node->value.size() &&
-              (lnode->value + rnode->value) == compound_node->value &&
+              absl::EndsWith(compound_node->value, rnode->value) &&
               segmenter_->IsBoundary(*lnode, *rnode, false)) {  // Constraint 3.
             const int32_t cost = lnode->wcost + GetCost(lnode, rnode);
             if (cost < best_cost) {  // choose the smallest ones
@@ -756,13 +788,17 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
     result_node = builder.result();
   } else {
     if (is_prediction) {
+      // The lattice is reused across prediction requests, and the nodes
+      // shorter than or equal to cache_info(begin_pos) are already in it.
       NodeListBuilderWithCacheEnabled builder(
           lattice->node_allocator(), lattice->cache_info(begin_pos) + 1,
           GetSpatialCostParams(request));
       dictionary_->LookupPrefix(absl::string_view(begin, len), request,
                                 &builder);
-      result_node = builder.result();
+      result_node = AddCharacterTypeBasedNodes(begin, end, lattice,
+                                               builder.result(), true);
       lattice->SetCacheInfo(begin_pos, len);
+      return result_node;
     } else {
       // When cache feature is not used, look up normally
       BaseNodeListBuilder builder(lattice->node_allocator(),
@@ -773,13 +809,12 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
       result_node = builder.result();
     }
   }
-  return AddCharacterTypeBasedNodes(begin, end, lattice, result_node);
+  return AddCharacterTypeBasedNodes(begin, end, lattice, result_node, false);
 }
 
-Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(const char *begin,
-                                                         const char *end,
-                                                         Lattice *lattice,
-                                                         Node *nodes) const {
+Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(
+    const char *begin, const char *end, Lattice *lattice, Node *nodes,
+    bool enable_cache) const {
   size_t mblen = 0;
   const char32_t ucs4 = Util::Utf8ToUcs4(begin, end, &mblen);
 
@@ -787,7 +822,10 @@ Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(const char *begin,
   const Util::FormType first_form_type = Util::GetFormType(ucs4);
 
   // Add 1 character node. It can be either UnknownId or NumberId.
-  {
+  // The cached node is kept in the lattice once added, as it doesn't depend
+  // on the rest of the key.
+  const size_t begin_pos = begin - lattice->key().data();
+  if (!enable_cache || lattice->cache_info(begin_pos) == 0) {
     Node *new_node = lattice->NewNode();
     CHECK(new_node);
     if (first_script_type == Util::NUMBER) {
@@ -798,16 +836,21 @@ Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(const char *begin,
       new_node->rid = unknown_id_;
     }
 
-    new_node->wcost = kMaxCost;
-    new_node->value.assign(begin, mblen);
-    new_node->key.assign(begin, mblen);
+    new_node->wcost =
+        (first_script_type == Util::NUMBER) ? kDefaultNumberCost : kMaxCost;
+    new_node->value =
+        lattice->node_allocator()->CopyString(absl::string_view(begin, mblen));
+    new_node->key = new_node->value;
     new_node->node_type = Node::NOR_NODE;
+    if (enable_cache) {
+      new_node->attributes |= Node::ENABLE_CACHE;
+      new_node->raw_wcost = new_node->wcost;
+    }
     new_node->bnext = nodes;
     nodes = new_node;
   }  // scope out |new_node|
 
   if (first_script_type == Util::NUMBER) {
-    nodes->wcost = kDefaultNumberCost;
     return nodes;
   }
 
@@ -841,8 +884,9 @@ Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(const char *begin,
       new_node->rid = unknown_id_;
     }
     new_node->wcost = kMaxCost / 2;
-    new_node->value.assign(begin, mblen);
-    new_node->key.assign(begin, mblen);
+    new_node->value =
+        lattice->node_allocator()->CopyString(absl::string_view(begin, mblen));
+    new_node->key = new_node->value;
     new_node->node_type = Node::NOR_NODE;
     new_node->bnext = nodes;
     nodes = new_node;
@@ -919,13 +963,92 @@ class CachingConnector final {
 // calculated based on kVeryBigCost.
 constexpr int kVeryBigCost = (INT_MAX >> 2);
 
+// Structure-of-arrays copy of the valid left nodes at a position, i.e., the
+// nodes in lattice->end_nodes(pos) having a valid |prev|.
+//
+// In Viterbi algorithm, the left nodes are scanned once for each right node.
+// Walking the linked list of Nodes every time touches a few cache lines per
+// node, so the fields needed for the min-cost search (cost and rid) are packed
+// into contiguous arrays once per position. The search itself is split into a
+// branchless min reduction, which compilers can vectorize, and a scan for the
+// first node having the minimum cost.
+//
+// The instance is reused across positions to avoid reallocation.
+class ViterbiColumn final {
+ public:
+  ViterbiColumn() = default;
+
+  ViterbiColumn(const ViterbiColumn &) = delete;
+  ViterbiColumn &operator=(const ViterbiColumn &) = delete;
+
+  // Packs the valid nodes in the end node list starting from |lnode|.
+  void Assign(Node *lnode) {
+    nodes_.clear();
+    costs_.clear();
+    rids_.clear();
+    for (; lnode != nullptr; lnode = lnode->enext) {
+      if (lnode->prev == nullptr) {
+        // Invalid lnode.
+        continue;
+      }
+      nodes_.push_back(lnode);
+      costs_.push_back(lnode->cost);
+      rids_.push_back(lnode->rid);
+    }
+    totals_.resize(nodes_.size());
+  }
+
+  // Finds a left node which connects to the right node having |rnode_lid| with
+  // minimum cost, and stores the cost to |best_cost|. When two or more nodes
+  // have the minimum cost, the first one in the end node list is returned, as
+  // in the linked list traversal. Returns nullptr and sets kVeryBigCost if no
+  // node is found.
+  Node *FindBestNode(uint16_t rnode_lid, CachingConnector *conn,
+                     int *best_cost) {
+    const size_t size = nodes_.size();
+    int32_t *totals = totals_.data();
+    for (size_t i = 0; i < size; ++i) {
+      totals[i] = conn->GetTransitionCost(rids_[i], rnode_lid);
+    }
+
+    const int32_t *costs = costs_.data();
+    int32_t min_cost = kVeryBigCost;
+    for (size_t i = 0; i < size; ++i) {
+      totals[i] += costs[i];
+      min_cost = std::min(min_cost, totals[i]);
+    }
+
+    *best_cost = kVeryBigCost;
+    if (min_cost >= kVeryBigCost) {
+      return nullptr;
+    }
+    size_t i = 0;
+    while (totals[i] != min_cost) {
+      ++i;
+    }
+    *best_cost = min_cost;
+    return nodes_[i];
+  }
+
+ private:
+  std::vector<Node *> nodes_;
+  std::vector<int32_t> costs_;
+  std::vector<uint16_t> rids_;
+  // Buffer for the total costs (cost + transition cost) of each node.
+  std::vector<int32_t> totals_;
+};
+
 // Runs viterbi algorithm at position |pos|. The left_boundary/right_boundary
 // are the next boundary looked from pos. (If pos is on the boundary,
 // left_boundary should be the previous one, and right_boundary should be
-// the next).
+// the next). |column| is a working buffer.
 inline void ViterbiInternal(const Connector &connector, size_t pos,
-                            size_t right_boundary, Lattice *lattice) {
+                            size_t right_boundary, Lattice *lattice,
+                            ViterbiColumn *column) {
   CachingConnector conn(connector);
+  // Left nodes end at |pos| and right nodes begin at |pos|, so the costs of
+  // left nodes don't change in the following loop.
+  column->Assign(lattice->end_nodes(pos));
   for (Node *rnode = lattice->begin_nodes(pos); rnode != nullptr;
        rnode = rnode->bnext) {
     if (rnode->end_pos > right_boundary) {
@@ -950,22 +1073,7 @@ inline void ViterbiInternal(const Connector &connector, size_t pos,
 
     // Find a valid node which connects to the rnode with minimum cost.
     int best_cost = kVeryBigCost;
-    Node *best_node = nullptr;
-    for (Node *lnode = lattice->end_nodes(pos); lnode != nullptr;
-         lnode = lnode->enext) {
-      if (lnode->prev == nullptr) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost = lnode->cost + conn.GetTransitionCost(lnode->rid, rnode->lid);
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_node = lnode;
-      }
-    }
-
-    rnode->prev = best_node;
+    rnode->prev = column->FindBestNode(rnode->lid, &conn, &best_cost);
     rnode->cost = best_cost + rnode->wcost;
   }
 }
@@ -1002,6 +1110,7 @@ bool ImmutableConverterImpl::Viterbi(const Segments &segments,
 
   size_t left_boundary = 0;
   const size_t segments_size = segments.segments_size();
+  ViterbiColumn column;
 
   // Specialization for the first segment.
   // Don't run on the left boundary (the connection with BOS node),
@@ -1010,7 +1119,7 @@ bool ImmutableConverterImpl::Viterbi(const Segments &segments,
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
     for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternal(*connector_, pos, right_boundary, lattice, &column);
     }
     left_boundary = right_boundary;
   }
@@ -1021,7 +1130,7 @@ bool ImmutableConverterImpl::Viterbi(const Segments &segments,
     const size_t right_boundary =
         left_boundary + segments.segment(i).key().size();
     for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternal(*connector_, pos, right_boundary, lattice, &column);
     }
     left_boundary = right_boundary;
   }
@@ -1110,6 +1219,9 @@ bool ImmutableConverterImpl::PredictionViterbi(const Segments &segments,
   }
   PredictionViterbiInternal(0, history_length, lattice);
   PredictionViterbiInternal(history_length, key_length, lattice);
+  // The costs of all the nodes are now valid and are reused by the next
+  // request until the lattice is modified.
+  lattice->SetViterbiCachePos(key_length + 1);
 
   Node *node = lattice->eos_nodes();
   CHECK(node->bnext == nullptr);
@@ -1158,7 +1270,30 @@ void ImmutableConverterImpl::PredictionViterbiInternal(int calc_begin_pos,
 
   const CostAndNode kInvalidValue(INT_MAX, nullptr);
 
+  // The nodes ending before |cache_pos| keep the costs computed by the
+  // previous run, because nothing on their paths has been changed. So only
+  // the nodes ending at or after |cache_pos| are updated. When a character is
+  // appended to the key, they are the nodes around the new character.
+  const size_t cache_pos = lattice->viterbi_cache_pos();
+
   for (size_t pos = calc_begin_pos; pos <= calc_end_pos; ++pos) {
+    rbest.clear();
+    Node *rnode_begin = lattice->begin_nodes(pos);
+    for (Node *rnode = rnode_begin; rnode != nullptr; rnode = rnode->bnext) {
+      if (rnode->end_pos > calc_end_pos || rnode->end_pos < cache_pos) {
+        continue;
+      }
+      const BestMap::value_type key(rnode->lid, kInvalidValue);
+      const BestMap::const_iterator iter = LowerBound(rbest, key);
+      if (iter == rbest.end() || iter->first != rnode->lid) {
+        rbest.insert(iter, key);
+      }
+    }
+
+    if (rbest.empty()) {
+      continue;
+    }
+
     lbest.clear();
     for (Node *lnode = lattice->end_nodes(pos); lnode != nullptr;
          lnode = lnode->enext) {
@@ -1178,23 +1313,6 @@ void ImmutableConverterImpl::PredictionViterbiInternal(int calc_begin_pos,
       continue;
     }
 
-    rbest.clear();
-    Node *rnode_begin = lattice->begin_nodes(pos);
-    for (Node *rnode = rnode_begin; rnode != nullptr; rnode = rnode->bnext) {
-      if (rnode->end_pos > calc_end_pos) {
-        continue;
-      }
-      const BestMap::value_type key(rnode->lid, kInvalidValue);
-      const BestMap::const_iterator iter = LowerBound(rbest, key);
-      if (iter == rbest.end() || iter->first != rnode->lid) {
-        rbest.insert(iter, key);
-      }
-    }
-
-    if (rbest.empty()) {
-      continue;
-    }
-
     for (BestMap::iterator liter = lbest.begin(); liter != lbest.end();
          ++liter) {
       for (BestMap::iterator riter = rbest.begin(); riter != rbest.end();
@@ -1209,7 +1327,7 @@ void ImmutableConverterImpl::PredictionViterbiInternal(int calc_begin_pos,
     }
 
     for (Node *rnode = rnode_begin; rnode != nullptr; rnode = rnode->bnext) {
-      if (rnode->end_pos > calc_end_pos) {
+      if (rnode->end_pos > calc_end_pos || rnode->end_pos < cache_pos) {
         continue;
       }
       const BestMap::value_type key(rnode->lid, kInvalidValue);
@@ -1481,9 +1599,23 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
     Lattice *lattice) const {
   const bool is_reverse =
       (request.request_type() == ConversionRequest::REVERSE_CONVERSION);
+  const bool is_prediction =
+      (request.request_type() == ConversionRequest::SUGGESTION ||
+       request.request_type() == ConversionRequest::PREDICTION);
   const size_t history_segments_size = segments.history_segments_size();
-  const std::string &key = lattice->key();
 
+  // In prediction, the lattice is reused across requests (see GetLattice())
+  // and the history nodes inserted by the previous request are cached.
+  if (is_prediction && lattice->history_end_pos() > 0) {
+    if (HasHistoryNodes(segments, *lattice)) {
+      return true;
+    }
+    // The history has been replaced with another one having the same length.
+    const std::string key = lattice->key();
+    lattice->SetKey(key);
+  }
+
+  const std::string &key = lattice->key();
   size_t segments_pos = 0;
   uint16_t last_rid = 0;
 
@@ -1506,10 +1638,14 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
     rnode->lid = candidate.lid;
     rnode->rid = candidate.rid;
     rnode->wcost = 0;
-    rnode->value = candidate.value;
-    rnode->key = segment.key();
+    rnode->value = lattice->node_allocator()->CopyString(candidate.value);
+    rnode->key = lattice->node_allocator()->CopyString(segment.key());
     rnode->node_type = Node::HIS_NODE;
     rnode->bnext = nullptr;
+    if (is_prediction) {
+      rnode->attributes |= Node::ENABLE_CACHE;
+      rnode->raw_wcost = rnode->wcost;
+    }
     lattice->Insert(segments_pos, rnode);
 
     // For the last history segment,  we also insert a new node having
@@ -1530,10 +1666,14 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
       // TODO(team): Figure out a better way to set the cost using
       // boundary.def-like approach.
       rnode2->wcost = 0;
-      rnode2->value = candidate.value;
-      rnode2->key = segment.key();
+      rnode2->value = rnode->value;
+      rnode2->key = rnode->key;
       rnode2->node_type = Node::HIS_NODE;
       rnode2->bnext = nullptr;
+      if (is_prediction) {
+        rnode2->attributes |= Node::ENABLE_CACHE;
+        rnode2->raw_wcost = rnode2->wcost;
+      }
       lattice->Insert(segments_pos, rnode2);
     }
 
@@ -1550,9 +1690,6 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
     // which comes from "にて" + "配".
     // The bigram-like lookup ("卓也" from "及川") is covered in
     // dictionary_predictor.
-    const bool is_prediction =
-        (request.request_type() == ConversionRequest::SUGGESTION ||
-         request.request_type() == ConversionRequest::PREDICTION);
     if (!is_prediction && s + 1 == history_segments_size) {
       const Node *node = Lookup(segments_pos, key.size(), request, is_reverse,
                                 is_prediction, lattice);
@@ -1579,11 +1716,8 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
         CHECK(new_node);
 
         // get the suffix part ("たくや/卓也")
-        new_node->key.assign(compound_node->key, rnode->key.size(),
-                             compound_node->key.size() - rnode->key.size());
-        new_node->value.assign(
-            compound_node->value, rnode->value.size(),
-            compound_node->value.size() - rnode->value.size());
+        new_node->key = compound_node->key.substr(rnode->key.size());
+        new_node->value = compound_node->value.substr(rnode->value.size());
 
         // rid/lid are derived from the compound.
         // lid is just an approximation
@@ -1668,8 +1802,12 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
           }
         }
       }
-      CHECK(rnode != nullptr);
-      lattice->Insert(pos, rnode);
+      if (rnode != nullptr) {
+        lattice->Insert(pos, rnode);
+      } else {
+        // All the nodes from |pos| are already in the cached lattice.
+        DCHECK(is_prediction);
+      }
       InsertCorrectedNodes(pos, key, request, key_corrector.get(), dictionary_,
                            lattice);
     }
@@ -1717,8 +1855,8 @@ void ImmutableConverterImpl::Resegment(const Segments &segments,
       rnode->lid = candidate.lid;
       rnode->rid = candidate.rid;
       rnode->wcost = kMinCost;
-      rnode->value = candidate.value;
-      rnode->key = segment.key();
+      rnode->value = lattice->node_allocator()->CopyString(candidate.value);
+      rnode->key = lattice->node_allocator()->CopyString(segment.key());
       rnode->node_type = Node::CON_NODE;
       rnode->bnext = nullptr;
       lattice->Insert(segments_pos, rnode);
@@ -2047,26 +2185,41 @@ void ImmutableConverterImpl::MakeGroup(const Segments &segments,
 
 bool ImmutableConverterImpl::ConvertForRequest(const ConversionRequest &request,
                                                Segments *segments) const {
+  using usage_stats::LatencyStats;
+  static const LatencyStats::StageId kMakeLatticeStage =
+      LatencyStats::RegisterStage("ImmutableConverter.MakeLattice");
+  static const LatencyStats::StageId kViterbiStage =
+      LatencyStats::RegisterStage("ImmutableConverter.Viterbi");
+  static const LatencyStats::StageId kPredictionViterbiStage =
+      LatencyStats::RegisterStage("ImmutableConverter.PredictionViterbi");
+  static const LatencyStats::StageId kMakeSegmentsStage =
+      LatencyStats::RegisterStage("ImmutableConverter.MakeSegments");
+
   const bool is_prediction =
       (request.request_type() == ConversionRequest::PREDICTION ||
        request.request_type() == ConversionRequest::SUGGESTION);
 
   Lattice *lattice = GetLattice(segments, is_prediction);
 
-  if (!MakeLattice(request, segments, lattice)) {
-    LOG(WARNING) << "could not make lattice";
-    return false;
+  {
+    usage_stats::ScopedLatencyRecorder recorder(kMakeLatticeStage);
+    if (!MakeLattice(request, segments, lattice)) {
+      LOG(WARNING) << "could not make lattice";
+      return false;
+    }
   }
 
   std::vector<uint16_t> group;
   MakeGroup(*segments, &group);
 
   if (is_prediction) {
+    usage_stats::ScopedLatencyRecorder recorder(kPredictionViterbiStage);
     if (!PredictionViterbi(*segments, lattice)) {
       LOG(WARNING) << "prediction_viterbi failed";
       return false;
     }
   } else {
+    usage_stats::ScopedLatencyRecorder recorder(kViterbiStage);
     if (!Viterbi(*segments, lattice)) {
       LOG(WARNING) << "viterbi failed";
       return false;
@@ -2074,9 +2227,13 @@ bool ImmutableConverterImpl::ConvertForRequest(const ConversionRequest &request,
   }
 
   VLOG(2) << lattice->DebugString();
-  if (!MakeSegments(request, *lattice, group, segments)) {
-    LOG(WARNING) << "make segments failed";
-    return false;
+  {
+    // MakeSegments runs the N-best search over the lattice.
+    usage_stats::ScopedLatencyRecorder recorder(kMakeSegmentsStage);
+    if (!MakeSegments(request, *lattice, group, segments)) {
+      LOG(WARNING) << "make segments failed";
+      return false;
+    }
   }
 
   return true;
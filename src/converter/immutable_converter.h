@@ -106,8 +106,12 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   Node *Lookup(const int begin_pos, const int end_pos,
                const ConversionRequest &request, bool is_reverse,
                bool is_prediction, Lattice *lattice) const;
+  // Adds nodes based on the character types of [begin, end) to |nodes|. If
+  // |enable_cache| is true, the single character node is cached in the
+  // lattice and is not added again for the position already looked up.
   Node *AddCharacterTypeBasedNodes(const char *begin, const char *end,
-                                   Lattice *lattice, Node *nodes) const;
+                                   Lattice *lattice, Node *nodes,
+                                   bool enable_cache) const;
 
   void Resegment(const Segments &segments, const std::string &history_key,
                  const std::string &conversion_key, Lattice *lattice) const;
@@ -320,6 +320,52 @@ TEST(ImmutableConverterTest, AddPredictiveNodes) {
   }
 }
 
+TEST(ImmutableConverterTest, ReuseLatticeForPrediction) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::PREDICTION);
+  request.set_max_conversion_candidates_size(10);
+
+  // Types the key character by character, followed by a backspace, and
+  // verifies that the results from the reused lattice are the same as those
+  // from a new lattice.
+  std::vector<std::string> keys;
+  std::string typed;
+  for (const std::string &c : {"わ", "た", "し", "の", "な", "ま", "え", "は",
+                               "な", "か", "の", "で", "す"}) {
+    typed += c;
+    keys.push_back(typed);
+  }
+  keys.push_back("わたしのなまえはなかので");
+
+  Segments segments;
+  for (const std::string &key : keys) {
+    segments.Clear();
+    segments.add_segment()->set_key(key);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+
+    Segments expected;
+    expected.add_segment()->set_key(key);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &expected));
+
+    const Segment &actual_segment = segments.conversion_segment(0);
+    const Segment &expected_segment = expected.conversion_segment(0);
+    ASSERT_EQ(actual_segment.candidates_size(),
+              expected_segment.candidates_size())
+        << key;
+    for (size_t i = 0; i < actual_segment.candidates_size(); ++i) {
+      EXPECT_EQ(actual_segment.candidate(i).value,
+                expected_segment.candidate(i).value)
+          << key;
+      EXPECT_EQ(actual_segment.candidate(i).cost,
+                expected_segment.candidate(i).cost)
+          << key;
+    }
+  }
+}
+
 TEST(ImmutableConverterTest, InnerSegmenBoundaryForPrediction) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
       new MockDataAndImmutableConverter);
@@ -38,6 +38,7 @@
 #include "base/port.h"
 #include "base/util.h"
 #include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 namespace {
@@ -558,7 +559,7 @@ bool KeyCorrector::IsInvalidPosition(size_t pos) {
 size_t KeyCorrector::InvalidPosition() { return kInvalidPos; }
 
 // static
-int KeyCorrector::GetCorrectedCostPenalty(const std::string &key) {
+int KeyCorrector::GetCorrectedCostPenalty(absl::string_view key) {
   // "んん" and "っっ" must be mis-spelling.
   if (absl::StrContains(key, "んん") || absl::StrContains(key, "っっ")) {
     return 0;
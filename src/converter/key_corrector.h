@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 
@@ -147,7 +148,7 @@ class KeyCorrector {
 
   // return the cost penalty for the corrected key.
   // The return value is added to the original cost as a penalty.
-  static int GetCorrectedCostPenalty(const std::string &key);
+  static int GetCorrectedCostPenalty(absl::string_view key);
 
   // clear internal data
   void Clear();
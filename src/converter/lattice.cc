@@ -52,7 +52,7 @@ Node *InitBOSNode(Lattice *lattice, uint16_t length) {
   DCHECK(bos_node);
   bos_node->rid = 0;  // 0 is reserved for EOS/BOS
   bos_node->lid = 0;
-  bos_node->key.clear();
+  bos_node->key = absl::string_view();
   bos_node->value = "BOS";
   bos_node->node_type = Node::BOS_NODE;
   bos_node->wcost = 0;
@@ -68,7 +68,7 @@ Node *InitEOSNode(Lattice *lattice, uint16_t length) {
   DCHECK(eos_node);
   eos_node->rid = 0;  // 0 is reserved for EOS/BOS
   eos_node->lid = 0;
-  eos_node->key.clear();
+  eos_node->key = absl::string_view();
   eos_node->value = "EOS";
   eos_node->node_type = Node::EOS_NODE;
   eos_node->wcost = 0;
@@ -145,7 +145,10 @@ struct LatticeDisplayNodeInfo {
   std::string display_node_str_;
 };
 
-Lattice::Lattice() : history_end_pos_(0), node_allocator_(new NodeAllocator) {}
+Lattice::Lattice()
+    : history_end_pos_(0),
+      node_allocator_(new NodeAllocator),
+      viterbi_cache_pos_(0) {}
 
 Lattice::~Lattice() {}
 
@@ -189,6 +192,7 @@ void Lattice::Insert(size_t pos, Node *node) {
     rnode->cost = 0;
     rnode->enext = end_nodes_[end_pos];
     end_nodes_[end_pos] = rnode;
+    viterbi_cache_pos_ = std::min(viterbi_cache_pos_, end_pos);
   }
 
   if (begin_nodes_[pos] == nullptr) {
@@ -215,6 +219,7 @@ void Lattice::Clear() {
   node_allocator_->Free();
   cache_info_.clear();
   history_end_pos_ = 0;
+  viterbi_cache_pos_ = 0;
 }
 
 void Lattice::SetDebugDisplayNode(size_t begin_pos, size_t end_pos,
@@ -278,6 +283,7 @@ void Lattice::AddSuffix(const std::string &suffix_key) {
 
   // update cache_info
   cache_info_.resize(new_size + 4, 0);
+  viterbi_cache_pos_ = std::min(viterbi_cache_pos_, old_size);
 
   // update key
   key_ += suffix_key;
@@ -326,6 +332,7 @@ void Lattice::ShrinkKey(const size_t new_len) {
     cache_info_[i] = std::min(cache_info_[i], new_len - i);
   }
   std::fill(cache_info_.begin() + new_len, cache_info_.end(), 0);
+  viterbi_cache_pos_ = std::min(viterbi_cache_pos_, new_len);
 
   // update key
   key_.erase(new_len);
@@ -341,61 +348,43 @@ void Lattice::SetCacheInfo(const size_t pos, const size_t len) {
   cache_info_[pos] = len;
 }
 
+size_t Lattice::viterbi_cache_pos() const { return viterbi_cache_pos_; }
+
+void Lattice::SetViterbiCachePos(const size_t pos) {
+  viterbi_cache_pos_ = pos;
+}
+
 void Lattice::ResetNodeCost() {
   for (size_t i = 0; i <= key_.size(); ++i) {
-    if (begin_nodes_[i] != nullptr) {
-      Node *prev = nullptr;
-      for (Node *node = begin_nodes_[i]; node != nullptr; node = node->bnext) {
-        // do not process BOS / EOS nodes
-        if (node->node_type == Node::BOS_NODE ||
-            node->node_type == Node::EOS_NODE) {
-          continue;
-        }
-        // if the node has ENABLE_CACHE attribute, then revert its wcost.
-        // Otherwise, erase the node from the lattice.
-        if (node->attributes & Node::ENABLE_CACHE) {
-          node->wcost = node->raw_wcost;
-        } else {
-          if (node == begin_nodes_[i]) {
-            if (node->bnext == nullptr) {
-              begin_nodes_[i] = nullptr;
-            } else {
-              begin_nodes_[i] = node->bnext;
-            }
-          } else {
-            CHECK(prev);
-            CHECK_EQ(prev->bnext, node);
-            prev->next = node->bnext;
-          }
-        }
-        // traverse a next node
-        prev = node;
+    for (Node **link = &begin_nodes_[i]; *link != nullptr;) {
+      Node *node = *link;
+      // do not process BOS / EOS nodes
+      if (node->node_type == Node::BOS_NODE ||
+          node->node_type == Node::EOS_NODE) {
+        link = &node->bnext;
+        continue;
+      }
+      // if the node has ENABLE_CACHE attribute, then revert its wcost.
+      // Otherwise, erase the node from the lattice.
+      if (node->attributes & Node::ENABLE_CACHE) {
+        node->wcost = node->raw_wcost;
+        link = &node->bnext;
+      } else {
+        *link = node->bnext;
+        // The nodes connected to the erased node need to be recomputed.
+        viterbi_cache_pos_ =
+            std::min<size_t>(viterbi_cache_pos_, node->end_pos);
       }
     }
 
-    if (end_nodes_[i] != nullptr) {
-      Node *prev = nullptr;
-      for (Node *node = end_nodes_[i]; node != nullptr; node = node->enext) {
-        if (node->node_type == Node::BOS_NODE ||
-            node->node_type == Node::EOS_NODE) {
-          continue;
-        }
-        if (node->attributes & Node::ENABLE_CACHE) {
-          node->wcost = node->raw_wcost;
-        } else {
-          if (node == end_nodes_[i]) {
-            if (node->enext == nullptr) {
-              end_nodes_[i] = nullptr;
-            } else {
-              end_nodes_[i] = node->enext;
-            }
-          } else {
-            CHECK(prev);
-            CHECK_EQ(prev->enext, node);
-            prev->next = node->enext;
-          }
-        }
-        prev = node;
+    for (Node **link = &end_nodes_[i]; *link != nullptr;) {
+      Node *node = *link;
+      if (node->node_type == Node::BOS_NODE ||
+          node->node_type == Node::EOS_NODE ||
+          (node->attributes & Node::ENABLE_CACHE)) {
+        link = &node->enext;
+      } else {
+        *link = node->enext;
       }
     }
   }
@@ -103,9 +103,22 @@ class Lattice {
   // setter
   void SetCacheInfo(const size_t pos, const size_t len);
 
-  // revert the wcost of nodes if it has ENABLE_CACHE attribute.
+  // Returns the position before which the result of the previous Viterbi
+  // run is reusable, i.e., cost and prev of the nodes ending before this
+  // position need not be recomputed. The position is moved back when the key
+  // is changed and when nodes are inserted into or removed from the lattice.
+  size_t viterbi_cache_pos() const;
+
+  // Sets the position described above. Viterbi algorithm sets it after
+  // computing the costs of all the nodes.
+  void SetViterbiCachePos(const size_t pos);
+
+  // revert the wcost of nodes if it has ENABLE_CACHE attribute, and erase the
+  // other nodes from the lattice.
   // This function is needed for wcost may be changed during conversion
-  // process for some heuristic methods.
+  // process for some heuristic methods. Note that the reverted wcost doesn't
+  // move viterbi_cache_pos() back; the caller is responsible for applying the
+  // same heuristics again before running Viterbi algorithm.
   void ResetNodeCost();
 
   // Dump the best path and the path that contains the designated string.
@@ -130,6 +143,9 @@ class Lattice {
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  // See viterbi_cache_pos().
+  size_t viterbi_cache_pos_;
 };
 
 }  // namespace mozc
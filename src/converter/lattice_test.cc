@@ -31,11 +31,13 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "converter/node.h"
 #include "testing/gunit.h"
 #include "absl/container/btree_set.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 
@@ -68,6 +70,23 @@ TEST(LatticeTest, NewNodeTest) {
   EXPECT_EQ(node->rid, 0);
 }
 
+TEST(LatticeTest, CopyStringTest) {
+  Lattice lattice;
+  NodeAllocator *allocator = lattice.node_allocator();
+  EXPECT_TRUE(allocator->CopyString("").empty());
+
+  std::string value = "value";
+  const absl::string_view copied = allocator->CopyString(value);
+  value = "modified";
+  EXPECT_EQ(copied, "value");
+
+  // Strings larger than a chunk get a dedicated block; earlier copies stay
+  // valid.
+  const std::string large(64 * 1024, 'a');
+  EXPECT_EQ(allocator->CopyString(large), large);
+  EXPECT_EQ(copied, "value");
+}
+
 TEST(LatticeTest, InsertTest) {
   Lattice lattice;
 
@@ -119,7 +138,8 @@ void InsertNodes(Lattice *lattice) {
   const size_t key_size = lattice->key().size();
   for (size_t i = 0; i < key_size; ++i) {
     Node *node = lattice->NewNode();
-    node->key.assign(lattice->key(), i, key_size - i);
+    node->key = lattice->node_allocator()->CopyString(
+        absl::string_view(lattice->key()).substr(i));
     lattice->Insert(i, node);
   }
 }
@@ -222,4 +242,64 @@ TEST(LatticeTest, ShrinkKeyTest) {
     }
   }
 }
+
+TEST(LatticeTest, ViterbiCachePosTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  EXPECT_EQ(lattice.viterbi_cache_pos(), 0);
+
+  lattice.SetViterbiCachePos(5);
+  lattice.AddSuffix("s");
+  EXPECT_EQ(lattice.viterbi_cache_pos(), 4);
+
+  lattice.SetViterbiCachePos(6);
+  lattice.ShrinkKey(3);
+  EXPECT_EQ(lattice.viterbi_cache_pos(), 3);
+
+  lattice.SetViterbiCachePos(4);
+  Node *node = lattice.NewNode();
+  node->key = "s";
+  lattice.Insert(1, node);
+  EXPECT_EQ(lattice.viterbi_cache_pos(), 2);
+
+  lattice.Clear();
+  EXPECT_EQ(lattice.viterbi_cache_pos(), 0);
+}
+
+TEST(LatticeTest, ResetNodeCostTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  // Inserts [cached, not cached, cached] nodes at the same position.
+  Node *nodes[3];
+  for (int i = 0; i < 3; ++i) {
+    nodes[i] = lattice.NewNode();
+    nodes[i]->key = "es";
+    nodes[i]->wcost = 100;
+    nodes[i]->raw_wcost = 10;
+    if (i != 1) {
+      nodes[i]->attributes |= Node::ENABLE_CACHE;
+    }
+  }
+  nodes[0]->bnext = nodes[1];
+  nodes[1]->bnext = nodes[2];
+  lattice.Insert(1, nodes[0]);
+  lattice.SetViterbiCachePos(5);
+
+  lattice.ResetNodeCost();
+  EXPECT_EQ(lattice.viterbi_cache_pos(), 3);
+
+  std::vector<const Node *> begin_nodes, end_nodes;
+  for (Node *node = lattice.begin_nodes(1); node != nullptr;
+       node = node->bnext) {
+    begin_nodes.push_back(node);
+    EXPECT_EQ(node->wcost, 10);
+  }
+  for (Node *node = lattice.end_nodes(3); node != nullptr;
+       node = node->enext) {
+    end_nodes.push_back(node);
+  }
+  EXPECT_EQ(begin_nodes, (std::vector<const Node *>{nodes[0], nodes[2]}));
+  EXPECT_EQ(end_nodes, (std::vector<const Node *>{nodes[2], nodes[0]}));
+}
 }  // namespace mozc
@@ -43,6 +43,7 @@
 #include "converter/segmenter.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
+#include "absl/strings/str_cat.h"
 
 using mozc::dictionary::PosMatcher;
 using mozc::dictionary::SuppressionDictionary;
@@ -53,6 +54,34 @@ namespace {
 constexpr int kFreeListSize = 512;
 constexpr int kCostDiff = 3453;  // log prob of 1/1000
 
+// Returns the attributes of the candidate built from |nodes|.
+uint32_t GetCandidateAttributes(const std::vector<const Node *> &nodes) {
+  uint32_t attributes = 0;
+  for (const Node *node : nodes) {
+    if (node->constrained_prev != nullptr ||
+        (node->next != nullptr && node->next->constrained_prev == node)) {
+      // If result has constrained_node, set CONTEXT_SENSITIVE.
+      // If a node has constrained node, the node is generated by
+      //  a) compound node and resegmented via personal name resegmentation
+      //  b) compound-based reranking.
+      attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
+    }
+    if (node->attributes & Node::SPELLING_CORRECTION) {
+      attributes |= Segment::Candidate::SPELLING_CORRECTION;
+    }
+    if (node->attributes & Node::NO_VARIANTS_EXPANSION) {
+      attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
+    }
+    if (node->attributes & Node::USER_DICTIONARY) {
+      attributes |= Segment::Candidate::USER_DICTIONARY;
+    }
+    if (node->attributes & Node::SUFFIX_DICTIONARY) {
+      attributes |= Segment::Candidate::SUFFIX_DICTIONARY;
+    }
+  }
+  return attributes;
+}
+
 }  // namespace
 
 using converter::CandidateFilter;
@@ -153,39 +182,20 @@ void NBestGenerator::MakeCandidate(
   candidate->structure_cost = structure_cost;
   candidate->wcost = wcost;
 
+  candidate->attributes |= GetCandidateAttributes(nodes);
+
   bool is_functional = false;
   for (size_t i = 0; i < nodes.size(); ++i) {
     const Node *node = nodes[i];
     DCHECK(node != nullptr);
     if (!is_functional && !pos_matcher_->IsFunctional(node->lid)) {
-      candidate->content_key += node->key;
-      candidate->content_value += node->value;
+      absl::StrAppend(&candidate->content_key, node->key);
+      absl::StrAppend(&candidate->content_value, node->value);
     } else {
       is_functional = true;
     }
-    candidate->key += node->key;
-    candidate->value += node->value;
-
-    if (node->constrained_prev != nullptr ||
-        (node->next != nullptr && node->next->constrained_prev == node)) {
-      // If result has constrained_node, set CONTEXT_SENSITIVE.
-      // If a node has constrained node, the node is generated by
-      //  a) compound node and resegmented via personal name resegmentation
-      //  b) compound-based reranking.
-      candidate->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
-    }
-    if (node->attributes & Node::SPELLING_CORRECTION) {
-      candidate->attributes |= Segment::Candidate::SPELLING_CORRECTION;
-    }
-    if (node->attributes & Node::NO_VARIANTS_EXPANSION) {
-      candidate->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
-    }
-    if (node->attributes & Node::USER_DICTIONARY) {
-      candidate->attributes |= Segment::Candidate::USER_DICTIONARY;
-    }
-    if (node->attributes & Node::SUFFIX_DICTIONARY) {
-      candidate->attributes |= Segment::Candidate::SUFFIX_DICTIONARY;
-    }
+    absl::StrAppend(&candidate->key, node->key);
+    absl::StrAppend(&candidate->value, node->value);
   }
 
   if (candidate->content_key.empty() || candidate->content_value.empty()) {
@@ -194,6 +204,12 @@ void NBestGenerator::MakeCandidate(
   }
 
   candidate->inner_segment_boundary.clear();
+}
+
+void NBestGenerator::SetInnerSegmentBoundary(
+    const std::vector<const Node *> &nodes,
+    Segment::Candidate *candidate) const {
+  DCHECK(!nodes.empty());
   if (check_mode_ == ONLY_EDGE) {
     // For realtime conversion.  Set inner segment boundary for user history
     // prediction from realtime conversion result.
@@ -322,6 +338,7 @@ bool NBestGenerator::Next(const ConversionRequest &request,
     // Viterbi-best path.
     switch (InsertTopResult(request, original_key, candidate)) {
       case CandidateFilter::GOOD_CANDIDATE:
+        SetInnerSegmentBoundary(top_nodes_, candidate);
         return true;
       case CandidateFilter::STOP_ENUMERATION:
         return false;
@@ -354,7 +371,8 @@ bool NBestGenerator::Next(const ConversionRequest &request,
 
     // reached to the goal.
     if (rnode->end_pos == begin_node_->end_pos) {
-      std::vector<const Node *> nodes;
+      std::vector<const Node *> &nodes = path_nodes_;
+      nodes.clear();
       for (const QueueElement *elm = top->next; elm->next != nullptr;
            elm = elm->next) {
         nodes.push_back(elm->node);
@@ -362,12 +380,25 @@ bool NBestGenerator::Next(const ConversionRequest &request,
       CHECK(!nodes.empty());
       CHECK(!top_nodes_.empty());
 
+      // Most of the rejected paths are duplicates of the accepted ones.  Drop
+      // them before building the candidate strings.
+      if (filter_->IsDuplicatePath(request, GetCandidateAttributes(nodes),
+                                   nodes)) {
+#ifdef MOZC_CANDIDATE_DEBUG
+        MakeCandidate(candidate, top->gx, top->structure_gx, top->w_gx, nodes);
+        MOZC_CANDIDATE_LOG(candidate, "already seen");
+        bad_candidates_.push_back(*candidate);
+#endif  // MOZC_CANDIDATE_DEBUG
+        continue;
+      }
+
       MakeCandidate(candidate, top->gx, top->structure_gx, top->w_gx, nodes);
       const int filter_result = filter_->FilterCandidate(
           request, original_key, candidate, top_nodes_, nodes);
 
       switch (filter_result) {
         case CandidateFilter::GOOD_CANDIDATE:
+          SetInnerSegmentBoundary(nodes, candidate);
           return true;
         case CandidateFilter::STOP_ENUMERATION:
           return false;
@@ -151,10 +151,16 @@ class NBestGenerator {
                       const std::string &original_key,
                       Segment::Candidate *candidate);
 
+  // Builds the strings, costs and attributes of the candidate.
   void MakeCandidate(Segment::Candidate *candidate, int32_t cost,
                      int32_t structure_cost, int32_t wcost,
                      const std::vector<const Node *> &nodes) const;
 
+  // Sets the inner segment boundary of the candidate.  This is done only for
+  // the candidates accepted by the filter.
+  void SetInnerSegmentBoundary(const std::vector<const Node *> &nodes,
+                               Segment::Candidate *candidate) const;
+
   // Helper function for Next(). Checks node boundary conditions.
   BoundaryCheckResult BoundaryCheck(const Node *lnode, const Node *rnode,
                                     bool is_edge) const;
@@ -187,6 +193,8 @@ class NBestGenerator {
   Agenda agenda_;
   FreeList<QueueElement> freelist_;
   std::vector<const Node *> top_nodes_;
+  // Buffer for the nodes of the path reached the goal in Next().
+  std::vector<const Node *> path_nodes_;
   std::unique_ptr<converter::CandidateFilter> filter_;
   bool viterbi_result_checked_ = false;
   BoundaryCheckMode check_mode_ = STRICT;
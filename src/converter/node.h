@@ -35,6 +35,7 @@
 
 #include "base/port.h"
 #include "dictionary/dictionary_token.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 
@@ -177,9 +178,13 @@ struct Node {
   // actual_key: The actual search key that corresponds to the value.
   //           Can differ from key when no modifier conversion is enabled.
   // value: The surface form of the word.
-  std::string key;
-  std::string actual_key;
-  std::string value;
+  //
+  // These are views of strings owned by NodeAllocator (see
+  // NodeAllocator::CopyString()) or of static strings, which are released at
+  // once when the lattice is cleared.
+  absl::string_view key;
+  absl::string_view actual_key;
+  absl::string_view value;
 
   Node() { Init(); }
 
@@ -198,11 +203,13 @@ struct Node {
     cost = 0;
     raw_wcost = 0;
     attributes = 0;
-    key.clear();
-    actual_key.clear();
-    value.clear();
+    key = absl::string_view();
+    actual_key = absl::string_view();
+    value = absl::string_view();
   }
 
+  // Initializes the node with |token| except for strings, which need to be
+  // copied to NodeAllocator; see NodeAllocator::NewNodeFromToken().
   inline void InitFromToken(const dictionary::Token &token) {
     prev = nullptr;
     next = nullptr;
@@ -228,9 +235,9 @@ struct Node {
       attributes |= USER_DICTIONARY;
       attributes |= NO_VARIANTS_EXPANSION;
     }
-    key = token.key;
-    actual_key.clear();
-    value = token.value;
+    key = absl::string_view();
+    actual_key = absl::string_view();
+    value = absl::string_view();
   }
 };
 
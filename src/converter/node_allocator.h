@@ -30,13 +30,25 @@
 #ifndef MOZC_CONVERTER_NODE_ALLOCATOR_H_
 #define MOZC_CONVERTER_NODE_ALLOCATOR_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
 #include "base/container/freelist.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "converter/node.h"
+#include "dictionary/dictionary_token.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 
+// Allocates nodes and the strings they refer to.  Node::key, actual_key and
+// value are views of strings owned by this class (or of static strings), so
+// strings set to nodes need to be copied by CopyString().  Both nodes and
+// strings are released at once by Free().
 class NodeAllocator {
  public:
   NodeAllocator()
@@ -53,10 +65,48 @@ class NodeAllocator {
     return node;
   }
 
-  // Frees all nodes allocateed by NewNode().
+  // Allocates a new node initialized with |token|.  The key and value are
+  // copied to this allocator.
+  Node *NewNodeFromToken(const dictionary::Token &token) {
+    Node *node = NewNode();
+    node->InitFromToken(token);
+    node->key = CopyString(token.key);
+    node->value = CopyString(token.value);
+    return node;
+  }
+
+  // Copies |str| to the string arena and returns the view of the copy, which
+  // is valid until Free() is called.
+  absl::string_view CopyString(absl::string_view str) {
+    if (str.empty()) {
+      return absl::string_view();
+    }
+    if (str.size() > string_chunk_remaining_) {
+      AllocateStringChunk(str.size());
+    }
+    char *dest = string_chunk_ptr_;
+    memcpy(dest, str.data(), str.size());
+    string_chunk_ptr_ += str.size();
+    string_chunk_remaining_ -= str.size();
+    return absl::string_view(dest, str.size());
+  }
+
+  // Frees all nodes allocateed by NewNode() and all strings copied by
+  // CopyString().  The first chunk of strings is kept for reuse.
   void Free() {
     node_freelist_.Free();
     node_count_ = 0;
+    if (string_chunks_.size() > 1) {
+      string_chunks_.resize(1);
+    }
+    if (string_chunks_.empty()) {
+      string_chunk_ptr_ = nullptr;
+      string_chunk_remaining_ = 0;
+    } else {
+      // The first chunk has at least kStringChunkSize bytes.
+      string_chunk_ptr_ = string_chunks_[0].get();
+      string_chunk_remaining_ = kStringChunkSize;
+    }
   }
 
   size_t max_nodes_size() const { return max_nodes_size_; }
@@ -68,9 +118,27 @@ class NodeAllocator {
   size_t node_count() const { return node_count_; }
 
  private:
+  // Size of a string chunk.  A string longer than this is stored in its own
+  // chunk.
+  static constexpr size_t kStringChunkSize = 16 * 1024;
+
+  // Appends a new chunk having at least |min_size| bytes and makes it
+  // current.  The remaining space of the previous chunk is abandoned.
+  void AllocateStringChunk(size_t min_size) {
+    const size_t size = std::max(min_size, kStringChunkSize);
+    string_chunks_.emplace_back(new char[size]);
+    string_chunk_ptr_ = string_chunks_.back().get();
+    string_chunk_remaining_ = size;
+  }
+
   FreeList<Node> node_freelist_;
   size_t max_nodes_size_;
   size_t node_count_;
+
+  // Bump allocator for the strings of nodes.
+  std::vector<std::unique_ptr<char[]>> string_chunks_;
+  char *string_chunk_ptr_ = nullptr;
+  size_t string_chunk_remaining_ = 0;
 };
 
 }  // namespace mozc
@@ -112,8 +112,7 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
   NodeAllocator *allocator() { return allocator_; }
 
   Node *NewNodeFromToken(const dictionary::Token &token) {
-    Node *new_node = allocator_->NewNode();
-    new_node->InitFromToken(token);
+    Node *new_node = allocator_->NewNodeFromToken(token);
     new_node->wcost += penalty_;
     return new_node;
   }
@@ -27,16 +27,24 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/init_mozc.h"
+#include "config/config_handler.h"
+#include "converter/converter_benchmark.h"
+#include "converter/converter_interface.h"
 #include "converter/quality_regression_util.h"
 #include "engine/eval_engine_factory.h"
+#include "protocol/commands.pb.h"
+#include "request/conversion_request.h"
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -46,7 +54,17 @@ ABSL_FLAG(std::string, data_file, "", "engine data file");
 ABSL_FLAG(std::string, data_type, "", "engine data type");
 ABSL_FLAG(std::string, engine_type, "desktop", "engine type");
 ABSL_FLAG(std::string, output, "", "output file");
+ABSL_FLAG(bool, benchmark, false,
+          "Measure the performance of converting the keys of the test files "
+          "instead of checking the results");
+ABSL_FLAG(std::string, benchmark_request_type, "conversion",
+          "Request type of the benchmark: (conversion|prediction|suggestion)");
+ABSL_FLAG(int32_t, benchmark_threads, 1,
+          "Number of threads of the benchmark. Each thread has its own engine");
+ABSL_FLAG(int32_t, benchmark_iterations, 1,
+          "Number of times each thread converts all the keys");
 
+using mozc::ConverterBenchmark;
 using mozc::Engine;
 using mozc::quality_regression::QualityRegressionUtil;
 
@@ -72,11 +90,69 @@ absl::Status Run(std::ostream &out, const Engine &engine,
   return absl::OkStatus();
 }
 
+absl::Status RunBenchmark(
+    std::ostream &out,
+    const std::vector<QualityRegressionUtil::TestItem> &items) {
+  ConverterBenchmark::Options options;
+  const absl::StatusOr<mozc::ConversionRequest::RequestType> request_type =
+      ConverterBenchmark::ParseRequestType(
+          absl::GetFlag(FLAGS_benchmark_request_type));
+  if (!request_type.ok()) {
+    return request_type.status();
+  }
+  options.request_type = *request_type;
+  options.iterations = absl::GetFlag(FLAGS_benchmark_iterations);
+
+  std::vector<std::unique_ptr<Engine>> engines;
+  std::vector<const mozc::ConverterInterface *> converters;
+  const int num_threads = std::max(absl::GetFlag(FLAGS_benchmark_threads), 1);
+  for (int i = 0; i < num_threads; ++i) {
+    absl::StatusOr<std::unique_ptr<Engine>> engine =
+        mozc::CreateEvalEngine(absl::GetFlag(FLAGS_data_file),
+                               absl::GetFlag(FLAGS_data_type),
+                               absl::GetFlag(FLAGS_engine_type));
+    if (!engine.ok()) {
+      return engine.status();
+    }
+    converters.push_back((*engine)->GetConverter());
+    engines.push_back(*std::move(engine));
+  }
+
+  std::vector<std::string> keys;
+  keys.reserve(items.size());
+  for (const QualityRegressionUtil::TestItem &item : items) {
+    keys.push_back(item.key);
+  }
+  const ConverterBenchmark::Result result = ConverterBenchmark::Run(
+      converters, keys, mozc::commands::Request(),
+      mozc::config::ConfigHandler::DefaultConfig(), options);
+  out << "keys: " << keys.size() << "\nthreads: " << num_threads << "\n"
+      << result.ToString();
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv);
 
+  std::vector<QualityRegressionUtil::TestItem> items;
+  const absl::Status parse_result = QualityRegressionUtil::ParseFiles(
+      absl::GetFlag(FLAGS_test_files), &items);
+  if (!parse_result.ok()) {
+    LOG(ERROR) << parse_result;
+    return static_cast<int>(parse_result.code());
+  }
+
+  if (absl::GetFlag(FLAGS_benchmark)) {
+    const absl::Status status = RunBenchmark(std::cout, items);
+    if (!status.ok()) {
+      LOG(ERROR) << status;
+      return static_cast<int>(status.code());
+    }
+    return 0;
+  }
+
   absl::StatusOr<std::unique_ptr<Engine>> create_result =
       mozc::CreateEvalEngine(absl::GetFlag(FLAGS_data_file),
                              absl::GetFlag(FLAGS_data_type),
@@ -86,14 +162,6 @@ int main(int argc, char **argv) {
     return static_cast<int>(create_result.status().code());
   }
 
-  std::vector<QualityRegressionUtil::TestItem> items;
-  const absl::Status parse_result = QualityRegressionUtil::ParseFiles(
-      absl::GetFlag(FLAGS_test_files), &items);
-  if (!parse_result.ok()) {
-    LOG(ERROR) << parse_result;
-    return static_cast<int>(parse_result.code());
-  }
-
   absl::Status status;
   if (!absl::GetFlag(FLAGS_output).empty()) {
     std::ofstream out(absl::GetFlag(FLAGS_output));
@@ -209,6 +209,10 @@ absl::string_view Segment::Candidate::InnerSegmentIterator::GetContentValue()
 }
 
 constexpr int kCandidatesPoolSize = 16;
+// Most of the requests have only a few segments including the history
+// segments, so the chunk of the pool is kept small.  The pool is retained by
+// every session even when it is idle.
+constexpr int kSegmentsPoolSize = 8;
 
 Segment::Segment() : segment_type_(FREE), pool_(kCandidatesPoolSize) {}
 
@@ -477,15 +481,13 @@ std::string Segment::DebugString() const {
 Segments::Segments()
     : max_history_segments_size_(0),
       resized_(false),
-      pool_(32),
-      cached_lattice_(new Lattice()) {}
+      pool_(kSegmentsPoolSize) {}
 
 Segments::Segments(const Segments &x)
     : max_history_segments_size_(x.max_history_segments_size_),
       resized_(x.resized_),
-      pool_(32),
-      revert_entries_(x.revert_entries_),
-      cached_lattice_(new Lattice()) {
+      pool_(kSegmentsPoolSize),
+      revert_entries_(x.revert_entries_) {
   // Deep-copy segments.
   for (const Segment *segment : x.segments_) {
     *add_segment() = *segment;
@@ -671,7 +673,20 @@ Segments::RevertEntry *Segments::mutable_revert_entry(size_t i) {
   return &revert_entries_[i];
 }
 
-Lattice *Segments::mutable_cached_lattice() { return cached_lattice_.get(); }
+Lattice *Segments::mutable_cached_lattice() {
+  return mutable_cached_lattice_handle().get();
+}
+
+std::shared_ptr<Lattice> Segments::mutable_cached_lattice_handle() {
+  if (cached_lattice_ == nullptr) {
+    cached_lattice_ = std::make_shared<Lattice>();
+  }
+  return cached_lattice_;
+}
+
+void Segments::set_cached_lattice(std::shared_ptr<Lattice> lattice) {
+  cached_lattice_ = std::move(lattice);
+}
 
 std::string Segments::DebugString() const {
   std::stringstream os;
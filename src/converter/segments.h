@@ -495,8 +495,17 @@ class Segments final {
   RevertEntry *mutable_revert_entry(size_t i);
 
   // setter
+  // The lattice is allocated on the first use, as most of the instances (e.g.
+  // copies for the predictors and the idle sessions) never use it.
   Lattice *mutable_cached_lattice();
 
+  // Returns the owning handle of the cached lattice. The lattice is not copied
+  // by the copy constructor, so the owner of the mutable Segments passes this
+  // handle to set_cached_lattice() of a temporary copy to reuse the lattice
+  // across requests.
+  std::shared_ptr<Lattice> mutable_cached_lattice_handle();
+  void set_cached_lattice(std::shared_ptr<Lattice> lattice);
+
  private:
   // LINT.IfChange
   size_t max_history_segments_size_;
@@ -505,7 +514,7 @@ class Segments final {
   ObjectPool<Segment> pool_;
   std::deque<Segment *> segments_;
   std::vector<RevertEntry> revert_entries_;
-  std::unique_ptr<Lattice> cached_lattice_;
+  std::shared_ptr<Lattice> cached_lattice_;
   // LINT.ThenChange(//converter/segments_matchers.h)
 };
 
@@ -38,6 +38,7 @@
 #include "base/system_util.h"
 #include "base/util.h"
 #include "config/config_handler.h"
+#include "converter/lattice.h"
 #include "testing/gunit.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
@@ -381,6 +382,28 @@ TEST(SegmentsTest, CopyTest) {
   }
 }
 
+TEST(SegmentsTest, CachedLattice) {
+  Segments src;
+  Lattice *lattice = src.mutable_cached_lattice();
+  ASSERT_NE(lattice, nullptr);
+  EXPECT_EQ(src.mutable_cached_lattice(), lattice);
+
+  // The lattice is not copied.
+  Segments copied = src;
+  EXPECT_NE(copied.mutable_cached_lattice(), lattice);
+
+  Segments shared = src;
+  shared.set_cached_lattice(src.mutable_cached_lattice_handle());
+  EXPECT_EQ(shared.mutable_cached_lattice(), lattice);
+
+  // The handle allocates the lattice even if |src| has not used it yet.
+  Segments new_src;
+  Segments new_shared;
+  new_shared.set_cached_lattice(new_src.mutable_cached_lattice_handle());
+  EXPECT_EQ(new_shared.mutable_cached_lattice(),
+            new_src.mutable_cached_lattice());
+}
+
 TEST(CandidateTest, functional_key) {
   Segment::Candidate candidate;
   candidate.Init();
@@ -41,13 +41,21 @@
 #include "base/logging.h"
 #include "base/version.h"
 #include "data_manager/dataset_reader.h"
+#include "data_manager/prefetch_manifest.h"
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/segmenter_data.pb.h"
+#include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 
+ABSL_FLAG(bool, data_prefetch, false,
+          "Record the pages of the data set touched by the first conversions "
+          "and prefetch them on the next launch.");
+
 namespace mozc {
 namespace {
 
@@ -434,16 +442,52 @@ DataManager::Status DataManager::InitFromFile(const std::string &path) {
 
 DataManager::Status DataManager::InitFromFile(const std::string &path,
                                               absl::string_view magic) {
-  absl::StatusOr<Mmap> mmap = Mmap::Map(path, Mmap::READ_ONLY);
+  // mlock() reads all the pages at once, which defeats the prefetch, and makes
+  // the manifest record all the pages as touched.
+  absl::StatusOr<Mmap> mmap = absl::GetFlag(FLAGS_data_prefetch)
+                                  ? Mmap::MapWithoutLock(path, Mmap::READ_ONLY)
+                                  : Mmap::Map(path, Mmap::READ_ONLY);
   if (!mmap.ok()) {
     LOG(ERROR) << mmap.status();
     return Status::MMAP_FAILURE;
   }
   mmap_ = *std::move(mmap);
   const absl::string_view data(mmap_.begin(), mmap_.size());
+  prefetch_manifest_path_ = absl::StrCat(path, ".prefetch");
+  if (absl::GetFlag(FLAGS_data_prefetch)) {
+    // Issue the read-ahead before parsing the data set so that the I/O runs
+    // while the engine is being built.
+    absl::StatusOr<PrefetchManifest> manifest =
+        PrefetchManifest::Load(prefetch_manifest_path_);
+    if (manifest.ok()) {
+      if (absl::Status s = manifest->Prefetch(data); !s.ok()) {
+        LOG(WARNING) << "Failed to prefetch " << path << ": " << s;
+      }
+    } else {
+      VLOG(1) << "No prefetch manifest: " << manifest.status();
+    }
+  }
   return InitFromArray(data, magic);
 }
 
+void DataManager::SavePrefetchManifest() const {
+  if (!absl::GetFlag(FLAGS_data_prefetch) || prefetch_manifest_path_.empty()) {
+    return;
+  }
+  absl::StatusOr<PrefetchManifest> manifest = PrefetchManifest::Record(
+      absl::string_view(mmap_.begin(), mmap_.size()));
+  if (!manifest.ok()) {
+    LOG(WARNING) << "Failed to record the prefetch manifest: "
+                 << manifest.status();
+    return;
+  }
+  // The directory of the data set may not be writable for the user.  The
+  // manifest is only a hint, so the failure is not critical.
+  if (absl::Status s = manifest->Save(prefetch_manifest_path_); !s.ok()) {
+    LOG(WARNING) << "Failed to save " << prefetch_manifest_path_ << ": " << s;
+  }
+}
+
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
     absl::string_view array, absl::string_view magic) {
   DataSetReader reader;
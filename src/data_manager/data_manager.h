@@ -88,7 +88,9 @@ class DataManager : public DataManagerInterface {
   Status InitFromArray(absl::string_view array, absl::string_view magic);
 
   // The same as above InitFromArray() but the data is loaded using mmap, which
-  // is owned in this instance.
+  // is owned in this instance.  With --data_prefetch, the ranges recorded in
+  // the prefetch manifest next to the file (|path| + ".prefetch") are read
+  // ahead, and the mapping isn't locked in memory.
   Status InitFromFile(const std::string &path);
   Status InitFromFile(const std::string &path, absl::string_view magic);
 
@@ -162,10 +164,15 @@ class DataManager : public DataManagerInterface {
   absl::string_view GetTypingModel(const std::string &name) const override;
   absl::string_view GetDataVersion() const override;
 
+  // Writes the prefetch manifest of the data set loaded by InitFromFile().
+  // Does nothing without --data_prefetch.
+  void SavePrefetchManifest() const override;
+
  private:
   Status InitFromReader(const DataSetReader &reader);
 
   Mmap mmap_;
+  std::string prefetch_manifest_path_;
   absl::string_view pos_matcher_data_;
   absl::string_view user_pos_token_array_data_;
   absl::string_view user_pos_string_array_data_;
@@ -148,6 +148,10 @@ class DataManagerInterface {
   // Gets the data version string.
   virtual absl::string_view GetDataVersion() const = 0;
 
+  // Records the pages of the data set touched so far, so that they are
+  // prefetched on the next launch.  Does nothing by default.
+  virtual void SavePrefetchManifest() const {}
+
  protected:
   DataManagerInterface() = default;
 };
@@ -158,13 +158,16 @@ bool DataSetReader::VerifyChecksum(absl::string_view memblock) {
   // Checksum is computed for all but last 28 bytes.
   const std::string& actual_checksum = internal::UnverifiedSHA1::MakeDigest(
       memblock.substr(0, memblock.size() - 28));
+  return actual_checksum == GetChecksum(memblock);
+}
 
+absl::string_view DataSetReader::GetChecksum(absl::string_view memblock) {
+  if (memblock.size() < kFooterSize) {
+    return absl::string_view();
+  }
   // Extract the stored SHA1; see dataset.proto for file format.
   const std::size_t kSHA1Length = 20;
-  absl::string_view expected_checksum =
-      absl::ClippedSubstr(memblock, memblock.size() - 28, kSHA1Length);
-
-  return actual_checksum == expected_checksum;
+  return absl::ClippedSubstr(memblock, memblock.size() - 28, kSHA1Length);
 }
 
 }  // namespace mozc
@@ -56,6 +56,11 @@ class DataSetReader {
   // Verifies the checksum of binary image.
   static bool VerifyChecksum(absl::string_view memblock);
 
+  // Returns the SHA1 checksum stored in the footer of binary image, which
+  // identifies the content of the data set.  Returns an empty string if
+  // |memblock| is too short.  The checksum is not verified.
+  static absl::string_view GetChecksum(absl::string_view memblock);
+
   const std::map<std::string, absl::string_view> &name_to_data_map() const {
     return name_to_data_map_;
   }
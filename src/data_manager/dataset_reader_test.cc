@@ -63,6 +63,7 @@ TEST(DataSetReaderTest, ValidData) {
 
   DataSetReader r;
   ASSERT_TRUE(DataSetReader::VerifyChecksum(image));
+  EXPECT_EQ(DataSetReader::GetChecksum(image).size(), 20);
   ASSERT_TRUE(r.Init(image, kTestMagicNumber));
 
   absl::string_view data;
@@ -87,6 +88,7 @@ TEST(DataSetReaderTest, BrokenMetadata) {
 
   // Only magic number, no metadata.
   EXPECT_FALSE(DataSetReader::VerifyChecksum(kTestMagicNumber));
+  EXPECT_TRUE(DataSetReader::GetChecksum(kTestMagicNumber).empty());
   EXPECT_FALSE(r.Init(kTestMagicNumber, kTestMagicNumber));
 
   // Metadata size is too small.
@@ -43,7 +43,10 @@
 namespace mozc {
 namespace {
 
-bool IsValidAlignment(int a) { return a == 8 || a == 16 || a == 32 || a == 64; }
+// 512 bits is for the data accessed by cache lines, e.g., blocked bloom filters.
+bool IsValidAlignment(int a) {
+  return a == 8 || a == 16 || a == 32 || a == 64 || a == 512;
+}
 
 }  // namespace
 
@@ -48,7 +48,7 @@ class DataSetWriter {
   ~DataSetWriter();
 
   // Adds a binary image to the packed file so that data is aligned at the
-  // specified bit boundary (8, 16, 32, or 64).
+  // specified bit boundary (8, 16, 32, 64, or 512).
   void Add(const std::string &name, int alignment, absl::string_view data);
 
   // Similar to Add() for absl::string_view but data is read from file.
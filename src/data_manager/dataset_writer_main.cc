@@ -39,7 +39,7 @@
 //
 // name:alignment:/path/to/infile
 //
-// where alignment must be one of {8, 16, 32, 64}.  Each packed file can be
+// where alignment must be one of {8, 16, 32, 64, 512}.  Each packed file can be
 // retrieved by DataSetReader through its name.
 
 #include <ios>
@@ -0,0 +1,149 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "data_manager/prefetch_manifest.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/mmap.h"
+#include "data_manager/dataset_reader.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+// The manifest is a small text file:
+//   MozcPrefetchManifest 2
+//   <data ID>
+//   <offset> <length>
+//   ...
+constexpr absl::string_view kHeader = "MozcPrefetchManifest 2";
+
+}  // namespace
+
+std::string PrefetchManifest::GetDataId(absl::string_view data) {
+  return absl::BytesToHexString(DataSetReader::GetChecksum(data));
+}
+
+absl::StatusOr<PrefetchManifest> PrefetchManifest::Record(
+    absl::string_view data) {
+  std::string data_id = GetDataId(data);
+  if (data_id.empty()) {
+    return absl::InvalidArgumentError("The data set has no checksum");
+  }
+  absl::StatusOr<std::vector<Range>> ranges =
+      Mmap::GetMappedRanges(data.data(), data.size());
+  if (!ranges.ok()) {
+    return std::move(ranges).status();
+  }
+  return PrefetchManifest(std::move(data_id), *std::move(ranges));
+}
+
+absl::StatusOr<PrefetchManifest> PrefetchManifest::Parse(
+    absl::string_view serialized) {
+  std::vector<absl::string_view> lines =
+      absl::StrSplit(serialized, '\n', absl::SkipEmpty());
+  if (lines.size() < 2 || lines[0] != kHeader) {
+    return absl::InvalidArgumentError("Invalid prefetch manifest header");
+  }
+  if (lines[1].empty()) {
+    return absl::InvalidArgumentError("Empty data ID");
+  }
+  std::vector<Range> ranges;
+  ranges.reserve(lines.size() - 2);
+  for (size_t i = 2; i < lines.size(); ++i) {
+    const std::pair<absl::string_view, absl::string_view> fields =
+        absl::StrSplit(lines[i], ' ');
+    Range range;
+    if (!absl::SimpleAtoi(fields.first, &range.first) ||
+        !absl::SimpleAtoi(fields.second, &range.second)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid range: ", lines[i]));
+    }
+    ranges.push_back(range);
+  }
+  return PrefetchManifest(std::string(lines[1]), std::move(ranges));
+}
+
+absl::StatusOr<PrefetchManifest> PrefetchManifest::Load(
+    const std::string &path) {
+  absl::StatusOr<std::string> serialized = FileUtil::GetContents(path);
+  if (!serialized.ok()) {
+    return std::move(serialized).status();
+  }
+  return Parse(*serialized);
+}
+
+absl::Status PrefetchManifest::Save(const std::string &path) const {
+  // Write to a temporary file first so that a concurrent launch never reads a
+  // partially written manifest.
+  const std::string tmp_path = absl::StrCat(path, ".tmp");
+  if (absl::Status s = FileUtil::SetContents(tmp_path, Serialize()); !s.ok()) {
+    return s;
+  }
+  return FileUtil::AtomicRename(tmp_path, path);
+}
+
+std::string PrefetchManifest::Serialize() const {
+  std::string serialized = absl::StrCat(kHeader, "\n", data_id_, "\n");
+  for (const auto &[offset, length] : ranges_) {
+    absl::StrAppend(&serialized, offset, " ", length, "\n");
+  }
+  return serialized;
+}
+
+absl::Status PrefetchManifest::Prefetch(absl::string_view data) const {
+  if (const std::string data_id = GetDataId(data); data_id != data_id_) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "The data ID ", data_id, " doesn't match the manifest: ", data_id_));
+  }
+  for (const auto &[offset, length] : ranges_) {
+    if (offset > data.size() || length > data.size() - offset) {
+      return absl::OutOfRangeError(
+          absl::StrCat("Invalid range: ", offset, " ", length));
+    }
+    if (absl::Status s = Mmap::Prefetch(data.data() + offset, length);
+        !s.ok()) {
+      return s;
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mozc
@@ -0,0 +1,89 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_DATA_MANAGER_PREFETCH_MANIFEST_H_
+#define MOZC_DATA_MANAGER_PREFETCH_MANIFEST_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+// A list of the byte ranges of a data set which were touched during the first
+// conversions.  The ranges are recorded from the pages mapped in the page table
+// of this process, and are prefetched on the next launch so that the first
+// conversion doesn't wait for the page faults on the dictionary, connector,
+// etc.  The manifest is keyed by the checksum stored in the data set, so it's
+// never applied to another data set even if it has the same size.
+class PrefetchManifest {
+ public:
+  // Pair of the offset from the beginning of the data set and the length.
+  using Range = std::pair<size_t, size_t>;
+
+  PrefetchManifest() = default;
+  PrefetchManifest(std::string data_id, std::vector<Range> ranges)
+      : data_id_(std::move(data_id)), ranges_(std::move(ranges)) {}
+
+  // Returns the ID of the data set image |data|, i.e. the hex string of its
+  // checksum.  Only the footer of |data| is read.
+  static std::string GetDataId(absl::string_view data);
+
+  // Records the ranges of |data| which this process has touched.
+  static absl::StatusOr<PrefetchManifest> Record(absl::string_view data);
+
+  // Parses the output of Serialize().
+  static absl::StatusOr<PrefetchManifest> Parse(absl::string_view serialized);
+
+  // Loads and saves the manifest file.
+  static absl::StatusOr<PrefetchManifest> Load(const std::string &path);
+  absl::Status Save(const std::string &path) const;
+
+  std::string Serialize() const;
+
+  // Asks the OS to read the recorded ranges of |data| ahead.  Fails if |data|
+  // is not the data set the manifest was recorded for, as it's stale.
+  absl::Status Prefetch(absl::string_view data) const;
+
+  const std::string &data_id() const { return data_id_; }
+  const std::vector<Range> &ranges() const { return ranges_; }
+
+ private:
+  std::string data_id_;
+  std::vector<Range> ranges_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_DATA_MANAGER_PREFETCH_MANIFEST_H_
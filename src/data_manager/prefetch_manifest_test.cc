@@ -0,0 +1,133 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "data_manager/prefetch_manifest.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/file_util.h"
+#include "data_manager/dataset_writer.h"
+#include "testing/gmock.h"
+#include "testing/googletest.h"
+#include "testing/gunit.h"
+#include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+std::string MakeDataSet(absl::string_view content) {
+  DataSetWriter writer("magic");
+  writer.Add("content", 64, content);
+  std::stringstream out;
+  writer.Finish(&out);
+  return out.str();
+}
+
+TEST(PrefetchManifestTest, SerializeAndParse) {
+  const PrefetchManifest manifest("0123abcd", {{0, 10}, {40, 60}});
+  const absl::StatusOr<PrefetchManifest> parsed =
+      PrefetchManifest::Parse(manifest.Serialize());
+  ASSERT_OK(parsed);
+  EXPECT_EQ(parsed->data_id(), "0123abcd");
+  EXPECT_THAT(parsed->ranges(), ElementsAre(Pair(0, 10), Pair(40, 60)));
+}
+
+TEST(PrefetchManifestTest, ParseInvalid) {
+  EXPECT_FALSE(PrefetchManifest::Parse("").ok());
+  EXPECT_FALSE(PrefetchManifest::Parse("MozcPrefetchManifest 1\n100\n").ok());
+  EXPECT_FALSE(PrefetchManifest::Parse("MozcPrefetchManifest 2\n").ok());
+  EXPECT_FALSE(
+      PrefetchManifest::Parse("MozcPrefetchManifest 2\nabcd\n10\n").ok());
+  EXPECT_FALSE(
+      PrefetchManifest::Parse("MozcPrefetchManifest 2\nabcd\nx 10\n").ok());
+}
+
+TEST(PrefetchManifestTest, SaveAndLoad) {
+  const std::string path = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "prefetch_manifest_test.prefetch");
+  const PrefetchManifest manifest("0123abcd", {{1024, 2048}});
+  ASSERT_OK(manifest.Save(path));
+  const absl::StatusOr<PrefetchManifest> loaded = PrefetchManifest::Load(path);
+  ASSERT_OK(loaded);
+  EXPECT_EQ(loaded->data_id(), "0123abcd");
+  EXPECT_THAT(loaded->ranges(), ElementsAre(Pair(1024, 2048)));
+  EXPECT_FALSE(PrefetchManifest::Load(path + ".missing").ok());
+}
+
+TEST(PrefetchManifestTest, DataId) {
+  const std::string data1 = MakeDataSet(std::string(10000, 'x'));
+  const std::string data2 = MakeDataSet(std::string(10000, 'y'));
+  ASSERT_EQ(data1.size(), data2.size());
+  EXPECT_EQ(PrefetchManifest::GetDataId(data1).size(), 40);
+  EXPECT_NE(PrefetchManifest::GetDataId(data1),
+            PrefetchManifest::GetDataId(data2));
+  EXPECT_TRUE(PrefetchManifest::GetDataId("short").empty());
+}
+
+TEST(PrefetchManifestTest, Prefetch) {
+  const std::string data1 = MakeDataSet(std::string(10000, 'x'));
+  const std::string data2 = MakeDataSet(std::string(10000, 'y'));
+  const PrefetchManifest manifest(PrefetchManifest::GetDataId(data1),
+                                  {{0, 100}, {4096, 4096}});
+#ifndef _WIN32
+  EXPECT_OK(manifest.Prefetch(data1));
+#endif  // _WIN32
+  // The manifest for the different data of the same size is not used.
+  EXPECT_FALSE(manifest.Prefetch(data2).ok());
+
+  const PrefetchManifest out_of_range(PrefetchManifest::GetDataId(data1),
+                                      {{data1.size() - 10, 20}});
+  EXPECT_FALSE(out_of_range.Prefetch(data1).ok());
+}
+
+#ifdef __linux__
+TEST(PrefetchManifestTest, Record) {
+  // The data in the heap which has just been written is mapped.
+  const std::string data = MakeDataSet(std::string(10000, 'x'));
+  const absl::StatusOr<PrefetchManifest> manifest =
+      PrefetchManifest::Record(data);
+  ASSERT_OK(manifest);
+  EXPECT_EQ(manifest->data_id(), PrefetchManifest::GetDataId(data));
+  EXPECT_THAT(manifest->ranges(), ElementsAre(Pair(0, data.size())));
+  EXPECT_OK(manifest->Prefetch(data));
+
+  EXPECT_FALSE(PrefetchManifest::Record("short").ok());
+}
+#endif  // __linux__
+
+}  // namespace
+}  // namespace mozc
@@ -168,12 +168,14 @@
         '<(gen_out_dir)/pos_map.inc',
         'user_dictionary.cc',
         'user_dictionary_importer.cc',
+        'user_dictionary_journal.cc',
         'user_dictionary_session.cc',
         'user_dictionary_session_handler.cc',
         'user_dictionary_storage.cc',
         'user_dictionary_util.cc',
       ],
       'dependencies': [
+        '../base/absl.gyp:absl_random',
         '../base/absl.gyp:absl_status',
         '../base/absl.gyp:absl_strings',
         '../base/absl.gyp:absl_synchronization',
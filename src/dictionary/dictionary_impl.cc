@@ -29,7 +29,9 @@
 
 #include "dictionary/dictionary_impl.h"
 
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -40,7 +42,9 @@
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "protocol/config.pb.h"
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace dictionary {
@@ -157,6 +161,44 @@ void DictionaryImpl::LookupPredictive(
   }
 }
 
+void DictionaryImpl::LookupPredictiveMulti(
+    absl::Span<const absl::string_view> keys,
+    const ConversionRequest &conversion_request,
+    absl::FunctionRef<Callback *(size_t)> get_callback) const {
+  // The system dictionary looks up all the keys at once.  To keep the order of
+  // the results same as LookupPredictive(), the other dictionaries look up each
+  // key after the system dictionary reports it, i.e., when the callback for the
+  // next key is requested.
+  std::optional<CallbackWithFilter> callback_with_filter;
+  size_t current_index = 0;
+  auto lookup_other_dictionaries = [&]() {
+    if (!callback_with_filter.has_value()) {
+      return;
+    }
+    for (size_t i = 1; i < dics_.size(); ++i) {
+      dics_[i]->LookupPredictive(keys[current_index], conversion_request,
+                                 &*callback_with_filter);
+    }
+    callback_with_filter.reset();
+  };
+  dics_[0]->LookupPredictiveMulti(
+      keys, conversion_request, [&](size_t index) -> Callback * {
+        lookup_other_dictionaries();
+        Callback *callback = get_callback(index);
+        if (callback == nullptr) {
+          return nullptr;
+        }
+        current_index = index;
+        callback_with_filter.emplace(
+            conversion_request.config().use_spelling_correction(),
+            conversion_request.config().use_zip_code_conversion(),
+            conversion_request.config().use_t13n_conversion(), pos_matcher_,
+            suppression_dictionary_, callback);
+        return &*callback_with_filter;
+      });
+  lookup_other_dictionaries();
+}
+
 void DictionaryImpl::LookupPrefix(absl::string_view key,
                                   const ConversionRequest &conversion_request,
                                   Callback *callback) const {
@@ -30,13 +30,16 @@
 #ifndef MOZC_DICTIONARY_DICTIONARY_INTERFACE_H_
 #define MOZC_DICTIONARY_DICTIONARY_INTERFACE_H_
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
 #include "base/port.h"
 #include "dictionary/dictionary_token.h"
 #include "request/conversion_request.h"
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace dictionary {
@@ -123,6 +126,25 @@ class DictionaryInterface {
                                 const ConversionRequest &conversion_request,
                                 Callback *callback) const = 0;
 
+  // Looks up values whose keys start from each of the keys. The results are
+  // the same as calling LookupPredictive() for the keys in order, but the
+  // dictionary may traverse the common prefix of the keys only once.
+  // `get_callback(i)` is called for each key in order, right before the results
+  // for `keys[i]` are reported, and returns the callback for them. If it
+  // returns nullptr, the lookup of the remaining keys is skipped.
+  virtual void LookupPredictiveMulti(
+      absl::Span<const absl::string_view> keys,
+      const ConversionRequest &conversion_request,
+      absl::FunctionRef<Callback *(size_t)> get_callback) const {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      Callback *callback = get_callback(i);
+      if (callback == nullptr) {
+        return;
+      }
+      LookupPredictive(keys[i], conversion_request, callback);
+    }
+  }
+
   // Looks up values whose keys are prefixes of the key.
   // (e.g. key = "abc" -> {"abc": "ABC", "a": "A"})
   virtual void LookupPrefix(absl::string_view key,
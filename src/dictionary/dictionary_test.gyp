@@ -41,6 +41,7 @@
         'single_kanji_dictionary_test.cc',
         'suffix_dictionary_test.cc',
         'user_dictionary_importer_test.cc',
+        'user_dictionary_journal_test.cc',
         'user_dictionary_session_handler_test.cc',
         'user_dictionary_session_test.cc',
         'user_dictionary_storage_test.cc',
@@ -551,36 +551,43 @@ bool SystemDictionary::HasValue(absl::string_view value) const {
   return false;
 }
 
+void SystemDictionary::ExpandPredictiveLookupStates(
+    const std::vector<PredictiveLookupSearchState> &states, char target_char,
+    const KeyExpansionTable &table,
+    std::vector<PredictiveLookupSearchState> *next) const {
+  const ExpandedKey &chars = table.ExpandKey(target_char);
+  next->clear();
+  for (PredictiveLookupSearchState state : states) {
+    for (key_trie_.MoveToFirstChild(&state.node);
+         key_trie_.IsValidNode(state.node);
+         key_trie_.MoveToNextSibling(&state.node)) {
+      const char c = key_trie_.GetEdgeLabelToParentNode(state.node);
+      if (!chars.IsHit(c)) {
+        continue;
+      }
+      const int num_expanded =
+          state.num_expanded + static_cast<int>(c != target_char);
+      next->push_back(PredictiveLookupSearchState(
+          state.node, state.key_pos + 1, num_expanded));
+    }
+  }
+}
+
 void SystemDictionary::CollectPredictiveNodesInBfsOrder(
-    absl::string_view encoded_key, const KeyExpansionTable &table, size_t limit,
+    const std::vector<PredictiveLookupSearchState> &states, size_t limit,
     std::vector<PredictiveLookupSearchState> *result) const {
+  if (states.empty()) {
+    return;
+  }
   std::queue<PredictiveLookupSearchState> queue;
-  queue.push(PredictiveLookupSearchState(LoudsTrie::Node(), 0, false));
+  for (const PredictiveLookupSearchState &state : states) {
+    queue.push(state);
+  }
   do {
     PredictiveLookupSearchState state = queue.front();
     queue.pop();
 
-    // Update traversal state for |encoded_key| and its expanded keys.
-    if (state.key_pos < encoded_key.size()) {
-      const char target_char = encoded_key[state.key_pos];
-      const ExpandedKey &chars = table.ExpandKey(target_char);
-
-      for (key_trie_.MoveToFirstChild(&state.node);
-           key_trie_.IsValidNode(state.node);
-           key_trie_.MoveToNextSibling(&state.node)) {
-        const char c = key_trie_.GetEdgeLabelToParentNode(state.node);
-        if (!chars.IsHit(c)) {
-          continue;
-        }
-        const int num_expanded =
-            state.num_expanded + static_cast<int>(c != target_char);
-        queue.push(PredictiveLookupSearchState(state.node, state.key_pos + 1,
-                                               num_expanded));
-      }
-      continue;
-    }
-
-    // Collect prediction keys (state.key_pos >= encoded_key.size()).
+    // Collect prediction keys.
     if (key_trie_.IsTerminalNode(state.node)) {
       result->push_back(state);
     }
@@ -616,6 +623,16 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
   } while (!queue.empty());
 }
 
+namespace {
+
+// TODO(noriyukit): Lookup limit should be implemented at caller side by using
+// callback mechanism.  This hard-coding limits the capability and generality
+// of dictionary module.  CollectPredictiveNodesInBfsOrder() and the following
+// loop for callback should be integrated for this purpose.
+constexpr size_t kPredictiveLookupLimit = 64;
+
+}  // namespace
+
 void SystemDictionary::LookupPredictive(
     absl::string_view key, const ConversionRequest &conversion_request,
     Callback *callback) const {
@@ -636,22 +653,85 @@ void SystemDictionary::LookupPredictive(
           ? hiragana_expansion_table_
           : KeyExpansionTable::GetDefaultInstance();
 
-  // TODO(noriyukit): Lookup limit should be implemented at caller side by using
-  // callback mechanism.  This hard-coding limits the capability and generality
-  // of dictionary module.  CollectPredictiveNodesInBfsOrder() and the following
-  // loop for callback should be integrated for this purpose.
-  constexpr size_t kLookupLimit = 64;
+  // Update traversal state for |encoded_key| and its expanded keys.
+  std::vector<PredictiveLookupSearchState> states = {
+      PredictiveLookupSearchState(LoudsTrie::Node(), 0, 0)};
+  std::vector<PredictiveLookupSearchState> next;
+  for (const char c : encoded_key) {
+    ExpandPredictiveLookupStates(states, c, table, &next);
+    states.swap(next);
+  }
+
   std::vector<PredictiveLookupSearchState> result;
-  result.reserve(kLookupLimit);
-  CollectPredictiveNodesInBfsOrder(encoded_key, table, kLookupLimit, &result);
+  result.reserve(kPredictiveLookupLimit);
+  CollectPredictiveNodesInBfsOrder(states, kPredictiveLookupLimit, &result);
+  ReportPredictiveNodes(key, encoded_key.size(), result, callback);
+}
+
+void SystemDictionary::LookupPredictiveMulti(
+    absl::Span<const absl::string_view> keys,
+    const ConversionRequest &conversion_request,
+    absl::FunctionRef<Callback *(size_t)> get_callback) const {
+  const KeyExpansionTable &table =
+      conversion_request.IsKanaModifierInsensitiveConversion()
+          ? hiragana_expansion_table_
+          : KeyExpansionTable::GetDefaultInstance();
 
+  // states[d] holds the traversal states after the first d characters of the
+  // previous key.  The states for the common prefix with the previous key are
+  // reused and only the rest is traversed.  Each key is traversed and reported
+  // before the callback for the next key is requested, so the lookup stops as
+  // soon as |get_callback| returns nullptr.
+  std::vector<std::vector<PredictiveLookupSearchState>> states = {
+      {PredictiveLookupSearchState(LoudsTrie::Node(), 0, 0)}};
+  std::vector<PredictiveLookupSearchState> result;
+  result.reserve(kPredictiveLookupLimit);
+  std::string prev_key, encoded_key;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Callback *callback = get_callback(i);
+    if (callback == nullptr) {
+      return;
+    }
+    if (keys[i].empty()) {
+      continue;
+    }
+    encoded_key.clear();
+    codec_->EncodeKey(keys[i], &encoded_key);
+    if (encoded_key.size() > LoudsTrie::kMaxDepth) {
+      continue;
+    }
+    size_t common_len = 0;
+    while (common_len < prev_key.size() && common_len < encoded_key.size() &&
+           prev_key[common_len] == encoded_key[common_len]) {
+      ++common_len;
+    }
+    states.resize(common_len + 1);
+    for (size_t pos = common_len; pos < encoded_key.size(); ++pos) {
+      std::vector<PredictiveLookupSearchState> next;
+      ExpandPredictiveLookupStates(states.back(), encoded_key[pos], table,
+                                   &next);
+      states.push_back(std::move(next));
+    }
+    prev_key.swap(encoded_key);
+
+    result.clear();
+    CollectPredictiveNodesInBfsOrder(states.back(), kPredictiveLookupLimit,
+                                     &result);
+    ReportPredictiveNodes(keys[i], prev_key.size(), result, callback);
+  }
+}
+
+void SystemDictionary::ReportPredictiveNodes(
+    absl::string_view key, size_t encoded_key_size,
+    const std::vector<PredictiveLookupSearchState> &nodes,
+    Callback *callback) const {
   // Reused buffer and instances inside the following loop.
   char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
   std::string decoded_key, actual_key_str;
   decoded_key.reserve(key.size() * 2);
   actual_key_str.reserve(key.size() * 2);
-  for (size_t i = 0; i < result.size(); ++i) {
-    const PredictiveLookupSearchState &state = result[i];
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const PredictiveLookupSearchState &state = nodes[i];
 
     // Computes the actual key.  For example:
     // key = "くー"
@@ -660,8 +740,8 @@ void SystemDictionary::LookupPredictive(
     const absl::string_view encoded_actual_key =
         key_trie_.RestoreKeyString(state.node, encoded_actual_key_buffer);
     const absl::string_view encoded_actual_key_prediction_suffix =
-        absl::ClippedSubstr(encoded_actual_key, encoded_key.size(),
-                            encoded_actual_key.size() - encoded_key.size());
+        absl::ClippedSubstr(encoded_actual_key, encoded_key_size,
+                            encoded_actual_key.size() - encoded_key_size);
 
     // decoded_key = "くーぐる" (= key + prediction suffix)
     decoded_key.clear();
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_H_
 #define MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <set>
@@ -45,8 +46,10 @@
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
 #include "absl/container/btree_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace dictionary {
@@ -141,6 +144,13 @@ class SystemDictionary : public DictionaryInterface {
                         const ConversionRequest &conversion_request,
                         Callback *callback) const override;
 
+  // Reuses the trie nodes for the common prefix with the previous key, so
+  // keys sharing long prefixes should be adjacent in |keys|.
+  void LookupPredictiveMulti(
+      absl::Span<const absl::string_view> keys,
+      const ConversionRequest &conversion_request,
+      absl::FunctionRef<Callback *(size_t)> get_callback) const override;
+
   void LookupPrefix(absl::string_view key,
                     const ConversionRequest &conversion_request,
                     Callback *callback) const override;
@@ -184,9 +194,24 @@ class SystemDictionary : public DictionaryInterface {
       absl::string_view::size_type key_pos, int num_expanded,
       char *actual_key_buffer, std::string *actual_prefix) const;
 
+  // Moves each of |states| to its children whose edge label matches
+  // |target_char| or its expansion.
+  void ExpandPredictiveLookupStates(
+      const std::vector<PredictiveLookupSearchState> &states, char target_char,
+      const KeyExpansionTable &table,
+      std::vector<PredictiveLookupSearchState> *next) const;
+
+  // Collects the terminal nodes under |states|, which are the nodes for the
+  // whole encoded key, in BFS order.
   void CollectPredictiveNodesInBfsOrder(
-      absl::string_view encoded_key, const KeyExpansionTable &table,
-      size_t limit, std::vector<PredictiveLookupSearchState> *result) const;
+      const std::vector<PredictiveLookupSearchState> &states, size_t limit,
+      std::vector<PredictiveLookupSearchState> *result) const;
+
+  // Calls back the keys and tokens of the collected |nodes| for |key|.
+  void ReportPredictiveNodes(
+      absl::string_view key, size_t encoded_key_size,
+      const std::vector<PredictiveLookupSearchState> &nodes,
+      Callback *callback) const;
 
   storage::louds::LoudsTrie key_trie_;
   storage::louds::LoudsTrie value_trie_;
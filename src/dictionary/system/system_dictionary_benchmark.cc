@@ -27,3 +27,275 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// Benchmarks for SystemDictionary lookups over the OSS data set.
+//
+// Each benchmark iteration performs one lookup, cycling through a corpus of
+// keys drawn from data/dictionary_oss/evaluation.tsv and
+// data/test/quality_regression_test/oss.tsv, so the reported time is per
+// lookup.  In addition to time, every benchmark reports:
+//   tokens/s:  Number of tokens delivered to the callback per second.
+//   tokens:    Average number of tokens delivered per lookup.
+//   allocs:    Average number of heap allocations per lookup.
+//
+// Usage:
+//   bazel run -c opt //dictionary/system:system_dictionary_benchmark -- \
+//       --benchmark_filter=LookupPrefix
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/status.h"
+#include "base/util.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/system_dictionary.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/benchmark_util.h"
+#include "testing/googletest.h"
+#include "testing/mozctest.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using ::benchmark::Counter;
+using ::mozc::testing::MakeSuffixes;
+
+// Counts the tokens delivered by a lookup.
+class CountTokenCallback : public DictionaryInterface::Callback {
+ public:
+  ResultType OnToken(absl::string_view key, absl::string_view actual_key,
+                     const Token &token) override {
+    ++num_tokens_;
+    return TRAVERSE_CONTINUE;
+  }
+
+  int64_t num_tokens() const { return num_tokens_; }
+
+ private:
+  int64_t num_tokens_ = 0;
+};
+
+// Collects the distinct keys of the tokens delivered by a lookup.
+class CollectKeyCallback : public DictionaryInterface::Callback {
+ public:
+  explicit CollectKeyCallback(absl::flat_hash_set<std::string> *keys)
+      : keys_(keys) {}
+
+  ResultType OnToken(absl::string_view key, absl::string_view actual_key,
+                     const Token &token) override {
+    keys_->emplace(token.key);
+    return TRAVERSE_NEXT_KEY;
+  }
+
+ private:
+  absl::flat_hash_set<std::string> *keys_;
+};
+
+// Sentences loaded from the test corpora: readings and their expected
+// conversions.
+struct Corpus {
+  std::vector<std::string> readings;
+  std::vector<std::string> surfaces;
+};
+
+// Appends the values at |column| of a TSV file in the test data.
+void LoadTsvColumn(const std::vector<absl::string_view> &path_components,
+                   int column, std::vector<std::string> *values) {
+  absl::StatusOr<std::vector<std::string>> column_values =
+      testing::ReadTsvColumn(testing::GetSourceFileOrDie(path_components),
+                             column);
+  CHECK_OK(column_values);
+  values->insert(values->end(),
+                 std::make_move_iterator(column_values->begin()),
+                 std::make_move_iterator(column_values->end()));
+}
+
+const Corpus &GetCorpus() {
+  static const Corpus *corpus = [] {
+    auto *corpus = new Corpus();
+    // status, input, output, command, argument, version
+    LoadTsvColumn({"data", "dictionary_oss", "evaluation.tsv"}, 1,
+                  &corpus->readings);
+    LoadTsvColumn({"data", "dictionary_oss", "evaluation.tsv"}, 2,
+                  &corpus->surfaces);
+    // label, key, value, command
+    LoadTsvColumn({"data", "test", "quality_regression_test", "oss.tsv"}, 1,
+                  &corpus->readings);
+    CHECK(!corpus->readings.empty()) << "No benchmark corpus is loaded";
+    return corpus;
+  }();
+  return *corpus;
+}
+
+// Returns the prefixes of |sentences| up to |max_chars| characters, which is
+// the key shape that prediction passes to LookupPredictive while typing.
+std::vector<std::string> MakePrefixes(const std::vector<std::string> &sentences,
+                                      size_t max_chars) {
+  std::vector<std::string> prefixes;
+  for (const std::string &sentence : sentences) {
+    const size_t len = std::min(Util::CharsLen(sentence), max_chars);
+    for (size_t i = 1; i <= len; ++i) {
+      prefixes.emplace_back(Util::Utf8SubString(sentence, 0, i));
+    }
+  }
+  return prefixes;
+}
+
+std::unique_ptr<SystemDictionary> CreateSystemDictionary(
+    SystemDictionary::Options options) {
+  static const oss::OssDataManager *data_manager = new oss::OssDataManager();
+  const char *data = nullptr;
+  int size = 0;
+  data_manager->GetSystemDictionaryData(&data, &size);
+  return SystemDictionary::Builder(data, size)
+      .SetOptions(options)
+      .Build()
+      .value();
+}
+
+// Returns the keys of the dictionary entries matched by prefix lookup of the
+// corpus, which are used as keys for LookupExact.
+const std::vector<std::string> &GetExactKeys(
+    const SystemDictionary &dictionary, const ConversionRequest &request) {
+  static const std::vector<std::string> *keys = [&] {
+    absl::flat_hash_set<std::string> key_set;
+    CollectKeyCallback callback(&key_set);
+    for (const std::string &key : MakeSuffixes(GetCorpus().readings)) {
+      dictionary.LookupPrefix(key, request, &callback);
+    }
+    auto *keys = new std::vector<std::string>(key_set.begin(), key_set.end());
+    std::sort(keys->begin(), keys->end());
+    return keys;
+  }();
+  return *keys;
+}
+
+class SystemDictionaryBenchmark {
+ public:
+  explicit SystemDictionaryBenchmark(
+      bool kana_modifier_insensitive,
+      SystemDictionary::Options options = SystemDictionary::NONE)
+      : dictionary_(CreateSystemDictionary(options)) {
+    request_.set_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    config_.set_use_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    convreq_.set_request(&request_);
+    convreq_.set_config(&config_);
+  }
+
+  const SystemDictionary &dictionary() const { return *dictionary_; }
+  const ConversionRequest &convreq() const { return convreq_; }
+
+  // Runs |lookup| for each key in |keys| in a round-robin manner and reports
+  // the counters.
+  template <typename Func>
+  void Run(benchmark::State &state, const std::vector<std::string> &keys,
+           Func lookup) const {
+    CHECK(!keys.empty());
+    CountTokenCallback callback;
+    size_t index = 0;
+    const int64_t allocations_begin = testing::GetAllocationCount();
+    for (auto s : state) {
+      lookup(keys[index], &callback);
+      if (++index == keys.size()) {
+        index = 0;
+      }
+    }
+    const double num_allocations =
+        testing::GetAllocationCount() - allocations_begin;
+    const double num_tokens = callback.num_tokens();
+    state.counters["tokens/s"] = Counter(num_tokens, Counter::kIsRate);
+    state.counters["tokens"] = Counter(num_tokens, Counter::kAvgIterations);
+    state.counters["allocs"] =
+        Counter(num_allocations, Counter::kAvgIterations);
+    state.counters["keys"] = keys.size();
+  }
+
+ private:
+  std::unique_ptr<SystemDictionary> dictionary_;
+  commands::Request request_;
+  config::Config config_;
+  ConversionRequest convreq_;
+};
+
+// state.range(0): 1 if KeyExpansionTable is used (kana modifier insensitive
+// conversion), 0 otherwise.
+void BM_LookupPrefix(benchmark::State &state) {
+  const SystemDictionaryBenchmark bm(state.range(0) != 0);
+  const std::vector<std::string> keys = MakeSuffixes(GetCorpus().readings);
+  bm.Run(state, keys,
+         [&bm](absl::string_view key, DictionaryInterface::Callback *callback) {
+           bm.dictionary().LookupPrefix(key, bm.convreq(), callback);
+         });
+}
+BENCHMARK(BM_LookupPrefix)->ArgName("expansion")->Arg(0)->Arg(1);
+
+// state.range(0): Same as BM_LookupPrefix.
+// state.range(1): Maximum number of characters of the predictive keys.
+void BM_LookupPredictive(benchmark::State &state) {
+  const SystemDictionaryBenchmark bm(state.range(0) != 0);
+  const std::vector<std::string> keys =
+      MakePrefixes(GetCorpus().readings, state.range(1));
+  bm.Run(state, keys,
+         [&bm](absl::string_view key, DictionaryInterface::Callback *callback) {
+           bm.dictionary().LookupPredictive(key, bm.convreq(), callback);
+         });
+}
+BENCHMARK(BM_LookupPredictive)
+    ->ArgNames({"expansion", "max_chars"})
+    ->ArgsProduct({{0, 1}, {1, 3, 6}});
+
+void BM_LookupExact(benchmark::State &state) {
+  const SystemDictionaryBenchmark bm(false);
+  const std::vector<std::string> &keys =
+      GetExactKeys(bm.dictionary(), bm.convreq());
+  bm.Run(state, keys,
+         [&bm](absl::string_view key, DictionaryInterface::Callback *callback) {
+           bm.dictionary().LookupExact(key, bm.convreq(), callback);
+         });
+}
+BENCHMARK(BM_LookupExact);
+
+// state.range(0): 1 if the reverse lookup index is built, 0 otherwise.
+void BM_LookupReverse(benchmark::State &state) {
+  const SystemDictionaryBenchmark bm(
+      false, state.range(0) != 0 ? SystemDictionary::ENABLE_REVERSE_LOOKUP_INDEX
+                                 : SystemDictionary::NONE);
+  const std::vector<std::string> keys = MakeSuffixes(GetCorpus().surfaces);
+  bm.Run(state, keys,
+         [&bm](absl::string_view key, DictionaryInterface::Callback *callback) {
+           bm.dictionary().LookupReverse(key, bm.convreq(), callback);
+         });
+}
+BENCHMARK(BM_LookupReverse)->ArgName("index")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  // Benchmark flags are consumed first so that the rest can be parsed as
+  // absl flags.
+  benchmark::Initialize(&argc, argv);
+  mozc::InitMozc(argv[0], &argc, &argv);
+  mozc::InitTestFlags();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
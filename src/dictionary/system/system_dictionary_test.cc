@@ -30,6 +30,7 @@
 #include "dictionary/system/system_dictionary.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <iterator>
@@ -524,6 +525,62 @@ TEST_F(SystemDictionaryTest, LookupPredictiveCutOffEmulatingBFS) {
   EXPECT_FALSE(callback.IsFound(&tokens[1]));
 }
 
+TEST_F(SystemDictionaryTest, LookupPredictiveMulti) {
+  Token tokens[] = {
+      {"かっこう", "格好", 0, 0, 0, Token::NONE},
+      {"がっこう", "学校", 0, 0, 0, Token::NONE},
+      {"かっこいい", "かっこいい", 0, 0, 0, Token::NONE},
+      {"かき", "柿", 0, 0, 0, Token::NONE},
+  };
+  std::vector<Token *> source_tokens = MakeTokenPointers(&tokens);
+  text_dict_.CollectTokens(&source_tokens);  // Load test data.
+  std::unique_ptr<SystemDictionary> system_dic =
+      BuildSystemDictionary(source_tokens, 10000);
+  ASSERT_TRUE(system_dic);
+
+  // The keys share prefixes in various lengths and include an empty key and
+  // a duplicated key.
+  const std::vector<absl::string_view> keys = {
+      "かっこ", "か", "", "かつこ", "かっこ", "かき", "がっ", "ん"};
+  for (const bool kana_modifier_insensitive : {false, true}) {
+    request_.set_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    config_.set_use_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+
+    std::vector<CollectTokenCallback> expected(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      system_dic->LookupPredictive(keys[i], convreq_, &expected[i]);
+    }
+    std::vector<CollectTokenCallback> actual(keys.size());
+    system_dic->LookupPredictiveMulti(
+        keys, convreq_,
+        [&actual](size_t i) -> DictionaryInterface::Callback * {
+          return &actual[i];
+        });
+    for (size_t i = 0; i < keys.size(); ++i) {
+      // The results are in the same order as LookupPredictive().
+      ASSERT_EQ(actual[i].tokens().size(), expected[i].tokens().size())
+          << keys[i];
+      for (size_t j = 0; j < expected[i].tokens().size(); ++j) {
+        EXPECT_TOKEN_EQ(expected[i].tokens()[j], actual[i].tokens()[j]);
+      }
+    }
+  }
+
+  // The remaining keys are skipped once the callback is not given.
+  std::vector<size_t> requested;
+  CollectTokenCallback callback;
+  system_dic->LookupPredictiveMulti(
+      keys, convreq_,
+      [&](size_t i) -> DictionaryInterface::Callback * {
+        requested.push_back(i);
+        return i < 2 ? &callback : nullptr;
+      });
+  EXPECT_EQ(requested, (std::vector<size_t>{0, 1, 2}));
+  EXPECT_FALSE(callback.tokens().empty());
+}
+
 TEST_F(SystemDictionaryTest, LookupExact) {
   const std::string k0 = "は";
   const std::string k1 = "はひふへほ";
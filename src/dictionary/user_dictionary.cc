@@ -69,33 +69,6 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
-struct OrderByKey {
-  bool operator()(const UserPos::Token &token, absl::string_view key) const {
-    return token.key < key;
-  }
-
-  bool operator()(absl::string_view key, const UserPos::Token &token) const {
-    return key < token.key;
-  }
-};
-
-struct OrderByKeyPrefix {
-  bool operator()(const UserPos::Token &token, absl::string_view prefix) const {
-    return absl::string_view(token.key).substr(0, prefix.size()) < prefix;
-  }
-
-  bool operator()(absl::string_view prefix, const UserPos::Token &token) const {
-    return prefix < absl::string_view(token.key).substr(0, prefix.size());
-  }
-};
-
-struct OrderByKeyThenById {
-  bool operator()(const UserPos::Token &lhs, const UserPos::Token &rhs) const {
-    const int comp = lhs.key.compare(rhs.key);
-    return comp == 0 ? (lhs.id < rhs.id) : (comp < 0);
-  }
-};
-
 class UserDictionaryFileManager {
  public:
   UserDictionaryFileManager() = default;
@@ -125,26 +98,80 @@ class UserDictionaryFileManager {
 
 }  // namespace
 
+// Immutable index of the user dictionary tokens. The tokens are stored in an
+// array sorted by key and then by POS ID, and all their strings are stored in
+// one buffer in the same order. A token with the same key as the previous
+// one shares the key string. Once loaded, the index is never modified, so it
+// is shared by the lookups without locks. See UserDictionary::Load().
 class UserDictionary::TokensIndex {
  public:
+  // Token in the index. The strings are stored in TokensIndex::strings_.
+  struct Entry {
+    uint32_t key_offset;
+    uint32_t value_offset;
+    uint32_t comment_offset;
+    uint16_t key_size;
+    uint16_t value_size;
+    uint16_t comment_size;
+    uint16_t id;
+    uint16_t attributes;
+
+    bool has_attribute(UserPos::Token::Attribute attr) const {
+      return attributes & attr;
+    }
+  };
+
+  using const_iterator = std::vector<Entry>::const_iterator;
+
   TokensIndex(const UserPosInterface *user_pos,
               SuppressionDictionary *suppression_dictionary)
       : user_pos_(user_pos), suppression_dictionary_(suppression_dictionary) {}
 
+  TokensIndex(const TokensIndex &) = delete;
+  TokensIndex &operator=(const TokensIndex &) = delete;
+
   ~TokensIndex() = default;
 
-  bool empty() const { return user_pos_tokens_.empty(); }
-  size_t size() const { return user_pos_tokens_.size(); }
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  absl::string_view key(const Entry &entry) const {
+    return absl::string_view(strings_.data() + entry.key_offset,
+                             entry.key_size);
+  }
+  absl::string_view value(const Entry &entry) const {
+    return absl::string_view(strings_.data() + entry.value_offset,
+                             entry.value_size);
+  }
+  absl::string_view comment(const Entry &entry) const {
+    return absl::string_view(strings_.data() + entry.comment_offset,
+                             entry.comment_size);
+  }
+
+  // Returns the range of the tokens whose key is |key|.
+  std::pair<const_iterator, const_iterator> EqualRange(
+      absl::string_view key) const {
+    return std::equal_range(begin(), end(), key, OrderByKey{this});
+  }
 
-  std::vector<UserPos::Token>::const_iterator begin() const {
-    return user_pos_tokens_.begin();
+  // Returns the range of the tokens whose key starts with |prefix|.
+  std::pair<const_iterator, const_iterator> PrefixRange(
+      absl::string_view prefix) const {
+    return std::equal_range(begin(), end(), prefix,
+                            OrderByKeyPrefix{this});
   }
-  std::vector<UserPos::Token>::const_iterator end() const {
-    return user_pos_tokens_.end();
+
+  // Returns the first token whose key is not less than |key|.
+  const_iterator LowerBound(absl::string_view key) const {
+    return std::lower_bound(begin(), end(), key, OrderByKey{this});
   }
 
   void Load(const user_dictionary::UserDictionaryStorage &storage) {
-    user_pos_tokens_.clear();
+    entries_.clear();
+    strings_.clear();
     std::set<uint64_t> seen;
     std::vector<UserPos::Token> tokens;
 
@@ -196,7 +223,6 @@ class UserDictionary::TokensIndex {
           const absl::string_view comment =
               absl::StripAsciiWhitespace(entry.comment());
           for (auto &token : tokens) {
-            token.comment = std::string(comment);
             if (is_shortcuts &&
                 token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
               // Words fed by Android shortcut are registered as SUGGESTION_ONLY
@@ -208,33 +234,109 @@ class UserDictionary::TokensIndex {
               token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
               token.add_attribute(UserPos::Token::SHORTCUT);
             }
-            user_pos_tokens_.push_back(std::move(token));
+            AddEntry(token.key, token.value, comment, token.id,
+                     token.attributes);
           }
         }
       }
     }
-    user_pos_tokens_.shrink_to_fit();
 
     // Sort first by key and then by POS ID.
-    std::sort(user_pos_tokens_.begin(), user_pos_tokens_.end(),
-              OrderByKeyThenById());
+    std::sort(entries_.begin(), entries_.end(),
+              [this](const Entry &lhs, const Entry &rhs) {
+                const int comp = key(lhs).compare(key(rhs));
+                return comp == 0 ? (lhs.id < rhs.id) : (comp < 0);
+              });
+    Compact();
 
-    VLOG(1) << user_pos_tokens_.size() << " user dic entries loaded";
+    VLOG(1) << entries_.size() << " user dic entries loaded";
 
-    usage_stats::UsageStats::SetInteger(
-        "UserRegisteredWord", static_cast<int>(user_pos_tokens_.size()));
+    usage_stats::UsageStats::SetInteger("UserRegisteredWord",
+                                        static_cast<int>(entries_.size()));
   }
 
  private:
+  struct OrderByKey {
+    bool operator()(const Entry &entry, absl::string_view key) const {
+      return index->key(entry) < key;
+    }
+    bool operator()(absl::string_view key, const Entry &entry) const {
+      return key < index->key(entry);
+    }
+    const TokensIndex *index;
+  };
+
+  struct OrderByKeyPrefix {
+    bool operator()(const Entry &entry, absl::string_view prefix) const {
+      return index->key(entry).substr(0, prefix.size()) < prefix;
+    }
+    bool operator()(absl::string_view prefix, const Entry &entry) const {
+      return prefix < index->key(entry).substr(0, prefix.size());
+    }
+    const TokensIndex *index;
+  };
+
+  uint32_t AppendString(absl::string_view str) {
+    const uint32_t offset = strings_.size();
+    strings_.append(str.data(), str.size());
+    return offset;
+  }
+
+  void AddEntry(absl::string_view key, absl::string_view value,
+                absl::string_view comment, uint16_t id, uint16_t attributes) {
+    // The sizes are limited by UserDictionaryUtil::IsValidEntry().
+    DCHECK_LE(key.size(), std::numeric_limits<uint16_t>::max());
+    DCHECK_LE(value.size(), std::numeric_limits<uint16_t>::max());
+    DCHECK_LE(comment.size(), std::numeric_limits<uint16_t>::max());
+    Entry entry;
+    entry.key_offset = AppendString(key);
+    entry.value_offset = AppendString(value);
+    entry.comment_offset = AppendString(comment);
+    entry.key_size = key.size();
+    entry.value_size = value.size();
+    entry.comment_size = comment.size();
+    entry.id = id;
+    entry.attributes = attributes;
+    entries_.push_back(entry);
+  }
+
+  // Lays out the strings in the order of |entries_| so that a lookup reads
+  // them sequentially, sharing the keys of the consecutive entries.
+  void Compact() {
+    std::string strings;
+    strings.reserve(strings_.size());
+    absl::string_view last_key;
+    uint32_t last_key_offset = 0;
+    for (Entry &entry : entries_) {
+      const absl::string_view key = this->key(entry);
+      const absl::string_view value = this->value(entry);
+      const absl::string_view comment = this->comment(entry);
+      if (key != last_key || strings.empty()) {
+        last_key_offset = strings.size();
+        strings.append(key.data(), key.size());
+      }
+      last_key = key;
+      entry.key_offset = last_key_offset;
+      entry.value_offset = strings.size();
+      strings.append(value.data(), value.size());
+      entry.comment_offset = strings.size();
+      strings.append(comment.data(), comment.size());
+    }
+    strings_ = std::move(strings);
+    strings_.shrink_to_fit();
+    entries_.shrink_to_fit();
+  }
+
   const UserPosInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
-  std::vector<UserPos::Token> user_pos_tokens_;
+  std::vector<Entry> entries_;
+  std::string strings_;
 };
 
 class UserDictionary::UserDictionaryReloader : public Thread {
  public:
   explicit UserDictionaryReloader(UserDictionary *dic)
-      : modified_at_(0), dic_(dic) {
+      : modified_at_(0), journal_modified_at_(0), dic_(dic) {
     DCHECK(dic_);
   }
 
@@ -243,12 +345,14 @@ class UserDictionary::UserDictionaryReloader : public Thread {
 
   ~UserDictionaryReloader() override { Join(); }
 
-  // When the user dictionary exists AND the modification time has been updated,
-  // reloads the dictionary.  Returns true when reloader thread is started.
+  // When the user dictionary exists AND the modification time of it or its
+  // journal has been updated, reloads the dictionary.  Returns true when
+  // reloader thread is started.
   bool MaybeStartReload() {
+    const std::string file_name =
+        Singleton<UserDictionaryFileManager>::get()->GetFileName();
     absl::StatusOr<FileTimeStamp> modification_time =
-        FileUtil::GetModificationTime(
-            Singleton<UserDictionaryFileManager>::get()->GetFileName());
+        FileUtil::GetModificationTime(file_name);
     if (!modification_time.ok()) {
       // If the file doesn't exist, return doing nothing.
       // Therefore if the file is deleted after first reload,
@@ -258,10 +362,17 @@ class UserDictionary::UserDictionaryReloader : public Thread {
                    << modification_time.status();
       return false;
     }
-    if (modified_at_ == *modification_time) {
+    // Save() usually updates only the journal.
+    const FileTimeStamp journal_modification_time =
+        FileUtil::GetModificationTime(
+            UserDictionaryStorage::GetJournalFileName(file_name))
+            .value_or(0);
+    if (modified_at_ == *modification_time &&
+        journal_modified_at_ == journal_modification_time) {
       return false;
     }
     modified_at_ = *modification_time;
+    journal_modified_at_ = journal_modification_time;
     Start("UserDictionaryReloader");
     return true;
   }
@@ -291,6 +402,7 @@ class UserDictionary::UserDictionaryReloader : public Thread {
 
  private:
   FileTimeStamp modified_at_;
+  FileTimeStamp journal_modified_at_;
   UserDictionary *dic_;
   std::string key_;
   std::string value_;
@@ -303,16 +415,14 @@ UserDictionary::UserDictionary(std::unique_ptr<const UserPosInterface> user_pos,
       user_pos_(std::move(user_pos)),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
-      tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)) {
+      tokens_(std::make_shared<TokensIndex>(user_pos_.get(),
+                                            suppression_dictionary)) {
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
 }
 
-UserDictionary::~UserDictionary() {
-  reloader_->Join();
-  delete tokens_;
-}
+UserDictionary::~UserDictionary() { reloader_->Join(); }
 
 bool UserDictionary::HasKey(absl::string_view key) const {
   // TODO(noriyukit): Currently, we don't support HasKey() for user dictionary
@@ -332,13 +442,12 @@ bool UserDictionary::HasValue(absl::string_view value) const {
 void UserDictionary::LookupPredictive(
     absl::string_view key, const ConversionRequest &conversion_request,
     Callback *callback) const {
-  absl::ReaderMutexLock l(&mutex_);
-
   if (key.empty()) {
     VLOG(2) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  const std::shared_ptr<const TokensIndex> tokens = GetTokens();
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -347,11 +456,9 @@ void UserDictionary::LookupPredictive(
 
   // Find the starting point of iteration over dictionary contents.
   Token token;
-  for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
-                                            key, OrderByKeyPrefix());
-       begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
-    switch (callback->OnKey(user_pos_token.key)) {
+  for (auto [begin, end] = tokens->PrefixRange(key); begin != end; ++begin) {
+    const absl::string_view entry_key = tokens->key(*begin);
+    switch (callback->OnKey(entry_key)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_NEXT_KEY:
@@ -360,8 +467,9 @@ void UserDictionary::LookupPredictive(
       default:
         break;
     }
-    PopulateTokenFromUserPosToken(user_pos_token, PREDICTIVE, &token);
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
+    PopulateToken(entry_key, tokens->value(*begin), begin->id,
+                  begin->attributes, PREDICTIVE, &token);
+    if (callback->OnToken(entry_key, entry_key, token) ==
         Callback::TRAVERSE_DONE) {
       return;
     }
@@ -372,13 +480,12 @@ void UserDictionary::LookupPredictive(
 void UserDictionary::LookupPrefix(absl::string_view key,
                                   const ConversionRequest &conversion_request,
                                   Callback *callback) const {
-  absl::ReaderMutexLock l(&mutex_);
-
   if (key.empty()) {
     LOG(WARNING) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  const std::shared_ptr<const TokensIndex> tokens = GetTokens();
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -389,20 +496,18 @@ void UserDictionary::LookupPrefix(absl::string_view key,
   const absl::string_view first_char =
       key.substr(0, Util::OneCharLen(key.data()));
   Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
-    const UserPos::Token &user_pos_token = *it;
-    if (user_pos_token.key > key) {
+  for (auto it = tokens->LowerBound(first_char); it != tokens->end(); ++it) {
+    const absl::string_view entry_key = tokens->key(*it);
+    if (entry_key > key) {
       break;
     }
-    if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
+    if (it->has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
       continue;
     }
-    if (!absl::StartsWith(key, user_pos_token.key)) {
+    if (!absl::StartsWith(key, entry_key)) {
       continue;
     }
-    switch (callback->OnKey(user_pos_token.key)) {
+    switch (callback->OnKey(entry_key)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_NEXT_KEY:
@@ -413,8 +518,9 @@ void UserDictionary::LookupPrefix(absl::string_view key,
       default:
         break;
     }
-    PopulateTokenFromUserPosToken(user_pos_token, PREFIX, &token);
-    switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
+    PopulateToken(entry_key, tokens->value(*it), it->id, it->attributes, PREFIX,
+                  &token);
+    switch (callback->OnToken(entry_key, entry_key, token)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_CULL:
@@ -429,13 +535,11 @@ void UserDictionary::LookupPrefix(absl::string_view key,
 void UserDictionary::LookupExact(absl::string_view key,
                                  const ConversionRequest &conversion_request,
                                  Callback *callback) const {
-  absl::ReaderMutexLock l(&mutex_);
-  if (key.empty() || tokens_->empty() ||
-      conversion_request.config().incognito_mode()) {
+  if (key.empty() || conversion_request.config().incognito_mode()) {
     return;
   }
-  auto [begin, end] =
-      std::equal_range(tokens_->begin(), tokens_->end(), key, OrderByKey());
+  const std::shared_ptr<const TokensIndex> tokens = GetTokens();
+  auto [begin, end] = tokens->EqualRange(key);
   if (begin == end) {
     return;
   }
@@ -445,11 +549,11 @@ void UserDictionary::LookupExact(absl::string_view key,
 
   Token token;
   for (; begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
-    if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
+    if (begin->has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
       continue;
     }
-    PopulateTokenFromUserPosToken(user_pos_token, EXACT, &token);
+    PopulateToken(key, tokens->value(*begin), begin->id, begin->attributes,
+                  EXACT, &token);
     if (callback->OnToken(key, key, token) != Callback::TRAVERSE_CONTINUE) {
       return;
     }
@@ -468,18 +572,13 @@ bool UserDictionary::LookupComment(absl::string_view key,
     return false;
   }
 
-  absl::ReaderMutexLock l(&mutex_);
-  if (tokens_->empty()) {
-    return false;
-  }
+  const std::shared_ptr<const TokensIndex> tokens = GetTokens();
 
   // Set the comment that was found first.
-  for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
-                                            key, OrderByKey());
-       begin != end; ++begin) {
-    const UserPos::Token &token = *begin;
-    if (token.value == value && !token.comment.empty()) {
-      comment->assign(token.comment);
+  for (auto [begin, end] = tokens->EqualRange(key); begin != end; ++begin) {
+    if (tokens->value(*begin) == value && begin->comment_size > 0) {
+      const absl::string_view entry_comment = tokens->comment(*begin);
+      comment->assign(entry_comment.data(), entry_comment.size());
       return true;
     }
   }
@@ -524,23 +623,21 @@ class FindValueCallback : public DictionaryInterface::Callback {
 
 void UserDictionary::WaitForReloader() { reloader_->Join(); }
 
-void UserDictionary::Swap(TokensIndex *new_tokens) {
+std::shared_ptr<const UserDictionary::TokensIndex> UserDictionary::GetTokens()
+    const {
+  return std::atomic_load(&tokens_);
+}
+
+void UserDictionary::Swap(std::shared_ptr<const TokensIndex> new_tokens) {
   DCHECK(new_tokens);
-  TokensIndex *old_tokens = tokens_;
-  {
-    absl::WriterMutexLock l(&mutex_);
-    tokens_ = new_tokens;
-  }
-  delete old_tokens;
+  // The old index is released by the last lookup using it, so neither the
+  // lookups nor the reloader wait for each other.
+  std::atomic_store(&tokens_, std::move(new_tokens));
 }
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
-  size_t size = 0;
-  {
-    absl::ReaderMutexLock l(&mutex_);
-    size = tokens_->size();
-  }
+  const size_t size = GetTokens()->size();
 
   // If UserDictionary is pretty big, we first remove the
   // current dictionary to save memory usage.
@@ -551,15 +648,14 @@ bool UserDictionary::Load(
 #endif  // __ANDROID__
 
   if (size >= kVeryBigUserDictionarySize) {
-    TokensIndex *dummy_empty_tokens =
-        new TokensIndex(user_pos_.get(), suppression_dictionary_);
-    Swap(dummy_empty_tokens);
+    Swap(std::make_shared<TokensIndex>(user_pos_.get(),
+                                       suppression_dictionary_));
   }
 
-  TokensIndex *tokens =
-      new TokensIndex(user_pos_.get(), suppression_dictionary_);
+  auto tokens =
+      std::make_shared<TokensIndex>(user_pos_.get(), suppression_dictionary_);
   tokens->Load(storage);
-  Swap(tokens);
+  Swap(std::move(tokens));
   return true;
 }
 
@@ -576,25 +672,37 @@ void UserDictionary::SetUserDictionaryName(const absl::string_view filename) {
 void UserDictionary::PopulateTokenFromUserPosToken(
     const UserPosInterface::Token &user_pos_token, RequestType request_type,
     Token *token) const {
-  token->key = user_pos_token.key;
-  token->value = user_pos_token.value;
-  token->lid = token->rid = user_pos_token.id;
+  PopulateToken(user_pos_token.key, user_pos_token.value, user_pos_token.id,
+                user_pos_token.attributes, request_type, token);
+}
+
+void UserDictionary::PopulateToken(absl::string_view key,
+                                   absl::string_view value, uint16_t id,
+                                   uint16_t attributes,
+                                   RequestType request_type,
+                                   Token *token) const {
+  auto has_attribute = [attributes](UserPos::Token::Attribute attr) {
+    return (attributes & attr) != 0;
+  };
+  token->key.assign(key.data(), key.size());
+  token->value.assign(value.data(), value.size());
+  token->lid = token->rid = id;
   token->attributes = Token::USER_DICTIONARY;
 
   // * Overwrites POS ids.
   // Actual pos id of suggestion-only candidates are 名詞-サ変.
   // TODO(taku): We would like to change the POS to 名詞-サ変 in user-pos.def,
   // because SUGGEST_ONLY is not POS.
-  if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY) ||
-      user_pos_token.has_attribute(UserPos::Token::SHORTCUT)) {
+  if (has_attribute(UserPos::Token::SUGGESTION_ONLY) ||
+      has_attribute(UserPos::Token::SHORTCUT)) {
     token->lid = token->rid = pos_matcher_.GetUnknownId();
   }
 
   // * Overwrites costs.
   // Locale is not Japanese.
-  if (user_pos_token.has_attribute(UserPos::Token::NON_JA_LOCALE)) {
+  if (has_attribute(UserPos::Token::NON_JA_LOCALE)) {
     token->cost = 10000;
-  } else if (user_pos_token.has_attribute(UserPos::Token::ISOLATED_WORD)) {
+  } else if (has_attribute(UserPos::Token::ISOLATED_WORD)) {
     // Set smaller cost for "短縮よみ" in order to make
     // the rank of the word higher than others.
     token->cost = 200;
@@ -607,7 +715,7 @@ void UserDictionary::PopulateTokenFromUserPosToken(
   // on the length of the key. Shorter keys have more penalty so that
   // they are not shown in the context.
   // TODO(taku): Better to apply this cost for all user defined words?
-  if (user_pos_token.has_attribute(UserPos::Token::SHORTCUT) &&
+  if (has_attribute(UserPos::Token::SHORTCUT) &&
       (request_type == PREFIX || request_type == EXACT)) {
     const int key_length = Util::CharsLen(token->key);
     token->cost += std::max<int>(0, 4 - key_length) * 2000;
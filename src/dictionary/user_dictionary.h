@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -42,7 +43,6 @@
 #include "protocol/user_dictionary_storage.pb.h"
 #include "request/conversion_request.h"
 #include "absl/strings/string_view.h"
-#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 namespace dictionary {
@@ -112,15 +112,24 @@ class UserDictionary : public DictionaryInterface {
   class TokensIndex;
   class UserDictionaryReloader;
 
-  // Swaps internal tokens index to |new_tokens|.
-  void Swap(TokensIndex *new_tokens);
+  // Returns the current tokens index. The lookups hold the returned index
+  // while reading it, so a reload never blocks them.
+  std::shared_ptr<const TokensIndex> GetTokens() const;
+
+  // Publishes |new_tokens| as the tokens index.
+  void Swap(std::shared_ptr<const TokensIndex> new_tokens);
+
+  // Same as PopulateTokenFromUserPosToken() for the fields of a token.
+  void PopulateToken(absl::string_view key, absl::string_view value,
+                     uint16_t id, uint16_t attributes,
+                     RequestType request_type, Token *token) const;
 
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPosInterface> user_pos_;
   const PosMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
-  TokensIndex *tokens_;
-  mutable absl::Mutex mutex_;
+  // Accessed only with std::atomic_load() and std::atomic_store().
+  std::shared_ptr<const TokensIndex> tokens_;
 
   friend class UserDictionaryTest;
 };
@@ -0,0 +1,269 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_journal.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "dictionary/user_dictionary_util.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "absl/base/internal/endian.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace {
+
+using ::mozc::user_dictionary::UserDictionary;
+using ::mozc::user_dictionary::UserDictionaryJournalRecord;
+using ::mozc::user_dictionary::UserDictionaryStorage;
+using Operation = UserDictionaryJournalRecord::Operation;
+
+// The length and the fingerprint of the record.
+constexpr size_t kFrameHeaderSize = 8;
+
+// Returns a copy of |dictionary| without entries.
+UserDictionary GetProperties(const UserDictionary &dictionary) {
+  UserDictionary properties = dictionary;
+  properties.clear_entries();
+  return properties;
+}
+
+bool ApplyUpdateEntriesOperation(const Operation &operation,
+                                 UserDictionary *dictionary) {
+  if (operation.entry_indices_size() != operation.entries_size()) {
+    return false;
+  }
+  auto *entries = dictionary->mutable_entries();
+
+  if (operation.deleted_entry_indices_size() > 0) {
+    const int size = entries->size();
+    int num_kept = 0;
+    int next = 0;
+    for (int i = 0; i < size; ++i) {
+      if (next < operation.deleted_entry_indices_size() &&
+          operation.deleted_entry_indices(next) == i) {
+        ++next;
+        continue;
+      }
+      if (num_kept != i) {
+        entries->SwapElements(num_kept, i);
+      }
+      ++num_kept;
+    }
+    if (next != operation.deleted_entry_indices_size()) {
+      // Indices are out of range or not sorted.
+      return false;
+    }
+    entries->DeleteSubrange(num_kept, size - num_kept);
+  }
+
+  for (int i = 0; i < operation.entry_indices_size(); ++i) {
+    const int index = operation.entry_indices(i);
+    if (index < 0 || index > entries->size()) {
+      return false;
+    }
+    if (index == entries->size()) {
+      *entries->Add() = operation.entries(i);
+    } else {
+      *entries->Mutable(index) = operation.entries(i);
+    }
+  }
+  return true;
+}
+
+bool ApplyOperation(const Operation &operation,
+                    UserDictionaryStorage *storage) {
+  switch (operation.type()) {
+    case Operation::DELETE_DICTIONARY: {
+      const int index = UserDictionaryUtil::GetUserDictionaryIndexById(
+          *storage, operation.dictionary_id());
+      if (index < 0) {
+        return false;
+      }
+      storage->mutable_dictionaries()->DeleteSubrange(index, 1);
+      return true;
+    }
+    case Operation::INSERT_DICTIONARY: {
+      const int index = operation.dictionary_index();
+      if (index < 0 || index > storage->dictionaries_size()) {
+        return false;
+      }
+      *storage->add_dictionaries() = operation.dictionary();
+      for (int i = storage->dictionaries_size() - 1; i > index; --i) {
+        storage->mutable_dictionaries()->SwapElements(i, i - 1);
+      }
+      return true;
+    }
+    case Operation::UPDATE_DICTIONARY_PROPERTIES: {
+      UserDictionary *dictionary =
+          UserDictionaryUtil::GetMutableUserDictionaryById(
+              storage, operation.dictionary_id());
+      if (dictionary == nullptr) {
+        return false;
+      }
+      // Replaces the dictionary with the properties, keeping the entries.
+      UserDictionary properties = operation.dictionary();
+      properties.mutable_entries()->Swap(dictionary->mutable_entries());
+      *dictionary = std::move(properties);
+      return true;
+    }
+    case Operation::UPDATE_ENTRIES: {
+      UserDictionary *dictionary =
+          UserDictionaryUtil::GetMutableUserDictionaryById(
+              storage, operation.dictionary_id());
+      if (dictionary == nullptr) {
+        return false;
+      }
+      return ApplyUpdateEntriesOperation(operation, dictionary);
+    }
+    default:
+      LOG(ERROR) << "Unknown operation: " << operation.type();
+      return false;
+  }
+}
+
+}  // namespace
+
+void UserDictionaryJournal::AddInsertDictionaryOperation(
+    const UserDictionaryStorage &storage, int index,
+    UserDictionaryJournalRecord *record) {
+  Operation *operation = record->add_operations();
+  operation->set_type(Operation::INSERT_DICTIONARY);
+  operation->set_dictionary_index(index);
+  *operation->mutable_dictionary() = storage.dictionaries(index);
+}
+
+void UserDictionaryJournal::AddDeleteDictionaryOperation(
+    uint64_t dictionary_id, UserDictionaryJournalRecord *record) {
+  Operation *operation = record->add_operations();
+  operation->set_type(Operation::DELETE_DICTIONARY);
+  operation->set_dictionary_id(dictionary_id);
+}
+
+void UserDictionaryJournal::AddUpdatePropertiesOperation(
+    const UserDictionary &dictionary, UserDictionaryJournalRecord *record) {
+  Operation *operation = record->add_operations();
+  operation->set_type(Operation::UPDATE_DICTIONARY_PROPERTIES);
+  operation->set_dictionary_id(dictionary.id());
+  *operation->mutable_dictionary() = GetProperties(dictionary);
+}
+
+void UserDictionaryJournal::AddUpdateEntriesOperation(
+    const UserDictionary &dictionary, int begin, int end,
+    UserDictionaryJournalRecord *record) {
+  DCHECK_LE(0, begin);
+  DCHECK_LE(end, dictionary.entries_size());
+  if (begin >= end) {
+    return;
+  }
+  Operation *operation = record->add_operations();
+  operation->set_type(Operation::UPDATE_ENTRIES);
+  operation->set_dictionary_id(dictionary.id());
+  for (int i = begin; i < end; ++i) {
+    operation->add_entry_indices(i);
+    *operation->add_entries() = dictionary.entries(i);
+  }
+}
+
+void UserDictionaryJournal::AddDeleteEntriesOperations(
+    uint64_t dictionary_id, absl::Span<const int> indices,
+    UserDictionaryJournalRecord *record) {
+  // Deleting entries in descending order doesn't move the entries deleted
+  // next, so each descending run is deleted by one operation.
+  const int first_operation = record->operations_size();
+  Operation *operation = nullptr;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    if (operation == nullptr || indices[i] >= indices[i - 1]) {
+      operation = record->add_operations();
+      operation->set_type(Operation::UPDATE_ENTRIES);
+      operation->set_dictionary_id(dictionary_id);
+    }
+    operation->add_deleted_entry_indices(indices[i]);
+  }
+  // The operation takes the indices in ascending order.
+  for (int i = first_operation; i < record->operations_size(); ++i) {
+    auto *deleted_indices =
+        record->mutable_operations(i)->mutable_deleted_entry_indices();
+    std::reverse(deleted_indices->begin(), deleted_indices->end());
+  }
+}
+
+bool UserDictionaryJournal::ApplyRecord(
+    const UserDictionaryJournalRecord &record,
+    UserDictionaryStorage *storage) {
+  for (const Operation &operation : record.operations()) {
+    if (!ApplyOperation(operation, storage)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void UserDictionaryJournal::AppendFrame(
+    const UserDictionaryJournalRecord &record, std::string *output) {
+  const std::string payload = record.SerializeAsString();
+  char header[kFrameHeaderSize];
+  absl::little_endian::Store32(header, payload.size());
+  absl::little_endian::Store32(header + 4, Hash::Fingerprint32(payload));
+  output->append(header, kFrameHeaderSize);
+  output->append(payload);
+}
+
+size_t UserDictionaryJournal::ParseFrames(
+    absl::string_view data, std::vector<UserDictionaryJournalRecord> *records) {
+  size_t pos = 0;
+  while (data.size() - pos >= kFrameHeaderSize) {
+    const char *header = data.data() + pos;
+    const uint32_t size = absl::little_endian::Load32(header);
+    const uint32_t fingerprint = absl::little_endian::Load32(header + 4);
+    if (data.size() - pos - kFrameHeaderSize < size) {
+      break;
+    }
+    const absl::string_view payload =
+        data.substr(pos + kFrameHeaderSize, size);
+    UserDictionaryJournalRecord record;
+    if (Hash::Fingerprint32(payload) != fingerprint ||
+        !record.ParseFromArray(payload.data(), payload.size())) {
+      break;
+    }
+    records->push_back(std::move(record));
+    pos += kFrameHeaderSize + size;
+  }
+  return pos;
+}
+
+}  // namespace mozc
@@ -0,0 +1,110 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// UserDictionaryJournal provides the functions to keep the changes of
+// UserDictionaryStorage in an append-only journal, so that saving a small
+// change doesn't rewrite the whole storage.
+//
+// The journal is a sequence of frames. Each frame is the 32-bit length and
+// the 32-bit fingerprint of a serialized UserDictionaryJournalRecord,
+// followed by the record itself. Both integers are little endian.
+
+#ifndef MOZC_DICTIONARY_USER_DICTIONARY_JOURNAL_H_
+#define MOZC_DICTIONARY_USER_DICTIONARY_JOURNAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "protocol/user_dictionary_storage.pb.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+
+class UserDictionaryJournal {
+ public:
+  UserDictionaryJournal() = delete;
+  UserDictionaryJournal(const UserDictionaryJournal &) = delete;
+  UserDictionaryJournal &operator=(const UserDictionaryJournal &) = delete;
+
+  // The following functions add the operations of a change to |record|.
+  // They are called after the change and copy the changed data.
+
+  // |storage|.dictionaries(|index|) has been inserted.
+  static void AddInsertDictionaryOperation(
+      const user_dictionary::UserDictionaryStorage &storage, int index,
+      user_dictionary::UserDictionaryJournalRecord *record);
+
+  // The dictionary of |dictionary_id| has been deleted.
+  static void AddDeleteDictionaryOperation(
+      uint64_t dictionary_id,
+      user_dictionary::UserDictionaryJournalRecord *record);
+
+  // The fields of |dictionary| other than the entries have been updated.
+  static void AddUpdatePropertiesOperation(
+      const user_dictionary::UserDictionary &dictionary,
+      user_dictionary::UserDictionaryJournalRecord *record);
+
+  // The entries of |dictionary| in [|begin|, |end|) have been updated or
+  // appended.
+  static void AddUpdateEntriesOperation(
+      const user_dictionary::UserDictionary &dictionary, int begin, int end,
+      user_dictionary::UserDictionaryJournalRecord *record);
+
+  // The entries at |indices| have been deleted one by one in this order from
+  // the dictionary of |dictionary_id|.
+  static void AddDeleteEntriesOperations(
+      uint64_t dictionary_id, absl::Span<const int> indices,
+      user_dictionary::UserDictionaryJournalRecord *record);
+
+  // Applies the operations in |record| to |storage|. Returns false if an
+  // operation doesn't match |storage|. In that case, |storage| may be
+  // partially updated.
+  static bool ApplyRecord(
+      const user_dictionary::UserDictionaryJournalRecord &record,
+      user_dictionary::UserDictionaryStorage *storage);
+
+  // Appends the frame of |record| to |output|.
+  static void AppendFrame(
+      const user_dictionary::UserDictionaryJournalRecord &record,
+      std::string *output);
+
+  // Parses the frames in |data| and appends the records to |records|.
+  // Parsing stops at the first broken frame, e.g., one written partially
+  // when the process crashed. Returns the size of the valid frames.
+  static size_t ParseFrames(
+      absl::string_view data,
+      std::vector<user_dictionary::UserDictionaryJournalRecord> *records);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_USER_DICTIONARY_JOURNAL_H_
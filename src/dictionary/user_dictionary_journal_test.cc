@@ -0,0 +1,248 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_journal.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "protocol/user_dictionary_storage.pb.h"
+#include "testing/gunit.h"
+#include "testing/testing_util.h"
+
+namespace mozc {
+namespace {
+
+using ::mozc::user_dictionary::UserDictionary;
+using ::mozc::user_dictionary::UserDictionaryJournalRecord;
+using ::mozc::user_dictionary::UserDictionaryStorage;
+
+UserDictionary *AddDictionary(UserDictionaryStorage *storage, uint64_t id,
+                              int num_entries) {
+  UserDictionary *dictionary = storage->add_dictionaries();
+  dictionary->set_id(id);
+  dictionary->set_name("dictionary" + std::to_string(id));
+  for (int i = 0; i < num_entries; ++i) {
+    UserDictionary::Entry *entry = dictionary->add_entries();
+    entry->set_key("key" + std::to_string(i));
+    entry->set_value("value" + std::to_string(i));
+    entry->set_pos(UserDictionary::NOUN);
+  }
+  return dictionary;
+}
+
+// Checks that applying |record| to |base| reproduces |storage|.
+void ExpectReplayed(const UserDictionaryStorage &base,
+                    const UserDictionaryStorage &storage,
+                    const UserDictionaryJournalRecord &record) {
+  UserDictionaryStorage replayed = base;
+  ASSERT_TRUE(UserDictionaryJournal::ApplyRecord(record, &replayed));
+  EXPECT_PROTO_EQ(storage, replayed);
+}
+
+TEST(UserDictionaryJournalTest, UpdateEntries) {
+  UserDictionaryStorage base;
+  AddDictionary(&base, 1, 10);
+  AddDictionary(&base, 2, 10);
+
+  {
+    // Append.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries(1)->add_entries()->set_key("new");
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddUpdateEntriesOperation(storage.dictionaries(1),
+                                                     10, 11, &record);
+    EXPECT_EQ(record.operations_size(), 1);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Edit.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries(0)->mutable_entries(3)->set_value("edited");
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddUpdateEntriesOperation(storage.dictionaries(0),
+                                                     3, 4, &record);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Empty range.
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddUpdateEntriesOperation(base.dictionaries(0), 3,
+                                                     3, &record);
+    EXPECT_EQ(record.operations_size(), 0);
+  }
+  {
+    // Delete in descending order, which is one operation.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries(0)->mutable_entries()->DeleteSubrange(7, 1);
+    storage.mutable_dictionaries(0)->mutable_entries()->DeleteSubrange(2, 3);
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddDeleteEntriesOperations(1, {7, 4, 3, 2},
+                                                      &record);
+    ASSERT_EQ(record.operations_size(), 1);
+    EXPECT_EQ(record.operations(0).deleted_entry_indices_size(), 4);
+    EXPECT_EQ(record.operations(0).entries_size(), 0);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Delete the same index twice, which moves the next entry to it.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries(1)->mutable_entries()->DeleteSubrange(5, 2);
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddDeleteEntriesOperations(2, {5, 5}, &record);
+    EXPECT_EQ(record.operations_size(), 2);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Delete, edit and append at once.
+    UserDictionaryStorage storage = base;
+    UserDictionary *dictionary = storage.mutable_dictionaries(1);
+    dictionary->mutable_entries()->DeleteSubrange(0, 2);
+    dictionary->mutable_entries(4)->set_comment("edited");
+    dictionary->add_entries()->set_key("new");
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddDeleteEntriesOperations(2, {1, 0}, &record);
+    UserDictionaryJournal::AddUpdateEntriesOperation(*dictionary, 4, 5,
+                                                     &record);
+    UserDictionaryJournal::AddUpdateEntriesOperation(*dictionary, 8, 9,
+                                                     &record);
+    EXPECT_EQ(record.operations_size(), 3);
+    ExpectReplayed(base, storage, record);
+  }
+}
+
+TEST(UserDictionaryJournalTest, UpdateDictionaries) {
+  UserDictionaryStorage base;
+  AddDictionary(&base, 1, 3);
+  AddDictionary(&base, 2, 3);
+  AddDictionary(&base, 3, 3);
+
+  {
+    // Rename.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries(1)->set_name("renamed");
+    storage.mutable_dictionaries(1)->set_enabled(false);
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddUpdatePropertiesOperation(
+        storage.dictionaries(1), &record);
+    ASSERT_EQ(record.operations_size(), 1);
+    EXPECT_EQ(record.operations(0).dictionary().name(), "renamed");
+    EXPECT_EQ(record.operations(0).dictionary().entries_size(), 0);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Delete.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries()->DeleteSubrange(1, 1);
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddDeleteDictionaryOperation(2, &record);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Insert.
+    UserDictionaryStorage storage = base;
+    AddDictionary(&storage, 4, 5);
+    storage.mutable_dictionaries()->SwapElements(2, 3);
+    storage.mutable_dictionaries()->SwapElements(1, 2);
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddInsertDictionaryOperation(storage, 1, &record);
+    ExpectReplayed(base, storage, record);
+  }
+  {
+    // Delete one, insert one and edit an entry.
+    UserDictionaryStorage storage = base;
+    storage.mutable_dictionaries()->DeleteSubrange(0, 1);
+    AddDictionary(&storage, 4, 5);
+    storage.mutable_dictionaries(1)->mutable_entries(0)->set_key("edited");
+    UserDictionaryJournalRecord record;
+    UserDictionaryJournal::AddDeleteDictionaryOperation(1, &record);
+    UserDictionaryJournal::AddInsertDictionaryOperation(storage, 2, &record);
+    UserDictionaryJournal::AddUpdateEntriesOperation(storage.dictionaries(1),
+                                                     0, 1, &record);
+    EXPECT_EQ(record.operations_size(), 3);
+    ExpectReplayed(base, storage, record);
+  }
+}
+
+TEST(UserDictionaryJournalTest, ApplyMismatchedRecord) {
+  UserDictionaryStorage storage;
+  AddDictionary(&storage, 1, 3);
+
+  UserDictionaryJournalRecord record;
+  UserDictionaryJournalRecord::Operation *operation = record.add_operations();
+  operation->set_type(UserDictionaryJournalRecord::Operation::UPDATE_ENTRIES);
+  operation->set_dictionary_id(1);
+  operation->add_entry_indices(5);
+  operation->add_entries()->set_key("new");
+  EXPECT_FALSE(UserDictionaryJournal::ApplyRecord(record, &storage));
+
+  operation->set_dictionary_id(2);
+  operation->set_entry_indices(0, 3);
+  EXPECT_FALSE(UserDictionaryJournal::ApplyRecord(record, &storage));
+}
+
+TEST(UserDictionaryJournalTest, Frames) {
+  std::vector<UserDictionaryJournalRecord> records(3);
+  records[0].set_snapshot_id(12345);
+  records[1].add_operations()->set_dictionary_id(1);
+  records[2].add_operations()->set_dictionary_id(2);
+
+  std::string data;
+  for (const UserDictionaryJournalRecord &record : records) {
+    UserDictionaryJournal::AppendFrame(record, &data);
+  }
+
+  std::vector<UserDictionaryJournalRecord> parsed;
+  EXPECT_EQ(UserDictionaryJournal::ParseFrames(data, &parsed), data.size());
+  ASSERT_EQ(parsed.size(), records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_PROTO_EQ(records[i], parsed[i]);
+  }
+
+  // The partially written frame is ignored.
+  std::string last_frame;
+  UserDictionaryJournal::AppendFrame(records[2], &last_frame);
+  const size_t valid_size = data.size() - last_frame.size();
+  parsed.clear();
+  EXPECT_EQ(
+      UserDictionaryJournal::ParseFrames(data.substr(0, data.size() - 1),
+                                         &parsed),
+      valid_size);
+  EXPECT_EQ(parsed.size(), 2);
+
+  // The broken frame is ignored.
+  data[data.size() - 1] ^= 0xff;
+  parsed.clear();
+  EXPECT_EQ(UserDictionaryJournal::ParseFrames(data, &parsed), valid_size);
+  EXPECT_EQ(parsed.size(), 2);
+}
+
+}  // namespace
+}  // namespace mozc
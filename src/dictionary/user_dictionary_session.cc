@@ -75,11 +75,15 @@ class UndoCreateDictionaryCommand : public UserDictionarySession::UndoCommand {
       delete;
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
-    if (storage->GetProto().dictionaries_size() == 0) {
+    UserDictionaryStorage &proto = storage->GetJournaledProto();
+    if (proto.dictionaries_size() == 0) {
       return false;
     }
 
-    storage->GetProto().mutable_dictionaries()->RemoveLast();
+    const uint64_t dictionary_id =
+        proto.dictionaries(proto.dictionaries_size() - 1).id();
+    proto.mutable_dictionaries()->RemoveLast();
+    storage->RecordDictionaryDeleted(dictionary_id);
     return true;
   }
 };
@@ -99,12 +103,13 @@ class UndoDeleteDictionaryCommand : public UserDictionarySession::UndoCommand {
     }
 
     RepeatedPtrField<UserDictionary> *dictionaries =
-        storage->GetProto().mutable_dictionaries();
+        storage->GetJournaledProto().mutable_dictionaries();
     dictionaries->AddAllocated(dictionary_.release());
 
     // Adjust the position of the reverted dictionary.
     std::rotate(dictionaries->pointer_begin() + index_,
                 dictionaries->pointer_end() - 1, dictionaries->pointer_end());
+    storage->RecordDictionaryInserted(index_);
     return true;
   }
 
@@ -127,10 +132,13 @@ class UndoDeleteDictionaryWithEnsuringNonEmptyStorageCommand
       const UndoDeleteDictionaryWithEnsuringNonEmptyStorageCommand &) = delete;
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
-    if (storage->GetProto().dictionaries_size() != 1) {
+    UserDictionaryStorage &proto = storage->GetJournaledProto();
+    if (proto.dictionaries_size() != 1) {
       return false;
     }
-    dictionary_->Swap(storage->GetProto().mutable_dictionaries(0));
+    dictionary_->Swap(proto.mutable_dictionaries(0));
+    storage->RecordDictionaryDeleted(dictionary_->id());
+    storage->RecordDictionaryInserted(0);
     return true;
   }
 
@@ -149,13 +157,14 @@ class UndoRenameDictionaryCommand : public UserDictionarySession::UndoCommand {
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
     UserDictionary *dictionary =
-        UserDictionaryUtil::GetMutableUserDictionaryById(&storage->GetProto(),
-                                                         dictionary_id_);
+        UserDictionaryUtil::GetMutableUserDictionaryById(
+            &storage->GetJournaledProto(), dictionary_id_);
     if (dictionary == nullptr) {
       return false;
     }
 
     dictionary->set_name(original_name_);
+    storage->RecordDictionaryPropertiesUpdated(dictionary_id_);
     return true;
   }
 
@@ -173,13 +182,15 @@ class UndoAddEntryCommand : public UserDictionarySession::UndoCommand {
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
     UserDictionary *dictionary =
-        UserDictionaryUtil::GetMutableUserDictionaryById(&storage->GetProto(),
-                                                         dictionary_id_);
+        UserDictionaryUtil::GetMutableUserDictionaryById(
+            &storage->GetJournaledProto(), dictionary_id_);
     if (dictionary == nullptr || dictionary->entries_size() == 0) {
       return false;
     }
 
     dictionary->mutable_entries()->RemoveLast();
+    const int index = dictionary->entries_size();
+    storage->RecordEntriesDeleted(dictionary_id_, {index});
     return true;
   }
 
@@ -199,14 +210,15 @@ class UndoEditEntryCommand : public UserDictionarySession::UndoCommand {
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
     UserDictionary *dictionary =
-        UserDictionaryUtil::GetMutableUserDictionaryById(&storage->GetProto(),
-                                                         dictionary_id_);
+        UserDictionaryUtil::GetMutableUserDictionaryById(
+            &storage->GetJournaledProto(), dictionary_id_);
     if (dictionary == nullptr || index_ < 0 ||
         dictionary->entries_size() <= index_) {
       return false;
     }
 
     *dictionary->mutable_entries(index_) = original_entry_;
+    storage->RecordEntriesUpdated(dictionary_id_, index_, index_ + 1);
     return true;
   }
 
@@ -244,8 +256,8 @@ class UndoDeleteEntryCommand : public UserDictionarySession::UndoCommand {
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
     UserDictionary *dictionary =
-        UserDictionaryUtil::GetMutableUserDictionaryById(&storage->GetProto(),
-                                                         dictionary_id_);
+        UserDictionaryUtil::GetMutableUserDictionaryById(
+            &storage->GetJournaledProto(), dictionary_id_);
     if (dictionary == nullptr) {
       return false;
     }
@@ -286,6 +298,12 @@ class UndoDeleteEntryCommand : public UserDictionarySession::UndoCommand {
       entries->AddAllocated(backup[backup_index]);
     }
 
+    // The entries after the first reverted one have been moved.
+    if (!deleted_entries_.empty()) {
+      storage->RecordEntriesUpdated(dictionary_id_, deleted_entries_[0].first,
+                                    entries->size());
+    }
+
     // Release the entries.
     deleted_entries_.clear();
     return true;
@@ -307,17 +325,20 @@ class UndoImportFromStringCommand : public UserDictionarySession::UndoCommand {
 
   bool RunUndo(mozc::UserDictionaryStorage *storage) override {
     UserDictionary *dictionary =
-        UserDictionaryUtil::GetMutableUserDictionaryById(&storage->GetProto(),
-                                                         dictionary_id_);
+        UserDictionaryUtil::GetMutableUserDictionaryById(
+            &storage->GetJournaledProto(), dictionary_id_);
     if (dictionary == nullptr) {
       return false;
     }
 
     RepeatedPtrField<UserDictionary::Entry> *entries =
         dictionary->mutable_entries();
+    std::vector<int> deleted_indices;
     while (original_num_entries_ < entries->size()) {
       entries->RemoveLast();
+      deleted_indices.push_back(entries->size());
     }
+    storage->RecordEntriesDeleted(dictionary_id_, deleted_indices);
     return true;
   }
 
@@ -342,7 +363,7 @@ UserDictionarySession::~UserDictionarySession() { ClearUndoHistory(); }
 
 // TODO(hidehiko) move this to header.
 const UserDictionaryStorage &UserDictionarySession::storage() const {
-  return storage_->GetProto();
+  return std::as_const(*storage_).GetProto();
 }
 mozc::UserDictionaryStorage *UserDictionarySession::mutable_storage() {
   return storage_.get();
@@ -463,9 +484,10 @@ UserDictionaryCommandStatus::Status UserDictionarySession::Undo() {
 UserDictionaryCommandStatus::Status UserDictionarySession::CreateDictionary(
     const absl::string_view dictionary_name, uint64_t *new_dictionary_id) {
   UserDictionaryCommandStatus::Status status =
-      UserDictionaryUtil::CreateDictionary(&storage_->GetProto(),
+      UserDictionaryUtil::CreateDictionary(&storage_->GetJournaledProto(),
                                            dictionary_name, new_dictionary_id);
   if (status == UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS) {
+    storage_->RecordDictionaryInserted(storage_->dictionaries_size() - 1);
     AddUndoCommand(new UndoCreateDictionaryCommand);
   }
   return status;
@@ -487,12 +509,13 @@ UserDictionarySession::DeleteDictionaryInternal(uint64_t dictionary_id,
                                                 bool ensure_non_empty_storage) {
   int original_index;
   UserDictionary *deleted_dictionary;
-  if (!UserDictionaryUtil::DeleteDictionary(&storage_->GetProto(),
+  if (!UserDictionaryUtil::DeleteDictionary(&storage_->GetJournaledProto(),
                                             dictionary_id, &original_index,
                                             &deleted_dictionary)) {
     // Failed to delete the dictionary.
     return UserDictionaryCommandStatus::UNKNOWN_DICTIONARY_ID;
   }
+  storage_->RecordDictionaryDeleted(dictionary_id);
 
   if ((ensure_non_empty_storage && EnsureNonEmptyStorage())) {
     // The storage was empty.
@@ -510,7 +533,7 @@ UserDictionaryCommandStatus::Status UserDictionarySession::RenameDictionary(
     const uint64_t dictionary_id, const absl::string_view dictionary_name) {
   std::string original_name;
   const UserDictionary *dictionary = UserDictionaryUtil::GetUserDictionaryById(
-      storage_->GetProto(), dictionary_id);
+      storage(), dictionary_id);
   if (dictionary != nullptr) {
     // Note that if dictionary is null, it means the dictionary_id is invalid
     // so following RenameDictionary will fail, and error handling is done
@@ -545,7 +568,7 @@ UserDictionaryCommandStatus::Status UserDictionarySession::RenameDictionary(
 UserDictionaryCommandStatus::Status UserDictionarySession::AddEntry(
     uint64_t dictionary_id, const UserDictionary::Entry &entry) {
   UserDictionary *dictionary = UserDictionaryUtil::GetMutableUserDictionaryById(
-      &storage_->GetProto(), dictionary_id);
+      &storage_->GetJournaledProto(), dictionary_id);
   if (dictionary == nullptr) {
     return UserDictionaryCommandStatus::UNKNOWN_DICTIONARY_ID;
   }
@@ -564,6 +587,8 @@ UserDictionaryCommandStatus::Status UserDictionarySession::AddEntry(
   UserDictionary::Entry *new_entry = dictionary->add_entries();
   *new_entry = entry;
   UserDictionaryUtil::SanitizeEntry(new_entry);
+  storage_->RecordEntriesUpdated(dictionary_id, dictionary->entries_size() - 1,
+                                 dictionary->entries_size());
 
   AddUndoCommand(new UndoAddEntryCommand(dictionary_id));
   return UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS;
@@ -572,7 +597,7 @@ UserDictionaryCommandStatus::Status UserDictionarySession::AddEntry(
 UserDictionaryCommandStatus::Status UserDictionarySession::EditEntry(
     uint64_t dictionary_id, int index, const UserDictionary::Entry &entry) {
   UserDictionary *dictionary = UserDictionaryUtil::GetMutableUserDictionaryById(
-      &storage_->GetProto(), dictionary_id);
+      &storage_->GetJournaledProto(), dictionary_id);
   if (dictionary == nullptr) {
     return UserDictionaryCommandStatus::UNKNOWN_DICTIONARY_ID;
   }
@@ -593,13 +618,14 @@ UserDictionaryCommandStatus::Status UserDictionarySession::EditEntry(
 
   *target_entry = entry;
   UserDictionaryUtil::SanitizeEntry(target_entry);
+  storage_->RecordEntriesUpdated(dictionary_id, index, index + 1);
   return UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS;
 }
 
 UserDictionaryCommandStatus::Status UserDictionarySession::DeleteEntry(
     uint64_t dictionary_id, std::vector<int> index_list) {
   UserDictionary *dictionary = UserDictionaryUtil::GetMutableUserDictionaryById(
-      &storage_->GetProto(), dictionary_id);
+      &storage_->GetJournaledProto(), dictionary_id);
   if (dictionary == nullptr) {
     return UserDictionaryCommandStatus::UNKNOWN_DICTIONARY_ID;
   }
@@ -627,6 +653,7 @@ UserDictionaryCommandStatus::Status UserDictionarySession::DeleteEntry(
                 entries->pointer_begin() + index + 1, entries->pointer_end());
     deleted_entries.push_back(std::make_pair(index, entries->ReleaseLast()));
   }
+  storage_->RecordEntriesDeleted(dictionary_id, index_list);
 
   AddUndoCommand(new UndoDeleteEntryCommand(dictionary_id, deleted_entries));
   return UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS;
@@ -635,7 +662,7 @@ UserDictionaryCommandStatus::Status UserDictionarySession::DeleteEntry(
 UserDictionaryCommandStatus::Status UserDictionarySession::ImportFromString(
     const uint64_t dictionary_id, const absl::string_view data) {
   UserDictionary *dictionary = UserDictionaryUtil::GetMutableUserDictionaryById(
-      &storage_->GetProto(), dictionary_id);
+      &storage_->GetJournaledProto(), dictionary_id);
   if (dictionary == nullptr) {
     return UserDictionaryCommandStatus::UNKNOWN_DICTIONARY_ID;
   }
@@ -643,6 +670,8 @@ UserDictionaryCommandStatus::Status UserDictionarySession::ImportFromString(
   int original_num_entries = dictionary->entries_size();
   UserDictionaryCommandStatus::Status status =
       ImportFromStringInternal(dictionary, data);
+  storage_->RecordEntriesUpdated(dictionary_id, original_num_entries,
+                                 dictionary->entries_size());
 
   // Remember the command regardless of whether the importing is successfully
   // done or not, because ImportFromStringInternal updates the dictionary
@@ -688,7 +717,7 @@ UserDictionarySession::ImportToNewDictionaryFromString(
     const absl::string_view dictionary_name, const absl::string_view data,
     uint64_t *new_dictionary_id) {
   UserDictionaryCommandStatus::Status status =
-      UserDictionaryUtil::CreateDictionary(&storage_->GetProto(),
+      UserDictionaryUtil::CreateDictionary(&storage_->GetJournaledProto(),
                                            dictionary_name, new_dictionary_id);
   if (status != UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS) {
     return status;
@@ -698,17 +727,20 @@ UserDictionarySession::ImportToNewDictionaryFromString(
   AddUndoCommand(new UndoCreateDictionaryCommand);
 
   UserDictionary *dictionary = UserDictionaryUtil::GetMutableUserDictionaryById(
-      &storage_->GetProto(), *new_dictionary_id);
+      &storage_->GetJournaledProto(), *new_dictionary_id);
   if (dictionary == nullptr) {
     // The dictionary should be always found.
     return UserDictionaryCommandStatus::UNKNOWN_ERROR;
   }
 
-  return ImportFromStringInternal(dictionary, data);
+  status = ImportFromStringInternal(dictionary, data);
+  // The new dictionary is the last one.
+  storage_->RecordDictionaryInserted(storage_->dictionaries_size() - 1);
+  return status;
 }
 
 bool UserDictionarySession::EnsureNonEmptyStorage() {
-  if (storage_->GetProto().dictionaries_size() > 0) {
+  if (storage_->dictionaries_size() > 0) {
     // The storage already has at least one dictionary. Do nothing.
     return false;
   }
@@ -716,10 +748,12 @@ bool UserDictionarySession::EnsureNonEmptyStorage() {
   // Creates a dictionary with the default name. Should never fail.
   uint64_t new_dictionary_id;
   UserDictionaryCommandStatus::Status status =
-      UserDictionaryUtil::CreateDictionary(
-          &storage_->GetProto(), default_dictionary_name_, &new_dictionary_id);
+      UserDictionaryUtil::CreateDictionary(&storage_->GetJournaledProto(),
+                                           default_dictionary_name_,
+                                           &new_dictionary_id);
   CHECK_EQ(status,
            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  storage_->RecordDictionaryInserted(storage_->dictionaries_size() - 1);
   return true;
 }
 
@@ -744,7 +778,15 @@ void UserDictionarySession::AddUndoCommand(UndoCommand *undo_command) {
 
 void UserDictionarySession::ClearDictionariesAndUndoHistory() {
   ScopedUserDictionaryLocker l(storage_.get());
-  storage_->GetProto().clear_dictionaries();
+  std::vector<uint64_t> dictionary_ids;
+  dictionary_ids.reserve(storage_->dictionaries_size());
+  for (size_t i = 0; i < storage_->dictionaries_size(); ++i) {
+    dictionary_ids.push_back(storage_->dictionaries(i).id());
+  }
+  storage_->GetJournaledProto().clear_dictionaries();
+  for (const uint64_t dictionary_id : dictionary_ids) {
+    storage_->RecordDictionaryDeleted(dictionary_id);
+  }
   ClearUndoHistory();
 }
 
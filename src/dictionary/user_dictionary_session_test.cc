@@ -46,6 +46,7 @@
 #include "testing/gunit.h"
 #include "testing/testing_util.h"
 #include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 
 namespace {
@@ -69,10 +70,12 @@ class UserDictionarySessionTest : public ::testing::Test {
     original_user_profile_directory_ = SystemUtil::GetUserProfileDirectory();
     SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
     EXPECT_OK(FileUtil::UnlinkIfExists(GetUserDictionaryFile()));
+    EXPECT_OK(FileUtil::UnlinkIfExists(GetJournalFile()));
   }
 
   void TearDown() override {
     EXPECT_OK(FileUtil::UnlinkIfExists(GetUserDictionaryFile()));
+    EXPECT_OK(FileUtil::UnlinkIfExists(GetJournalFile()));
     SystemUtil::SetUserProfileDirectory(original_user_profile_directory_);
   }
 
@@ -83,6 +86,22 @@ class UserDictionarySessionTest : public ::testing::Test {
     return FileUtil::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "test.db");
   }
 
+  static std::string GetJournalFile() {
+    return mozc::UserDictionaryStorage::GetJournalFileName(
+        GetUserDictionaryFile());
+  }
+
+  // Saves the session and checks that another session loads the same
+  // storage.
+  void ExpectSaved(UserDictionarySession *session) {
+    ASSERT_EQ(session->Save(),
+              UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+    UserDictionarySession loaded(GetUserDictionaryFile());
+    ASSERT_EQ(loaded.Load(),
+              UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+    EXPECT_PROTO_EQ(session->storage(), loaded.storage());
+  }
+
   void ResetEntry(const absl::string_view key, const absl::string_view value,
                   const UserDictionary::PosType pos,
                   UserDictionary::Entry *entry) {
@@ -737,4 +756,70 @@ TEST_F(UserDictionarySessionTest, ClearDictionariesAndUndoHistory) {
   EXPECT_FALSE(session.has_undo_history());
 }
 
+TEST_F(UserDictionarySessionTest, SaveToJournal) {
+  UserDictionarySession session(GetUserDictionaryFile());
+  ASSERT_EQ(session.Load(), UserDictionaryCommandStatus::FILE_NOT_FOUND);
+
+  uint64_t dic_id;
+  ASSERT_EQ(session.ImportToNewDictionaryFromString("dic1", kDictionaryData,
+                                                    &dic_id),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  const absl::StatusOr<std::string> snapshot =
+      FileUtil::GetContents(GetUserDictionaryFile());
+  ASSERT_OK(snapshot);
+
+  // Every command and its undo is appended to the journal.
+  UserDictionary::Entry entry;
+  ResetEntry("reading", "word", UserDictionary::NOUN, &entry);
+  ASSERT_EQ(session.AddEntry(dic_id, entry),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  ResetEntry("reading", "edited", UserDictionary::NOUN, &entry);
+  ASSERT_EQ(session.EditEntry(dic_id, 1, entry),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  ASSERT_EQ(session.DeleteEntry(dic_id, {3, 0, 2}),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(session.Undo(),
+              UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+    ExpectSaved(&session);
+  }
+  ASSERT_EQ(session.ImportFromString(dic_id, "きょう\t今日\t名詞\n"),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  ASSERT_EQ(session.Undo(),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+
+  uint64_t dic_id2;
+  ASSERT_EQ(session.CreateDictionary("dic2", &dic_id2),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  ASSERT_EQ(session.RenameDictionary(dic_id2, "renamed"),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  ASSERT_EQ(session.DeleteDictionary(dic_id),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(session.Undo(),
+              UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+    ExpectSaved(&session);
+  }
+  ASSERT_EQ(session.DeleteDictionaryWithEnsuringNonEmptyStorage(dic_id),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  ASSERT_EQ(session.Undo(),
+            UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS);
+  ExpectSaved(&session);
+  session.ClearDictionariesAndUndoHistory();
+  ExpectSaved(&session);
+
+  EXPECT_EQ(FileUtil::GetContents(GetUserDictionaryFile()).value(),
+            *snapshot);
+}
+
 }  // namespace
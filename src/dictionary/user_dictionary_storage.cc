@@ -32,21 +32,30 @@
 #include <cstddef>
 #include <cstdint>
 #include <ios>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/process_mutex.h"
 #include "base/protobuf/zero_copy_stream_impl.h"
+#include "base/thread2.h"
+#include "dictionary/user_dictionary_journal.h"
 #include "dictionary/user_dictionary_util.h"
 #include "protocol/user_dictionary_storage.pb.h"
+#include "absl/random/random.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace {
@@ -60,18 +69,84 @@ constexpr size_t kDefaultTotalBytesLimit = 512 << 20;
 // saved correctly. Please make the dictionary size smaller"
 constexpr size_t kDefaultWarningTotalBytesLimit = 256 << 20;
 
+// The journal is compacted into a new snapshot when it exceeds both of
+// kMinJournalSizeToCompact and 1/kSnapshotToJournalSizeRatio of the
+// snapshot.
+constexpr size_t kMinJournalSizeToCompact = 256 << 10;
+constexpr size_t kSnapshotToJournalSizeRatio = 4;
+
 constexpr char kDefaultSyncDictionaryName[] = "Sync Dictionary";
 constexpr char kDictionaryNameConvertedFromSyncableDictionary[] = "同期用辞書";
 
 using ::mozc::user_dictionary::UserDictionaryCommandStatus;
+using ::mozc::user_dictionary::UserDictionaryJournalRecord;
+
+uint64_t CreateSnapshotId() {
+  absl::BitGen gen;
+  uint64_t id = 0;
+  while (id == 0) {
+    id = absl::Uniform<uint64_t>(gen);
+  }
+  return id;
+}
+
+// Returns the first record of the journal for the snapshot of |snapshot_id|.
+std::string GetJournalHeader(uint64_t snapshot_id) {
+  UserDictionaryJournalRecord record;
+  record.set_snapshot_id(snapshot_id);
+  std::string header;
+  UserDictionaryJournal::AppendFrame(record, &header);
+  return header;
+}
+
+// Serializes |storage| to |file_name| and returns the file size.
+absl::StatusOr<size_t> WriteStorage(
+    const user_dictionary::UserDictionaryStorage &storage,
+    const std::string &file_name) {
+  OutputFileStream ofs(file_name,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!ofs) {
+    return absl::PermissionDeniedError(absl::StrFormat(
+        "Cannot open %s for write (SYNC_FAILURE)", file_name));
+  }
+
+  if (!storage.SerializeToOstream(&ofs)) {
+    return absl::InternalError(absl::StrFormat(
+        "SerializeToOstream failed (SYNC_FAILURE); path = %s", file_name));
+  }
+
+  const size_t file_size = ofs.tellp();
+
+  ofs.close();
+  if (ofs.fail()) {
+    return absl::UnknownError(
+        absl::StrFormat("Failed to close %s (SYNC_FAILURE)", file_name));
+  }
+  return file_size;
+}
+
+// Writes |contents| to |file_name| through a temporary file.
+absl::Status AtomicSetContents(const std::string &file_name,
+                               absl::string_view contents) {
+  const std::string tmp_file_name = file_name + ".tmp";
+  if (absl::Status s = FileUtil::SetContents(tmp_file_name, contents);
+      !s.ok()) {
+    return s;
+  }
+  return FileUtil::AtomicRename(tmp_file_name, file_name);
+}
 
 }  // namespace
 
 UserDictionaryStorage::UserDictionaryStorage(const std::string &file_name)
     : file_name_(file_name),
+      journal_file_name_(GetJournalFileName(file_name)),
       process_mutex_(new ProcessMutex(FileUtil::Basename(file_name).c_str())) {}
 
-UserDictionaryStorage::~UserDictionaryStorage() { UnLock(); }
+UserDictionaryStorage::~UserDictionaryStorage() {
+  WaitForCompaction();
+  UnLock();
+}
 
 const std::string &UserDictionaryStorage::filename() const {
   return file_name_;
@@ -108,17 +183,101 @@ absl::Status UserDictionaryStorage::LoadInternal() {
     last_error_type_ = BROKEN_FILE;
     return absl::UnknownError("ParseFromCodedStream failed. File seems broken");
   }
+
+  absl::MutexLock l(&local_mutex_);
+  snapshot_id_ = proto_.snapshot_id();
+  snapshot_size_ = decoder.CurrentPosition();
   return absl::OkStatus();
 }
 
+absl::StatusOr<bool> UserDictionaryStorage::LoadJournal() {
+  absl::MutexLock l(&local_mutex_);
+  journal_id_ = 0;
+  journal_size_ = 0;
+  if (snapshot_id_ == 0) {
+    // Saved without the journal.
+    return false;
+  }
+
+  absl::StatusOr<std::string> journal =
+      FileUtil::GetContents(journal_file_name_);
+  if (!journal.ok()) {
+    VLOG(1) << "Cannot read the journal: " << journal.status();
+    return false;
+  }
+
+  std::vector<UserDictionaryJournalRecord> records;
+  const size_t valid_size =
+      UserDictionaryJournal::ParseFrames(*journal, &records);
+  if (records.empty()) {
+    LOG(WARNING) << "The journal has no header";
+    return false;
+  }
+
+  // The number of the records included in the snapshot, and the header.
+  size_t num_included_records = 1;
+  const uint64_t journal_id = records[0].snapshot_id();
+  if (journal_id != snapshot_id_) {
+    if (journal_id != proto_.base_snapshot_id() ||
+        valid_size < proto_.base_journal_size()) {
+      // The journal belongs to another snapshot. This happens when the
+      // process stopped while replacing the snapshot and the journal.
+      LOG(WARNING) << "Ignores the journal of another snapshot";
+      return false;
+    }
+    // The compaction stopped before writing the new journal, so the rest of
+    // the old journal is replayed.
+    std::vector<UserDictionaryJournalRecord> included_records;
+    if (UserDictionaryJournal::ParseFrames(
+            absl::string_view(*journal).substr(0, proto_.base_journal_size()),
+            &included_records) != proto_.base_journal_size()) {
+      LOG(WARNING) << "The snapshot doesn't end at a record of the journal";
+      return false;
+    }
+    num_included_records = included_records.size();
+  }
+
+  for (size_t i = num_included_records; i < records.size(); ++i) {
+    if (!UserDictionaryJournal::ApplyRecord(records[i], &proto_)) {
+      return absl::DataLossError(
+          absl::StrCat("The journal doesn't match the snapshot: record=", i));
+    }
+  }
+  if (valid_size != journal->size()) {
+    LOG(WARNING) << "Ignores the broken tail of the journal: "
+                 << journal->size() - valid_size << " bytes";
+    return false;
+  }
+  journal_id_ = journal_id;
+  journal_size_ = valid_size;
+  return true;
+}
+
 absl::Status UserDictionaryStorage::Load() {
+  WaitForCompaction();
   last_error_type_ = USER_DICTIONARY_STORAGE_NO_ERROR;
+  pending_record_.reset();
 
   absl::Status status = Exists();
 
   // Check if the user dictionary exists or not.
   if (status.ok()) {
     status = LoadInternal();
+    if (status.ok()) {
+      absl::StatusOr<bool> appendable = LoadJournal();
+      if (!appendable.ok()) {
+        // Discards the partially applied journal. The journal is not appended
+        // any more, so the next Save() writes the whole storage.
+        LOG(ERROR) << "Cannot apply the journal: " << appendable.status();
+        status = LoadInternal();
+        if (status.ok()) {
+          last_error_type_ = BROKEN_FILE;
+          status = appendable.status();
+        }
+      } else if (*appendable) {
+        pending_record_.emplace();
+      }
+    }
   } else if (absl::IsNotFound(status)) {
     // This is also an expected scenario: e.g., clean installation, unit tests.
     VLOG(1) << "User dictionary file has not been created";
@@ -138,6 +297,7 @@ absl::Status UserDictionaryStorage::Load() {
     if (dict.id() == 0) {
       proto_.mutable_dictionaries(i)->set_id(
           UserDictionaryUtil::CreateNewDictionaryId(proto_));
+      pending_record_.reset();
     }
   }
 
@@ -156,40 +316,105 @@ absl::Status UserDictionaryStorage::Save() {
     }
   }
 
-  const std::string tmp_file_name = file_name_ + ".tmp";
-  std::string size_error_msg;
-  {
-    OutputFileStream ofs(tmp_file_name,
-                         std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!ofs) {
-      last_error_type_ = SYNC_FAILURE;
-      return absl::PermissionDeniedError(absl::StrFormat(
-          "Cannot open %s for write (SYNC_FAILURE)", tmp_file_name));
+  if (pending_record_.has_value()) {
+    absl::Status s = AppendJournal(*pending_record_);
+    if (s.ok() || last_error_type_ == TOO_BIG_FILE_BYTES) {
+      // The record has been appended.
+      pending_record_->Clear();
+      MaybeStartCompaction();
+      return s;
     }
+    LOG(WARNING) << "Cannot append to the journal: " << s;
+  }
 
-    if (!proto_.SerializeToOstream(&ofs)) {
-      last_error_type_ = SYNC_FAILURE;
-      return absl::InternalError(
-          absl::StrFormat("SerializeToOstream failed (SYNC_FAILURE); path = %s",
-                          tmp_file_name));
-    }
+  WaitForCompaction();
+  return SaveSnapshot();
+}
+
+absl::Status UserDictionaryStorage::AppendJournal(
+    const UserDictionaryJournalRecord &record) {
+  if (record.operations_size() == 0) {
+    return absl::OkStatus();
+  }
+
+  absl::MutexLock l(&local_mutex_);
+  if (journal_size_ == 0) {
+    return absl::FailedPreconditionError("No journal to append");
+  }
 
-    const size_t file_size = ofs.tellp();
+  // Another process may have saved the storage after this object loaded it.
+  // Appending to the journal is allowed only when the journal is exactly
+  // what this object saw last time.
+  {
+    InputFileStream ifs(journal_file_name_, std::ios::binary);
+    if (!ifs) {
+      return absl::NotFoundError(
+          absl::StrCat("Cannot open the journal: ", journal_file_name_));
+    }
+    const std::string expected_header = GetJournalHeader(journal_id_);
+    std::string header(expected_header.size(), '\0');
+    ifs.read(header.data(), header.size());
+    ifs.seekg(0, std::ios::end);
+    if (!ifs || header != expected_header ||
+        static_cast<size_t>(ifs.tellg()) != journal_size_) {
+      return absl::AbortedError("The journal has been updated by others");
+    }
+  }
 
+  std::string frame;
+  UserDictionaryJournal::AppendFrame(record, &frame);
+  {
+    OutputFileStream ofs(journal_file_name_,
+                         std::ios::out | std::ios::binary | std::ios::app);
+    if (!ofs) {
+      journal_size_ = 0;
+      return absl::PermissionDeniedError(absl::StrFormat(
+          "Cannot open %s for append (SYNC_FAILURE)", journal_file_name_));
+    }
+    ofs.write(frame.data(), frame.size());
     ofs.close();
     if (ofs.fail()) {
-      last_error_type_ = SYNC_FAILURE;
+      // The journal may end with a partial frame.
+      journal_size_ = 0;
       return absl::UnknownError(
-          absl::StrFormat("Failed to close %s (SYNC_FAILURE)", tmp_file_name));
+          absl::StrFormat("Failed to append to %s", journal_file_name_));
     }
+  }
+  journal_size_ += frame.size();
 
-    if (file_size >= kDefaultWarningTotalBytesLimit) {
-      size_error_msg = absl::StrFormat(
-          "The file size exceeds the limit: size = %d, limit = %d", file_size,
-          kDefaultWarningTotalBytesLimit);
-      // Perform "AtomicRename" even if the size exceeded.
-      last_error_type_ = TOO_BIG_FILE_BYTES;
-    }
+  const size_t file_size = snapshot_size_ + journal_size_;
+  if (file_size >= kDefaultWarningTotalBytesLimit) {
+    last_error_type_ = TOO_BIG_FILE_BYTES;
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Save was successful with error (TOO_BIG_FILE_BYTES): "
+        "The file size exceeds the limit: size = %d, limit = %d",
+        file_size, kDefaultWarningTotalBytesLimit));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status UserDictionaryStorage::SaveSnapshot() {
+  // The changes are not appended to the journal until this succeeds.
+  pending_record_.reset();
+  const uint64_t snapshot_id = CreateSnapshotId();
+  proto_.set_snapshot_id(snapshot_id);
+  proto_.clear_base_snapshot_id();
+  proto_.clear_base_journal_size();
+
+  const std::string tmp_file_name = file_name_ + ".tmp";
+  absl::StatusOr<size_t> file_size = WriteStorage(proto_, tmp_file_name);
+  if (!file_size.ok()) {
+    last_error_type_ = SYNC_FAILURE;
+    return file_size.status();
+  }
+
+  std::string size_error_msg;
+  if (*file_size >= kDefaultWarningTotalBytesLimit) {
+    size_error_msg = absl::StrFormat(
+        "The file size exceeds the limit: size = %d, limit = %d", *file_size,
+        kDefaultWarningTotalBytesLimit);
+    // Perform "AtomicRename" even if the size exceeded.
+    last_error_type_ = TOO_BIG_FILE_BYTES;
   }
 
   if (absl::Status s = FileUtil::AtomicRename(tmp_file_name, file_name_);
@@ -204,6 +429,24 @@ absl::Status UserDictionaryStorage::Save() {
     return absl::Status(s.code(), msg);
   }
 
+  // Starts a new journal. The old journal is ignored even if this fails, as
+  // it has the ID of the old snapshot.
+  const std::string journal_header = GetJournalHeader(snapshot_id);
+  absl::Status journal_status =
+      AtomicSetContents(journal_file_name_, journal_header);
+  LOG_IF(ERROR, !journal_status.ok())
+      << "Cannot create the journal: " << journal_status;
+  {
+    absl::MutexLock l(&local_mutex_);
+    snapshot_id_ = snapshot_id;
+    snapshot_size_ = *file_size;
+    journal_id_ = journal_status.ok() ? snapshot_id : 0;
+    journal_size_ = journal_status.ok() ? journal_header.size() : 0;
+  }
+  if (journal_status.ok()) {
+    pending_record_.emplace();
+  }
+
   if (last_error_type_ == TOO_BIG_FILE_BYTES) {
     return absl::FailedPreconditionError(absl::StrFormat(
         "Save was successful with error (TOO_BIG_FILE_BYTES): %s",
@@ -213,6 +456,93 @@ absl::Status UserDictionaryStorage::Save() {
   return absl::OkStatus();
 }
 
+void UserDictionaryStorage::MaybeStartCompaction() {
+  uint64_t journal_id = 0;
+  size_t journal_offset = 0;
+  {
+    absl::MutexLock l(&local_mutex_);
+    if (compacting_ || journal_size_ < kMinJournalSizeToCompact ||
+        journal_size_ < snapshot_size_ / kSnapshotToJournalSizeRatio) {
+      return;
+    }
+    compacting_ = true;
+    journal_id = journal_id_;
+    journal_offset = journal_size_;
+  }
+
+  // The previous compaction has already finished as |compacting_| was false.
+  if (compaction_thread_.has_value()) {
+    compaction_thread_->Join();
+  }
+  // The copy is taken here, as proto_ can be modified while compacting.
+  auto snapshot =
+      std::make_shared<user_dictionary::UserDictionaryStorage>(proto_);
+  snapshot->set_base_snapshot_id(journal_id);
+  snapshot->set_base_journal_size(journal_offset);
+  compaction_thread_.emplace([this, snapshot] { Compact(snapshot.get()); });
+}
+
+void UserDictionaryStorage::Compact(
+    user_dictionary::UserDictionaryStorage *snapshot) {
+  const uint64_t snapshot_id = CreateSnapshotId();
+  snapshot->set_snapshot_id(snapshot_id);
+  const std::string tmp_file_name = file_name_ + ".compact.tmp";
+  absl::StatusOr<size_t> file_size = WriteStorage(*snapshot, tmp_file_name);
+
+  absl::MutexLock l(&local_mutex_);
+  compacting_ = false;
+  if (!file_size.ok()) {
+    LOG(ERROR) << "Cannot write the snapshot: " << file_size.status();
+    FileUtil::UnlinkOrLogError(tmp_file_name);
+    return;
+  }
+
+  // Another process can save the storage after UnLock(), so the files are
+  // replaced only while this process holds the lock.
+  if (!locked_ && !process_mutex_->Lock()) {
+    LOG(WARNING) << "The storage is locked by others. Cancels the compaction";
+    FileUtil::UnlinkOrLogError(tmp_file_name);
+    return;
+  }
+
+  // The snapshot is valid only while the journal is the one it is based on.
+  absl::StatusOr<std::string> journal =
+      FileUtil::GetContents(journal_file_name_);
+  absl::Status status = journal.status();
+  if (status.ok() &&
+      (journal_id_ != snapshot->base_snapshot_id() ||
+       journal_size_ < snapshot->base_journal_size() ||
+       journal->size() != journal_size_ ||
+       !absl::StartsWith(*journal, GetJournalHeader(journal_id_)))) {
+    status = absl::AbortedError("The journal has been updated by others");
+  }
+  if (status.ok()) {
+    // Until the new journal is written, Load() replays the old journal after
+    // |base_journal_size| on top of the new snapshot.
+    status = FileUtil::AtomicRename(tmp_file_name, file_name_);
+  }
+  if (status.ok()) {
+    snapshot_id_ = snapshot_id;
+    snapshot_size_ = *file_size;
+    std::string new_journal = GetJournalHeader(snapshot_id);
+    new_journal.append(*journal, snapshot->base_journal_size(),
+                       std::string::npos);
+    // The old journal is kept and appended if this fails.
+    status = AtomicSetContents(journal_file_name_, new_journal);
+    if (status.ok()) {
+      journal_id_ = snapshot_id;
+      journal_size_ = new_journal.size();
+    }
+  } else {
+    FileUtil::UnlinkOrLogError(tmp_file_name);
+  }
+  LOG_IF(ERROR, !status.ok()) << "Compaction failed: " << status;
+
+  if (!locked_) {
+    process_mutex_->UnLock();
+  }
+}
+
 bool UserDictionaryStorage::Lock() {
   absl::MutexLock l(&local_mutex_);
   locked_ = process_mutex_->Lock();
@@ -227,6 +557,13 @@ bool UserDictionaryStorage::UnLock() {
   return true;
 }
 
+void UserDictionaryStorage::WaitForCompaction() {
+  if (compaction_thread_.has_value()) {
+    compaction_thread_->Join();
+    compaction_thread_.reset();
+  }
+}
+
 bool UserDictionaryStorage::ExportDictionary(const uint64_t dic_id,
                                              const std::string &file_name) {
   const int index = GetUserDictionaryIndex(dic_id);
@@ -284,7 +621,11 @@ bool UserDictionaryStorage::CreateDictionary(const absl::string_view dic_name,
       break;
   }
 
-  return status == UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS;
+  if (status != UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS) {
+    return false;
+  }
+  RecordDictionaryInserted(proto_.dictionaries_size() - 1);
+  return true;
 }
 
 bool UserDictionaryStorage::DeleteDictionary(uint64_t dic_id) {
@@ -295,6 +636,7 @@ bool UserDictionaryStorage::DeleteDictionary(uint64_t dic_id) {
     return false;
   }
 
+  RecordDictionaryDeleted(dic_id);
   last_error_type_ = USER_DICTIONARY_STORAGE_NO_ERROR;
   return true;
 }
@@ -308,7 +650,8 @@ bool UserDictionaryStorage::RenameDictionary(const uint64_t dic_id,
     return false;
   }
 
-  UserDictionary *dic = GetUserDictionary(dic_id);
+  UserDictionary *dic =
+      UserDictionaryUtil::GetMutableUserDictionaryById(&proto_, dic_id);
   if (dic == nullptr) {
     last_error_type_ = INVALID_DICTIONARY_ID;
     LOG(ERROR) << "Invalid dictionary id: " << dic_id;
@@ -329,6 +672,7 @@ bool UserDictionaryStorage::RenameDictionary(const uint64_t dic_id,
   }
 
   dic->set_name(std::string(dic_name));
+  RecordDictionaryPropertiesUpdated(dic_id);
 
   return true;
 }
@@ -351,9 +695,74 @@ bool UserDictionaryStorage::GetUserDictionaryId(
 
 user_dictionary::UserDictionary *UserDictionaryStorage::GetUserDictionary(
     uint64_t dic_id) {
+  return UserDictionaryUtil::GetMutableUserDictionaryById(&GetProto(), dic_id);
+}
+
+user_dictionary::UserDictionary *
+UserDictionaryStorage::GetJournaledUserDictionary(uint64_t dic_id) {
   return UserDictionaryUtil::GetMutableUserDictionaryById(&proto_, dic_id);
 }
 
+void UserDictionaryStorage::RecordDictionaryInserted(int index) {
+  if (!pending_record_.has_value()) {
+    return;
+  }
+  if (index < 0 || index >= proto_.dictionaries_size()) {
+    LOG(ERROR) << "Invalid dictionary index: " << index;
+    pending_record_.reset();
+    return;
+  }
+  UserDictionaryJournal::AddInsertDictionaryOperation(proto_, index,
+                                                      &*pending_record_);
+}
+
+void UserDictionaryStorage::RecordDictionaryDeleted(uint64_t dic_id) {
+  if (pending_record_.has_value()) {
+    UserDictionaryJournal::AddDeleteDictionaryOperation(dic_id,
+                                                        &*pending_record_);
+  }
+}
+
+void UserDictionaryStorage::RecordDictionaryPropertiesUpdated(uint64_t dic_id) {
+  if (!pending_record_.has_value()) {
+    return;
+  }
+  const UserDictionary *dic =
+      UserDictionaryUtil::GetUserDictionaryById(proto_, dic_id);
+  if (dic == nullptr) {
+    LOG(ERROR) << "Invalid dictionary id: " << dic_id;
+    pending_record_.reset();
+    return;
+  }
+  UserDictionaryJournal::AddUpdatePropertiesOperation(*dic,
+                                                      &*pending_record_);
+}
+
+void UserDictionaryStorage::RecordEntriesUpdated(uint64_t dic_id, int begin,
+                                                 int end) {
+  if (!pending_record_.has_value()) {
+    return;
+  }
+  const UserDictionary *dic =
+      UserDictionaryUtil::GetUserDictionaryById(proto_, dic_id);
+  if (dic == nullptr || begin < 0 || end > dic->entries_size()) {
+    LOG(ERROR) << "Invalid entries: id=" << dic_id << ", range=[" << begin
+               << ", " << end << ")";
+    pending_record_.reset();
+    return;
+  }
+  UserDictionaryJournal::AddUpdateEntriesOperation(*dic, begin, end,
+                                                   &*pending_record_);
+}
+
+void UserDictionaryStorage::RecordEntriesDeleted(
+    uint64_t dic_id, absl::Span<const int> indices) {
+  if (pending_record_.has_value()) {
+    UserDictionaryJournal::AddDeleteEntriesOperations(dic_id, indices,
+                                                      &*pending_record_);
+  }
+}
+
 UserDictionaryStorage::UserDictionaryStorageErrorType
 UserDictionaryStorage::GetLastError() const {
   return last_error_type_;
@@ -363,6 +772,7 @@ bool UserDictionaryStorage::ConvertSyncDictionariesToNormalDictionaries() {
   if (CountSyncableDictionaries(proto_) == 0) {
     return false;
   }
+  pending_record_.reset();
 
   for (int dictionary_index = proto_.dictionaries_size() - 1;
        dictionary_index >= 0; --dictionary_index) {
@@ -468,4 +878,9 @@ std::string UserDictionaryStorage::default_sync_dictionary_name() {
   return std::string(kDefaultSyncDictionaryName);
 }
 
+std::string UserDictionaryStorage::GetJournalFileName(
+    absl::string_view file_name) {
+  return absl::StrCat(file_name, ".journal");
+}
+
 }  // namespace mozc
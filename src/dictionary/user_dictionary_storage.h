@@ -57,18 +57,29 @@
 //   UserDicStorageInterface provides CreateDictionary() and
 //   AddEntry(). Clients of the class can import an external
 //   dictionary file using the two member functions.
+//
+// The storage is saved as a snapshot of the whole storage and an
+// append-only journal of the changes made after the snapshot. Save()
+// usually appends only the changes to the journal, and the journal is
+// compacted into a new snapshot in the background when it gets large.
 
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_STORAGE_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_STORAGE_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 
+#include "base/thread2.h"
 #include "protocol/user_dictionary_storage.pb.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -117,6 +128,8 @@ class UserDictionaryStorage {
 
   // Serialize user dictionary to local file.
   // Need to call Lock() the dictionary before calling Save().
+  // Only the changes recorded since the last Load() or Save() are appended to
+  // the journal when possible. Otherwise, the whole storage is written.
   absl::Status Save();
 
   // Lock the dictionary so that other processes/threads cannot
@@ -145,8 +158,13 @@ class UserDictionaryStorage {
   int GetUserDictionaryIndex(uint64_t dic_id) const;
 
   // return mutable UserDictionary corresponding to dic_id
+  // The changes made through it are not recorded. See GetProto().
   UserDictionary *GetUserDictionary(uint64_t dic_id);
 
+  // Same as GetUserDictionary(), but the caller records the changes with the
+  // Record*() functions. See GetJournaledProto().
+  UserDictionary *GetJournaledUserDictionary(uint64_t dic_id);
+
   // Searches a dictionary from a dictionary name, and the dictionary id is
   // stored in "dic_id".
   // Returns false if the name is not found.
@@ -176,12 +194,45 @@ class UserDictionaryStorage {
 
   static std::string default_sync_dictionary_name();
 
-  user_dictionary::UserDictionaryStorage &GetProto() { return proto_; }
+  // Returns the file name of the journal saved along with |file_name|.
+  static std::string GetJournalFileName(absl::string_view file_name);
+
+  // Returns the mutable storage. The changes made through it are not
+  // recorded, so the next Save() writes the whole storage.
+  user_dictionary::UserDictionaryStorage &GetProto() {
+    pending_record_.reset();
+    return proto_;
+  }
 
   const user_dictionary::UserDictionaryStorage &GetProto() const {
     return proto_;
   }
 
+  // Same as GetProto(), but the caller records every change made through it
+  // with the Record*() functions below, so that the next Save() appends only
+  // the changes to the journal.
+  user_dictionary::UserDictionaryStorage &GetJournaledProto() {
+    return proto_;
+  }
+
+  // The dictionary at |index| has been inserted.
+  void RecordDictionaryInserted(int index);
+
+  // The dictionary of |dic_id| has been deleted.
+  void RecordDictionaryDeleted(uint64_t dic_id);
+
+  // The fields of the dictionary of |dic_id| other than the entries have been
+  // updated.
+  void RecordDictionaryPropertiesUpdated(uint64_t dic_id);
+
+  // The entries in [|begin|, |end|) of the dictionary of |dic_id| have been
+  // updated or appended.
+  void RecordEntriesUpdated(uint64_t dic_id, int begin, int end);
+
+  // The entries at |indices| have been deleted one by one in this order from
+  // the dictionary of |dic_id|.
+  void RecordEntriesDeleted(uint64_t dic_id, absl::Span<const int> indices);
+
   size_t dictionaries_size() const { return proto_.dictionaries_size(); }
 
   const user_dictionary::UserDictionary &dictionaries(size_t i) const {
@@ -196,13 +247,49 @@ class UserDictionaryStorage {
   // Load the data from file_name actually.
   absl::Status LoadInternal();
 
+  // Applies the journal to proto_. Returns false if the journal doesn't
+  // exist or cannot be appended any more. Returns an error if the journal
+  // doesn't match the snapshot, leaving proto_ partially updated.
+  absl::StatusOr<bool> LoadJournal() ABSL_LOCKS_EXCLUDED(local_mutex_);
+
+  // Appends |record| to the journal.
+  absl::Status AppendJournal(
+      const user_dictionary::UserDictionaryJournalRecord &record)
+      ABSL_LOCKS_EXCLUDED(local_mutex_);
+
+  // Writes the whole storage and starts a new journal.
+  absl::Status SaveSnapshot() ABSL_LOCKS_EXCLUDED(local_mutex_);
+
+  // Writes |snapshot|, which includes the journal up to its
+  // |base_journal_size|, and moves the rest of the journal to a new journal.
+  // Runs in the compaction thread.
+  void Compact(user_dictionary::UserDictionaryStorage *snapshot)
+      ABSL_LOCKS_EXCLUDED(local_mutex_);
+
+  void MaybeStartCompaction() ABSL_LOCKS_EXCLUDED(local_mutex_);
+  void WaitForCompaction() ABSL_LOCKS_EXCLUDED(local_mutex_);
+
   user_dictionary::UserDictionaryStorage proto_;
   std::string file_name_;
-  bool locked_ = false;
+  std::string journal_file_name_;
+  bool locked_ ABSL_GUARDED_BY(local_mutex_) = false;
   UserDictionaryStorageErrorType last_error_type_ =
       USER_DICTIONARY_STORAGE_NO_ERROR;
   absl::Mutex local_mutex_;
   std::unique_ptr<ProcessMutex> process_mutex_;
+
+  // The changes to be appended to the journal by the next Save(). Empty if
+  // the next Save() has to write the whole storage.
+  std::optional<user_dictionary::UserDictionaryJournalRecord> pending_record_;
+  uint64_t snapshot_id_ ABSL_GUARDED_BY(local_mutex_) = 0;
+  size_t snapshot_size_ ABSL_GUARDED_BY(local_mutex_) = 0;
+  // ID in the header of the journal file. Differs from snapshot_id_ when the
+  // compaction couldn't write the new journal.
+  uint64_t journal_id_ ABSL_GUARDED_BY(local_mutex_) = 0;
+  // Size of the journal file. 0 if the journal cannot be appended.
+  size_t journal_size_ ABSL_GUARDED_BY(local_mutex_) = 0;
+  bool compacting_ ABSL_GUARDED_BY(local_mutex_) = false;
+  std::optional<Thread2> compaction_thread_;
 };
 
 }  // namespace mozc
@@ -33,6 +33,7 @@
 #include <ios>
 #include <iterator>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/file_stream.h"
@@ -42,10 +43,12 @@
 #include "base/random.h"
 #include "base/system_util.h"
 #include "dictionary/user_dictionary_importer.h"
+#include "dictionary/user_dictionary_journal.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "testing/gmock.h"
 #include "testing/googletest.h"
 #include "testing/gunit.h"
+#include "testing/testing_util.h"
 #include "absl/flags/flag.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_format.h"
@@ -54,6 +57,42 @@ namespace mozc {
 namespace {
 
 using user_dictionary::UserDictionary;
+using user_dictionary::UserDictionaryJournalRecord;
+
+void AddEntry(const std::string &key, UserDictionary *dictionary) {
+  UserDictionary::Entry *entry = dictionary->add_entries();
+  entry->set_key(key);
+  entry->set_value(key + "value");
+  entry->set_pos(UserDictionary::NOUN);
+}
+
+// Adds an entry to the dictionary of |dic_id| and records it for the journal.
+void AddJournaledEntry(const std::string &key, uint64_t dic_id,
+                       UserDictionaryStorage *storage) {
+  const int index = storage->GetUserDictionaryIndex(dic_id);
+  ASSERT_GE(index, 0);
+  UserDictionary *dictionary =
+      storage->GetJournaledProto().mutable_dictionaries(index);
+  AddEntry(key, dictionary);
+  storage->RecordEntriesUpdated(dic_id, dictionary->entries_size() - 1,
+                                dictionary->entries_size());
+}
+
+// Compares the dictionaries. The snapshot IDs can be different, e.g., after
+// the journal is compacted.
+void ExpectSameDictionaries(
+    const user_dictionary::UserDictionaryStorage &expected,
+    const user_dictionary::UserDictionaryStorage &actual) {
+  user_dictionary::UserDictionaryStorage expected_dictionaries = expected;
+  user_dictionary::UserDictionaryStorage actual_dictionaries = actual;
+  for (user_dictionary::UserDictionaryStorage *storage :
+       {&expected_dictionaries, &actual_dictionaries}) {
+    storage->clear_snapshot_id();
+    storage->clear_base_snapshot_id();
+    storage->clear_base_journal_size();
+  }
+  EXPECT_PROTO_EQ(expected_dictionaries, actual_dictionaries);
+}
 
 }  // namespace
 
@@ -63,10 +102,12 @@ class UserDictionaryStorageTest : public ::testing::Test {
     backup_user_profile_directory_ = SystemUtil::GetUserProfileDirectory();
     SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
     EXPECT_OK(FileUtil::UnlinkIfExists(GetUserDictionaryFile()));
+    EXPECT_OK(FileUtil::UnlinkIfExists(GetJournalFile()));
   }
 
   void TearDown() override {
     EXPECT_OK(FileUtil::UnlinkIfExists(GetUserDictionaryFile()));
+    EXPECT_OK(FileUtil::UnlinkIfExists(GetJournalFile()));
     SystemUtil::SetUserProfileDirectory(backup_user_profile_directory_);
   }
 
@@ -74,6 +115,10 @@ class UserDictionaryStorageTest : public ::testing::Test {
     return FileUtil::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "test.db");
   }
 
+  static std::string GetJournalFile() {
+    return UserDictionaryStorage::GetJournalFileName(GetUserDictionaryFile());
+  }
+
  private:
   std::string backup_user_profile_directory_;
 };
@@ -466,4 +511,247 @@ TEST_F(UserDictionaryStorageTest, Export) {
 #endif  // _WIN32
 }
 
+TEST_F(UserDictionaryStorageTest, JournalTest) {
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  uint64_t id = 0;
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  for (int i = 0; i < 10; ++i) {
+    AddEntry("key" + std::to_string(i), storage1.GetUserDictionary(id));
+  }
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  const absl::StatusOr<std::string> snapshot =
+      FileUtil::GetContents(GetUserDictionaryFile());
+  ASSERT_OK(snapshot);
+
+  // Add, edit and delete entries. Only the journal is updated.
+  UserDictionary *dictionary = storage1.GetJournaledUserDictionary(id);
+  ASSERT_NE(dictionary, nullptr);
+  AddEntry("added", dictionary);
+  storage1.RecordEntriesUpdated(id, 10, 11);
+  ASSERT_OK(storage1.Save());
+  dictionary->mutable_entries(3)->set_comment("edited");
+  storage1.RecordEntriesUpdated(id, 3, 4);
+  ASSERT_OK(storage1.Save());
+  dictionary->mutable_entries()->DeleteSubrange(5, 2);
+  storage1.RecordEntriesDeleted(id, {6, 5});
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.RenameDictionary(id, "renamed"));
+  uint64_t id2 = 0;
+  ASSERT_TRUE(storage1.CreateDictionary("test2", &id2));
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.DeleteDictionary(id2));
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.UnLock());
+  EXPECT_EQ(FileUtil::GetContents(GetUserDictionaryFile()).value(), *snapshot);
+
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  ASSERT_OK(storage2.Load());
+  EXPECT_PROTO_EQ(storage1.GetProto(), storage2.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, SavedByAnotherStorageTest) {
+  uint64_t id = 0;
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.UnLock());
+
+  {
+    UserDictionaryStorage storage2(GetUserDictionaryFile());
+    ASSERT_OK(storage2.Load());
+    AddJournaledEntry("storage2", id, &storage2);
+    ASSERT_TRUE(storage2.Lock());
+    ASSERT_OK(storage2.Save());
+    EXPECT_TRUE(storage2.UnLock());
+  }
+
+  // The journal has been updated by storage2, so storage1 overwrites the
+  // whole storage instead of appending its change to the journal.
+  AddJournaledEntry("storage1", id, &storage1);
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.UnLock());
+
+  UserDictionaryStorage storage3(GetUserDictionaryFile());
+  ASSERT_OK(storage3.Load());
+  EXPECT_PROTO_EQ(storage1.GetProto(), storage3.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, BrokenJournalTest) {
+  uint64_t id = 0;
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  AddJournaledEntry("key", id, &storage1);
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.UnLock());
+
+  // Emulates a crash while appending to the journal.
+  absl::StatusOr<std::string> journal = FileUtil::GetContents(GetJournalFile());
+  ASSERT_OK(journal);
+  ASSERT_OK(FileUtil::SetContents(GetJournalFile(), *journal + "broken"));
+
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  ASSERT_OK(storage2.Load());
+  EXPECT_PROTO_EQ(storage1.GetProto(), storage2.GetProto());
+
+  // The broken journal is not appended any more.
+  AddJournaledEntry("key2", id, &storage2);
+  ASSERT_TRUE(storage2.Lock());
+  ASSERT_OK(storage2.Save());
+  EXPECT_TRUE(storage2.UnLock());
+
+  UserDictionaryStorage storage3(GetUserDictionaryFile());
+  ASSERT_OK(storage3.Load());
+  EXPECT_PROTO_EQ(storage2.GetProto(), storage3.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, UntrackedChangeTest) {
+  uint64_t id = 0;
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  const absl::StatusOr<std::string> snapshot =
+      FileUtil::GetContents(GetUserDictionaryFile());
+  ASSERT_OK(snapshot);
+
+  // The change made through GetUserDictionary() is not recorded, so the whole
+  // storage is written.
+  AddEntry("key", storage1.GetUserDictionary(id));
+  ASSERT_OK(storage1.Save());
+  EXPECT_NE(FileUtil::GetContents(GetUserDictionaryFile()).value(), *snapshot);
+  EXPECT_TRUE(storage1.UnLock());
+
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  ASSERT_OK(storage2.Load());
+  EXPECT_PROTO_EQ(storage1.GetProto(), storage2.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, MismatchedJournalTest) {
+  uint64_t id = 0;
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  // Reads through the const overload, which doesn't drop the recorded changes.
+  const user_dictionary::UserDictionaryStorage snapshot =
+      std::as_const(storage1).GetProto();
+  AddJournaledEntry("key", id, &storage1);
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.UnLock());
+
+  // Appends a record which deletes an unknown dictionary.
+  UserDictionaryJournalRecord record;
+  UserDictionaryJournal::AddDeleteDictionaryOperation(id + 1, &record);
+  std::string journal = FileUtil::GetContents(GetJournalFile()).value();
+  UserDictionaryJournal::AppendFrame(record, &journal);
+  ASSERT_OK(FileUtil::SetContents(GetJournalFile(), journal));
+
+  // The partially applied journal is discarded.
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  EXPECT_FALSE(storage2.Load().ok());
+  EXPECT_EQ(storage2.GetLastError(), UserDictionaryStorage::BROKEN_FILE);
+  EXPECT_PROTO_EQ(snapshot, storage2.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, CompactionTest) {
+  uint64_t id = 0;
+  user_dictionary::UserDictionaryStorage expected;
+  {
+    UserDictionaryStorage storage1(GetUserDictionaryFile());
+    EXPECT_FALSE(storage1.Load().ok());
+    ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+    ASSERT_TRUE(storage1.Lock());
+    ASSERT_OK(storage1.Save());
+
+    // Each save appends about 40KB to the journal, and the journal is
+    // compacted in the background when it exceeds 256KB.
+    for (int i = 0; i < 30; ++i) {
+      for (int j = 0; j < 1000; ++j) {
+        AddJournaledEntry(absl::StrFormat("key%d_%d", i, j), id, &storage1);
+      }
+      ASSERT_OK(storage1.Save());
+    }
+    expected = storage1.GetProto();
+    // The destructor waits for the compaction, and then unlocks the storage.
+  }
+
+  const absl::StatusOr<std::string> snapshot =
+      FileUtil::GetContents(GetUserDictionaryFile());
+  ASSERT_OK(snapshot);
+  EXPECT_GT(snapshot->size(), 256 << 10);
+
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  ASSERT_OK(storage2.Load());
+  ExpectSameDictionaries(expected, storage2.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, UnLockWhileCompactingTest) {
+  uint64_t id = 0;
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 1000; ++j) {
+      AddJournaledEntry(absl::StrFormat("key%d_%d", i, j), id, &storage1);
+    }
+    ASSERT_OK(storage1.Save());
+  }
+  EXPECT_TRUE(storage1.UnLock());
+
+  // The lock is released even while compacting.
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  ASSERT_TRUE(storage2.Lock());
+  EXPECT_TRUE(storage2.UnLock());
+
+  UserDictionaryStorage storage3(GetUserDictionaryFile());
+  ASSERT_OK(storage3.Load());
+  ExpectSameDictionaries(storage1.GetProto(), storage3.GetProto());
+}
+
+TEST_F(UserDictionaryStorageTest, InterruptedCompactionTest) {
+  uint64_t id = 0;
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  EXPECT_FALSE(storage1.Load().ok());
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  AddJournaledEntry("key1", id, &storage1);
+  ASSERT_OK(storage1.Save());
+
+  // Emulates the compaction which stopped after replacing the snapshot. The
+  // new snapshot includes the journal so far.
+  const std::string journal = FileUtil::GetContents(GetJournalFile()).value();
+  user_dictionary::UserDictionaryStorage compacted =
+      std::as_const(storage1).GetProto();
+  compacted.set_base_snapshot_id(compacted.snapshot_id());
+  compacted.set_base_journal_size(journal.size());
+  compacted.set_snapshot_id(compacted.snapshot_id() + 1);
+  ASSERT_OK(FileUtil::SetContents(GetUserDictionaryFile(),
+                                  compacted.SerializeAsString()));
+
+  // The record appended to the old journal is replayed on the new snapshot.
+  AddJournaledEntry("key2", id, &storage1);
+  ASSERT_OK(storage1.Save());
+  EXPECT_TRUE(storage1.UnLock());
+  EXPECT_EQ(FileUtil::GetContents(GetUserDictionaryFile()).value(),
+            compacted.SerializeAsString());
+
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  ASSERT_OK(storage2.Load());
+  ExpectSameDictionaries(storage1.GetProto(), storage2.GetProto());
+  EXPECT_EQ(storage2.GetProto().dictionaries(0).entries_size(), 2);
+}
+
 }  // namespace mozc
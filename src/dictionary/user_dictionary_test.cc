@@ -30,6 +30,7 @@
 #include "dictionary/user_dictionary.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
@@ -45,6 +46,7 @@
 #include "base/port.h"
 #include "base/random.h"
 #include "base/singleton.h"
+#include "base/thread2.h"
 #include "config/config_handler.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_test_util.h"
@@ -904,6 +906,37 @@ TEST_F(UserDictionaryTest, LookupComment) {
   EXPECT_TRUE(LookupComment(*dic, "mismatching_key", "comment_value4").empty());
 }
 
+TEST_F(UserDictionaryTest, LookupWhileLoading) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage0("");
+  LoadFromString(kUserDictionary0, &storage0);
+  UserDictionaryStorage storage1("");
+  LoadFromString(kUserDictionary1, &storage1);
+  dic->Load(storage0.GetProto());
+
+  // Lookups see either of the dictionaries as a whole while the other thread
+  // swaps them.
+  std::atomic<bool> done = false;
+  Thread2 loader([&] {
+    for (int i = 0; i < 100; ++i) {
+      dic->Load((i % 2 == 0 ? storage1 : storage0).GetProto());
+    }
+    done = true;
+  });
+  while (!done) {
+    CollectTokenCallback callback;
+    dic->LookupExact("start", convreq_, &callback);
+    const size_t size = callback.tokens().size();
+    EXPECT_TRUE(size == 0 || size == 1) << size;
+    const std::string comment =
+        LookupComment(*dic, "comment_key2", "comment_value2");
+    EXPECT_TRUE(comment.empty() || comment == "comment") << comment;
+  }
+  loader.Join();
+}
+
 TEST_F(UserDictionaryTest, TestPopulateTokenFromUserPosToken) {
   std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
   dic->WaitForReloader();
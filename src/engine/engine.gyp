@@ -117,6 +117,19 @@
       'conditions': [
       ],
     },
+    {
+      'target_name': 'serialized_engine',
+      'type': 'static_library',
+      'sources': [
+        'serialized_engine.cc',
+      ],
+      'dependencies': [
+        '../base/absl.gyp:absl_strings',
+        '../base/absl.gyp:absl_synchronization',
+        '../converter/converter_base.gyp:segments',
+        '../request/request.gyp:conversion_request',
+      ],
+    },
     {
       'target_name': 'minimal_engine',
       'type': 'static_library',
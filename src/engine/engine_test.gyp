@@ -57,12 +57,22 @@
         }
       ],
     },
+    {
+      'target_name': 'serialized_engine_test',
+      'type': 'executable',
+      'sources': ['serialized_engine_test.cc'],
+      'dependencies': [
+        'engine.gyp:serialized_engine',
+        '../testing/testing.gyp:gtest_main',
+      ],
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'engine_all_test',
       'type': 'none',
       'dependencies': [
         'engine_builder_test',
+        'serialized_engine_test',
       ],
     },
   ],
@@ -0,0 +1,272 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/serialized_engine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "data_manager/data_manager_interface.h"
+#include "dictionary/suppression_dictionary.h"
+#include "engine/engine_interface.h"
+#include "engine/user_data_manager_interface.h"
+#include "prediction/predictor_interface.h"
+#include "request/conversion_request.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace {
+
+class SerializedConverter : public ConverterInterface {
+ public:
+  SerializedConverter(const ConverterInterface *converter, absl::Mutex *mutex)
+      : converter_(converter), mutex_(mutex) {}
+
+  bool StartConversionForRequest(const ConversionRequest &request,
+                                 Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartConversionForRequest(request, segments);
+  }
+  bool StartConversion(Segments *segments,
+                       absl::string_view key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartConversion(segments, key);
+  }
+  bool StartReverseConversion(Segments *segments,
+                              absl::string_view key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartReverseConversion(segments, key);
+  }
+  bool StartPredictionForRequest(const ConversionRequest &request,
+                                 Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartPredictionForRequest(request, segments);
+  }
+  bool StartPrediction(Segments *segments,
+                       absl::string_view key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartPrediction(segments, key);
+  }
+  bool StartSuggestionForRequest(const ConversionRequest &request,
+                                 Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartSuggestionForRequest(request, segments);
+  }
+  bool StartSuggestion(Segments *segments,
+                       absl::string_view key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartSuggestion(segments, key);
+  }
+  bool StartPartialPredictionForRequest(const ConversionRequest &request,
+                                        Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartPartialPredictionForRequest(request, segments);
+  }
+  bool StartPartialPrediction(Segments *segments,
+                              absl::string_view key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartPartialPrediction(segments, key);
+  }
+  bool StartPartialSuggestionForRequest(const ConversionRequest &request,
+                                        Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartPartialSuggestionForRequest(request, segments);
+  }
+  bool StartPartialSuggestion(Segments *segments,
+                              absl::string_view key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->StartPartialSuggestion(segments, key);
+  }
+  void FinishConversion(const ConversionRequest &request,
+                        Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    converter_->FinishConversion(request, segments);
+  }
+  void CancelConversion(Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    converter_->CancelConversion(segments);
+  }
+  void ResetConversion(Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    converter_->ResetConversion(segments);
+  }
+  void RevertConversion(Segments *segments) const override {
+    absl::MutexLock l(mutex_);
+    converter_->RevertConversion(segments);
+  }
+  bool ReconstructHistory(Segments *segments,
+                          absl::string_view preceding_text) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->ReconstructHistory(segments, preceding_text);
+  }
+  bool CommitSegmentValue(Segments *segments, size_t segment_index,
+                          int candidate_index) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->CommitSegmentValue(segments, segment_index,
+                                          candidate_index);
+  }
+  bool CommitPartialSuggestionSegmentValue(
+      Segments *segments, size_t segment_index, int candidate_index,
+      absl::string_view current_segment_key,
+      absl::string_view new_segment_key) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->CommitPartialSuggestionSegmentValue(
+        segments, segment_index, candidate_index, current_segment_key,
+        new_segment_key);
+  }
+  bool FocusSegmentValue(Segments *segments, size_t segment_index,
+                         int candidate_index) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->FocusSegmentValue(segments, segment_index,
+                                         candidate_index);
+  }
+  bool CommitSegments(
+      Segments *segments,
+      const std::vector<size_t> &candidate_index) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->CommitSegments(segments, candidate_index);
+  }
+  bool ResizeSegment(Segments *segments, const ConversionRequest &request,
+                     size_t segment_index, int offset_length) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->ResizeSegment(segments, request, segment_index,
+                                     offset_length);
+  }
+  bool ResizeSegment(
+      Segments *segments, const ConversionRequest &request,
+      size_t start_segment_index, size_t segments_size,
+      absl::Span<const uint8_t> new_size_array) const override {
+    absl::MutexLock l(mutex_);
+    return converter_->ResizeSegment(segments, request, start_segment_index,
+                                     segments_size, new_size_array);
+  }
+
+ private:
+  const ConverterInterface *converter_;
+  absl::Mutex *mutex_;
+};
+
+class SerializedUserDataManager : public UserDataManagerInterface {
+ public:
+  SerializedUserDataManager(UserDataManagerInterface *manager,
+                            absl::Mutex *mutex)
+      : manager_(manager), mutex_(mutex) {}
+
+  bool Sync() override {
+    absl::MutexLock l(mutex_);
+    return manager_->Sync();
+  }
+  bool Reload() override {
+    absl::MutexLock l(mutex_);
+    return manager_->Reload();
+  }
+  bool ClearUserHistory() override {
+    absl::MutexLock l(mutex_);
+    return manager_->ClearUserHistory();
+  }
+  bool ClearUserPrediction() override {
+    absl::MutexLock l(mutex_);
+    return manager_->ClearUserPrediction();
+  }
+  bool ClearUnusedUserPrediction() override {
+    absl::MutexLock l(mutex_);
+    return manager_->ClearUnusedUserPrediction();
+  }
+  bool ClearUserPredictionEntry(absl::string_view key,
+                                absl::string_view value) override {
+    absl::MutexLock l(mutex_);
+    return manager_->ClearUserPredictionEntry(key, value);
+  }
+  // Waits for the syncer thread without the lock, as it doesn't touch the
+  // state used by the converter.
+  bool Wait() override { return manager_->Wait(); }
+
+ private:
+  UserDataManagerInterface *manager_;
+  absl::Mutex *mutex_;
+};
+
+}  // namespace
+
+SerializedEngine::SerializedEngine(EngineInterface *engine) : engine_(engine) {
+  if (const ConverterInterface *converter = engine_->GetConverter();
+      converter != nullptr) {
+    converter_ = std::make_unique<SerializedConverter>(converter, &mutex_);
+  }
+  if (UserDataManagerInterface *manager = engine_->GetUserDataManager();
+      manager != nullptr) {
+    user_data_manager_ =
+        std::make_unique<SerializedUserDataManager>(manager, &mutex_);
+  }
+}
+
+SerializedEngine::~SerializedEngine() = default;
+
+ConverterInterface *SerializedEngine::GetConverter() const {
+  return converter_.get();
+}
+
+PredictorInterface *SerializedEngine::GetPredictor() const {
+  return engine_->GetPredictor();
+}
+
+dictionary::SuppressionDictionary *
+SerializedEngine::GetSuppressionDictionary() {
+  return engine_->GetSuppressionDictionary();
+}
+
+bool SerializedEngine::Reload() {
+  absl::MutexLock l(&mutex_);
+  return engine_->Reload();
+}
+
+UserDataManagerInterface *SerializedEngine::GetUserDataManager() {
+  return user_data_manager_.get();
+}
+
+absl::string_view SerializedEngine::GetDataVersion() const {
+  return engine_->GetDataVersion();
+}
+
+const DataManagerInterface *SerializedEngine::GetDataManager() const {
+  return engine_->GetDataManager();
+}
+
+std::vector<std::string> SerializedEngine::GetPosList() const {
+  return engine_->GetPosList();
+}
+
+}  // namespace mozc
@@ -0,0 +1,133 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/serialized_engine.h"
+
+#include <atomic>
+#include <vector>
+
+#include "base/thread2.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "engine/engine_mock.h"
+#include "engine/engine_stub.h"
+#include "engine/user_data_manager_mock.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::_;
+using ::testing::InvokeWithoutArgs;
+using ::testing::Return;
+
+TEST(SerializedEngineTest, ForwardsCalls) {
+  MockConverter converter;
+  MockUserDataManager user_data_manager;
+  MockEngine engine;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+  EXPECT_CALL(engine, GetUserDataManager())
+      .WillRepeatedly(Return(&user_data_manager));
+  EXPECT_CALL(engine, GetDataVersion()).WillOnce(Return("1.2.3"));
+  SerializedEngine serialized_engine(&engine);
+
+  Segments segments;
+  EXPECT_CALL(converter, StartConversion(&segments, absl::string_view("key")))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(serialized_engine.GetConverter()->StartConversion(&segments,
+                                                                "key"));
+
+  EXPECT_CALL(user_data_manager, Sync()).WillOnce(Return(true));
+  EXPECT_TRUE(serialized_engine.GetUserDataManager()->Sync());
+
+  EXPECT_EQ(serialized_engine.GetDataVersion(), "1.2.3");
+}
+
+TEST(SerializedEngineTest, NoConverter) {
+  EngineStub engine;
+  SerializedEngine serialized_engine(&engine);
+  EXPECT_EQ(serialized_engine.GetConverter(), nullptr);
+  EXPECT_EQ(serialized_engine.GetUserDataManager(), nullptr);
+}
+
+TEST(SerializedEngineTest, SerializesCalls) {
+  MockConverter converter;
+  MockUserDataManager user_data_manager;
+  MockEngine engine;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+  EXPECT_CALL(engine, GetUserDataManager())
+      .WillRepeatedly(Return(&user_data_manager));
+  SerializedEngine serialized_engine(&engine);
+
+  std::atomic<int> running = 0;
+  std::atomic<int> max_running = 0;
+  auto enter = [&] {
+    const int current = running.fetch_add(1) + 1;
+    int max = max_running.load();
+    while (current > max && !max_running.compare_exchange_weak(max, current)) {
+    }
+    absl::SleepFor(absl::Milliseconds(1));
+    running.fetch_sub(1);
+    return true;
+  };
+  EXPECT_CALL(converter, StartSuggestion(_, _))
+      .WillRepeatedly(InvokeWithoutArgs(enter));
+  EXPECT_CALL(user_data_manager, ClearUserPredictionEntry(_, _))
+      .WillRepeatedly(InvokeWithoutArgs(enter));
+
+  constexpr int kNumThreads = 4;
+  constexpr int kNumCalls = 20;
+  std::vector<Thread2> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&serialized_engine, i] {
+      for (int j = 0; j < kNumCalls; ++j) {
+        if (i % 2 == 0) {
+          Segments segments;
+          EXPECT_TRUE(serialized_engine.GetConverter()->StartSuggestion(
+              &segments, "key"));
+        } else {
+          EXPECT_TRUE(
+              serialized_engine.GetUserDataManager()->ClearUserPredictionEntry(
+                  "key", "value"));
+        }
+      }
+    });
+  }
+  for (Thread2 &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_EQ(max_running.load(), 1);
+}
+
+}  // namespace
+}  // namespace mozc
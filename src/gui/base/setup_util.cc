@@ -128,9 +128,9 @@ bool SetupUtil::MigrateDictionaryFromMSIME() {
   }
 
   UserDictionaryStorage::UserDictionary *dic =
-      storage_->GetUserDictionary(dic_id);
+      storage_->GetJournaledUserDictionary(dic_id);
   if (dic == nullptr) {
-    LOG(ERROR) << "GetUserDictionary returned nullptr";
+    LOG(ERROR) << "GetJournaledUserDictionary returned nullptr";
     return false;
   }
 
@@ -141,8 +141,11 @@ bool SetupUtil::MigrateDictionaryFromMSIME() {
     return false;
   }
 
-  if (UserDictionaryImporter::ImportFromIterator(iter.get(), dic) !=
-      UserDictionaryImporter::IMPORT_NO_ERROR) {
+  const int old_size = dic->entries_size();
+  const UserDictionaryImporter::ErrorType error =
+      UserDictionaryImporter::ImportFromIterator(iter.get(), dic);
+  storage_->RecordEntriesUpdated(dic_id, old_size, dic->entries_size());
+  if (error != UserDictionaryImporter::IMPORT_NO_ERROR) {
     LOG(ERROR) << "ImportFromMSIME failed";
     return false;
   }
@@ -619,8 +619,9 @@ void DictionaryTool::OnDictionarySelectionChanged() {
 }
 
 void DictionaryTool::SetupDicContentEditor(const DictionaryInfo &dic_info) {
-  UserDictionary *dic =
-      session_->mutable_storage()->GetUserDictionary(dic_info.id);
+  const UserDictionary *dic =
+      UserDictionaryUtil::GetUserDictionaryById(session_->storage(),
+                                                dic_info.id);
 
   if (dic == nullptr) {
     LOG(ERROR) << "Failed to load the dictionary: " << dic_info.id;
@@ -863,7 +864,8 @@ void DictionaryTool::ImportHelper(
     return;
   }
 
-  UserDictionary *dic = session_->mutable_storage()->GetUserDictionary(dic_id);
+  UserDictionary *dic =
+      session_->mutable_storage()->GetJournaledUserDictionary(dic_id);
 
   if (dic == nullptr) {
     LOG(ERROR) << "Cannot find dictionary id: " << dic_id;
@@ -892,6 +894,8 @@ void DictionaryTool::ImportHelper(
   const UserDictionaryImporter::ErrorType error =
       UserDictionaryImporter::ImportFromTextLineIterator(ime_type, iter.get(),
                                                          dic);
+  session_->mutable_storage()->RecordEntriesUpdated(dic_id, old_size,
+                                                    dic->entries_size());
 
   const int added_entries_size = dic->entries_size() - old_size;
 
@@ -944,7 +948,7 @@ void DictionaryTool::ImportFromDefaultIME() {
   SyncToStorage();
 
   UserDictionary *dic =
-      session_->mutable_storage()->GetUserDictionary(dic_info.id);
+      session_->mutable_storage()->GetJournaledUserDictionary(dic_info.id);
   DCHECK(dic);
 
   const int old_size = dic->entries_size();
@@ -959,6 +963,8 @@ void DictionaryTool::ImportFromDefaultIME() {
       error = UserDictionaryImporter::ImportFromIterator(iter.get(), dic);
     }
   }
+  session_->mutable_storage()->RecordEntriesUpdated(dic_info.id, old_size,
+                                                    dic->entries_size());
 
   const int added_entries_size = dic->entries_size() - old_size;
 
@@ -1141,7 +1147,7 @@ void DictionaryTool::MoveTo(int dictionary_row) {
       return;
     }
 
-    target_dict = session_->mutable_storage()->GetUserDictionary(
+    target_dict = session_->mutable_storage()->GetJournaledUserDictionary(
         target_dict_item->data(Qt::UserRole).toULongLong());
   }
 
@@ -1173,6 +1179,7 @@ void DictionaryTool::MoveTo(int dictionary_row) {
 
     int progress_index = 0;
     if (target_dict) {
+      const int old_size = target_dict->entries_size();
       for (size_t i = 0; i < rows.size(); ++i) {
         UserDictionary::Entry *entry = target_dict->add_entries();
         const int row = rows[i];
@@ -1185,6 +1192,8 @@ void DictionaryTool::MoveTo(int dictionary_row) {
         progress->setValue(progress_index);
         ++progress_index;
       }
+      session_->mutable_storage()->RecordEntriesUpdated(
+          target_dict->id(), old_size, target_dict->entries_size());
     }
     for (size_t i = 0; i < rows.size(); ++i) {
       dic_content_->removeRow(rows[i]);
@@ -1397,25 +1406,48 @@ void DictionaryTool::SyncToStorage() {
     return;
   }
 
-  UserDictionary *dic =
-      session_->mutable_storage()->GetUserDictionary(current_dic_id_);
+  mozc::UserDictionaryStorage *storage = session_->mutable_storage();
+  UserDictionary *dic = storage->GetJournaledUserDictionary(current_dic_id_);
 
   if (dic == nullptr) {
     LOG(ERROR) << "No save dictionary: " << current_dic_id_;
     return;
   }
 
-  dic->clear_entries();
-
-  for (int i = 0; i < dic_content_->rowCount(); ++i) {
-    UserDictionary::Entry *entry = dic->add_entries();
-    entry->set_key(dic_content_->item(i, 0)->text().toStdString());
-    entry->set_value(dic_content_->item(i, 1)->text().toStdString());
-    entry->set_pos(UserDictionaryUtil::ToPosType(
+  // Records the entries from the first changed row as updated or appended,
+  // and the old entries beyond the rows as deleted.
+  const int old_size = dic->entries_size();
+  const int new_size = dic_content_->rowCount();
+  int first_changed = new_size;
+  for (int i = 0; i < new_size; ++i) {
+    UserDictionary::Entry entry;
+    entry.set_key(dic_content_->item(i, 0)->text().toStdString());
+    entry.set_value(dic_content_->item(i, 1)->text().toStdString());
+    entry.set_pos(UserDictionaryUtil::ToPosType(
         dic_content_->item(i, 2)->text().toStdString().c_str()));
-    entry->set_comment(dic_content_->item(i, 3)->text().toStdString());
-    UserDictionaryUtil::SanitizeEntry(entry);
+    entry.set_comment(dic_content_->item(i, 3)->text().toStdString());
+    UserDictionaryUtil::SanitizeEntry(&entry);
+    if (i < old_size) {
+      if (first_changed == new_size &&
+          entry.SerializeAsString() == dic->entries(i).SerializeAsString()) {
+        continue;
+      }
+      *dic->mutable_entries(i) = std::move(entry);
+    } else {
+      *dic->add_entries() = std::move(entry);
+    }
+    first_changed = std::min(first_changed, i);
+  }
+
+  std::vector<int> deleted_indices;
+  for (int i = old_size - 1; i >= new_size; --i) {
+    deleted_indices.push_back(i);
+  }
+  if (!deleted_indices.empty()) {
+    dic->mutable_entries()->DeleteSubrange(new_size, old_size - new_size);
+    storage->RecordEntriesDeleted(current_dic_id_, deleted_indices);
   }
+  storage->RecordEntriesUpdated(current_dic_id_, first_changed, new_size);
 
   modified_ = false;
 }
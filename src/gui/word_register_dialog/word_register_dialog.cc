@@ -305,8 +305,9 @@ WordRegisterDialog::ErrorCode WordRegisterDialog::SaveEntry() {
     return FATAL_ERROR;
   }
 
-  UserDictionary *dic =
-      session_->mutable_storage()->GetProto().mutable_dictionaries(index);
+  UserDictionary *dic = session_->mutable_storage()
+                            ->GetJournaledProto()
+                            .mutable_dictionaries(index);
   CHECK(dic);
 
   if (dic->name() != DictionarycomboBox->currentText().toStdString().c_str()) {
@@ -319,6 +320,8 @@ WordRegisterDialog::ErrorCode WordRegisterDialog::SaveEntry() {
   entry->set_key(key);
   entry->set_value(value);
   entry->set_pos(pos);
+  session_->mutable_storage()->RecordEntriesUpdated(
+      dic->id(), dic->entries_size() - 1, dic->entries_size());
 
   if (absl::Status s = session_->mutable_storage()->Save();
       !s.ok() && session_->mutable_storage()->GetLastError() ==
@@ -79,6 +79,17 @@ void IPCServer::LoopAndReturn() {
   }
 }
 
+uint64_t IPCServer::ParseRequest(absl::string_view request,
+                                 std::unique_ptr<ParsedRequest> *parsed) const {
+  return 0;
+}
+
+bool IPCServer::ProcessParsedRequest(absl::string_view request,
+                                     ParsedRequest *parsed,
+                                     std::string *response) {
+  return Process(request, response);
+}
+
 void IPCServer::Wait() {
   if (server_thread_ != nullptr) {
     server_thread_->Join();
@@ -51,6 +51,7 @@
         '../base/absl.gyp:absl_time',
         '../base/base.gyp:base',
         '../base/base.gyp:version',
+        '../usage_stats/usage_stats_base.gyp:latency_stats',
         'ipc_protocol',
       ],
       'conditions': [
@@ -33,6 +33,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -56,8 +57,20 @@ enum {
 };
 
 // increment this value if protocol has changed.
+// Only the Linux transport accepts persistent connections, so the other
+// platforms keep the previous version and don't restart their servers.
 enum {
+#if defined(__linux__) && !defined(__ANDROID__)
+  IPC_PROTOCOL_VERSION = 4,
+#else   // __linux__ && !__ANDROID__
   IPC_PROTOCOL_VERSION = 3,
+#endif  // __linux__ && !__ANDROID__
+};
+
+// The minimum protocol version of the server which accepts persistent
+// connections. See IPCClientInterface::EnablePersistentConnection().
+enum {
+  IPC_PERSISTENT_CONNECTION_PROTOCOL_VERSION = 4,
 };
 
 enum IPCErrorType {
@@ -86,6 +99,28 @@ class IPCClientInterface {
 
   // return last error
   virtual IPCErrorType GetLastIPCError() const = 0;
+
+  // Asks the server to keep the connection open. On success, messages are
+  // exchanged with length-prefixed frames, Call() can be called more than
+  // once and CallPipelined() can send several requests at once. Returns false
+  // if the server or the platform doesn't support it; the connection is still
+  // usable for one Call() in that case.
+  virtual bool EnablePersistentConnection(absl::Duration timeout) {
+    return false;
+  }
+
+  // Sends all the |requests| before reading their responses, which are stored
+  // in |responses| in the same order. Requires the persistent connection
+  // unless |requests| has at most one request.
+  virtual bool CallPipelined(const std::vector<std::string> &requests,
+                             std::vector<std::string> *responses,
+                             absl::Duration timeout) {
+    if (requests.size() > 1) {
+      return false;
+    }
+    responses->resize(requests.size());
+    return requests.empty() || Call(requests[0], &(*responses)[0], timeout);
+  }
 };
 
 #ifdef __APPLE__
@@ -144,10 +179,19 @@ class IPCClient : public IPCClientInterface {
   // When Server doesn't send response within timeout, 'Call' returns false.
   // When timeout (in msec) is set -1, 'Call' waits forever.
   // Note that on Linux and Windows, Call() closes the socket_. This means you
-  // cannot call the Call() function more than once.
+  // cannot call the Call() function more than once, unless the persistent
+  // connection is enabled on Linux.
   bool Call(const std::string &request, std::string *response,
             absl::Duration timeout) override;
 
+#if defined(__linux__) && !defined(__ANDROID__)
+  bool EnablePersistentConnection(absl::Duration timeout) override;
+
+  bool CallPipelined(const std::vector<std::string> &requests,
+                     std::vector<std::string> *responses,
+                     absl::Duration timeout) override;
+#endif  // __linux__ && !__ANDROID__
+
   IPCErrorType GetLastIPCError() const override { return last_ipc_error_; }
 
   // terminate the server process named |name|
@@ -172,6 +216,8 @@ class IPCClient : public IPCClientInterface {
   MachPortManagerInterface *mach_port_manager_;
 #else   // _WIN32
   int socket_;
+  // True if the connection is persistent and framed.
+  bool persistent_ = false;
 #endif  // _WIN32
   bool connected_;
   IPCPathManager *ipc_path_manager_;
@@ -237,8 +283,50 @@ class IPCServer {
 
   // Implement a server algorithm in subclass.
   // If 'Process' return false, server finishes select loop
+  // When the server runs with worker threads (see SetNumWorkers()),
+  // 'Process' can be called from several threads at the same time for the
+  // requests with different serialization keys.
   virtual bool Process(absl::string_view request, std::string *response) = 0;
 
+  // A request decoded by ParseRequest(). A subclass derives from it to keep
+  // the decoded request for ProcessParsedRequest().
+  class ParsedRequest {
+   public:
+    virtual ~ParsedRequest() = default;
+  };
+
+  // Decodes |request| before it is handed to a worker thread, and returns the
+  // key to order the requests with. Requests with the same key are processed
+  // one by one in the arrival order, and requests with different keys may be
+  // processed in parallel by the worker threads. The decoded request stored in
+  // |parsed| is passed to ProcessParsedRequest() so that a request is decoded
+  // only once. The default implementation returns the same key for all the
+  // requests and leaves |parsed| empty.
+  virtual uint64_t ParseRequest(absl::string_view request,
+                                std::unique_ptr<ParsedRequest> *parsed) const;
+
+  // Processes the request decoded by ParseRequest() in a worker thread.
+  // |parsed| is nullptr if ParseRequest() didn't store it. The default
+  // implementation calls Process().
+  virtual bool ProcessParsedRequest(absl::string_view request,
+                                    ParsedRequest *parsed,
+                                    std::string *response);
+
+  // Sets the number of worker threads which call 'Process'. When it is
+  // positive, Loop() multiplexes the connections in one thread and hands the
+  // received requests to the workers. 0 (default) runs the single-thread loop.
+  // Persistent connections are kept open only with the workers; the
+  // single-thread loop declines them and serves one request per connection.
+  // Must be called before Loop(). Currently only Linux supports the workers;
+  // the other platforms always run the single-thread loop.
+  void SetNumWorkers(int num_workers) { num_workers_ = num_workers; }
+
+  // Sets how long a persistent connection can stay idle before the server
+  // closes it. The client reconnects on the next call.
+  void SetIdleTimeout(absl::Duration idle_timeout) {
+    idle_timeout_ = idle_timeout;
+  }
+
   // Start select loop. It goes into infinite loop.
   void Loop();
 
@@ -275,11 +363,18 @@ class IPCServer {
   std::string name_;
   MachPortManagerInterface *mach_port_manager_;
 #else   // _WIN32
+  // Runs Loop() with |num_workers_| worker threads.
+  void LoopWithWorkers();
+
   int socket_;
   std::string server_address_;
+  // eventfd to wake up LoopWithWorkers() for termination.
+  int wakeup_fd_;
 #endif  // _WIN32
 
   absl::Duration timeout_;
+  int num_workers_ = 0;
+  absl::Duration idle_timeout_ = absl::Minutes(5);
 };
 
 }  // namespace mozc
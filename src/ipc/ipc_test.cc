@@ -30,7 +30,9 @@
 #include "ipc/ipc.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/random.h"
@@ -38,10 +40,13 @@
 #include "base/thread2.h"
 #include "testing/googletest.h"
 #include "testing/gunit.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
 #include "absl/random/distributions.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 
@@ -135,3 +140,224 @@ TEST(IPCTest, IPCTest) {
 
   con.Wait();
 }
+
+#if defined(__linux__) && !defined(__ANDROID__)
+namespace {
+
+// Echo server which records whether requests of the same key are processed
+// at the same time.
+class SerializingEchoServer : public EchoServer {
+ public:
+  using EchoServer::EchoServer;
+
+  uint64_t ParseRequest(absl::string_view request,
+                        std::unique_ptr<ParsedRequest> *parsed) const override {
+    auto parsed_key = std::make_unique<ParsedKey>();
+    parsed_key->key = request.empty() ? 0 : request[0];
+    const uint64_t key = parsed_key->key;
+    *parsed = std::move(parsed_key);
+    return key;
+  }
+
+  bool ProcessParsedRequest(absl::string_view input, ParsedRequest *parsed,
+                            std::string *output) override {
+    // ParseRequest() always stores the key.
+    EXPECT_NE(parsed, nullptr);
+    const uint64_t key = static_cast<ParsedKey *>(parsed)->key;
+    {
+      absl::MutexLock l(&mutex_);
+      if (++running_[key] > 1) {
+        overlapped_ = true;
+      }
+    }
+    absl::SleepFor(absl::Microseconds(100));
+    {
+      absl::MutexLock l(&mutex_);
+      --running_[key];
+    }
+    return Process(input, output);
+  }
+
+  bool overlapped() const {
+    absl::MutexLock l(&mutex_);
+    return overlapped_;
+  }
+
+ private:
+  struct ParsedKey : public ParsedRequest {
+    uint64_t key = 0;
+  };
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<uint64_t, int> running_ ABSL_GUARDED_BY(mutex_);
+  bool overlapped_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace
+
+TEST(IPCTest, Workers) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+
+  SerializingEchoServer con(kServerAddress, 10, absl::Milliseconds(1000));
+  con.SetNumWorkers(4);
+  con.LoopAndReturn();
+
+  std::vector<mozc::Thread2> cons;
+  for (int i = 0; i < kNumThreads; ++i) {
+    // Two clients share each key.
+    const char key = 'a' + i / 2;
+    cons.push_back(mozc::Thread2([key] {
+      mozc::Random random;
+      for (int i = 0; i < kNumRequests / 10; ++i) {
+        mozc::IPCClient con(kServerAddress, "");
+        ASSERT_TRUE(con.Connected());
+        const int size = absl::Uniform(random, 1, 8000);
+        const std::string input = absl::StrCat(
+            absl::string_view(&key, 1), "test", random.ByteString(size));
+        std::string output;
+        ASSERT_TRUE(con.Call(input, &output, absl::Milliseconds(1000)));
+        EXPECT_EQ(output, input);
+      }
+    }));
+  }
+
+  for (mozc::Thread2 &con : cons) {
+    con.Join();
+  }
+  EXPECT_FALSE(con.overlapped());
+
+  mozc::IPCClient kill(kServerAddress, "");
+  std::string output;
+  kill.Call("kill", &output, absl::Milliseconds(1000));
+  con.Wait();
+}
+
+TEST(IPCTest, PersistentConnection) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+
+  SerializingEchoServer con(kServerAddress, 10, absl::Milliseconds(1000));
+  con.SetNumWorkers(4);
+  con.LoopAndReturn();
+
+  std::vector<mozc::Thread2> cons;
+  for (int i = 0; i < kNumThreads; ++i) {
+    const char key = 'a' + i / 2;
+    cons.push_back(mozc::Thread2([key] {
+      mozc::Random random;
+      mozc::IPCClient con(kServerAddress, "");
+      ASSERT_TRUE(con.Connected());
+      ASSERT_TRUE(con.EnablePersistentConnection(absl::Milliseconds(1000)));
+      for (int i = 0; i < kNumRequests / 10; ++i) {
+        const int size = absl::Uniform(random, 1, 8000);
+        const std::string input = absl::StrCat(
+            absl::string_view(&key, 1), "test", random.ByteString(size));
+        std::string output;
+        ASSERT_TRUE(con.Call(input, &output, absl::Milliseconds(1000)));
+        EXPECT_EQ(output, input);
+      }
+
+      // Requests with different keys are responded in the order of requests.
+      std::vector<std::string> inputs;
+      for (int i = 0; i < 10; ++i) {
+        inputs.push_back(absl::StrCat(absl::string_view(&"xyz"[i % 3], 1),
+                                      "test", random.ByteString(i * 100)));
+      }
+      std::vector<std::string> outputs;
+      ASSERT_TRUE(
+          con.CallPipelined(inputs, &outputs, absl::Milliseconds(1000)));
+      EXPECT_EQ(outputs, inputs);
+      EXPECT_TRUE(con.Connected());
+    }));
+  }
+
+  for (mozc::Thread2 &con : cons) {
+    con.Join();
+  }
+  EXPECT_FALSE(con.overlapped());
+
+  mozc::IPCClient kill(kServerAddress, "");
+  std::string output;
+  kill.Call("kill", &output, absl::Milliseconds(1000));
+  con.Wait();
+}
+
+TEST(IPCTest, PersistentConnectionLargeResponses) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+
+  EchoServer con(kServerAddress, 10, absl::Milliseconds(1000));
+  con.SetNumWorkers(2);
+  con.LoopAndReturn();
+
+  {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    ASSERT_TRUE(client.EnablePersistentConnection(absl::Milliseconds(1000)));
+    // The responses don't fit in the socket buffer while the client is still
+    // sending the requests, so the server has to wait for the socket to be
+    // writable.
+    mozc::Random random;
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 16; ++i) {
+      inputs.push_back(random.ByteString(256 * 1024));
+    }
+    std::vector<std::string> outputs;
+    ASSERT_TRUE(
+        client.CallPipelined(inputs, &outputs, absl::Milliseconds(5000)));
+    EXPECT_EQ(outputs, inputs);
+  }
+
+  mozc::IPCClient kill(kServerAddress, "");
+  std::string output;
+  kill.Call("kill", &output, absl::Milliseconds(1000));
+  con.Wait();
+}
+
+TEST(IPCTest, PersistentConnectionIdleTimeout) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+
+  EchoServer con(kServerAddress, 10, absl::Milliseconds(1000));
+  con.SetNumWorkers(2);
+  con.SetIdleTimeout(absl::Milliseconds(100));
+  con.LoopAndReturn();
+
+  {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    ASSERT_TRUE(client.EnablePersistentConnection(absl::Milliseconds(1000)));
+    std::string output;
+    ASSERT_TRUE(client.Call("test", &output, absl::Milliseconds(1000)));
+    EXPECT_EQ(output, "test");
+    EXPECT_TRUE(client.Connected());
+
+    absl::SleepFor(absl::Milliseconds(500));
+    EXPECT_FALSE(client.Connected());
+  }
+
+  mozc::IPCClient kill(kServerAddress, "");
+  std::string output;
+  kill.Call("kill", &output, absl::Milliseconds(1000));
+  con.Wait();
+}
+
+TEST(IPCTest, PersistentConnectionIsDeclinedWithoutWorkers) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+
+  EchoServer con(kServerAddress, 10, absl::Milliseconds(1000));
+  con.LoopAndReturn();
+
+  {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    EXPECT_FALSE(client.EnablePersistentConnection(absl::Milliseconds(1000)));
+    // The connection still serves one request.
+    std::string output;
+    ASSERT_TRUE(client.Call("test", &output, absl::Milliseconds(1000)));
+    EXPECT_EQ(output, "test");
+  }
+
+  mozc::IPCClient kill(kServerAddress, "");
+  std::string output;
+  kill.Call("kill", &output, absl::Milliseconds(1000));
+  con.Wait();
+}
+#endif  // __linux__ && !__ANDROID__
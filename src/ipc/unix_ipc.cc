@@ -31,28 +31,44 @@
 #if defined(__linux__)
 
 #include <fcntl.h>
+#include <poll.h>
 #include <stddef.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "base/clock.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/thread.h"
+#include "base/thread2.h"
 #include "ipc/ipc.h"
 #include "ipc/ipc_path_manager.h"
+#include "usage_stats/latency_stats.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 
 #ifndef UNIX_PATH_MAX
@@ -64,6 +80,20 @@ namespace {
 
 constexpr int kInvalidSocket = -1;
 
+// Returns the latency stage of a request on the server side, from the receipt
+// of the complete request to the response sent, including the time the
+// request waits for a worker.
+usage_stats::LatencyStats::StageId RequestStage() {
+  static const usage_stats::LatencyStats::StageId kRequestStage =
+      usage_stats::LatencyStats::RegisterStage("IPCServer.Request");
+  return kRequestStage;
+}
+
+void RecordRequestLatency(absl::Time received) {
+  usage_stats::LatencyStats::Record(RequestStage(),
+                                    Clock::GetAbslTime() - received);
+}
+
 absl::Status mkdir_p(const std::string &dirname) {
   const std::string parent_dir = FileUtil::Dirname(dirname);
   struct stat st;
@@ -75,47 +105,39 @@ absl::Status mkdir_p(const std::string &dirname) {
   return FileUtil::CreateDirectory(dirname);
 }
 
-bool IsReadTimeout(int socket, absl::Duration timeout) {
+// Returns true if |socket| doesn't get any of |events| in |timeout|. poll() is
+// used instead of select() as the server can have more than FD_SETSIZE
+// connections.
+bool IsPollTimeout(int socket, int16_t events, absl::Duration timeout) {
   if (timeout < absl::ZeroDuration()) {
     return false;
   }
-  fd_set fds;
-  struct timeval tv = absl::ToTimeval(timeout);
-  FD_ZERO(&fds);
-  FD_SET(socket, &fds);
-  if (select(socket + 1, &fds, nullptr, nullptr, &tv) < 0) {
+  pollfd fds = {};
+  fds.fd = socket;
+  fds.events = events;
+  const int result = ::poll(&fds, 1, absl::ToInt64Milliseconds(timeout));
+  if (result < 0) {
     // Mac OS X and glibc implementations of strerror() return a pointer to a
     // string literal whenever errno is in a valid range, and thus thread-safe.
     // Probably we don't have to use the cumbersome strerror_r() function.
-    LOG(WARNING) << "select() failed: " << strerror(errno);
+    LOG(WARNING) << "poll() failed: " << strerror(errno);
     return true;
   }
-  if (FD_ISSET(socket, &fds)) {
+  if (result > 0) {
+    // POLLHUP and POLLERR are reported by the following recv() or send().
     return false;
   }
 
-  LOG(ERROR) << "FD_ISSET failed";
+  LOG(ERROR) << "poll() timed out";
   return true;
 }
 
-bool IsWriteTimeout(int socket, absl::Duration timeout) {
-  if (timeout < absl::ZeroDuration()) {
-    return false;
-  }
-  fd_set fds;
-  struct timeval tv = absl::ToTimeval(timeout);
-  FD_ZERO(&fds);
-  FD_SET(socket, &fds);
-  if (select(socket + 1, nullptr, &fds, nullptr, &tv) < 0) {
-    LOG(WARNING) << "select() failed: " << strerror(errno);
-    return true;
-  }
-  if (FD_ISSET(socket, &fds)) {
-    return false;
-  }
+bool IsReadTimeout(int socket, absl::Duration timeout) {
+  return IsPollTimeout(socket, POLLIN, timeout);
+}
 
-  LOG(ERROR) << "FD_ISSET failed";
-  return true;
+bool IsWriteTimeout(int socket, absl::Duration timeout) {
+  return IsPollTimeout(socket, POLLOUT, timeout);
 }
 
 bool IsPeerValid(int socket, pid_t *pid) {
@@ -156,6 +178,10 @@ IPCErrorType SendMessage(int socket, const std::string &msg,
     }
     const ssize_t l =
         ::send(socket, msg.data() + offset, msg.size() - offset, MSG_NOSIGNAL);
+    if (l < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The socket is non-blocking and its buffer is full.
+      continue;
+    }
     if (l < 0) {
       // An error occurs.
       LOG(ERROR) << "an error occurred during sending \"" << msg.substr(offset)
@@ -199,6 +225,109 @@ IPCErrorType RecvMessage(int socket, std::string *msg, absl::Duration timeout) {
   return IPC_NO_ERROR;
 }
 
+// Reads exactly |size| bytes and appends them to |msg|.
+IPCErrorType RecvBytes(int socket, size_t size, std::string *msg,
+                       absl::Duration timeout) {
+  const size_t end = msg->size() + size;
+  const size_t begin = msg->size();
+  msg->resize(end);
+  size_t offset = begin;
+  while (offset < end) {
+    if (IsReadTimeout(socket, timeout)) {
+      LOG(WARNING) << "Read timeout " << timeout;
+      msg->resize(begin);
+      return IPC_TIMEOUT_ERROR;
+    }
+    const ssize_t read_length =
+        ::recv(socket, msg->data() + offset, end - offset, /* flags */ 0);
+    if (read_length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      continue;
+    }
+    if (read_length <= 0) {
+      LOG(ERROR) << "an error occurred during recv(): "
+                 << (read_length == 0 ? "connection closed" : strerror(errno));
+      msg->resize(begin);
+      return IPC_READ_ERROR;
+    }
+    offset += read_length;
+  }
+  return IPC_NO_ERROR;
+}
+
+// Persistent connections:
+// A client starts a persistent connection by sending
+// kPersistentConnectionMagic, and the server answers with one byte of
+// kPersistentConnectionAccepted or kPersistentConnectionRejected. After it is
+// accepted, every request and response is a frame of a 4-byte little-endian
+// length followed by the message, and the client can send the next requests
+// before receiving the responses. The responses are sent in the order of the
+// requests. A rejected connection continues as a normal one-shot connection.
+// The magic starts with 0xFF, which cannot start a serialized protobuf.
+constexpr absl::string_view kPersistentConnectionMagic = "\xFFMZP";
+constexpr char kPersistentConnectionAccepted = 1;
+constexpr char kPersistentConnectionRejected = 0;
+constexpr size_t kFrameHeaderSize = 4;
+constexpr uint32_t kMaxFrameSize = 64 << 20;
+
+void AppendFrame(absl::string_view message, std::string *output) {
+  const uint32_t size = message.size();
+  for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+    output->push_back(static_cast<char>((size >> (8 * i)) & 0xFF));
+  }
+  output->append(message.data(), message.size());
+}
+
+uint32_t DecodeFrameHeader(absl::string_view header) {
+  DCHECK_GE(header.size(), kFrameHeaderSize);
+  uint32_t size = 0;
+  for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+    size |= static_cast<uint32_t>(static_cast<uint8_t>(header[i])) << (8 * i);
+  }
+  return size;
+}
+
+IPCErrorType RecvFrame(int socket, std::string *msg, absl::Duration timeout) {
+  std::string header;
+  if (const IPCErrorType error =
+          RecvBytes(socket, kFrameHeaderSize, &header, timeout);
+      error != IPC_NO_ERROR) {
+    return error;
+  }
+  const uint32_t size = DecodeFrameHeader(header);
+  if (size > kMaxFrameSize) {
+    LOG(ERROR) << "Too large frame: " << size;
+    return IPC_READ_ERROR;
+  }
+  msg->clear();
+  return RecvBytes(socket, size, msg, timeout);
+}
+
+// Returns true if the client of |socket| starts the persistent connection
+// handshake. The magic is consumed in that case.
+bool ReadPersistentConnectionMagic(int socket, absl::Duration timeout) {
+  if (IsReadTimeout(socket, timeout)) {
+    return false;
+  }
+  char buf[kPersistentConnectionMagic.size()];
+  // One-shot clients half-close the connection after the request, so this
+  // doesn't wait for short requests.
+  const ssize_t length =
+      ::recv(socket, buf, sizeof(buf), MSG_PEEK | MSG_WAITALL);
+  if (length != sizeof(buf) ||
+      absl::string_view(buf, sizeof(buf)) != kPersistentConnectionMagic) {
+    return false;
+  }
+  return ::recv(socket, buf, sizeof(buf), 0) == sizeof(buf);
+}
+
+// Returns true if |socket| has data to read or is closed by the peer.
+bool IsReadable(int socket) {
+  pollfd fds = {};
+  fds.fd = socket;
+  fds.events = POLLIN;
+  return ::poll(&fds, 1, 0) > 0;
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -218,6 +347,236 @@ void SetCloseOnExecFlag(int fd) {
 bool IsAbstractSocket(const std::string &address) {
   return (!address.empty()) && (address[0] == '\0');
 }
+
+bool SetNonBlocking(int fd, bool non_blocking) {
+  int flags = ::fcntl(fd, F_GETFL, 0);
+  if (flags < 0) {
+    LOG(WARNING) << "fcntl(F_GETFL) for fd " << fd
+                 << " failed: " << strerror(errno);
+    return false;
+  }
+  if (non_blocking) {
+    flags |= O_NONBLOCK;
+  } else {
+    flags &= ~O_NONBLOCK;
+  }
+  if (::fcntl(fd, F_SETFL, flags) != 0) {
+    LOG(WARNING) << "fcntl(F_SETFL) for fd " << fd
+                 << " failed: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// Runs tasks on a fixed number of threads. Tasks submitted with the same key
+// run one by one in the submitted order, while tasks with different keys run
+// in parallel.
+class SerializingWorkerPool {
+ public:
+  explicit SerializingWorkerPool(int num_threads) {
+    DCHECK_GT(num_threads, 0);
+    threads_.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  SerializingWorkerPool(const SerializingWorkerPool &) = delete;
+  SerializingWorkerPool &operator=(const SerializingWorkerPool &) = delete;
+
+  // Runs all the submitted tasks and joins the threads.
+  ~SerializingWorkerPool() {
+    {
+      absl::MutexLock l(&mutex_);
+      stopping_ = true;
+    }
+    for (Thread2 &thread : threads_) {
+      thread.Join();
+    }
+  }
+
+  void Submit(uint64_t key, std::function<void()> task) {
+    absl::MutexLock l(&mutex_);
+    auto [it, inserted] = tasks_.try_emplace(key);
+    it->second.push_back(std::move(task));
+    if (inserted) {
+      // Otherwise the key is already in |ready_keys_| or its task is running,
+      // and the new task runs after that.
+      ready_keys_.push_back(key);
+    }
+  }
+
+ private:
+  void WorkerLoop() {
+    absl::MutexLock l(&mutex_);
+    while (true) {
+      mutex_.Await(absl::Condition(this, &SerializingWorkerPool::HasWork));
+      if (ready_keys_.empty()) {
+        return;
+      }
+      const uint64_t key = ready_keys_.front();
+      ready_keys_.pop_front();
+      // The key stays in |tasks_| while its task is running so that no other
+      // worker picks up the next task of the same key.
+      std::deque<std::function<void()>> &queue = tasks_[key];
+      std::function<void()> task = std::move(queue.front());
+      queue.pop_front();
+
+      mutex_.Unlock();
+      task();
+      mutex_.Lock();
+
+      auto it = tasks_.find(key);
+      if (it->second.empty()) {
+        tasks_.erase(it);
+      } else {
+        ready_keys_.push_back(key);
+      }
+    }
+  }
+
+  // Returns true if there is a task to run or all the tasks are done after
+  // the pool is stopped.
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !ready_keys_.empty() || (stopping_ && tasks_.empty());
+  }
+
+  absl::Mutex mutex_;
+  // Pending tasks for each key. A key is either in |ready_keys_| or has its
+  // task running while it is in |tasks_|.
+  absl::flat_hash_map<uint64_t, std::deque<std::function<void()>>> tasks_
+      ABSL_GUARDED_BY(mutex_);
+  std::deque<uint64_t> ready_keys_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<Thread2> threads_;
+};
+// A client connection of IPCServer::LoopWithWorkers(). The socket is closed
+// when the loop and all the pending requests of the connection release it.
+class ServerConnection {
+ public:
+  // |epoll_fd| is the epoll instance of the loop watching |fd|.
+  ServerConnection(int fd, int epoll_fd) : fd_(fd), epoll_fd_(epoll_fd) {}
+
+  ServerConnection(const ServerConnection &) = delete;
+  ServerConnection &operator=(const ServerConnection &) = delete;
+
+  ~ServerConnection() { ::close(fd_); }
+
+  int fd() const { return fd_; }
+
+  // Queues |response| to the |index|-th request of the persistent connection
+  // and sends the responses in the order of the requests. It doesn't block on
+  // a client which is slow to read. The rest is sent by Flush() when the loop
+  // finds the socket writable.
+  void SendFramedResponse(uint64_t index, absl::string_view response) {
+    absl::MutexLock l(&mutex_);
+    if (broken_) {
+      return;
+    }
+    pending_responses_[index] = std::string(response);
+    for (auto it = pending_responses_.find(next_response_);
+         it != pending_responses_.end();
+         it = pending_responses_.find(next_response_)) {
+      AppendFrame(it->second, &output_);
+      pending_responses_.erase(it);
+      ++next_response_;
+    }
+    FlushLocked();
+  }
+
+  // Sends the queued responses as much as the socket accepts.
+  void Flush() {
+    absl::MutexLock l(&mutex_);
+    FlushLocked();
+  }
+
+  // Returns true if the responses to all the |num_requests| requests are sent.
+  bool IsIdle(uint64_t num_requests) const {
+    absl::MutexLock l(&mutex_);
+    return next_response_ == num_requests && output_offset_ == output_.size();
+  }
+
+  // Returns the last time the queued responses made progress, or
+  // absl::InfiniteFuture() if nothing waits for the client to read.
+  absl::Time write_blocked_since() const {
+    absl::MutexLock l(&mutex_);
+    return write_blocked_since_;
+  }
+
+  // Stops sending the responses and lets the loop find the connection closed.
+  void Shutdown() {
+    absl::MutexLock l(&mutex_);
+    ShutdownLocked();
+  }
+
+ private:
+  void FlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (broken_) {
+      return;
+    }
+    const size_t begin = output_offset_;
+    while (output_offset_ < output_.size()) {
+      const ssize_t length =
+          ::send(fd_, output_.data() + output_offset_,
+                 output_.size() - output_offset_, MSG_NOSIGNAL);
+      if (length < 0 && errno == EINTR) {
+        continue;
+      }
+      if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      if (length < 0) {
+        LOG(WARNING) << "an error occurred during send(): " << strerror(errno);
+        ShutdownLocked();
+        return;
+      }
+      output_offset_ += length;
+    }
+    const bool blocked = output_offset_ < output_.size();
+    if (!blocked) {
+      output_.clear();
+      output_offset_ = 0;
+    }
+    if (blocked && (write_blocked_since_ == absl::InfiniteFuture() ||
+                    output_offset_ > begin)) {
+      write_blocked_since_ = absl::Now();
+    } else if (!blocked) {
+      write_blocked_since_ = absl::InfiniteFuture();
+    }
+    if (blocked == watching_writable_) {
+      return;
+    }
+    watching_writable_ = blocked;
+    epoll_event event = {};
+    event.events = blocked ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = fd_;
+    // This fails after the loop drops the connection, which is fine.
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd_, &event);
+  }
+
+  void ShutdownLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    broken_ = true;
+    output_.clear();
+    output_offset_ = 0;
+    write_blocked_since_ = absl::InfiniteFuture();
+    ::shutdown(fd_, SHUT_RDWR);
+  }
+
+  const int fd_;
+  const int epoll_fd_;
+  mutable absl::Mutex mutex_;
+  uint64_t next_response_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<uint64_t, std::string> pending_responses_
+      ABSL_GUARDED_BY(mutex_);
+  // Frames to send. The bytes before |output_offset_| are already sent.
+  std::string output_ ABSL_GUARDED_BY(mutex_);
+  size_t output_offset_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::Time write_blocked_since_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfiniteFuture();
+  // True while the loop watches the socket for EPOLLOUT.
+  bool watching_writable_ ABSL_GUARDED_BY(mutex_) = false;
+  bool broken_ ABSL_GUARDED_BY(mutex_) = false;
+};
 }  // namespace
 
 // Client
@@ -311,9 +670,71 @@ IPCClient::~IPCClient() {
   VLOG(1) << "connection closed (IPCClient destructed)";
 }
 
+bool IPCClient::EnablePersistentConnection(absl::Duration timeout) {
+  if (persistent_) {
+    return true;
+  }
+  if (!connected_ || ipc_path_manager_ == nullptr ||
+      ipc_path_manager_->GetServerProtocolVersion() <
+          IPC_PERSISTENT_CONNECTION_PROTOCOL_VERSION) {
+    return false;
+  }
+  last_ipc_error_ = SendMessage(
+      socket_, std::string(kPersistentConnectionMagic), timeout);
+  std::string reply;
+  if (last_ipc_error_ == IPC_NO_ERROR) {
+    last_ipc_error_ = RecvBytes(socket_, 1, &reply, timeout);
+  }
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    LOG(ERROR) << "Persistent connection handshake failed";
+    connected_ = false;
+    return false;
+  }
+  persistent_ = (reply[0] == kPersistentConnectionAccepted);
+  return persistent_;
+}
+
+bool IPCClient::CallPipelined(const std::vector<std::string> &requests,
+                              std::vector<std::string> *responses,
+                              absl::Duration timeout) {
+  if (!persistent_) {
+    return IPCClientInterface::CallPipelined(requests, responses, timeout);
+  }
+  std::string frames;
+  for (const std::string &request : requests) {
+    AppendFrame(request, &frames);
+  }
+  responses->resize(requests.size());
+  last_ipc_error_ = SendMessage(socket_, frames, timeout);
+  for (size_t i = 0;
+       last_ipc_error_ == IPC_NO_ERROR && i < responses->size(); ++i) {
+    last_ipc_error_ = RecvFrame(socket_, &(*responses)[i], timeout);
+  }
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    // The stream can't be reused once a response is lost.
+    LOG(ERROR) << "Pipelined call failed";
+    ::close(socket_);
+    socket_ = kInvalidSocket;
+    connected_ = false;
+    persistent_ = false;
+    return false;
+  }
+  VLOG(1) << "Call succeeded";
+  return true;
+}
+
 // RPC call
 bool IPCClient::Call(const std::string &request, std::string *response,
                      absl::Duration timeout) {
+  if (persistent_) {
+    std::vector<std::string> responses;
+    if (!CallPipelined({request}, &responses, timeout)) {
+      return false;
+    }
+    *response = std::move(responses[0]);
+    return true;
+  }
+
   last_ipc_error_ = SendMessage(socket_, request, timeout);
   if (last_ipc_error_ != IPC_NO_ERROR) {
     LOG(ERROR) << "SendMessage failed";
@@ -337,12 +758,19 @@ bool IPCClient::Call(const std::string &request, std::string *response,
   return true;
 }
 
-bool IPCClient::Connected() const { return connected_; }
+bool IPCClient::Connected() const {
+  // The server sends nothing on an idle persistent connection, so it is
+  // readable only when the server has closed it.
+  return connected_ && !(persistent_ && IsReadable(socket_));
+}
 
 // Server
 IPCServer::IPCServer(const std::string &name, int32_t num_connections,
                      absl::Duration timeout)
-    : connected_(false), socket_(kInvalidSocket), timeout_(timeout) {
+    : connected_(false),
+      socket_(kInvalidSocket),
+      wakeup_fd_(kInvalidSocket),
+      timeout_(timeout) {
   IPCPathManager *manager = IPCPathManager::GetIPCPathManager(name);
   if (!manager->CreateNewPathName() && !manager->LoadPathName()) {
     LOG(ERROR) << "Cannot prepare IPC path name";
@@ -405,13 +833,28 @@ IPCServer::IPCServer(const std::string &name, int32_t num_connections,
     return;
   }
 
+  wakeup_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeup_fd_ < 0) {
+    LOG(WARNING) << "eventfd() failed: " << strerror(errno);
+  }
+
   connected_ = true;
   VLOG(1) << "IPCServer ready";
 }
 
 IPCServer::~IPCServer() {
   if (server_thread_ != nullptr) {
-    server_thread_->Terminate();
+    if (num_workers_ > 0) {
+      // Stops the loop gracefully so that the workers are joined.
+      Terminate();
+      Wait();
+    } else {
+      server_thread_->Terminate();
+    }
+  }
+  if (wakeup_fd_ != kInvalidSocket) {
+    ::close(wakeup_fd_);
+    wakeup_fd_ = kInvalidSocket;
   }
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
@@ -427,44 +870,57 @@ IPCServer::~IPCServer() {
 bool IPCServer::Connected() const { return connected_; }
 
 void IPCServer::Loop() {
-  // The most portable and straightforward single-thread server
-  bool error = false;
-  pid_t pid = 0;
-  std::string request;
-  std::string response;
-  while (!error) {
-    const int new_sock = ::accept(socket_, nullptr, nullptr);
-    if (new_sock < 0) {
-      LOG(FATAL) << "accept() failed: " << strerror(errno);
-      return;
-    }
-    if (!IsPeerValid(new_sock, &pid)) {
-      continue;
-    }
+  if (num_workers_ > 0 && wakeup_fd_ != kInvalidSocket) {
+    LoopWithWorkers();
+  } else {
+    // The most portable and straightforward single-thread server
+    bool error = false;
+    pid_t pid = 0;
+    std::string request;
+    std::string response;
+    while (!error) {
+      const int new_sock = ::accept(socket_, nullptr, nullptr);
+      if (new_sock < 0) {
+        LOG(FATAL) << "accept() failed: " << strerror(errno);
+        return;
+      }
+      if (!IsPeerValid(new_sock, &pid)) {
+        continue;
+      }
 
-    if (RecvMessage(new_sock, &request, timeout_) != IPC_NO_ERROR) {
-      LOG(WARNING) << "RecvMessage() failed";
-      ::close(new_sock);
-      continue;
-    }
+      if (ReadPersistentConnectionMagic(new_sock, timeout_) &&
+          SendMessage(new_sock, std::string(1, kPersistentConnectionRejected),
+                      timeout_) != IPC_NO_ERROR) {
+        LOG(WARNING) << "SendMessage() failed";
+        ::close(new_sock);
+        continue;
+      }
 
-    if (!Process(request, &response)) {
-      LOG(WARNING) << "Process() failed";
-      ::close(new_sock);
-      error = true;
-      continue;
-    }
+      if (RecvMessage(new_sock, &request, timeout_) != IPC_NO_ERROR) {
+        LOG(WARNING) << "RecvMessage() failed";
+        ::close(new_sock);
+        continue;
+      }
 
-    if (response.empty()) {
-      LOG(WARNING) << "response is empty";
-      ::close(new_sock);
-      continue;
-    }
+      usage_stats::ScopedLatencyRecorder recorder(RequestStage());
+      if (!Process(request, &response)) {
+        LOG(WARNING) << "Process() failed";
+        ::close(new_sock);
+        error = true;
+        continue;
+      }
 
-    if (SendMessage(new_sock, response, timeout_) != IPC_NO_ERROR) {
-      LOG(WARNING) << "SendMessage() failed";
+      if (response.empty()) {
+        LOG(WARNING) << "response is empty";
+        ::close(new_sock);
+        continue;
+      }
+
+      if (SendMessage(new_sock, response, timeout_) != IPC_NO_ERROR) {
+        LOG(WARNING) << "SendMessage() failed";
+      }
+      ::close(new_sock);
     }
-    ::close(new_sock);
   }
 
   ::shutdown(socket_, SHUT_RDWR);
@@ -477,7 +933,292 @@ void IPCServer::Loop() {
   socket_ = kInvalidSocket;
 }
 
-void IPCServer::Terminate() { server_thread_->Terminate(); }
+void IPCServer::LoopWithWorkers() {
+  // Connections are accepted and read in this thread with epoll, and the
+  // requests are processed and responded by the workers. A one-shot
+  // connection carries one request and is closed after the response. A
+  // persistent connection carries framed requests until the client closes it
+  // or leaves it idle for |idle_timeout_|.
+  enum class Mode { kUnknown, kOneShot, kPersistent };
+  struct ConnectionState {
+    std::shared_ptr<ServerConnection> connection;
+    Mode mode = Mode::kUnknown;
+    std::string buffer;
+    absl::Time deadline;
+    uint64_t num_requests = 0;
+  };
+
+  const int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    LOG(ERROR) << "epoll_create1() failed: " << strerror(errno);
+    return;
+  }
+  auto watch = [epoll_fd](int fd) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+  };
+  if (!SetNonBlocking(socket_, true) || !watch(socket_) || !watch(wakeup_fd_)) {
+    LOG(ERROR) << "Cannot watch the server socket: " << strerror(errno);
+    ::close(epoll_fd);
+    return;
+  }
+
+  absl::flat_hash_map<int, ConnectionState> connections;
+  auto close_connection = [epoll_fd, &connections](int fd) {
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    // The socket is closed when the pending requests are also done.
+    connections.erase(fd);
+  };
+  auto request_deadline = [this]() {
+    return timeout_ < absl::ZeroDuration() ? absl::InfiniteFuture()
+                                           : absl::Now() + timeout_;
+  };
+
+  std::atomic<bool> quit = false;
+  auto process = [this, &quit](absl::string_view request,
+                               ParsedRequest *parsed, std::string *response) {
+    if (quit) {
+      response->clear();
+      return;
+    }
+    if (!ProcessParsedRequest(request, parsed, response)) {
+      LOG(WARNING) << "Process() failed";
+      response->clear();
+      quit = true;
+      Terminate();
+    }
+  };
+  {
+    SerializingWorkerPool workers(num_workers_);
+
+    constexpr int kMaxEvents = 64;
+    epoll_event events[kMaxEvents];
+    char buf[8192];
+    while (!quit) {
+      const absl::Duration wait = timeout_ < absl::ZeroDuration()
+                                      ? idle_timeout_
+                                      : std::min(timeout_, idle_timeout_);
+      const int wait_msec = absl::ToInt64Milliseconds(wait) + 1;
+      const int num_events =
+          ::epoll_wait(epoll_fd, events, kMaxEvents, wait_msec);
+      if (num_events < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        LOG(ERROR) << "epoll_wait() failed: " << strerror(errno);
+        break;
+      }
+
+      for (int i = 0; i < num_events; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == wakeup_fd_) {
+          uint64_t value = 0;
+          while (::read(wakeup_fd_, &value, sizeof(value)) > 0) {
+          }
+          quit = true;
+          continue;
+        }
+
+        if (fd == socket_) {
+          while (true) {
+            const int new_sock = ::accept4(socket_, nullptr, nullptr,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (new_sock < 0) {
+              if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                  errno != ECONNABORTED && errno != EINTR) {
+                LOG(ERROR) << "accept4() failed: " << strerror(errno);
+              }
+              break;
+            }
+            pid_t pid = 0;
+            if (!IsPeerValid(new_sock, &pid) || !watch(new_sock)) {
+              ::close(new_sock);
+              continue;
+            }
+            ConnectionState &state = connections[new_sock];
+            state.connection =
+                std::make_shared<ServerConnection>(new_sock, epoll_fd);
+            state.deadline = request_deadline();
+          }
+          continue;
+        }
+
+        auto it = connections.find(fd);
+        if (it == connections.end()) {
+          continue;
+        }
+        ConnectionState &state = it->second;
+        if (events[i].events & EPOLLOUT) {
+          state.connection->Flush();
+        }
+        if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+          continue;
+        }
+        const bool was_idle = state.buffer.empty();
+        bool eof = false;
+        bool error = false;
+        while (true) {
+          const ssize_t length = ::recv(fd, buf, sizeof(buf), 0);
+          if (length > 0) {
+            state.buffer.append(buf, length);
+            continue;
+          }
+          if (length == 0) {
+            eof = true;
+          } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG(ERROR) << "an error occurred during recv(): "
+                       << strerror(errno);
+            error = true;
+          }
+          break;
+        }
+        if (error) {
+          close_connection(fd);
+          continue;
+        }
+
+        if (state.mode == Mode::kUnknown &&
+            (eof || state.buffer.size() >= kPersistentConnectionMagic.size())) {
+          if (absl::StartsWith(state.buffer, kPersistentConnectionMagic)) {
+            state.mode = Mode::kPersistent;
+            state.buffer.erase(0, kPersistentConnectionMagic.size());
+            if (SendMessage(fd,
+                            std::string(1, kPersistentConnectionAccepted),
+                            timeout_) != IPC_NO_ERROR) {
+              close_connection(fd);
+              continue;
+            }
+          } else {
+            state.mode = Mode::kOneShot;
+          }
+        }
+
+        if (state.mode == Mode::kPersistent) {
+          // Dispatches all the complete frames.
+          size_t offset = 0;
+          while (state.buffer.size() - offset >= kFrameHeaderSize) {
+            const uint32_t size = DecodeFrameHeader(
+                absl::string_view(state.buffer).substr(offset));
+            if (size > kMaxFrameSize) {
+              LOG(ERROR) << "Too large frame: " << size;
+              error = true;
+              break;
+            }
+            if (state.buffer.size() - offset < kFrameHeaderSize + size) {
+              break;
+            }
+            std::string request =
+                state.buffer.substr(offset + kFrameHeaderSize, size);
+            offset += kFrameHeaderSize + size;
+            std::unique_ptr<ParsedRequest> parsed;
+            const uint64_t key = ParseRequest(request, &parsed);
+            workers.Submit(key, [this, connection = state.connection,
+                                 index = state.num_requests++,
+                                 request = std::move(request),
+                                 parsed = std::shared_ptr<ParsedRequest>(
+                                     std::move(parsed)),
+                                 received = Clock::GetAbslTime(), &process] {
+              std::string response;
+              process(request, parsed.get(), &response);
+              connection->SendFramedResponse(index, response);
+              RecordRequestLatency(received);
+            });
+          }
+          state.buffer.erase(0, offset);
+          if (error || eof) {
+            close_connection(fd);
+            continue;
+          }
+          if (state.buffer.empty()) {
+            state.deadline = absl::Now() + idle_timeout_;
+          } else if (was_idle || offset > 0) {
+            state.deadline = request_deadline();
+          }
+          continue;
+        }
+
+        // The one-shot client half-closes the connection after the request,
+        // so the request is complete at EOF.
+        if (!eof) {
+          continue;
+        }
+        std::string request = std::move(state.buffer);
+        std::shared_ptr<ServerConnection> connection =
+            std::move(state.connection);
+        close_connection(fd);
+        std::unique_ptr<ParsedRequest> parsed;
+        const uint64_t key = ParseRequest(request, &parsed);
+        workers.Submit(key, [this, connection = std::move(connection),
+                             request = std::move(request),
+                             parsed = std::shared_ptr<ParsedRequest>(
+                                 std::move(parsed)),
+                             received = Clock::GetAbslTime(), &process] {
+          std::string response;
+          process(request, parsed.get(), &response);
+          if (response.empty()) {
+            LOG(WARNING) << "response is empty";
+            return;
+          }
+          if (SendMessage(connection->fd(), response, timeout_) !=
+              IPC_NO_ERROR) {
+            LOG(WARNING) << "SendMessage() failed";
+          }
+          RecordRequestLatency(received);
+        });
+      }
+
+      // Drops the connections which don't complete the request or read the
+      // responses in time, and the persistent connections left idle.
+      const absl::Time now = absl::Now();
+      std::vector<int> expired;
+      for (auto &[fd, state] : connections) {
+        if (state.mode == Mode::kPersistent) {
+          if (timeout_ >= absl::ZeroDuration() &&
+              state.connection->write_blocked_since() + timeout_ < now) {
+            LOG(WARNING) << "Write timeout " << timeout_;
+            expired.push_back(fd);
+            continue;
+          }
+          if (state.deadline < now && state.buffer.empty() &&
+              !state.connection->IsIdle(state.num_requests)) {
+            // The requests are still being processed.
+            state.deadline = now + idle_timeout_;
+            continue;
+          }
+        }
+        if (state.deadline < now) {
+          if (state.mode == Mode::kPersistent && state.buffer.empty()) {
+            VLOG(1) << "Closing the idle connection";
+          } else {
+            LOG(WARNING) << "Read timeout " << timeout_;
+          }
+          expired.push_back(fd);
+        }
+      }
+      for (const int fd : expired) {
+        connections[fd].connection->Shutdown();
+        close_connection(fd);
+      }
+    }
+    // |workers| runs the remaining tasks and is joined here.
+  }
+
+  connections.clear();
+  ::close(epoll_fd);
+}
+
+void IPCServer::Terminate() {
+  if (num_workers_ > 0 && wakeup_fd_ != kInvalidSocket) {
+    const uint64_t value = 1;
+    if (::write(wakeup_fd_, &value, sizeof(value)) < 0) {
+      LOG(WARNING) << "write() to eventfd failed: " << strerror(errno);
+    }
+    return;
+  }
+  server_thread_->Terminate();
+}
 
 }  // namespace mozc
 
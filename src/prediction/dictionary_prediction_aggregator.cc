@@ -32,8 +32,10 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <utility>
@@ -42,6 +44,7 @@
 #include "base/japanese_util.h"
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/type_corrected_query.h"
@@ -54,6 +57,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "prediction/number_decoder.h"
+#include "prediction/prediction_thread_pool.h"
 #include "prediction/single_kanji_prediction_aggregator.h"
 #include "prediction/zero_query_dict.h"
 #include "protocol/commands.pb.h"
@@ -62,6 +66,7 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #ifndef NDEBUG
 #define MOZC_DEBUG
@@ -511,14 +516,21 @@ DictionaryPredictionAggregator::DictionaryPredictionAggregator(
 
 std::vector<Result> DictionaryPredictionAggregator::AggregateResults(
     const ConversionRequest &request, const Segments &segments) const {
+  return AggregateResultsWithLattice(request, segments, nullptr);
+}
+
+std::vector<Result> DictionaryPredictionAggregator::AggregateResultsWithLattice(
+    const ConversionRequest &request, const Segments &segments,
+    std::shared_ptr<Lattice> lattice) const {
   std::vector<Result> results;
-  AggregatePredictionForTesting(request, segments, &results);
+  AggregatePredictionForTesting(request, segments, std::move(lattice),
+                                &results);
   return results;
 }
 
 PredictionTypes DictionaryPredictionAggregator::AggregatePredictionForTesting(
     const ConversionRequest &request, const Segments &segments,
-    std::vector<Result> *results) const {
+    std::shared_ptr<Lattice> lattice, std::vector<Result> *results) const {
   const bool is_mixed_conversion = IsMixedConversionEnabled(request.request());
   // In mixed conversion mode, the number of real time candidates is increased.
   const size_t realtime_max_size =
@@ -526,7 +538,7 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePredictionForTesting(
   const auto &unigram_config = GetUnigramConfig(request);
 
   return AggregatePrediction(request, realtime_max_size, unigram_config,
-                             segments, results);
+                             segments, std::move(lattice), results);
 }
 
 DictionaryPredictionAggregator::UnigramConfig
@@ -565,7 +577,7 @@ DictionaryPredictionAggregator::GetUnigramConfig(
 PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     const ConversionRequest &request, size_t realtime_max_size,
     const UnigramConfig &unigram_config, const Segments &segments,
-    std::vector<Result> *results) const {
+    std::shared_ptr<Lattice> lattice, std::vector<Result> *results) const {
   DCHECK(results);
 
   // Zero query prediction.
@@ -589,56 +601,87 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
       return NO_PREDICTION;
     }
   }
-  PredictionTypes selected_types = NO_PREDICTION;
+  std::vector<PredictionStep> steps;
   if (ShouldAggregateRealTimeConversionResults(request, segments)) {
-    AggregateRealtimeConversion(request, realtime_max_size, segments, results);
-    selected_types |= REALTIME;
+    // Only this step uses the lattice and the converters.
+    steps.push_back({[&](std::vector<Result> *step_results) {
+      AggregateRealtimeConversion(request, realtime_max_size, segments,
+                                  std::move(lattice), step_results);
+      return REALTIME;
+    }});
   }
+
   // In partial suggestion or prediction, only realtime candidates are used.
-  if (request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
-      request.request_type() == ConversionRequest::PARTIAL_PREDICTION) {
-    return selected_types;
+  if (request.request_type() != ConversionRequest::PARTIAL_SUGGESTION &&
+      request.request_type() != ConversionRequest::PARTIAL_PREDICTION) {
+    AppendPredictionSteps(request, unigram_config, segments, key_len, &steps);
   }
 
+  return RunPredictionSteps(GetPredictionThreadPool(), request, steps,
+                            results);
+}
+
+void DictionaryPredictionAggregator::AppendPredictionSteps(
+    const ConversionRequest &request, const UnigramConfig &unigram_config,
+    const Segments &segments, size_t key_len,
+    std::vector<PredictionStep> *steps) const {
   // Add unigram candidates.
   const size_t min_unigram_key_len = unigram_config.min_key_len;
   if (key_len >= min_unigram_key_len) {
-    const auto &unigram_fn = unigram_config.unigram_fn;
-    PredictionType type = (this->*unigram_fn)(request, segments, results);
-    selected_types |= type;
+    steps->push_back({[&](std::vector<Result> *results) {
+      const auto &unigram_fn = unigram_config.unigram_fn;
+      return static_cast<PredictionTypes>(
+          (this->*unigram_fn)(request, segments, results));
+    }});
   }
 
-  if (IsMixedConversionEnabled(request.request()) && key_len > 0 &&
-      AggregateNumberCandidates(request, segments, results)) {
-    selected_types |= NUMBER;
+  if (IsMixedConversionEnabled(request.request()) && key_len > 0) {
+    steps->push_back({[&](std::vector<Result> *results) {
+      return AggregateNumberCandidates(request, segments, results)
+                 ? NUMBER
+                 : NO_PREDICTION;
+    }});
   }
 
   // Add bigram candidates.
   constexpr int kMinHistoryKeyLen = 3;
   if (HasHistoryKeyLongerThanOrEqualTo(segments, kMinHistoryKeyLen)) {
-    AggregateBigramPrediction(request, segments,
-                              Segment::Candidate::SOURCE_INFO_NONE, results);
-    selected_types |= BIGRAM;
+    steps->push_back({[&](std::vector<Result> *results) {
+      AggregateBigramPrediction(request, segments,
+                                Segment::Candidate::SOURCE_INFO_NONE, results);
+      return BIGRAM;
+    }});
   }
 
   // Add english candidates.
   if (IsLanguageAwareInputEnabled(request) && IsQwertyMobileTable(request) &&
       key_len >= min_unigram_key_len) {
-    AggregateEnglishPredictionUsingRawInput(request, segments, results);
-    selected_types |= ENGLISH;
+    steps->push_back({[&](std::vector<Result> *results) {
+      AggregateEnglishPredictionUsingRawInput(request, segments, results);
+      return ENGLISH;
+    }});
   }
 
   // Add typing correction candidates.
   constexpr int kMinTypingCorrectionKeyLen = 3;
   if (IsTypingCorrectionEnabled(request) &&
       key_len >= kMinTypingCorrectionKeyLen) {
-    AggregateTypeCorrectingPrediction(request, segments, results);
-    selected_types |= TYPING_CORRECTION;
+    steps->push_back({[&](std::vector<Result> *results) {
+      AggregateTypeCorrectingPrediction(request, segments, results);
+      return TYPING_CORRECTION;
+    }});
   }
 
   if (IsMixedConversionEnabled(request.request())) {
-    AggregatePrefixCandidates(request, segments, results);
-    selected_types |= PREFIX;
+    // The prefix candidates are cut off by the number of all the results so
+    // far.
+    PredictionStep step;
+    step.run = [&](std::vector<Result> *results) {
+      AggregatePrefixCandidates(request, segments, results);
+      return PREFIX;
+    };
+    step.depends_on_preceding_results = true;
+    steps->push_back(std::move(step));
   }
 
   if (IsMixedConversionEnabled(request.request()) &&
@@ -646,16 +689,52 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     // We do not want to add single kanji results for non mixed conversion
     // (i.e., Desktop, or Hardware Keyboard in Mobile), since they contain
     // partial results.
-    const std::vector<Result> single_kanji_results =
-        single_kanji_prediction_aggregator_->AggregateResults(request,
-                                                              segments);
-    if (!single_kanji_results.empty()) {
+    steps->push_back({[&](std::vector<Result> *results) {
+      const std::vector<Result> single_kanji_results =
+          single_kanji_prediction_aggregator_->AggregateResults(request,
+                                                                segments);
+      if (single_kanji_results.empty()) {
+        return NO_PREDICTION;
+      }
       results->insert(results->end(), single_kanji_results.begin(),
                       single_kanji_results.end());
-      selected_types |= SINGLE_KANJI;
+      return SINGLE_KANJI;
+    }});
+  }
+}
+
+PredictionTypes DictionaryPredictionAggregator::RunPredictionSteps(
+    ThreadPool *pool, const ConversionRequest &request,
+    absl::Span<const PredictionStep> steps, std::vector<Result> *results) {
+  PredictionTypes selected_types = NO_PREDICTION;
+  if (pool == nullptr || steps.size() <= 1) {
+    for (const PredictionStep &step : steps) {
+      selected_types |= step.run(results);
+    }
+    return selected_types;
+  }
+
+  std::vector<std::vector<Result>> step_results(steps.size());
+  std::vector<PredictionTypes> step_types(steps.size(), NO_PREDICTION);
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i < steps.size(); ++i) {
+    if (!steps[i].depends_on_preceding_results) {
+      tasks.push_back(
+          [&, i] { step_types[i] = steps[i].run(&step_results[i]); });
     }
   }
+  RunPredictionTasks(pool, request, tasks);
 
+  for (size_t i = 0; i < steps.size(); ++i) {
+    if (steps[i].depends_on_preceding_results) {
+      selected_types |= steps[i].run(results);
+      continue;
+    }
+    selected_types |= step_types[i];
+    results->insert(results->end(),
+                    std::make_move_iterator(step_results[i].begin()),
+                    std::make_move_iterator(step_results[i].end()));
+  }
   return selected_types;
 }
 
@@ -831,7 +910,8 @@ bool DictionaryPredictionAggregator::PushBackTopConversionResult(
 
 void DictionaryPredictionAggregator::AggregateRealtimeConversion(
     const ConversionRequest &request, size_t realtime_candidates_size,
-    const Segments &segments, std::vector<Result> *results) const {
+    const Segments &segments, std::shared_ptr<Lattice> lattice,
+    std::vector<Result> *results) const {
   DCHECK(converter_);
   DCHECK(immutable_converter_);
   DCHECK(results);
@@ -850,6 +930,12 @@ void DictionaryPredictionAggregator::AggregateRealtimeConversion(
       GetConversionRequestForRealtimeCandidates(request,
                                                 realtime_candidates_size);
   Segments tmp_segments = GetSegmentsForRealtimeCandidatesGeneration(segments);
+  // Realtime conversion runs on every key stroke. Reuse the lattice built for
+  // the previous key so that only the nodes around the new characters are
+  // looked up and recomputed.
+  if (lattice != nullptr) {
+    tmp_segments.set_cached_lattice(std::move(lattice));
+  }
   if (!immutable_converter_->ConvertForRequest(request_for_realtime,
                                                &tmp_segments) ||
       tmp_segments.conversion_segments_size() == 0 ||
@@ -1198,17 +1284,26 @@ void DictionaryPredictionAggregator::GetPredictiveResults(
   const std::string non_expanded_original_key =
       absl::StrCat(history_key, segments.conversion_segment(0).key());
 
-  // |expanded| is a very small set, so calling LookupPredictive multiple
-  // times is not so expensive.  Also, the number of lookup results is limited
-  // by |lookup_limit|.
+  // The keys share "|history_key| + |base|", which is traversed only once by
+  // LookupPredictiveMulti().  The number of lookup results is limited by
+  // |lookup_limit| for each key.
+  std::vector<std::string> input_keys;
+  input_keys.reserve(expanded.size());
   for (const std::string &expanded_char : expanded) {
-    input_key = absl::StrCat(history_key, base, expanded_char);
-    PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
-                                      nullptr, source_info, zip_code_id,
-                                      unknown_id, non_expanded_original_key,
-                                      GetSpatialCostParams(request), results);
-    dictionary.LookupPredictive(input_key, request, &callback);
-  }
+    input_keys.push_back(absl::StrCat(history_key, base, expanded_char));
+  }
+  const std::vector<absl::string_view> keys(input_keys.begin(),
+                                            input_keys.end());
+  const SpatialCostParams spatial_cost_params = GetSpatialCostParams(request);
+  std::optional<PredictiveLookupCallback> callback;
+  dictionary.LookupPredictiveMulti(
+      keys, request, [&](size_t index) -> DictionaryInterface::Callback * {
+        callback.emplace(types, lookup_limit, keys[index].size(), nullptr,
+                         source_info, zip_code_id, unknown_id,
+                         non_expanded_original_key, spatial_cost_params,
+                         results);
+        return &*callback;
+      });
 }
 
 void DictionaryPredictionAggregator::GetPredictiveResultsForBigram(
@@ -1309,17 +1404,28 @@ void DictionaryPredictionAggregator::GetPredictiveResultsUsingTypingCorrection(
 
   std::vector<composer::TypeCorrectedQuery> queries;
   request.composer().GetTypeCorrectedQueriesForPrediction(&queries);
-  for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
-    const composer::TypeCorrectedQuery &query = queries[query_index];
-    const std::string input_key(absl::StrCat(history_key, query.base));
-    const size_t previous_results_size = results->size();
-    PredictiveLookupCallback callback(
-        types, lookup_limit, input_key.size(),
-        query.expanded.empty() ? nullptr : &query.expanded,
-        Segment::Candidate::SOURCE_INFO_NONE, zip_code_id_, unknown_id_,
-        query.asis, GetSpatialCostParams(request), results);
-    dictionary.LookupPredictive(input_key, request, &callback);
-
+  std::vector<std::string> input_keys;
+  input_keys.reserve(queries.size());
+  for (const composer::TypeCorrectedQuery &query : queries) {
+    input_keys.push_back(absl::StrCat(history_key, query.base));
+  }
+  const std::vector<absl::string_view> keys(input_keys.begin(),
+                                            input_keys.end());
+
+  // The corrected queries mostly share their prefixes, so they are looked up
+  // by LookupPredictiveMulti().  The callback for each query is created when
+  // the dictionary requests it, after the results of the previous query.
+  const SpatialCostParams spatial_cost_params = GetSpatialCostParams(request);
+  std::optional<PredictiveLookupCallback> callback;
+  std::optional<size_t> current_query_index;
+  size_t previous_results_size = results->size();
+  // Returns false if enough results are collected.
+  auto finish_current_query = [&]() {
+    if (!current_query_index.has_value()) {
+      return true;
+    }
+    const composer::TypeCorrectedQuery &query = queries[*current_query_index];
+    current_query_index.reset();
     for (size_t i = previous_results_size; i < results->size(); ++i) {
       // Query cost can be negative in 'diff cost' due to typing model.
       // We do not want to strongly promote TC candidates even if the query cost
@@ -1327,10 +1433,25 @@ void DictionaryPredictionAggregator::GetPredictiveResultsUsingTypingCorrection(
       (*results)[i].wcost += std::max(0, query.cost);
     }
     lookup_limit -= results->size() - previous_results_size;
-    if (lookup_limit <= 0) {
-      break;
-    }
-  }
+    return lookup_limit > 0;
+  };
+  dictionary.LookupPredictiveMulti(
+      keys, request,
+      [&](size_t query_index) -> DictionaryInterface::Callback * {
+        if (!finish_current_query()) {
+          return nullptr;
+        }
+        const composer::TypeCorrectedQuery &query = queries[query_index];
+        current_query_index = query_index;
+        previous_results_size = results->size();
+        callback.emplace(types, lookup_limit, keys[query_index].size(),
+                         query.expanded.empty() ? nullptr : &query.expanded,
+                         Segment::Candidate::SOURCE_INFO_NONE, zip_code_id_,
+                         unknown_id_, query.asis, spatial_cost_params,
+                         results);
+        return &*callback;
+      });
+  finish_current_query();
 }
 
 // static
@@ -32,11 +32,13 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "converter/converter_interface.h"
 #include "converter/immutable_converter_interface.h"
@@ -52,6 +54,7 @@
 #include "prediction/zero_query_dict.h"
 #include "request/conversion_request.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace prediction {
@@ -74,6 +77,9 @@ class DictionaryPredictionAggregator : public PredictionAggregatorInterface {
 
   std::vector<Result> AggregateResults(const ConversionRequest &request,
                                        const Segments &segments) const override;
+  std::vector<Result> AggregateResultsWithLattice(
+      const ConversionRequest &request, const Segments &segments,
+      std::shared_ptr<Lattice> lattice) const override;
 
  private:
   class PredictiveLookupCallback;
@@ -89,6 +95,14 @@ class DictionaryPredictionAggregator : public PredictionAggregatorInterface {
     size_t min_key_len;
   };
 
+  // A step of AggregatePrediction().  The step appends its results to the
+  // given vector and returns the type of the prediction.
+  struct PredictionStep {
+    std::function<PredictionTypes(std::vector<Result> *)> run;
+    // True if the step reads the results of the preceding steps.
+    bool depends_on_preceding_results = false;
+  };
+
   // For testing
   DictionaryPredictionAggregator(
       const DataManagerInterface &data_manager,
@@ -104,14 +118,30 @@ class DictionaryPredictionAggregator : public PredictionAggregatorInterface {
   // were used.  NO_PREDICTION means that no prediction was made.
   PredictionTypes AggregatePredictionForTesting(
       const ConversionRequest &request, const Segments &segments,
-      std::vector<Result> *results) const;
+      std::shared_ptr<Lattice> lattice, std::vector<Result> *results) const;
 
   PredictionTypes AggregatePrediction(const ConversionRequest &request,
                                       size_t realtime_max_size,
                                       const UnigramConfig &unigram_config,
                                       const Segments &segments,
+                                      std::shared_ptr<Lattice> lattice,
                                       std::vector<Result> *results) const;
 
+  // Appends the prediction steps other than the realtime conversion to
+  // |steps|.
+  void AppendPredictionSteps(const ConversionRequest &request,
+                             const UnigramConfig &unigram_config,
+                             const Segments &segments, size_t key_len,
+                             std::vector<PredictionStep> *steps) const;
+
+  // Runs |steps| and appends their results to |results| in the order of the
+  // steps.  With |pool|, the independent steps run concurrently on their own
+  // result vectors, and the dependent ones run once the preceding results are
+  // merged, so the results are the same as the sequential execution.
+  static PredictionTypes RunPredictionSteps(
+      ThreadPool *pool, const ConversionRequest &request,
+      absl::Span<const PredictionStep> steps, std::vector<Result> *results);
+
   // Looks up the given range and appends zero query candidate list for |key|
   // to |results|.
   // Returns false if there is no result for |key|.
@@ -214,9 +244,11 @@ class DictionaryPredictionAggregator : public PredictionAggregatorInterface {
 
   // Aggregate* methods aggregate the candidates with different resources
   // and algorithms.
+  // |lattice| is reused by the realtime conversion when it is not null.
   void AggregateRealtimeConversion(const ConversionRequest &request,
                                    size_t realtime_candidates_size,
                                    const Segments &segments,
+                                   std::shared_ptr<Lattice> lattice,
                                    std::vector<Result> *results) const;
 
   void AggregateBigramPrediction(const ConversionRequest &request,
@@ -42,6 +42,7 @@
 #include "base/container/serialized_string_array.h"
 #include "base/logging.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/internal/typing_model.h"
@@ -59,6 +60,7 @@
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suffix_dictionary.h"
 #include "prediction/prediction_aggregator_interface.h"
+#include "prediction/prediction_thread_pool.h"
 #include "prediction/result.h"
 #include "prediction/zero_query_dict.h"
 #include "protocol/commands.pb.h"
@@ -99,7 +101,7 @@ class DictionaryPredictionAggregatorTestPeer {
       const ConversionRequest &request, const Segments &segments,
       std::vector<Result> *results) const {
     return aggregator_.AggregatePredictionForTesting(request, segments,
-                                                     results);
+                                                     nullptr, results);
   }
 
   size_t GetCandidateCutoffThreshold(
@@ -133,7 +135,7 @@ class DictionaryPredictionAggregatorTestPeer {
                                    const Segments &segments,
                                    std::vector<Result> *results) const {
     aggregator_.AggregateRealtimeConversion(request, realtime_candidates_size,
-                                            segments, results);
+                                            segments, nullptr, results);
   }
 
   void AggregateSuffixPrediction(const ConversionRequest &request,
@@ -2750,6 +2752,56 @@ TEST_F(DictionaryPredictionAggregatorTest,
                SINGLE_KANJI);
 }
 
+TEST_F(DictionaryPredictionAggregatorTest, ParallelSteps) {
+  std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
+      CreateAggregatorWithMockData();
+  const DictionaryPredictionAggregatorTestPeer &aggregator =
+      data_and_aggregator->aggregator();
+  commands::RequestForUnitTest::FillMobileRequest(request_.get());
+  request_->mutable_decoder_experiment_params()
+      ->set_enable_single_kanji_prediction(true);
+  {
+    Result result;
+    result.key = "ぐ";
+    result.value = "具";
+    result.SetTypesAndTokenAttributes(SINGLE_KANJI, Token::NONE);
+    MockSingleKanjiPredictionAggregator *mock =
+        data_and_aggregator->mutable_single_kanji_prediction_aggregator();
+    EXPECT_CALL(*mock, AggregateResults(_, _))
+        .WillRepeatedly(Return(std::vector<Result>{result}));
+  }
+
+  Segments segments;
+  SetUpInputForSuggestion("ぐーぐる", composer_.get(), &segments);
+
+  std::vector<Result> expected;
+  SetPredictionThreadPoolForTesting(nullptr);
+  const PredictionTypes expected_types =
+      aggregator.AggregatePredictionForRequest(*prediction_convreq_, segments,
+                                               &expected);
+  EXPECT_TRUE(expected_types & REALTIME);
+  EXPECT_TRUE(expected_types & UNIGRAM);
+  EXPECT_TRUE(expected_types & PREFIX);
+  EXPECT_TRUE(expected_types & SINGLE_KANJI);
+
+  // The steps run concurrently, but the results are merged in the same order.
+  ThreadPool pool(2);
+  SetPredictionThreadPoolForTesting(&pool);
+  for (int trial = 0; trial < 10; ++trial) {
+    std::vector<Result> results;
+    EXPECT_EQ(aggregator.AggregatePredictionForRequest(*prediction_convreq_,
+                                                       segments, &results),
+              expected_types);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].key, expected[i].key);
+      EXPECT_EQ(results[i].value, expected[i].value);
+      EXPECT_EQ(results[i].types, expected[i].types);
+    }
+  }
+  SetPredictionThreadPoolForTesting(nullptr);
+}
+
 }  // namespace
 }  // namespace prediction
 }  // namespace mozc
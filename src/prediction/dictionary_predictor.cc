@@ -59,6 +59,7 @@
 #include "protocol/commands.pb.h"
 #include "request/conversion_request.h"
 #include "transliteration/transliteration.h"
+#include "usage_stats/latency_stats.h"
 #include "usage_stats/usage_stats.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -292,8 +293,15 @@ bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
   // conversion, meaning that results may include the candidates whose
   // key is exactly the same as the composition.  This mode is used in mobile.
   const bool is_mixed_conversion = IsMixedConversionEnabled(request.request());
-  std::vector<Result> results =
-      aggregator_->AggregateResults(request, *segments);
+  static const usage_stats::LatencyStats::StageId kAggregateStage =
+      usage_stats::LatencyStats::RegisterStage(
+          "DictionaryPredictor.AggregateResults");
+  std::vector<Result> results;
+  {
+    usage_stats::ScopedLatencyRecorder recorder(kAggregateStage);
+    results = aggregator_->AggregateResultsWithLattice(
+        request, *segments, segments->mutable_cached_lattice_handle());
+  }
   if (results.empty()) {
     return false;
   }
@@ -56,6 +56,9 @@ ABSL_FLAG(std::string, safe_list_files, "",
           "Comma separated files that contain safe word list. If specified, "
           "retries filter generation with different parameters until these "
           "words will not be filtered.");
+ABSL_FLAG(bool, blocked_filter, true,
+          "uses the blocked layout of the existence filter, which reads one "
+          "cache line per lookup");
 
 namespace {
 using mozc::storage::ExistenceFilter;
@@ -91,12 +94,17 @@ void ReadSafeWords(const absl::string_view safe_list_files,
 
 constexpr size_t kMinimumFilterBytes = 100 * 1000;
 
+ExistenceFilter::Layout GetLayout() {
+  return absl::GetFlag(FLAGS_blocked_filter) ? ExistenceFilter::BLOCKED
+                                             : ExistenceFilter::CLASSIC;
+}
+
 ExistenceFilter GetFilter(const size_t num_bytes,
                           const std::vector<uint64_t> &hash_list) {
   LOG(INFO) << "num_bytes: " << num_bytes;
 
-  ExistenceFilter filter(
-      ExistenceFilter::CreateOptimal(num_bytes, hash_list.size()));
+  ExistenceFilter filter(ExistenceFilter::CreateOptimal(
+      num_bytes, hash_list.size(), GetLayout()));
   for (size_t i = 0; i < hash_list.size(); ++i) {
     filter.Insert(hash_list[i]);
   }
@@ -119,10 +127,11 @@ ExistenceFilter SetupFilter(const size_t num_bytes,
                             const std::vector<uint64_t> &hash_list,
                             const std::vector<std::string> &safe_word_list) {
   constexpr int kNumRetryMax = 10;
-  constexpr int kSizeOffset = 8;
+  // The blocked filter is rounded up to 64 bytes, so it grows by a block.
+  const int size_offset = GetLayout() == ExistenceFilter::BLOCKED ? 64 : 8;
   // Prevent filtering of common words by false positive.
   for (int i = 0; i < kNumRetryMax; ++i) {
-    ExistenceFilter filter = GetFilter(num_bytes + i * kSizeOffset, hash_list);
+    ExistenceFilter filter = GetFilter(num_bytes + i * size_offset, hash_list);
     if (TestFilter(filter, safe_word_list)) {
       return filter;
     }
@@ -153,7 +162,7 @@ int main(int argc, char **argv) {
   static constexpr float kErrorRate = 0.00001;
   const size_t num_bytes =
       std::max(ExistenceFilter::MinFilterSizeInBytesForErrorRate(
-                   kErrorRate, hash_list.size()),
+                   kErrorRate, hash_list.size(), GetLayout()),
                kMinimumFilterBytes);
 
   std::vector<std::string> safe_word_list;
@@ -41,6 +41,7 @@
         'dictionary_predictor.cc',
         'dictionary_prediction_aggregator.cc',
         'number_decoder.cc',
+        'prediction_thread_pool.cc',
         'predictor.cc',
         'result.cc',
         'single_kanji_prediction_aggregator.cc',
@@ -30,6 +30,7 @@
 #ifndef MOZC_PREDICTION_PREDICTION_AGGREGATOR_INTERFACE_H_
 #define MOZC_PREDICTION_PREDICTION_AGGREGATOR_INTERFACE_H_
 
+#include <memory>
 #include <vector>
 
 #include "converter/segments.h"
@@ -51,6 +52,14 @@ class PredictionAggregatorInterface {
   virtual std::vector<Result> AggregateResults(
       const ConversionRequest &request, const Segments &segments) const = 0;
 
+  // Same as AggregateResults(), but the realtime conversion may reuse
+  // `lattice`, the cached lattice taken from the caller's mutable Segments.
+  virtual std::vector<Result> AggregateResultsWithLattice(
+      const ConversionRequest &request, const Segments &segments,
+      std::shared_ptr<Lattice> lattice) const {
+    return AggregateResults(request, segments);
+  }
+
  protected:
   PredictionAggregatorInterface() = default;
 };
@@ -0,0 +1,89 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/prediction_thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "base/thread_pool.h"
+#include "composer/composer.h"
+#include "request/conversion_request.h"
+#include "absl/flags/flag.h"
+#include "absl/types/span.h"
+
+ABSL_FLAG(int32_t, prediction_threads, 0,
+          "Number of worker threads to run the independent prediction steps "
+          "concurrently.  0 runs them sequentially.");
+
+namespace mozc {
+namespace prediction {
+namespace {
+
+std::atomic<ThreadPool *> g_pool_for_testing = nullptr;
+std::atomic<bool> g_pool_for_testing_is_set = false;
+
+}  // namespace
+
+ThreadPool *GetPredictionThreadPool() {
+  if (g_pool_for_testing_is_set.load(std::memory_order_acquire)) {
+    return g_pool_for_testing.load(std::memory_order_relaxed);
+  }
+  // Leaked on purpose, as the workers may be running at exit.
+  static ThreadPool *pool = [] {
+    const int32_t num_threads = absl::GetFlag(FLAGS_prediction_threads);
+    return num_threads > 0 ? new ThreadPool(num_threads) : nullptr;
+  }();
+  return pool;
+}
+
+void SetPredictionThreadPoolForTesting(ThreadPool *pool) {
+  g_pool_for_testing.store(pool, std::memory_order_relaxed);
+  g_pool_for_testing_is_set.store(true, std::memory_order_release);
+}
+
+void RunPredictionTasks(ThreadPool *pool, const ConversionRequest &request,
+                        absl::Span<const std::function<void()>> tasks) {
+  if (pool == nullptr || tasks.size() <= 1) {
+    for (const std::function<void()> &task : tasks) {
+      task();
+    }
+    return;
+  }
+  // Composer caches the length of each chunk on the first access even in the
+  // const methods.  Fill the cache here so that the tasks only read it.
+  if (request.has_composer()) {
+    request.composer().GetLength();
+  }
+  pool->RunAll(tasks);
+}
+
+}  // namespace prediction
+}  // namespace mozc
@@ -0,0 +1,59 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_PREDICTION_PREDICTION_THREAD_POOL_H_
+#define MOZC_PREDICTION_PREDICTION_THREAD_POOL_H_
+
+#include <functional>
+
+#include "base/thread_pool.h"
+#include "request/conversion_request.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace prediction {
+
+// Returns the thread pool on which independent prediction steps run
+// concurrently, or nullptr when they run sequentially.  The pool has
+// --prediction_threads worker threads and is disabled by default.
+ThreadPool *GetPredictionThreadPool();
+
+// Overrides the pool returned by GetPredictionThreadPool().  nullptr disables
+// the parallel execution.  The pool isn't owned.
+void SetPredictionThreadPoolForTesting(ThreadPool *pool);
+
+// Runs |tasks| on |pool|, or sequentially on the calling thread if |pool| is
+// nullptr.  The tasks may read |request| concurrently.
+void RunPredictionTasks(ThreadPool *pool, const ConversionRequest &request,
+                        absl::Span<const std::function<void()>> tasks);
+
+}  // namespace prediction
+}  // namespace mozc
+
+#endif  // MOZC_PREDICTION_PREDICTION_THREAD_POOL_H_
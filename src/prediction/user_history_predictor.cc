@@ -36,6 +36,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <set>
@@ -379,6 +380,42 @@ class UserHistoryPredictorSyncer : public Thread {
   RequestType type_;
 };
 
+void UserHistoryPredictor::KeyIndex::Touch(absl::string_view key,
+                                           uint32_t fp) {
+  index_[std::make_pair(std::string(key), fp)] = ++sequence_;
+}
+
+void UserHistoryPredictor::KeyIndex::Lookup(absl::string_view key,
+                                            std::vector<uint32_t> *fps) const {
+  DCHECK(fps);
+  std::vector<std::pair<uint64_t, uint32_t>> found;
+  std::string prefix;
+  // Keys which are prefixes of |key|.
+  for (size_t len = 1; len < key.size(); ++len) {
+    prefix.assign(key.data(), len);
+    for (auto it = index_.lower_bound(std::make_pair(prefix, 0u));
+         it != index_.end() && it->first.first == prefix; ++it) {
+      found.emplace_back(it->second, it->first.second);
+    }
+  }
+  // Keys which start with |key|.
+  prefix.assign(key.data(), key.size());
+  for (auto it = index_.lower_bound(std::make_pair(prefix, 0u));
+       it != index_.end() && absl::StartsWith(it->first.first, key); ++it) {
+    found.emplace_back(it->second, it->first.second);
+  }
+  std::sort(found.begin(), found.end(), std::greater<>());
+  fps->reserve(fps->size() + found.size());
+  for (const auto &[sequence, fp] : found) {
+    fps->push_back(fp);
+  }
+}
+
+void UserHistoryPredictor::KeyIndex::Clear() {
+  index_.clear();
+  sequence_ = 0;
+}
+
 UserHistoryPredictor::UserHistoryPredictor(
     const DictionaryInterface *dictionary, const PosMatcher *pos_matcher,
     const SuppressionDictionary *suppression_dictionary,
@@ -483,6 +520,7 @@ bool UserHistoryPredictor::Load() {
 
 bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
   dic_->Clear();
+  key_index_.Clear();
   for (const Entry &entry : history.GetProto().entries()) {
     // Workaround for b/116826494: Some garbled characters are suggested
     // from user history. This fiters such entries.
@@ -491,7 +529,9 @@ bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
                  << entry.Utf8DebugString();
       continue;
     }
-    dic_->Insert(EntryFingerprint(entry), entry);
+    const uint32_t fp = EntryFingerprint(entry);
+    dic_->Insert(fp, entry);
+    key_index_.Touch(entry.key(), fp);
   }
 
   VLOG(1) << "Loaded user history, size=" << history.GetProto().entries_size();
@@ -1334,36 +1374,76 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
 
   const uint64_t now = Clock::GetTime();
   int trial = 0;
-  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
-    if (!IsValidEntryIgnoringRemovedField(elm->value)) {
-      continue;
+  // Looks up |entry| and returns false if no more entries need to be looked
+  // up.
+  auto lookup = [&](const Entry &entry) {
+    if (!IsValidEntryIgnoringRemovedField(entry)) {
+      return true;
     }
-    if (elm->value.last_access_time() + k62DaysInSec < now) {
+    if (entry.last_access_time() + k62DaysInSec < now) {
       updated_ = true;  // We found an entry to be deleted at next save.
-      continue;
+      return true;
     }
     if (request.request_type() == ConversionRequest::SUGGESTION &&
         trial++ >= kMaxSuggestionTrial) {
       VLOG(2) << "too many trials";
-      break;
+      return false;
     }
 
     // Lookup key from elm_value and prev_entry.
     // If a new entry is found, the entry is pushed to the results.
     // TODO(team): make KanaFuzzyLookupEntry().
-    if (!LookupEntry(request_type, input_key, base_key, expanded.get(),
-                     &(elm->value), prev_entry, results) &&
-        !RomanFuzzyLookupEntry(roman_input_key, &(elm->value), results)) {
-      continue;
+    if (!LookupEntry(request_type, input_key, base_key, expanded.get(), &entry,
+                     prev_entry, results) &&
+        !RomanFuzzyLookupEntry(roman_input_key, &entry, results)) {
+      return true;
     }
 
     // already found enough results.
-    if (results->size() >= max_results_size) {
+    return results->size() < max_results_size;
+  };
+
+  // Entries can match the input only if their keys share a prefix with
+  // |base_key|, so only such entries are looked up with the key index, in the
+  // LRU order. The fuzzy match for misspelled roman input and the empty base
+  // key (zero query or ambiguous first character) can match any entry, so
+  // the whole LRU is scanned in that case.
+  if (roman_input_key.empty() && !base_key.empty()) {
+    std::vector<uint32_t> fps;
+    key_index_.Lookup(base_key, &fps);
+    for (const uint32_t fp : fps) {
+      const Entry *entry = dic_->LookupWithoutInsert(fp);
+      if (entry == nullptr) {
+        // Evicted or erased.
+        continue;
+      }
+      if (!lookup(*entry)) {
+        break;
+      }
+    }
+    // The expired entries are found from the tail of LRU.
+    const DicElement *tail = dic_->Tail();
+    if (tail != nullptr &&
+        tail->value.last_access_time() + k62DaysInSec < now) {
+      updated_ = true;
+    }
+    return;
+  }
+
+  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
+    if (!lookup(elm->value)) {
       break;
     }
   }
 }
 
+void UserHistoryPredictor::RebuildKeyIndex() {
+  key_index_.Clear();
+  for (const DicElement *elm = dic_->Tail(); elm != nullptr; elm = elm->prev) {
+    key_index_.Touch(elm->value.key(), elm->key);
+  }
+}
+
 // static
 void UserHistoryPredictor::GetInputKeyFromSegments(
     const ConversionRequest &request, const Segments &segments,
@@ -1621,6 +1701,13 @@ void UserHistoryPredictor::Insert(const absl::string_view key,
     return;
   }
 
+  key_index_.Touch(key, dic_key);
+  // The index keeps the keys evicted from |dic_|. Rebuild it when the stale
+  // keys get as many as the live ones.
+  if (key_index_.size() >= 2 * cache_size()) {
+    RebuildKeyIndex();
+  }
+
   Entry *entry = &(e->value);
   DCHECK(entry);
 
@@ -52,6 +52,7 @@
 #include "storage/encrypted_string_storage.h"
 #include "storage/lru_cache.h"
 #include "testing/gunit_prod.h"  // for FRIEND_TEST
+#include "absl/container/btree_map.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
@@ -221,6 +222,7 @@ class UserHistoryPredictor : public PredictorInterface {
 
   FRIEND_TEST(UserHistoryPredictorTest, UserHistoryPredictorTestSuggestion);
   FRIEND_TEST(UserHistoryPredictorTest, GetMatchTypeTest);
+  FRIEND_TEST(UserHistoryPredictorTest, KeyIndex);
   FRIEND_TEST(UserHistoryPredictorTest, Uint32ToStringTest);
   FRIEND_TEST(UserHistoryPredictorTest, GetScore);
   FRIEND_TEST(UserHistoryPredictorTest, IsValidEntry);
@@ -362,6 +364,35 @@ class UserHistoryPredictor : public PredictorInterface {
   typedef mozc::storage::LruCache<uint32_t, Entry> DicCache;
   typedef DicCache::Element DicElement;
 
+  // Secondary index over the keys of the entries in |dic_|, used to find the
+  // entries which can match the input without scanning the whole LRU.
+  // The index mirrors the LRU order with a sequence number updated whenever
+  // an entry is moved to the head of |dic_|. Entries evicted from or erased
+  // in |dic_| are not removed from the index; callers must check that the
+  // returned fingerprints are still in |dic_|.
+  class KeyIndex {
+   public:
+    KeyIndex() = default;
+
+    KeyIndex(const KeyIndex &) = delete;
+    KeyIndex &operator=(const KeyIndex &) = delete;
+
+    // Adds the entry of |key| and |fp| as the most recently used one.
+    void Touch(absl::string_view key, uint32_t fp);
+
+    // Appends the fingerprints of the entries whose key starts with |key| or
+    // is a non-empty prefix of |key| to |fps|, from the most recently used.
+    void Lookup(absl::string_view key, std::vector<uint32_t> *fps) const;
+
+    void Clear();
+    size_t size() const { return index_.size(); }
+
+   private:
+    // (key, fingerprint) => sequence number of the last access.
+    absl::btree_map<std::pair<std::string, uint32_t>, uint64_t> index_;
+    uint64_t sequence_ = 0;
+  };
+
   bool CheckSyncerAndDelete() const;
 
   // If |entry| is the target of prediction,
@@ -399,6 +430,9 @@ class UserHistoryPredictor : public PredictorInterface {
                                  const Entry &entry,
                                  EntryPriorityQueue *results) const;
 
+  // Rebuilds |key_index_| from |dic_|, dropping the stale keys.
+  void RebuildKeyIndex();
+
   void GetResultsFromHistoryDictionary(RequestType request_type,
                                        const ConversionRequest &request,
                                        const Segments &segments,
@@ -499,6 +533,7 @@ class UserHistoryPredictor : public PredictorInterface {
   bool content_word_learning_enabled_;
   mutable std::atomic<bool> updated_;
   std::unique_ptr<DicCache> dic_;
+  KeyIndex key_index_;
   mutable std::unique_ptr<UserHistoryPredictorSyncer> syncer_;
 };
 
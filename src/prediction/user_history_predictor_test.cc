@@ -68,6 +68,7 @@
 #include "absl/flags/flag.h"
 #include "absl/random/random.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -79,6 +80,7 @@ using ::mozc::commands::Request;
 using ::mozc::config::Config;
 using ::mozc::dictionary::MockDictionary;
 using ::mozc::dictionary::SuppressionDictionary;
+using ::testing::ElementsAre;
 
 }  // namespace
 
@@ -156,8 +158,9 @@ class UserHistoryPredictorTest : public ::testing::Test {
   static UserHistoryPredictor::Entry *InsertEntry(
       UserHistoryPredictor *predictor, const absl::string_view key,
       const absl::string_view value) {
-    UserHistoryPredictor::Entry *e =
-        &predictor->dic_->Insert(predictor->Fingerprint(key, value))->value;
+    const uint32_t fp = predictor->Fingerprint(key, value);
+    UserHistoryPredictor::Entry *e = &predictor->dic_->Insert(fp)->value;
+    predictor->key_index_.Touch(key, fp);
     e->set_key(std::string(key));
     e->set_value(std::string(value));
     e->set_removed(false);
@@ -1687,6 +1690,64 @@ TEST_F(UserHistoryPredictorTest, GetMatchTypeTest) {
             UserHistoryPredictor::RIGHT_PREFIX_MATCH);
 }
 
+TEST_F(UserHistoryPredictorTest, KeyIndex) {
+  UserHistoryPredictor::KeyIndex index;
+  index.Touch("foo", 1);
+  index.Touch("foobar", 2);
+  index.Touch("fo", 3);
+  index.Touch("bar", 4);
+  index.Touch("f", 5);
+  index.Touch("food", 6);
+  EXPECT_EQ(index.size(), 6);
+
+  {
+    std::vector<uint32_t> fps;
+    index.Lookup("foo", &fps);
+    EXPECT_THAT(fps, ElementsAre(6, 5, 3, 2, 1));
+  }
+  {
+    std::vector<uint32_t> fps;
+    index.Lookup("foob", &fps);
+    EXPECT_THAT(fps, ElementsAre(5, 3, 2, 1));
+  }
+  {
+    std::vector<uint32_t> fps;
+    index.Lookup("baz", &fps);
+    EXPECT_TRUE(fps.empty());
+  }
+
+  // Touching again moves the entry to the front.
+  index.Touch("foo", 1);
+  EXPECT_EQ(index.size(), 6);
+  {
+    std::vector<uint32_t> fps;
+    index.Lookup("foo", &fps);
+    EXPECT_THAT(fps, ElementsAre(1, 6, 5, 3, 2));
+  }
+
+  index.Clear();
+  EXPECT_EQ(index.size(), 0);
+  std::vector<uint32_t> fps;
+  index.Lookup("foo", &fps);
+  EXPECT_TRUE(fps.empty());
+}
+
+TEST_F(UserHistoryPredictorTest, SuggestOldEntryBehindManyEntries) {
+  ScopedClockMock clock(1, 0);
+
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  InsertEntry(predictor, "japanese", "Japanese")->set_last_access_time(1);
+  // More unrelated entries than the number of trials for suggestion.
+  for (int i = 0; i < 5000; ++i) {
+    InsertEntry(predictor, absl::StrCat("input", i), absl::StrCat("Input", i))
+        ->set_last_access_time(1);
+  }
+
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor, "japan", "Japanese"));
+  EXPECT_FALSE(IsSuggested(predictor, "japan", "Input0"));
+}
+
 TEST_F(UserHistoryPredictorTest, FingerPrintTest) {
   constexpr char kKey[] = "abc";
   constexpr char kValue[] = "ABC";
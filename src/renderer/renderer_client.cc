@@ -35,6 +35,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/logging.h"
@@ -71,7 +72,7 @@ constexpr size_t kMaxErrorTimes = 5;
 constexpr uint64_t kRetryIntervalTime = 30;  // 30 sec
 constexpr char kServiceName[] = "renderer";
 
-inline void CallCommand(IPCClientInterface *client,
+inline bool CallCommand(IPCClientInterface *client,
                         const commands::RendererCommand &command) {
   std::string buf;
   command.SerializeToString(&buf);
@@ -81,7 +82,9 @@ inline void CallCommand(IPCClientInterface *client,
 
   if (!client->Call(buf, &result, kIpcTimeout)) {
     LOG(ERROR) << "Cannot send the request: ";
+    return false;
   }
+  return true;
 }
 }  // namespace
 
@@ -351,6 +354,21 @@ RendererClient::RendererClient()
 }
 
 RendererClient::~RendererClient() {
+  if (async_thread_.has_value()) {
+    {
+      absl::MutexLock l(&async_mu_);
+      async_quit_ = true;
+    }
+    // The sender thread sends all the queued commands before it quits.
+    async_thread_->Join();
+    async_thread_.reset();
+    const AsyncStats stats = GetAsyncStats();
+    LOG(INFO) << "Renderer async update: sent=" << stats.sent
+              << " coalesced=" << stats.coalesced
+              << " pending=" << stats.pending
+              << " discarded=" << stats.discarded
+              << " failed=" << stats.failed;
+  }
   if (!IsAvailable() || !is_window_visible_) {
     return;
   }
@@ -426,15 +444,95 @@ void RendererClient::set_suppress_error_dialog(bool suppress) {
   renderer_launcher_interface_->set_suppress_error_dialog(suppress);
 }
 
+void RendererClient::EnableAsyncUpdate() {
+  if (async_thread_.has_value()) {
+    return;
+  }
+  async_thread_.emplace([this] { AsyncUpdateThreadMain(); });
+}
+
+void RendererClient::WaitForAsyncUpdate() const {
+  absl::MutexLock l(&async_mu_);
+  async_mu_.Await(absl::Condition(this, &RendererClient::IsAsyncQueueIdle));
+}
+
+RendererClient::AsyncStats RendererClient::GetAsyncStats() const {
+  absl::MutexLock l(&async_mu_);
+  return async_stats_;
+}
+
+bool RendererClient::HasAsyncCommandOrQuit() const {
+  return async_quit_ || !async_queue_.empty();
+}
+
+bool RendererClient::IsAsyncQueueIdle() const {
+  return async_queue_.empty() && !async_sending_;
+}
+
+void RendererClient::AsyncUpdateThreadMain() {
+  while (true) {
+    commands::RendererCommand command;
+    {
+      absl::MutexLock l(&async_mu_);
+      async_mu_.Await(
+          absl::Condition(this, &RendererClient::HasAsyncCommandOrQuit));
+      if (async_queue_.empty()) {
+        // Quit and no more command.
+        return;
+      }
+      command = std::move(async_queue_.front());
+      async_queue_.pop_front();
+      async_sending_ = true;
+    }
+    const ExecStatus status = ExecCommandInternal(command);
+    absl::MutexLock l(&async_mu_);
+    async_sending_ = false;
+    switch (status) {
+      case ExecStatus::kSent:
+        ++async_stats_.sent;
+        break;
+      case ExecStatus::kPending:
+        ++async_stats_.pending;
+        break;
+      case ExecStatus::kDiscarded:
+        ++async_stats_.discarded;
+        break;
+      case ExecStatus::kFailed:
+        ++async_stats_.failed;
+        break;
+    }
+  }
+}
+
 bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
+  if (!async_thread_.has_value()) {
+    return ExecCommandInternal(command) != ExecStatus::kFailed;
+  }
+
+  absl::MutexLock l(&async_mu_);
+  // Only the latest UPDATE matters to the renderer. Overwrite the one which
+  // has not been sent yet instead of queuing a stale frame.
+  if (command.type() == commands::RendererCommand::UPDATE &&
+      !async_queue_.empty() &&
+      async_queue_.back().type() == commands::RendererCommand::UPDATE) {
+    async_queue_.back() = command;
+    ++async_stats_.coalesced;
+    return true;
+  }
+  async_queue_.push_back(command);
+  return true;
+}
+
+RendererClient::ExecStatus RendererClient::ExecCommandInternal(
+    const commands::RendererCommand &command) {
   if (renderer_launcher_interface_ == nullptr) {
     LOG(ERROR) << "RendererLauncher is nullptr";
-    return false;
+    return ExecStatus::kFailed;
   }
 
   if (ipc_client_factory_interface_ == nullptr) {
     LOG(ERROR) << "IPCClientFactory is nullptr";
-    return false;
+    return ExecStatus::kFailed;
   }
 
   if (!renderer_launcher_interface_->CanConnect()) {
@@ -443,14 +541,14 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     // after SetPendingCommand().
     if (!renderer_launcher_interface_->CanConnect()) {
       VLOG(1) << "renderer_launcher::CanConnect() return false";
-      return true;
+      return ExecStatus::kPending;
     }
   }
 
   // Drop the current request if version mismatch happens.
   constexpr int kMaxVersionMismatchNums = 3;
   if (version_mismatch_nums_ >= kMaxVersionMismatchNums) {
-    return true;
+    return ExecStatus::kDiscarded;
   }
 
   VLOG(2) << "Sending: " << MOZC_LOG_PROTOBUF(command);
@@ -461,7 +559,7 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
   // checked here.  See also b/3264926.
   // TODO(yukawa): Check any other error.
   if (client->GetLastIPCError() == IPC_TIMEOUT_ERROR) {
-    return false;
+    return ExecStatus::kFailed;
   }
 
   is_window_visible_ = command.visible();
@@ -472,14 +570,14 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
         (!is_window_visible_ || !command.has_output())) {
       LOG(WARNING) << "Discards a HIDE command since the "
                    << "renderer is not running";
-      return true;
+      return ExecStatus::kDiscarded;
     }
     LOG(WARNING) << "cannot connect to renderer. restarting";
     renderer_launcher_interface_->SetPendingCommand(command);
     renderer_launcher_interface_->StartRenderer(name_, renderer_path_,
                                                 disable_renderer_path_check_,
                                                 ipc_client_factory_interface_);
-    return true;
+    return ExecStatus::kPending;
   }
 
   if (IPC_PROTOCOL_VERSION > client->GetServerProtocolVersion()) {
@@ -491,14 +589,14 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     }
     ++version_mismatch_nums_;
     renderer_launcher_interface_->SetPendingCommand(command);
-    return true;
+    return ExecStatus::kPending;
   } else if (IPC_PROTOCOL_VERSION < client->GetServerProtocolVersion()) {
     version_mismatch_nums_ = INT_MAX;
     renderer_launcher_interface_->OnFatal(
         RendererLauncherInterface::RENDERER_VERSION_MISMATCH);
     LOG(ERROR) << "client protocol version is older than "
                << "renderer protocol version.";
-    return true;
+    return ExecStatus::kDiscarded;
   }
 
   if (Version::CompareVersion(client->GetServerProductVersion(),
@@ -510,12 +608,13 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     shutdown_command.set_type(commands::RendererCommand::SHUTDOWN);
     CallCommand(client.get(), shutdown_command);
     ++version_mismatch_nums_;
-    return true;
+    return ExecStatus::kPending;
   }
 
-  CallCommand(client.get(), command);
-
-  return true;
+  if (!CallCommand(client.get(), command)) {
+    return ExecStatus::kFailed;
+  }
+  return ExecStatus::kSent;
 }
 
 IPCClientInterface *RendererClient::CreateIPCClient() const {
@@ -30,12 +30,18 @@
 #ifndef MOZC_RENDERER_RENDERER_CLIENT_H_
 #define MOZC_RENDERER_RENDERER_CLIENT_H_
 
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <optional>
 #include <string>
 
+#include "base/thread2.h"
 #include "ipc/ipc.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 
@@ -77,6 +83,22 @@ class RendererLauncherInterface {
 // IPC-based client for out-proc renderer.
 class RendererClient : public RendererInterface {
  public:
+  // Counters of the asynchronous update channel.
+  struct AsyncStats {
+    // Number of commands passed to the renderer by the sender thread.
+    uint64_t sent = 0;
+    // Number of UPDATE commands replaced by a newer one before being sent.
+    uint64_t coalesced = 0;
+    // Number of commands left to the launcher, which sends only the latest
+    // one after the renderer starts.
+    uint64_t pending = 0;
+    // Number of commands discarded on purpose, e.g. a HIDE while the renderer
+    // is not running, or any command after the version mismatches.
+    uint64_t discarded = 0;
+    // Number of commands which could not be sent because of an error.
+    uint64_t failed = 0;
+  };
+
   RendererClient();
   ~RendererClient() override;
 
@@ -107,8 +129,26 @@ class RendererClient : public RendererInterface {
   // Otherwise command::RendererCommand::SHUDDOWN is used.
   bool Shutdown(bool force);
 
+  // Sends |command| to the renderer. When the asynchronous update channel is
+  // enabled, |command| is only queued and true is returned immediately.
   bool ExecCommand(const commands::RendererCommand &command) override;
 
+  // Starts a dedicated thread which sends the commands to the renderer, so
+  // that ExecCommand() never blocks the caller on the IPC. An UPDATE command
+  // still waiting in the queue is overwritten by the next UPDATE, as the
+  // renderer only needs to draw the latest state of its windows. NOOP and
+  // SHUTDOWN commands are never coalesced.
+  // Call this before the client is used from the other threads.
+  void EnableAsyncUpdate();
+
+  // Blocks until all the queued commands are handed to the renderer.
+  // Does nothing when the asynchronous update channel is disabled.
+  void WaitForAsyncUpdate() const;
+
+  // Returns the counters of the asynchronous update channel. They are also
+  // logged when the client is destroyed.
+  AsyncStats GetAsyncStats() const;
+
   // Don't check the renderer server path.
   // DO NOT call it except for testing
   void DisableRendererServerCheck();
@@ -117,7 +157,20 @@ class RendererClient : public RendererInterface {
   void set_suppress_error_dialog(bool suppress);
 
  private:
+  // The outcome of sending a command.
+  enum class ExecStatus {
+    kSent,
+    // Handed to the launcher with SetPendingCommand().
+    kPending,
+    kDiscarded,
+    kFailed,
+  };
+
   IPCClientInterface *CreateIPCClient() const;
+  ExecStatus ExecCommandInternal(const commands::RendererCommand &command);
+  void AsyncUpdateThreadMain();
+  bool HasAsyncCommandOrQuit() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(async_mu_);
+  bool IsAsyncQueueIdle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(async_mu_);
 
   bool is_window_visible_;
   bool disable_renderer_path_check_;
@@ -129,6 +182,14 @@ class RendererClient : public RendererInterface {
 
   std::unique_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  mutable absl::Mutex async_mu_;
+  std::deque<commands::RendererCommand> async_queue_ ABSL_GUARDED_BY(async_mu_);
+  // True while the sender thread is sending a command popped from the queue.
+  bool async_sending_ ABSL_GUARDED_BY(async_mu_) = false;
+  bool async_quit_ ABSL_GUARDED_BY(async_mu_) = false;
+  AsyncStats async_stats_ ABSL_GUARDED_BY(async_mu_);
+  std::optional<Thread2> async_thread_;
 };
 
 }  // namespace renderer
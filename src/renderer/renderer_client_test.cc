@@ -45,6 +45,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 
 namespace mozc {
@@ -66,6 +67,10 @@ int g_counter = 0;
 bool g_connected = false;
 uint32_t g_server_protocol_version = IPC_PROTOCOL_VERSION;
 std::string g_server_product_version;
+// When set, Call() notifies |g_call_started| and then blocks until
+// |g_call_released| is notified.
+absl::Notification *g_call_started = nullptr;
+absl::Notification *g_call_released = nullptr;
 
 class TestIPCClient : public IPCClientInterface {
  public:
@@ -88,6 +93,12 @@ class TestIPCClient : public IPCClientInterface {
   bool Call(const std::string &request, std::string *response,
             absl::Duration timeout) override {
     g_counter++;
+    if (g_call_started != nullptr && !g_call_started->HasBeenNotified()) {
+      g_call_started->Notify();
+    }
+    if (g_call_released != nullptr) {
+      g_call_released->WaitForNotification();
+    }
     return true;
   }
 
@@ -568,5 +579,116 @@ TEST(RendererClient, SetPendingCommandTest) {
     EXPECT_FALSE(launcher.is_set_pending_command_called());
   }
 }
+
+TEST(RendererClient, AsyncUpdateTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.EnableAsyncUpdate();
+
+  launcher.set_available(false);
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::set_server_protocol_version(IPC_PROTOCOL_VERSION);
+  TestIPCClient::Reset();
+
+  absl::Notification call_started;
+  absl::Notification call_released;
+  g_call_started = &call_started;
+  g_call_released = &call_released;
+
+  commands::RendererCommand update;
+  update.set_type(commands::RendererCommand::UPDATE);
+  update.set_visible(true);
+  commands::RendererCommand noop;
+  noop.set_type(commands::RendererCommand::NOOP);
+
+  // The sender thread is blocked in the IPC call of the first command.
+  EXPECT_TRUE(client.ExecCommand(update));
+  call_started.WaitForNotification();
+
+  // Pending UPDATEs are coalesced into the latest one, but not across NOOP.
+  EXPECT_TRUE(client.ExecCommand(update));
+  EXPECT_TRUE(client.ExecCommand(update));
+  EXPECT_TRUE(client.ExecCommand(update));
+  EXPECT_TRUE(client.ExecCommand(noop));
+  EXPECT_TRUE(client.ExecCommand(update));
+
+  call_released.Notify();
+  client.WaitForAsyncUpdate();
+  g_call_started = nullptr;
+  g_call_released = nullptr;
+
+  EXPECT_EQ(TestIPCClient::counter(), 4);
+  const RendererClient::AsyncStats stats = client.GetAsyncStats();
+  EXPECT_EQ(stats.sent, 4);
+  EXPECT_EQ(stats.coalesced, 2);
+  EXPECT_EQ(stats.pending, 0);
+  EXPECT_EQ(stats.discarded, 0);
+  EXPECT_EQ(stats.failed, 0);
+}
+
+TEST(RendererClient, AsyncUpdateFailedTest) {
+  RendererClient client;
+
+  client.SetIPCClientFactory(nullptr);
+  client.SetRendererLauncherInterface(nullptr);
+  client.EnableAsyncUpdate();
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::NOOP);
+
+  // The command is queued, but cannot be delivered.
+  EXPECT_TRUE(client.ExecCommand(command));
+  client.WaitForAsyncUpdate();
+
+  const RendererClient::AsyncStats stats = client.GetAsyncStats();
+  EXPECT_EQ(stats.sent, 0);
+  EXPECT_EQ(stats.coalesced, 0);
+  EXPECT_EQ(stats.failed, 1);
+}
+
+TEST(RendererClient, AsyncUpdateNotSentTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.EnableAsyncUpdate();
+
+  TestIPCClient::set_server_protocol_version(IPC_PROTOCOL_VERSION);
+  TestIPCClient::Reset();
+
+  commands::RendererCommand hide;
+  hide.set_type(commands::RendererCommand::UPDATE);
+  hide.set_visible(false);
+  commands::RendererCommand noop;
+  noop.set_type(commands::RendererCommand::NOOP);
+
+  // HIDE is not worth launching the renderer.
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(false);
+  EXPECT_TRUE(client.ExecCommand(hide));
+  client.WaitForAsyncUpdate();
+
+  // The launcher keeps the command until the renderer gets ready.
+  launcher.set_can_connect(false);
+  EXPECT_TRUE(client.ExecCommand(noop));
+  client.WaitForAsyncUpdate();
+
+  EXPECT_EQ(TestIPCClient::counter(), 0);
+  const RendererClient::AsyncStats stats = client.GetAsyncStats();
+  EXPECT_EQ(stats.sent, 0);
+  EXPECT_EQ(stats.pending, 1);
+  EXPECT_EQ(stats.discarded, 1);
+  EXPECT_EQ(stats.failed, 0);
+}
+
 }  // namespace renderer
 }  // namespace mozc
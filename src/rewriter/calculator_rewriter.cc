@@ -60,6 +60,14 @@ int CalculatorRewriter::capability(const ConversionRequest &request) const {
   return RewriterInterface::CONVERSION;
 }
 
+RewriterInterface::Trigger CalculatorRewriter::trigger() const {
+  // "1+1=" or "=1+1".  Keys are normalized to half width by the calculator.
+  Trigger result;
+  result.required_script_types = ScriptTypeBit(Util::NUMBER) |
+                                 ScriptTypeBit(Util::UNKNOWN_SCRIPT);  // '='
+  return result;
+}
+
 // Rewrites candidates when conversion segments of |segments| represents an
 // expression that can be calculated. In such case, if |segments| consists
 // of multiple segments, it merges them by calling ConverterInterface::
@@ -50,6 +50,8 @@ class CalculatorRewriter : public RewriterInterface {
 
   int capability(const ConversionRequest &request) const override;
 
+  Trigger trigger() const override;
+
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
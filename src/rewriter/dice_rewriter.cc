@@ -33,6 +33,7 @@
 #include <string>
 
 #include "base/logging.h"
+#include "base/util.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 #include "absl/random/random.h"
@@ -86,6 +87,14 @@ DiceRewriter::DiceRewriter() = default;
 
 DiceRewriter::~DiceRewriter() = default;
 
+RewriterInterface::Trigger DiceRewriter::trigger() const {
+  // "さいころ".
+  Trigger result;
+  result.required_script_types = ScriptTypeBit(Util::HIRAGANA);
+  result.max_conversion_segments = 1;
+  return result;
+}
+
 bool DiceRewriter::Rewrite(const ConversionRequest &request,
                            Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
@@ -43,6 +43,8 @@ class DiceRewriter : public RewriterInterface {
   DiceRewriter();
   ~DiceRewriter() override;
 
+  Trigger trigger() const override;
+
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
@@ -38,6 +38,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/util.h"
 #include "converter/segments.h"
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/commands.pb.h"
@@ -236,6 +237,13 @@ int EmoticonRewriter::capability(const ConversionRequest &request) const {
   return RewriterInterface::CONVERSION;
 }
 
+RewriterInterface::Trigger EmoticonRewriter::trigger() const {
+  // All the keys of the emoticon dictionary are written in Hiragana.
+  Trigger result;
+  result.required_script_types = ScriptTypeBit(Util::HIRAGANA);
+  return result;
+}
+
 bool EmoticonRewriter::Rewrite(const ConversionRequest &request,
                                Segments *segments) const {
   if (!request.config().use_emoticon_conversion()) {
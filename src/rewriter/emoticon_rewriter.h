@@ -54,6 +54,8 @@ class EmoticonRewriter : public RewriterInterface {
 
   int capability(const ConversionRequest &request) const override;
 
+  Trigger trigger() const override;
+
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
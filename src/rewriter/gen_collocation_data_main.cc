@@ -47,12 +47,16 @@
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "rewriter/gen_existence_data.h"
+#include "storage/existence_filter.h"
 #include "absl/flags/flag.h"
 
 ABSL_FLAG(std::string, collocation_data, "", "collocation data text");
 ABSL_FLAG(std::string, output, "", "output file name (default: stdout)");
 ABSL_FLAG(double, error_rate, 0.00001, "error rate");
 ABSL_FLAG(bool, binary_mode, false, "outputs binary file");
+ABSL_FLAG(bool, blocked_filter, true,
+          "uses the blocked layout of the existence filter, which reads one "
+          "cache line per lookup");
 
 namespace mozc {
 namespace {
@@ -78,12 +82,16 @@ void Convert() {
     }
   }
 
+  const storage::ExistenceFilter::Layout layout =
+      absl::GetFlag(FLAGS_blocked_filter) ? storage::ExistenceFilter::BLOCKED
+                                          : storage::ExistenceFilter::CLASSIC;
   if (absl::GetFlag(FLAGS_binary_mode)) {
-    OutputExistenceBinary(entries, ofs, absl::GetFlag(FLAGS_error_rate));
+    OutputExistenceBinary(entries, ofs, absl::GetFlag(FLAGS_error_rate),
+                          layout);
   } else {
     const std::string kNameSpace = "CollocationData";
     OutputExistenceHeader(entries, kNameSpace, ofs,
-                          absl::GetFlag(FLAGS_error_rate));
+                          absl::GetFlag(FLAGS_error_rate), layout);
   }
 
   if (ofs != &std::cout) {
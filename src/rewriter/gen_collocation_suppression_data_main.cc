@@ -51,6 +51,7 @@
 #include "base/logging.h"
 #include "base/util.h"
 #include "rewriter/gen_existence_data.h"
+#include "storage/existence_filter.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/str_split.h"
 
@@ -58,6 +59,9 @@ ABSL_FLAG(std::string, suppression_data, "", "suppression data text");
 ABSL_FLAG(std::string, output, "", "output file name (default: stdout)");
 ABSL_FLAG(double, error_rate, 0.00001, "error rate");
 ABSL_FLAG(bool, binary_mode, false, "outputs binary file");
+ABSL_FLAG(bool, blocked_filter, true,
+          "uses the blocked layout of the existence filter, which reads one "
+          "cache line per lookup");
 
 namespace mozc {
 namespace {
@@ -94,12 +98,16 @@ void Convert() {
     }
   }
 
+  const storage::ExistenceFilter::Layout layout =
+      absl::GetFlag(FLAGS_blocked_filter) ? storage::ExistenceFilter::BLOCKED
+                                          : storage::ExistenceFilter::CLASSIC;
   if (absl::GetFlag(FLAGS_binary_mode)) {
-    OutputExistenceBinary(entries, ofs, absl::GetFlag(FLAGS_error_rate));
+    OutputExistenceBinary(entries, ofs, absl::GetFlag(FLAGS_error_rate),
+                          layout);
   } else {
     const std::string kNameSpace = "CollocationSuppressionData";
     OutputExistenceHeader(entries, kNameSpace, ofs,
-                          absl::GetFlag(FLAGS_error_rate));
+                          absl::GetFlag(FLAGS_error_rate), layout);
   }
 
   if (ofs != &std::cout) {
@@ -50,13 +50,14 @@ namespace {
 using storage::ExistenceFilter;
 
 std::string GenExistenceData(const std::vector<std::string> &entries,
-                             double error_rate) {
+                             double error_rate,
+                             ExistenceFilter::Layout layout) {
   const int n = entries.size();
   const int m =
-      ExistenceFilter::MinFilterSizeInBytesForErrorRate(error_rate, n);
+      ExistenceFilter::MinFilterSizeInBytesForErrorRate(error_rate, n, layout);
   LOG(INFO) << "entry: " << n << " err: " << error_rate << " bytes: " << m;
 
-  ExistenceFilter filter(ExistenceFilter::CreateOptimal(m, n));
+  ExistenceFilter filter(ExistenceFilter::CreateOptimal(m, n, layout));
 
   for (const std::string &entry : entries) {
     const uint64_t id = Hash::Fingerprint(entry);
@@ -69,8 +70,10 @@ std::string GenExistenceData(const std::vector<std::string> &entries,
 
 void OutputExistenceHeader(const std::vector<std::string> &entries,
                            const absl::string_view data_namespace,
-                           std::ostream *ofs, double error_rate) {
-  const std::string existence_data = GenExistenceData(entries, error_rate);
+                           std::ostream *ofs, double error_rate,
+                           ExistenceFilter::Layout layout) {
+  const std::string existence_data =
+      GenExistenceData(entries, error_rate, layout);
 
   *ofs << "// This header file is generated by "
        << "gen_existence_data." << std::endl;
@@ -86,8 +89,10 @@ void OutputExistenceHeader(const std::vector<std::string> &entries,
 }
 
 void OutputExistenceBinary(const std::vector<std::string> &entries,
-                           std::ostream *ofs, double error_rate) {
-  const std::string existence_data = GenExistenceData(entries, error_rate);
+                           std::ostream *ofs, double error_rate,
+                           ExistenceFilter::Layout layout) {
+  const std::string existence_data =
+      GenExistenceData(entries, error_rate, layout);
   ofs->write(existence_data.data(), existence_data.size());
 }
 }  // namespace mozc
@@ -35,15 +35,18 @@
 #include <string>
 #include <vector>
 
+#include "storage/existence_filter.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
 
 void OutputExistenceHeader(const std::vector<std::string> &entries,
                            absl::string_view data_namespace, std::ostream *ofs,
-                           double error_rate);
+                           double error_rate,
+                           storage::ExistenceFilter::Layout layout);
 void OutputExistenceBinary(const std::vector<std::string> &entries,
-                           std::ostream *ofs, double error_rate);
+                           std::ostream *ofs, double error_rate,
+                           storage::ExistenceFilter::Layout layout);
 
 }  // namespace mozc
 
@@ -0,0 +1,95 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "absl/base/call_once.h"
+
+namespace mozc {
+
+RewriterInterface *LazyRewriter::GetOrCreate() const {
+  absl::call_once(once_, [this] {
+    rewriter_ = factory_();
+    constructed_.store(true, std::memory_order_release);
+  });
+  return rewriter_.get();
+}
+
+int LazyRewriter::capability(const ConversionRequest &request) const {
+  if (!is_enabled_(request)) {
+    return NOT_AVAILABLE;
+  }
+  return GetOrCreate()->capability(request);
+}
+
+bool LazyRewriter::Rewrite(const ConversionRequest &request,
+                           Segments *segments) const {
+  if (!is_enabled_(request)) {
+    return false;
+  }
+  return GetOrCreate()->Rewrite(request, segments);
+}
+
+bool LazyRewriter::Focus(Segments *segments, size_t segment_index,
+                         int candidate_index) const {
+  RewriterInterface *rewriter = GetIfConstructed();
+  return rewriter == nullptr ||
+         rewriter->Focus(segments, segment_index, candidate_index);
+}
+
+void LazyRewriter::Finish(const ConversionRequest &request,
+                          Segments *segments) {
+  if (RewriterInterface *rewriter = GetIfConstructed(); rewriter != nullptr) {
+    rewriter->Finish(request, segments);
+  }
+}
+
+bool LazyRewriter::Sync() {
+  RewriterInterface *rewriter = GetIfConstructed();
+  return rewriter == nullptr || rewriter->Sync();
+}
+
+bool LazyRewriter::Reload() {
+  RewriterInterface *rewriter = GetIfConstructed();
+  return rewriter == nullptr || rewriter->Reload();
+}
+
+void LazyRewriter::Clear() {
+  if (RewriterInterface *rewriter = GetIfConstructed(); rewriter != nullptr) {
+    rewriter->Clear();
+  }
+}
+
+}  // namespace mozc
@@ -0,0 +1,91 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_REWRITER_LAZY_REWRITER_H_
+#define MOZC_REWRITER_LAZY_REWRITER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "absl/base/call_once.h"
+
+namespace mozc {
+
+// Defers the construction of a rarely used rewriter until a request needs it,
+// so that the rewriter doesn't slow down the engine start-up.  |is_enabled| is
+// a cheap check on the request (e.g. a config option for the rewriter); the
+// rewriter is not constructed while it returns false.  Focus(), Finish() and
+// the other hooks are forwarded only after the construction.
+class LazyRewriter : public RewriterInterface {
+ public:
+  using Factory = std::function<std::unique_ptr<RewriterInterface>()>;
+  using IsEnabled = std::function<bool(const ConversionRequest &)>;
+
+  LazyRewriter(Factory factory, IsEnabled is_enabled)
+      : factory_(std::move(factory)), is_enabled_(std::move(is_enabled)) {}
+
+  int capability(const ConversionRequest &request) const override;
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override;
+  bool Focus(Segments *segments, size_t segment_index,
+             int candidate_index) const override;
+  void Finish(const ConversionRequest &request, Segments *segments) override;
+  bool Sync() override;
+  bool Reload() override;
+  void Clear() override;
+
+  // Returns true if the rewriter has been constructed.
+  bool constructed() const {
+    return constructed_.load(std::memory_order_acquire);
+  }
+
+ private:
+  // Constructs the rewriter on the first call.
+  RewriterInterface *GetOrCreate() const;
+  // Returns the rewriter if it has been constructed, or nullptr.
+  RewriterInterface *GetIfConstructed() const {
+    return constructed() ? rewriter_.get() : nullptr;
+  }
+
+  const Factory factory_;
+  const IsEnabled is_enabled_;
+  mutable absl::once_flag once_;
+  mutable std::unique_ptr<RewriterInterface> rewriter_;
+  mutable std::atomic<bool> constructed_ = false;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_LAZY_REWRITER_H_
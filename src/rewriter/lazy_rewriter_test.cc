@@ -0,0 +1,120 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <memory>
+
+#include "converter/segments.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+class CountingRewriter : public RewriterInterface {
+ public:
+  explicit CountingRewriter(int *finish_count) : finish_count_(finish_count) {}
+
+  int capability(const ConversionRequest &request) const override {
+    return PREDICTION;
+  }
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    segments->add_segment()->set_key("rewritten");
+    return true;
+  }
+
+  void Finish(const ConversionRequest &request, Segments *segments) override {
+    ++*finish_count_;
+  }
+
+ private:
+  int *finish_count_;
+};
+
+class LazyRewriterTest : public ::testing::Test {
+ protected:
+  LazyRewriterTest()
+      : rewriter_(
+            [this] {
+              ++construct_count_;
+              return std::make_unique<CountingRewriter>(&finish_count_);
+            },
+            [](const ConversionRequest &request) {
+              return request.config().use_emoji_conversion();
+            }) {}
+
+  int construct_count_ = 0;
+  int finish_count_ = 0;
+  LazyRewriter rewriter_;
+};
+
+TEST_F(LazyRewriterTest, NotConstructedWhileDisabled) {
+  config::Config config;
+  config.set_use_emoji_conversion(false);
+  ConversionRequest request;
+  request.set_config(&config);
+  Segments segments;
+
+  EXPECT_EQ(rewriter_.capability(request), RewriterInterface::NOT_AVAILABLE);
+  EXPECT_FALSE(rewriter_.Rewrite(request, &segments));
+  EXPECT_TRUE(rewriter_.Focus(&segments, 0, 0));
+  rewriter_.Finish(request, &segments);
+  EXPECT_TRUE(rewriter_.Sync());
+  EXPECT_TRUE(rewriter_.Reload());
+  rewriter_.Clear();
+
+  EXPECT_FALSE(rewriter_.constructed());
+  EXPECT_EQ(construct_count_, 0);
+  EXPECT_EQ(finish_count_, 0);
+  EXPECT_EQ(segments.segments_size(), 0);
+}
+
+TEST_F(LazyRewriterTest, ConstructedOnceOnFirstUse) {
+  config::Config config;
+  config.set_use_emoji_conversion(true);
+  ConversionRequest request;
+  request.set_config(&config);
+  Segments segments;
+
+  EXPECT_EQ(rewriter_.capability(request), RewriterInterface::PREDICTION);
+  EXPECT_TRUE(rewriter_.constructed());
+  EXPECT_TRUE(rewriter_.Rewrite(request, &segments));
+  EXPECT_EQ(segments.segments_size(), 1);
+  rewriter_.Finish(request, &segments);
+  EXPECT_EQ(finish_count_, 1);
+  EXPECT_EQ(construct_count_, 1);
+}
+
+}  // namespace
+}  // namespace mozc
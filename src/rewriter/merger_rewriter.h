@@ -30,16 +30,24 @@
 #ifndef MOZC_REWRITER_MERGER_REWRITER_H_
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <vector>
 
+#include "base/logging.h"
+#include "base/util.h"
+#include "composer/composer.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
+#include "usage_stats/latency_stats.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 
@@ -79,16 +87,72 @@ class MergerRewriter : public RewriterInterface {
     }
   }
 
+  // Returns true if the trigger of the rewriter accepts the segments.
+  // |script_types| is the value of GetConversionKeyScriptTypes(segments).
+  static bool CheckTrigger(const RewriterInterface::Trigger &trigger,
+                           const ConversionRequest &request,
+                           const Segments &segments, uint32_t script_types) {
+    if (trigger.accept_source_text && request.has_composer() &&
+        !request.composer().source_text().empty()) {
+      return true;
+    }
+    if ((trigger.required_script_types & script_types) !=
+        trigger.required_script_types) {
+      return false;
+    }
+    return trigger.max_conversion_segments == 0 ||
+           segments.conversion_segments_size() <=
+               trigger.max_conversion_segments;
+  }
+
+  // Returns the bit set of the script types which appear in the keys of the
+  // conversion segments.
+  static uint32_t GetConversionKeyScriptTypes(const Segments &segments) {
+    uint32_t script_types = 0;
+    for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+      for (ConstChar32Iterator iter(segments.conversion_segment(i).key());
+           !iter.Done(); iter.Next()) {
+        script_types |=
+            RewriterInterface::ScriptTypeBit(Util::GetScriptType(iter.Get()));
+      }
+    }
+    return script_types;
+  }
+
   void AddRewriter(std::unique_ptr<RewriterInterface> rewriter) {
+    triggers_.push_back(rewriter->trigger());
     rewriters_.push_back(std::move(rewriter));
+    stages_.push_back(usage_stats::LatencyStats::kInvalidStage);
+  }
+
+  // Adds the rewriter whose Rewrite() latency is recorded to LatencyStats as
+  // "Rewriter.<name>".
+  void AddRewriter(absl::string_view name,
+                   std::unique_ptr<RewriterInterface> rewriter) {
+    triggers_.push_back(rewriter->trigger());
+    rewriters_.push_back(std::move(rewriter));
+    stages_.push_back(usage_stats::LatencyStats::RegisterStage(
+        absl::StrCat("Rewriter.", name)));
   }
 
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override {
+    DCHECK(segments);
     bool result = false;
-    for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
-      if (CheckCapability(request, segments, *rewriter)) {
-        result |= rewriter->Rewrite(request, segments);
+    // Rewriters may resize the segments, but it doesn't change the script
+    // types of the concatenated keys.
+    const uint32_t script_types = GetConversionKeyScriptTypes(*segments);
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      const RewriterInterface &rewriter = *rewriters_[i];
+      if (!CheckCapability(request, segments, rewriter) ||
+          !CheckTrigger(triggers_[i], request, *segments, script_types)) {
+        continue;
+      }
+      if (stages_[i] == usage_stats::LatencyStats::kInvalidStage) {
+        result |= rewriter.Rewrite(request, segments);
+      } else {
+        usage_stats::ScopedLatencyRecorder recorder(stages_[i]);
+        result |= rewriter.Rewrite(request, segments);
       }
     }
 
@@ -154,6 +218,9 @@ class MergerRewriter : public RewriterInterface {
 
  private:
   std::vector<std::unique_ptr<RewriterInterface>> rewriters_;
+  // Trigger and LatencyStats stage of each rewriter in rewriters_.
+  std::vector<RewriterInterface::Trigger> triggers_;
+  std::vector<usage_stats::LatencyStats::StageId> stages_;
 };
 
 }  // namespace mozc
@@ -31,14 +31,17 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/system_util.h"
+#include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "testing/googletest.h"
 #include "testing/gunit.h"
+#include "usage_stats/latency_stats.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/string_view.h"
 
@@ -71,6 +74,10 @@ class TestRewriter : public RewriterInterface {
 
   virtual void set_capability(int capability) { capability_ = capability; }
 
+  void set_trigger(const Trigger &trigger) { trigger_ = trigger; }
+
+  Trigger trigger() const override { return trigger_; }
+
   int capability(const ConversionRequest &request) const override {
     return capability_;
   }
@@ -102,6 +109,7 @@ class TestRewriter : public RewriterInterface {
   const std::string name_;
   const bool return_value_;
   int capability_;
+  Trigger trigger_;
 };
 
 class MergerRewriterTest : public testing::Test {
@@ -135,6 +143,89 @@ TEST_F(MergerRewriterTest, Rewrite) {
             "d.Rewrite();");
 }
 
+TEST_F(MergerRewriterTest, RewriteCheckTrigger) {
+  std::string call_result;
+  MergerRewriter merger;
+  const ConversionRequest request;
+
+  auto number_rewriter =
+      std::make_unique<TestRewriter>(&call_result, "number", false);
+  RewriterInterface::Trigger trigger;
+  trigger.required_script_types =
+      RewriterInterface::ScriptTypeBit(Util::NUMBER) |
+      RewriterInterface::ScriptTypeBit(Util::UNKNOWN_SCRIPT);
+  number_rewriter->set_trigger(trigger);
+  merger.AddRewriter(std::move(number_rewriter));
+
+  auto single_rewriter =
+      std::make_unique<TestRewriter>(&call_result, "single", false);
+  trigger = RewriterInterface::Trigger();
+  trigger.max_conversion_segments = 1;
+  single_rewriter->set_trigger(trigger);
+  merger.AddRewriter(std::move(single_rewriter));
+
+  merger.AddRewriter(
+      std::make_unique<TestRewriter>(&call_result, "any", false));
+
+  {
+    Segments segments;
+    segments.add_segment()->set_key("あいう");
+    merger.Rewrite(request, &segments);
+    EXPECT_EQ(call_result, "single.Rewrite();any.Rewrite();");
+  }
+  {
+    call_result.clear();
+    Segments segments;
+    segments.add_segment()->set_key("1+1");
+    segments.add_segment()->set_key("=");
+    merger.Rewrite(request, &segments);
+    EXPECT_EQ(call_result, "number.Rewrite();any.Rewrite();");
+  }
+  {
+    call_result.clear();
+    Segments segments;
+    segments.add_segment()->set_key("１＋１＝");
+    merger.Rewrite(request, &segments);
+    EXPECT_EQ(call_result, "number.Rewrite();single.Rewrite();any.Rewrite();");
+  }
+  {
+    // Keys of history segments are not checked.
+    call_result.clear();
+    Segments segments;
+    Segment *history = segments.add_segment();
+    history->set_key("1=");
+    history->set_segment_type(Segment::HISTORY);
+    segments.add_segment()->set_key("あ");
+    merger.Rewrite(request, &segments);
+    EXPECT_EQ(call_result, "single.Rewrite();any.Rewrite();");
+  }
+}
+
+TEST_F(MergerRewriterTest, RewriteRecordsLatency) {
+  std::string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  merger.AddRewriter("Named",
+                     std::make_unique<TestRewriter>(&call_result, "a", true));
+  merger.AddRewriter(std::make_unique<TestRewriter>(&call_result, "b", false));
+  usage_stats::LatencyStats::ClearAll();
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_EQ(call_result,
+            "a.Rewrite();"
+            "b.Rewrite();");
+
+  int num_records = 0;
+  for (const usage_stats::LatencyStats::StageSnapshot &stage :
+       usage_stats::LatencyStats::GetSnapshot()) {
+    if (stage.name == "Rewriter.Named") {
+      num_records += stage.count;
+    }
+  }
+  EXPECT_EQ(num_records, 1);
+}
+
 TEST_F(MergerRewriterTest, RewriteSuggestion) {
   std::string call_result;
   MergerRewriter merger;
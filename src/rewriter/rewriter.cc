@@ -36,6 +36,9 @@
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
 #include "rewriter/a11y_description_rewriter.h"
 #include "rewriter/calculator_rewriter.h"
 #include "rewriter/collocation_rewriter.h"
@@ -51,6 +54,7 @@
 #include "rewriter/fortune_rewriter.h"
 #include "rewriter/ivs_variants_rewriter.h"
 #include "rewriter/language_aware_rewriter.h"
+#include "rewriter/lazy_rewriter.h"
 #include "rewriter/merger_rewriter.h"
 #include "rewriter/number_rewriter.h"
 #include "rewriter/remove_redundant_candidate_rewriter.h"
@@ -97,51 +101,94 @@ RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
   DCHECK(pos_group);
   // |dictionary| can be NULL
 
-  AddRewriter(std::make_unique<UserDictionaryRewriter>());
-  AddRewriter(std::make_unique<FocusCandidateRewriter>(data_manager));
-  AddRewriter(
-      std::make_unique<LanguageAwareRewriter>(pos_matcher_, dictionary));
-  AddRewriter(std::make_unique<TransliterationRewriter>(pos_matcher_));
-  AddRewriter(std::make_unique<EnglishVariantsRewriter>());
-  AddRewriter(std::make_unique<NumberRewriter>(data_manager));
-  AddRewriter(std::make_unique<CollocationRewriter>(data_manager));
-  AddRewriter(std::make_unique<SingleKanjiRewriter>(*data_manager));
-  AddRewriter(std::make_unique<IvsVariantsRewriter>());
-  AddRewriter(std::make_unique<EmojiRewriter>(*data_manager));
-  AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager));
-  AddRewriter(std::make_unique<CalculatorRewriter>(parent_converter));
-  AddRewriter(std::make_unique<SymbolRewriter>(parent_converter, data_manager));
-  AddRewriter(std::make_unique<UnicodeRewriter>(parent_converter));
-  AddRewriter(std::make_unique<VariantsRewriter>(pos_matcher_));
-  AddRewriter(std::make_unique<ZipcodeRewriter>(&pos_matcher_));
-  AddRewriter(std::make_unique<DiceRewriter>());
-  AddRewriter(std::make_unique<SmallLetterRewriter>(parent_converter));
+  // The rewriters for the features which are disabled by default are wrapped
+  // by LazyRewriter, so that they are constructed on the first request using
+  // them rather than at the start-up.
+
+  AddRewriter("UserDictionaryRewriter",
+              std::make_unique<UserDictionaryRewriter>());
+  AddRewriter("FocusCandidateRewriter",
+              std::make_unique<FocusCandidateRewriter>(data_manager));
+  AddRewriter("LanguageAwareRewriter",
+              std::make_unique<LanguageAwareRewriter>(
+                  pos_matcher_, dictionary));
+  AddRewriter("TransliterationRewriter",
+              std::make_unique<TransliterationRewriter>(pos_matcher_));
+  AddRewriter("EnglishVariantsRewriter",
+              std::make_unique<EnglishVariantsRewriter>());
+  AddRewriter("NumberRewriter", std::make_unique<NumberRewriter>(data_manager));
+  AddRewriter("CollocationRewriter",
+              std::make_unique<CollocationRewriter>(data_manager));
+  AddRewriter("SingleKanjiRewriter",
+              std::make_unique<SingleKanjiRewriter>(*data_manager));
+  AddRewriter("IvsVariantsRewriter", std::make_unique<IvsVariantsRewriter>());
+  AddRewriter("EmojiRewriter",
+              std::make_unique<LazyRewriter>(
+                  [data_manager] {
+                    return std::make_unique<EmojiRewriter>(*data_manager);
+                  },
+                  [](const ConversionRequest &request) {
+                    return request.config().use_emoji_conversion() &&
+                           request.request().emoji_rewriter_capability() !=
+                               RewriterInterface::NOT_AVAILABLE;
+                  }));
+  AddRewriter("EmoticonRewriter",
+              EmoticonRewriter::CreateFromDataManager(*data_manager));
+  AddRewriter("CalculatorRewriter",
+              std::make_unique<CalculatorRewriter>(parent_converter));
+  AddRewriter("SymbolRewriter",
+              std::make_unique<SymbolRewriter>(parent_converter, data_manager));
+  AddRewriter("UnicodeRewriter",
+              std::make_unique<UnicodeRewriter>(parent_converter));
+  AddRewriter("VariantsRewriter",
+              std::make_unique<VariantsRewriter>(pos_matcher_));
+  AddRewriter("ZipcodeRewriter",
+              std::make_unique<ZipcodeRewriter>(&pos_matcher_));
+  AddRewriter("DiceRewriter", std::make_unique<DiceRewriter>());
+  AddRewriter("SmallLetterRewriter",
+              std::make_unique<SmallLetterRewriter>(parent_converter));
 
   if (absl::GetFlag(FLAGS_use_history_rewriter)) {
-    AddRewriter(
-        std::make_unique<UserBoundaryHistoryRewriter>(parent_converter));
-    AddRewriter(
-        std::make_unique<UserSegmentHistoryRewriter>(&pos_matcher_, pos_group));
+    AddRewriter("UserBoundaryHistoryRewriter",
+                std::make_unique<UserBoundaryHistoryRewriter>(
+                    parent_converter));
+    AddRewriter("UserSegmentHistoryRewriter",
+                std::make_unique<UserSegmentHistoryRewriter>(
+                    &pos_matcher_, pos_group));
   }
 
-  AddRewriter(std::make_unique<DateRewriter>(dictionary));
-  AddRewriter(std::make_unique<FortuneRewriter>());
+  AddRewriter("DateRewriter", std::make_unique<DateRewriter>(dictionary));
+  AddRewriter("FortuneRewriter", std::make_unique<FortuneRewriter>());
 #if !(defined(__ANDROID__) || (defined(TARGET_OS_IPHONE) && TARGET_OS_IPHONE))
   // CommandRewriter is not tested well on Android or iOS.
   // So we temporarily disable it.
   // TODO(yukawa, team): Enable CommandRewriter on Android if necessary.
-  AddRewriter(std::make_unique<CommandRewriter>());
+  AddRewriter("CommandRewriter", std::make_unique<CommandRewriter>());
 #endif  // !(__ANDROID__ || TARGET_OS_IPHONE)
 #ifndef NO_USAGE_REWRITER
-  AddRewriter(std::make_unique<UsageRewriter>(data_manager, dictionary));
+  AddRewriter("UsageRewriter",
+              std::make_unique<UsageRewriter>(data_manager, dictionary));
 #endif  // NO_USAGE_REWRITER
-  AddRewriter(
-      std::make_unique<VersionRewriter>(data_manager->GetDataVersion()));
-  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager));
-  AddRewriter(std::make_unique<T13nPromotionRewriter>());
-  AddRewriter(std::make_unique<EnvironmentalFilterRewriter>(*data_manager));
-  AddRewriter(std::make_unique<RemoveRedundantCandidateRewriter>());
-  AddRewriter(std::make_unique<A11yDescriptionRewriter>(data_manager));
+  AddRewriter("VersionRewriter",
+              std::make_unique<VersionRewriter>(
+                  data_manager->GetDataVersion()));
+  AddRewriter("CorrectionRewriter",
+              CorrectionRewriter::CreateCorrectionRewriter(data_manager));
+  AddRewriter("T13nPromotionRewriter",
+              std::make_unique<T13nPromotionRewriter>());
+  AddRewriter("EnvironmentalFilterRewriter",
+              std::make_unique<EnvironmentalFilterRewriter>(*data_manager));
+  AddRewriter("RemoveRedundantCandidateRewriter",
+              std::make_unique<RemoveRedundantCandidateRewriter>());
+  AddRewriter("A11yDescriptionRewriter",
+              std::make_unique<LazyRewriter>(
+                  [data_manager] {
+                    return std::make_unique<A11yDescriptionRewriter>(
+                        data_manager);
+                  },
+                  [](const ConversionRequest &request) {
+                    return request.request().enable_a11y_description();
+                  }));
 }
 
 }  // namespace mozc
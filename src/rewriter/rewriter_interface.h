@@ -31,7 +31,9 @@
 #define MOZC_REWRITER_REWRITER_INTERFACE_H_
 
 #include <cstddef>  // for size_t
+#include <cstdint>
 
+#include "base/util.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 
@@ -56,6 +58,29 @@ class RewriterInterface {
     return CONVERSION;
   }
 
+  // Cheap conditions which the conversion segments need to satisfy for
+  // Rewrite() to do anything.  MergerRewriter evaluates them once per
+  // Segments, so that rewriters for special inputs (e.g. calculator or
+  // zipcode) are skipped without calling Rewrite() for ordinary keys.
+  struct Trigger {
+    // Bit set of (1 << Util::ScriptType).  The keys of the conversion segments
+    // need to contain characters of all the script types.  0 accepts any key.
+    uint32_t required_script_types = 0;
+    // The maximum number of the conversion segments.  0 means no limit.
+    size_t max_conversion_segments = 0;
+    // Accepts any segments on reconversion, i.e. when the composer has the
+    // source text.  The rewriter reads the source text instead of the keys.
+    bool accept_source_text = false;
+  };
+
+  static constexpr uint32_t ScriptTypeBit(Util::ScriptType type) {
+    return uint32_t{1} << type;
+  }
+
+  // Returns the trigger of this rewriter.  It must not depend on the request
+  // as MergerRewriter calls it only once when the rewriter is added.
+  virtual Trigger trigger() const { return Trigger(); }
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
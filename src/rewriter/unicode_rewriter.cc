@@ -187,6 +187,15 @@ bool UnicodeRewriter::RewriteFromUnicodeCharFormat(
   return true;
 }
 
+RewriterInterface::Trigger UnicodeRewriter::trigger() const {
+  // "U+XXXX", or any key on reconversion for "A" -> "U+0041".
+  Trigger result;
+  result.required_script_types = ScriptTypeBit(Util::ALPHABET) |
+                                 ScriptTypeBit(Util::UNKNOWN_SCRIPT);  // '+'
+  result.accept_source_text = true;
+  return result;
+}
+
 bool UnicodeRewriter::Rewrite(const ConversionRequest &request,
                               Segments *segments) const {
   DCHECK(segments);
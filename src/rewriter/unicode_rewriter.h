@@ -43,6 +43,8 @@ class UnicodeRewriter : public RewriterInterface {
   explicit UnicodeRewriter(const ConverterInterface *parent_converter);
   ~UnicodeRewriter() override = default;
 
+  Trigger trigger() const override;
+
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
@@ -47,6 +47,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "rewriter/merger_rewriter.h"
 #include "testing/googletest.h"
 #include "testing/gunit.h"
 #include "absl/flags/flag.h"
@@ -293,4 +294,22 @@ TEST_F(UnicodeRewriterTest, RewriteToUnicodeCharFormat) {
   }
 }
 
+TEST_F(UnicodeRewriterTest, ReconversionThroughMergerRewriter) {
+  // The reconverted text comes with a hiragana key, which doesn't match the
+  // key trigger for "U+XXXX".
+  MergerRewriter merger;
+  merger.AddRewriter(
+      std::make_unique<UnicodeRewriter>(engine_->GetConverter()));
+
+  composer::Composer composer(nullptr, &default_request(), &default_config());
+  composer.set_source_text("愛");
+  ConversionRequest request(&composer, &default_request(), &default_config());
+
+  Segments segments;
+  AddSegment("あい", "愛", &segments);
+
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_TRUE(ContainCandidate(segments, "U+611B"));
+}
+
 }  // namespace mozc
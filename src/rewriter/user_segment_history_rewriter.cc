@@ -30,14 +30,18 @@
 #include "rewriter/user_segment_history_rewriter.h"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/util.h"
@@ -54,8 +58,56 @@
 #include "absl/container/btree_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
+
+// Feature key consisting of TAB separated fields.  The fields are not copied,
+// so the key is valid only while the referred strings are alive.  The key can
+// be fingerprinted without building the joined string.
+class UserSegmentHistoryRewriter::FeatureKey {
+ public:
+  FeatureKey() : size_(0) {}
+
+  void Set(std::initializer_list<absl::string_view> fields) {
+    DCHECK_LE(fields.size(), kMaxFields);
+    size_ = 0;
+    for (const absl::string_view field : fields) {
+      if (size_ > 0) {
+        pieces_[size_++] = "\t";
+      }
+      pieces_[size_++] = field;
+    }
+  }
+
+  // Returns the joined string, which is the key of LruStorage.
+  std::string ToString() const {
+    size_t length = 0;
+    for (size_t i = 0; i < size_; ++i) {
+      length += pieces_[i].size();
+    }
+    std::string result;
+    result.reserve(length);
+    for (size_t i = 0; i < size_; ++i) {
+      result.append(pieces_[i].data(), pieces_[i].size());
+    }
+    return result;
+  }
+
+  // Returns the same fingerprint as LruStorage computes for ToString().
+  uint64_t Fingerprint(uint32_t seed) const {
+    return Hash::FingerprintConcatWithSeed(
+        absl::MakeConstSpan(pieces_.data(), size_), seed);
+  }
+
+ private:
+  static constexpr size_t kMaxFields = 5;
+
+  // Fields and TAB delimiters.
+  std::array<absl::string_view, kMaxFields * 2 - 1> pieces_;
+  size_t size_;
+};
+
 namespace {
 
 using ::mozc::config::CharacterFormManager;
@@ -63,6 +115,7 @@ using ::mozc::config::Config;
 using ::mozc::dictionary::PosGroup;
 using ::mozc::dictionary::PosMatcher;
 using ::mozc::storage::LruStorage;
+using FeatureKey = UserSegmentHistoryRewriter::FeatureKey;
 
 constexpr uint32_t kValueSize = 4;
 constexpr uint32_t kLruSize = 20000;
@@ -136,11 +189,10 @@ inline int GetDefaultCandidateIndex(const Segment &segment) {
   return 0;
 }
 
-// JoinStringWithTabN joins N strings with TAB delimiters ('\t') in a way
+// JoinStringsWithTab2 joins 2 strings with a TAB delimiter ('\t') in a way
 // similar to absl::StrJoin() and/or Util::AppendStringWithDelimiter() but
-// in a more efficient way. Since this module is called every key stroke and
-// performs many string concatenation, we use these functions instead of ones
-// from Util.
+// in a more efficient way. The other features are built as FeatureKey, which
+// doesn't join the strings at all for lookup.
 inline void JoinStringsWithTab2(const absl::string_view s1,
                                 const absl::string_view s2,
                                 std::string *output) {
@@ -151,149 +203,98 @@ inline void JoinStringsWithTab2(const absl::string_view s1,
       .append(s2.data(), s2.size());
 }
 
-inline void JoinStringsWithTab3(const absl::string_view s1,
-                                const absl::string_view s2,
-                                const absl::string_view s3,
-                                std::string *output) {
-  // Pre-allocate the buffer, including 2 TAB delimiters.
-  output->reserve(s1.size() + s2.size() + s3.size() + 2);
-  output->assign(s1.data(), s1.size())
-      .append("\t")
-      .append(s2.data(), s2.size())
-      .append("\t")
-      .append(s3.data(), s3.size());
-}
-
-inline void JoinStringsWithTab4(const absl::string_view s1,
-                                const absl::string_view s2,
-                                const absl::string_view s3,
-                                const absl::string_view s4,
-                                std::string *output) {
-  // Pre-allocate the buffer, including 3 TAB delimiters.
-  output->reserve(s1.size() + s2.size() + s3.size() + s4.size() + 3);
-  output->assign(s1.data(), s1.size())
-      .append("\t")
-      .append(s2.data(), s2.size())
-      .append("\t")
-      .append(s3.data(), s3.size())
-      .append("\t")
-      .append(s4.data(), s4.size());
-}
-
-inline void JoinStringsWithTab5(const absl::string_view s1,
-                                const absl::string_view s2,
-                                const absl::string_view s3,
-                                const absl::string_view s4,
-                                const absl::string_view s5,
-                                std::string *output) {
-  // Pre-allocate the buffer, including 4 TAB delimiters.
-  output->reserve(s1.size() + s2.size() + s3.size() + s4.size() + s5.size() +
-                  4);
-  output->assign(s1.data(), s1.size())
-      .append("\t")
-      .append(s2.data(), s2.size())
-      .append("\t")
-      .append(s3.data(), s3.size())
-      .append("\t")
-      .append(s4.data(), s4.size())
-      .append("\t")
-      .append(s5.data(), s5.size());
-}
-
 // Feature "Left Right"
 inline bool GetFeatureLR(const Segments &segments, size_t i,
                          absl::string_view base_key,
-                         absl::string_view base_value, std::string *value) {
-  DCHECK(value);
+                         absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
   if (i + 1 >= segments.segments_size() || i <= 0) {
     return false;
   }
   const int j1 = GetDefaultCandidateIndex(segments.segment(i - 1));
   const int j2 = GetDefaultCandidateIndex(segments.segment(i + 1));
-  JoinStringsWithTab5("LR", base_key,
-                      segments.segment(i - 1).candidate(j1).value, base_value,
-                      segments.segment(i + 1).candidate(j2).value, value);
+  key->Set({"LR", base_key, segments.segment(i - 1).candidate(j1).value,
+            base_value, segments.segment(i + 1).candidate(j2).value});
   return true;
 }
 
 // Feature "Left Left"
 inline bool GetFeatureLL(const Segments &segments, size_t i,
                          absl::string_view base_key,
-                         absl::string_view base_value, std::string *value) {
-  DCHECK(value);
+                         absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
   if (i < 2) {
     return false;
   }
   const int j1 = GetDefaultCandidateIndex(segments.segment(i - 2));
   const int j2 = GetDefaultCandidateIndex(segments.segment(i - 1));
-  JoinStringsWithTab5(
-      "LL", base_key, segments.segment(i - 2).candidate(j1).value,
-      segments.segment(i - 1).candidate(j2).value, base_value, value);
+  key->Set({"LL", base_key, segments.segment(i - 2).candidate(j1).value,
+            segments.segment(i - 1).candidate(j2).value, base_value});
   return true;
 }
 
 // Feature "Right Right"
 inline bool GetFeatureRR(const Segments &segments, size_t i,
                          absl::string_view base_key,
-                         absl::string_view base_value, std::string *value) {
-  DCHECK(value);
+                         absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
   if (i + 2 >= segments.segments_size()) {
     return false;
   }
   const int j1 = GetDefaultCandidateIndex(segments.segment(i + 1));
   const int j2 = GetDefaultCandidateIndex(segments.segment(i + 2));
-  JoinStringsWithTab5("RR", base_key, base_value,
-                      segments.segment(i + 1).candidate(j1).value,
-                      segments.segment(i + 2).candidate(j2).value, value);
+  key->Set({"RR", base_key, base_value,
+            segments.segment(i + 1).candidate(j1).value,
+            segments.segment(i + 2).candidate(j2).value});
   return true;
 }
 
 // Feature "Left"
 inline bool GetFeatureL(const Segments &segments, size_t i,
                         absl::string_view base_key,
-                        absl::string_view base_value, std::string *value) {
-  DCHECK(value);
+                        absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
   if (i < 1) {
     return false;
   }
   const int j = GetDefaultCandidateIndex(segments.segment(i - 1));
-  JoinStringsWithTab4("L", base_key, segments.segment(i - 1).candidate(j).value,
-                      base_value, value);
+  key->Set({"L", base_key, segments.segment(i - 1).candidate(j).value,
+            base_value});
   return true;
 }
 
 // Feature "Right"
 inline bool GetFeatureR(const Segments &segments, size_t i,
                         absl::string_view base_key,
-                        absl::string_view base_value, std::string *value) {
-  DCHECK(value);
+                        absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
   if (i + 1 >= segments.segments_size()) {
     return false;
   }
   const int j = GetDefaultCandidateIndex(segments.segment(i + 1));
-  JoinStringsWithTab4("R", base_key, base_value,
-                      segments.segment(i + 1).candidate(j).value, value);
+  key->Set({"R", base_key, base_value,
+            segments.segment(i + 1).candidate(j).value});
   return true;
 }
 
 // Feature "Current"
 inline bool GetFeatureC(const Segments &segments, size_t i,
                         absl::string_view base_key,
-                        absl::string_view base_value, std::string *value) {
-  DCHECK(value);
-  JoinStringsWithTab3("C", base_key, base_value, value);
+                        absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
+  key->Set({"C", base_key, base_value});
   return true;
 }
 
 // Feature "Single"
 inline bool GetFeatureS(const Segments &segments, size_t i,
                         absl::string_view base_key,
-                        absl::string_view base_value, std::string *value) {
-  DCHECK(value);
+                        absl::string_view base_value, FeatureKey *key) {
+  DCHECK(key);
   if (segments.segments_size() - segments.history_segments_size() != 1) {
     return false;
   }
-  JoinStringsWithTab3("S", base_key, base_value, value);
+  key->Set({"S", base_key, base_value});
   return true;
 }
 
@@ -504,30 +505,26 @@ UserSegmentHistoryRewriter::~UserSegmentHistoryRewriter() = default;
       FeatureValue v;                                                          \
       DCHECK(v.IsValid());                                                     \
       if (force_insert) {                                                      \
-        storage_->Insert(feature_key, reinterpret_cast<const char *>(&v));     \
+        storage_->Insert(feature_key.ToString(),                               \
+                         reinterpret_cast<const char *>(&v));                  \
       } else {                                                                 \
-        storage_->TryInsert(feature_key, reinterpret_cast<const char *>(&v));  \
+        storage_->TryInsert(feature_key.ToString(),                            \
+                            reinterpret_cast<const char *>(&v));               \
       }                                                                        \
     }                                                                          \
   } while (0)
 
-#define FETCH_FEATURE(func, base_key, base_value, weight)                    \
+#define APPEND_FEATURE(func, base_key, base_value, weight)                   \
   do {                                                                       \
     if (func(segments, segment_index, base_key, base_value, &feature_key)) { \
-      const FeatureValue *v = reinterpret_cast<const FeatureValue *>(        \
-          storage_->Lookup(feature_key, &last_access_time_result));          \
-      if (v != NULL && v->IsValid()) {                                       \
-        *score = std::max(*score, weight);                                   \
-        *last_access_time =                                                  \
-            std::max(*last_access_time, last_access_time_result);            \
-      }                                                                      \
+      features->fps.push_back(feature_key.Fingerprint(storage_->seed()));    \
+      features->weights.push_back(weight);                                   \
     }                                                                        \
   } while (0)
 
-bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
-                                          size_t segment_index,
-                                          int candidate_index, uint32_t *score,
-                                          uint32_t *last_access_time) const {
+void UserSegmentHistoryRewriter::AppendScoringFeatures(
+    const Segments &segments, size_t segment_index, int candidate_index,
+    ScoringFeatures *features) const {
   const size_t segments_size = segments.conversion_segments_size();
   const Segment::Candidate &top_candidate =
       segments.segment(segment_index).candidate(0);
@@ -545,15 +542,10 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
       (candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE) ||
       (segments.segment(segment_index).candidate(0).attributes &
        Segment::Candidate::CONTEXT_SENSITIVE);
-  DCHECK(score);
-  DCHECK(last_access_time);
+  DCHECK(features);
 
-  *score = 0;
-  *last_access_time = 0;
-
-  // They are used inside FETCH_FEATURE
-  uint32_t last_access_time_result = 0;
-  std::string feature_key;
+  // It is used inside APPEND_FEATURE
+  FeatureKey feature_key;
 
   const uint32_t trigram_score = (segments_size == 3) ? 180 : 30;
   const uint32_t bigram_score = (segments_size == 2) ? 60 : 10;
@@ -561,41 +553,39 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
   const uint32_t unigram_score = (segments_size == 1) ? 36 : 6;
   const uint32_t single_score = (segments_size == 1) ? 90 : 15;
 
-  FETCH_FEATURE(GetFeatureLR, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureLL, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureRR, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureL, all_key, all_value, bigram_score);
-  FETCH_FEATURE(GetFeatureR, all_key, all_value, bigram_score);
-  FETCH_FEATURE(GetFeatureS, all_key, all_value, single_score);
-  FETCH_FEATURE(GetFeatureLN, content_key, content_value, bigram_number_score);
-  FETCH_FEATURE(GetFeatureRN, content_key, content_value, bigram_number_score);
+  APPEND_FEATURE(GetFeatureLR, all_key, all_value, trigram_score);
+  APPEND_FEATURE(GetFeatureLL, all_key, all_value, trigram_score);
+  APPEND_FEATURE(GetFeatureRR, all_key, all_value, trigram_score);
+  APPEND_FEATURE(GetFeatureL, all_key, all_value, bigram_score);
+  APPEND_FEATURE(GetFeatureR, all_key, all_value, bigram_score);
+  APPEND_FEATURE(GetFeatureS, all_key, all_value, single_score);
+  APPEND_FEATURE(GetFeatureLN, content_key, content_value, bigram_number_score);
+  APPEND_FEATURE(GetFeatureRN, content_key, content_value, bigram_number_score);
 
   const bool is_replaceable = Replaceable(top_candidate, candidate);
 
   if (!context_sensitive && is_replaceable) {
-    FETCH_FEATURE(GetFeatureC, all_key, all_value, unigram_score);
+    APPEND_FEATURE(GetFeatureC, all_key, all_value, unigram_score);
   }
 
   if (!is_replaceable) {
-    return (*score > 0);
+    return;
   }
 
-  FETCH_FEATURE(GetFeatureLR, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureLL, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureRR, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureL, content_key, content_value, bigram_score / 2);
-  FETCH_FEATURE(GetFeatureR, content_key, content_value, bigram_score / 2);
-  FETCH_FEATURE(GetFeatureS, content_key, content_value, single_score / 2);
-  FETCH_FEATURE(GetFeatureLN, content_key, content_value,
-                bigram_number_score / 2);
-  FETCH_FEATURE(GetFeatureRN, content_key, content_value,
-                bigram_number_score / 2);
+  APPEND_FEATURE(GetFeatureLR, content_key, content_value, trigram_score / 2);
+  APPEND_FEATURE(GetFeatureLL, content_key, content_value, trigram_score / 2);
+  APPEND_FEATURE(GetFeatureRR, content_key, content_value, trigram_score / 2);
+  APPEND_FEATURE(GetFeatureL, content_key, content_value, bigram_score / 2);
+  APPEND_FEATURE(GetFeatureR, content_key, content_value, bigram_score / 2);
+  APPEND_FEATURE(GetFeatureS, content_key, content_value, single_score / 2);
+  APPEND_FEATURE(GetFeatureLN, content_key, content_value,
+                 bigram_number_score / 2);
+  APPEND_FEATURE(GetFeatureRN, content_key, content_value,
+                 bigram_number_score / 2);
 
   if (!context_sensitive) {
-    FETCH_FEATURE(GetFeatureC, content_key, content_value, unigram_score / 2);
+    APPEND_FEATURE(GetFeatureC, content_key, content_value, unigram_score / 2);
   }
-
-  return (*score > 0);
 }
 
 // Returns true if |lhs| candidate can be replaceable with |rhs|.
@@ -678,7 +668,7 @@ void UserSegmentHistoryRewriter::RememberFirstCandidate(
       ((top_index == 0) || Replaceable(seg.candidate(top_index), candidate));
 
   // |feature_key| is used inside INSERT_FEATURE
-  std::string feature_key;
+  FeatureKey feature_key;
   INSERT_FEATURE(GetFeatureLR, all_key, all_value, force_insert);
   INSERT_FEATURE(GetFeatureLL, all_key, all_value, force_insert);
   INSERT_FEATURE(GetFeatureRR, all_key, all_value, force_insert);
@@ -935,6 +925,12 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
         Segment::Candidate::BEST_CANDIDATE;
   }
 
+  // Buffers reused across segments.
+  ScoringFeatures features;
+  std::vector<std::pair<int, size_t>> candidate_feature_ends;
+  std::vector<const char *> values;
+  std::vector<uint32_t> last_access_times;
+
   bool modified = false;
   for (size_t i = segments->history_segments_size();
        i < segments->segments_size(); ++i) {
@@ -963,8 +959,10 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
     DVLOG_IF(2, (segment->candidates_size() < max_candidates_size))
         << "Cannot expand candidates. ignored. Rewrite may be failed";
 
-    // for each all candidates expanded
-    std::vector<ScoreType> scores;
+    // Collects the features of all the candidates expanded, and then looks
+    // them up at once.
+    features.Clear();
+    candidate_feature_ends.clear();
     for (size_t l = 0;
          l < segment->candidates_size() + segment->meta_candidates_size();
          ++l) {
@@ -973,10 +971,29 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
         j -= static_cast<int>(segment->candidates_size() +
                               transliteration::NUM_T13N_TYPES);
       }
+      AppendScoringFeatures(*segments, i, j, &features);
+      candidate_feature_ends.emplace_back(j, features.fps.size());
+    }
+    values.resize(features.fps.size());
+    last_access_times.resize(features.fps.size());
+    storage_->LookupBatch(features.fps, absl::MakeSpan(values),
+                          absl::MakeSpan(last_access_times));
 
+    std::vector<ScoreType> scores;
+    size_t begin = 0;
+    for (const auto &[j, end] : candidate_feature_ends) {
       uint32_t score = 0;
       uint32_t last_access_time = 0;
-      if (GetScore(*segments, i, j, &score, &last_access_time)) {
+      for (size_t k = begin; k < end; ++k) {
+        const FeatureValue *v =
+            reinterpret_cast<const FeatureValue *>(values[k]);
+        if (v != nullptr && v->IsValid()) {
+          score = std::max(score, features.weights[k]);
+          last_access_time = std::max(last_access_time, last_access_times[k]);
+        }
+      }
+      begin = end;
+      if (score > 0) {
         scores.push_back(ScoreType());
         scores.back().score = score;
         scores.back().last_access_time = last_access_time;
@@ -1013,8 +1030,8 @@ bool UserSegmentHistoryRewriter::GetFeatureLN(const Segments &segments,
                                               size_t i,
                                               absl::string_view base_key,
                                               absl::string_view base_value,
-                                              std::string *value) const {
-  DCHECK(value);
+                                              FeatureKey *key) const {
+  DCHECK(key);
   if (i < 1) {
     return false;
   }
@@ -1023,8 +1040,7 @@ bool UserSegmentHistoryRewriter::GetFeatureLN(const Segments &segments,
   if (pos_matcher_->IsNumber(candidate.rid) ||
       pos_matcher_->IsKanjiNumber(candidate.rid) ||
       Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    JoinStringsWithTab3(absl::string_view("LN", 2), base_key, base_value,
-                        value);
+    key->Set({"LN", base_key, base_value});
     return true;
   }
   return false;
@@ -1035,8 +1051,8 @@ bool UserSegmentHistoryRewriter::GetFeatureRN(const Segments &segments,
                                               size_t i,
                                               absl::string_view base_key,
                                               absl::string_view base_value,
-                                              std::string *value) const {
-  DCHECK(value);
+                                              FeatureKey *key) const {
+  DCHECK(key);
   if (i + 1 >= segments.segments_size()) {
     return false;
   }
@@ -1045,8 +1061,7 @@ bool UserSegmentHistoryRewriter::GetFeatureRN(const Segments &segments,
   if (pos_matcher_->IsNumber(candidate.lid) ||
       pos_matcher_->IsKanjiNumber(candidate.lid) ||
       Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    JoinStringsWithTab3(absl::string_view("RN", 2), base_key, base_value,
-                        value);
+    key->Set({"RN", base_key, base_value});
     return true;
   }
   return false;
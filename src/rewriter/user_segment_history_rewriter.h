@@ -54,6 +54,9 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
     const Segment::Candidate *candidate;
   };
 
+  // Key of a learned feature.  Defined in the .cc file.
+  class FeatureKey;
+
   UserSegmentHistoryRewriter(const dictionary::PosMatcher *pos_matcher,
                              const dictionary::PosGroup *pos_group);
   ~UserSegmentHistoryRewriter() override;
@@ -67,11 +70,23 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
   void Clear() override;
 
  private:
+  // Fingerprints of the features used for scoring candidates and their
+  // weights.
+  struct ScoringFeatures {
+    void Clear() {
+      fps.clear();
+      weights.clear();
+    }
+
+    std::vector<uint64_t> fps;
+    std::vector<uint32_t> weights;
+  };
+
   bool IsAvailable(const ConversionRequest &request,
                    const Segments &segments) const;
-  bool GetScore(const Segments &segments, size_t segment_index,
-                int candidate_index, uint32_t *score,
-                uint32_t *last_access_time) const;
+  void AppendScoringFeatures(const Segments &segments, size_t segment_index,
+                             int candidate_index,
+                             ScoringFeatures *features) const;
   bool Replaceable(const Segment::Candidate &lhs,
                    const Segment::Candidate &rhs) const;
   void RememberFirstCandidate(const Segments &segments, size_t segment_index);
@@ -83,10 +98,10 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
                      const Segment::Candidate &candidate) const;
   bool GetFeatureLN(const Segments &segments, size_t i,
                     absl::string_view base_key, absl::string_view base_value,
-                    std::string *value) const;
+                    FeatureKey *key) const;
   bool GetFeatureRN(const Segments &segments, size_t i,
                     absl::string_view base_key, absl::string_view base_value,
-                    std::string *value) const;
+                    FeatureKey *key) const;
   bool SortCandidates(const std::vector<ScoreType> &sorted_scores,
                       Segment *segment) const;
 
@@ -33,6 +33,7 @@
 #include <string>
 
 #include "base/logging.h"
+#include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
@@ -133,6 +134,14 @@ ZipcodeRewriter::ZipcodeRewriter(const PosMatcher *pos_matcher)
 
 ZipcodeRewriter::~ZipcodeRewriter() = default;
 
+RewriterInterface::Trigger ZipcodeRewriter::trigger() const {
+  // Zipcode candidates are looked up by the digits in one segment.
+  Trigger result;
+  result.required_script_types = ScriptTypeBit(Util::NUMBER);
+  result.max_conversion_segments = 1;
+  return result;
+}
+
 bool ZipcodeRewriter::Rewrite(const ConversionRequest &request,
                               Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
@@ -46,6 +46,8 @@ class ZipcodeRewriter : public RewriterInterface {
   ZipcodeRewriter &operator=(const ZipcodeRewriter &) = delete;
   ~ZipcodeRewriter() override;
 
+  Trigger trigger() const override;
+
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
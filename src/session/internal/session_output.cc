@@ -158,6 +158,27 @@ void FillAllCandidateWordsInternal(
   }
 }
 
+// Walks the candidates in the same order as FillAllCandidateWordsInternal()
+// and updates |focused_index| like it.  |index| is the number of candidates
+// visited so far.
+void GetAllCandidateWordsFocusedIndexInternal(
+    const CandidateList &candidate_list, const int focused_id, int *index,
+    int *focused_index) {
+  for (size_t i = 0; i < candidate_list.size(); ++i) {
+    const Candidate &candidate = candidate_list.candidate(i);
+    if (candidate.IsSubcandidateList()) {
+      GetAllCandidateWordsFocusedIndexInternal(candidate.subcandidate_list(),
+                                               focused_id, index,
+                                               focused_index);
+      continue;
+    }
+    if (candidate.id() == focused_id && candidate_list.focused()) {
+      *focused_index = *index;
+    }
+    ++*index;
+  }
+}
+
 }  // namespace
 
 // static
@@ -242,6 +263,17 @@ void SessionOutput::FillAllCandidateWords(
                                 candidate_list_proto);
 }
 
+// static
+int SessionOutput::GetAllCandidateWordsFocusedIndex(
+    const CandidateList &candidate_list) {
+  int index = 0;
+  int focused_index = -1;
+  GetAllCandidateWordsFocusedIndexInternal(candidate_list,
+                                           candidate_list.focused_id(), &index,
+                                           &focused_index);
+  return focused_index;
+}
+
 // static
 void SessionOutput::FillRemovedCandidates(
     const Segment &segment, commands::CandidateList *candidate_list_proto) {
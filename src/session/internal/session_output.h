@@ -68,6 +68,11 @@ class SessionOutput {
       commands::Category category,
       commands::CandidateList *candidate_list_proto);
 
+  // Returns the focused index of the CandidateList protobuf filled by
+  // FillAllCandidateWords(), or -1 if no candidate is focused.
+  static int GetAllCandidateWordsFocusedIndex(
+      const CandidateList &candidate_list);
+
   // For debug. Fill the CandidateList protobuf with the
   // removed_candidates_for_debug in the segment.
   static void FillRemovedCandidates(
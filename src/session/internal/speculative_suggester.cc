@@ -0,0 +1,293 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/internal/speculative_suggester.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/thread_pool.h"
+#include "composer/composer.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/cleanup/cleanup.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+ABSL_FLAG(bool, speculative_suggestion, false,
+          "Precompute the suggestions for the likely next key inputs while "
+          "the server is idle.");
+
+namespace mozc {
+namespace session {
+namespace {
+
+// The number of the next inputs to precompute.  Vowels come first, which
+// covers most of the keystrokes after a consonant.
+constexpr size_t kMaxSpeculativeInputs = 5;
+
+// Guards |g_foreground_count|.  Held only to update or wait for the count, so
+// the foreground commands don't exclude each other.
+ABSL_CONST_INIT absl::Mutex g_foreground_mutex(absl::kConstInit);
+
+// The number of the alive ForegroundScopes.  The background task starts the
+// next suggestion only when it's zero.
+int g_foreground_count ABSL_GUARDED_BY(g_foreground_mutex) = 0;
+
+ThreadPool *GetThreadPool() {
+  // Leaked on purpose, as the worker may be running at exit.
+  static ThreadPool *pool = new ThreadPool(1);
+  return pool;
+}
+
+// Returns the string identifying the history used by the suggestion.
+std::string GetHistoryFingerprint(const ConversionRequest &request,
+                                  const Segments &segments) {
+  std::string fingerprint =
+      absl::StrCat(request.enable_user_history_for_conversion(), ":",
+                   segments.max_history_segments_size(), "\n");
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &segment = segments.history_segment(i);
+    absl::StrAppend(&fingerprint, segment.key(), "\t",
+                    segment.candidates_size() > 0 ? segment.candidate(0).value
+                                                  : "",
+                    "\n");
+  }
+  return fingerprint;
+}
+
+// Returns the fingerprint of the settings which the suggestion depends on, so
+// that a SetRequest() or SetConfig() between the keystrokes invalidates the
+// results.
+uint64_t GetSettingsFingerprint(const ConversionRequest &request) {
+  return Hash::Fingerprint(absl::StrCat(
+      request.request().SerializeAsString(), "\t",
+      request.config().SerializeAsString(), "\t",
+      request.use_actual_converter_for_realtime_conversion(), ":",
+      request.create_partial_candidates()));
+}
+
+}  // namespace
+
+struct SpeculativeSuggester::Task {
+  const ConverterInterface *converter = nullptr;
+  commands::Request request;
+  config::Config config;
+  // The conversion request pointing to |request| and |config| above.
+  ConversionRequest conversion_request;
+  // The composers for each next input.
+  std::vector<composer::Composer> composers;
+  // The history segments without conversion segments.
+  Segments segments;
+  std::string history_fingerprint;
+  uint64_t settings_fingerprint = 0;
+
+  // Set by Cancel().  Also read while waiting for |g_foreground_mutex|.
+  std::atomic<bool> cancelled = false;
+
+  absl::Mutex mutex;
+  bool running ABSL_GUARDED_BY(mutex) = false;
+  // Set when the task returns.
+  bool finished ABSL_GUARDED_BY(mutex) = false;
+  // Maps the prediction query to the segments filled by the converter.
+  absl::flat_hash_map<std::string, Segments> results ABSL_GUARDED_BY(mutex);
+};
+
+SpeculativeSuggester::ForegroundScope::ForegroundScope() {
+  absl::MutexLock lock(&g_foreground_mutex);
+  ++g_foreground_count;
+}
+
+SpeculativeSuggester::ForegroundScope::~ForegroundScope() {
+  absl::MutexLock lock(&g_foreground_mutex);
+  --g_foreground_count;
+}
+
+SpeculativeSuggester::~SpeculativeSuggester() { Cancel(); }
+
+// static
+bool SpeculativeSuggester::IsEnabled() {
+  return absl::GetFlag(FLAGS_speculative_suggestion);
+}
+
+void SpeculativeSuggester::Start(const ConverterInterface *converter,
+                                 const ConversionRequest &request,
+                                 const Segments &segments) {
+  DCHECK(converter);
+  Cancel();
+  if (!request.has_composer()) {
+    return;
+  }
+  const std::vector<std::string> inputs =
+      request.composer().GetPendingCompletions(kMaxSpeculativeInputs);
+  if (inputs.empty()) {
+    return;
+  }
+
+  auto task = std::make_shared<Task>();
+  task->converter = converter;
+  task->request = request.request();
+  task->config = request.config();
+  task->conversion_request = request;
+  task->conversion_request.set_request(&task->request);
+  task->conversion_request.set_config(&task->config);
+  task->composers.reserve(inputs.size());
+  for (const std::string &input : inputs) {
+    // Sends the key event which the session would send for the keystroke.
+    // The other inputs, e.g. kana with key_string, are not precomputed.
+    if (input.size() != 1 || !absl::ascii_isgraph(input[0])) {
+      continue;
+    }
+    commands::KeyEvent key;
+    key.set_key_code(static_cast<uint8_t>(input[0]));
+    composer::Composer &composer =
+        task->composers.emplace_back(request.composer());
+    composer.SetRequest(&task->request);
+    composer.SetConfig(&task->config);
+    if (!composer.InsertCharacterKeyEvent(key)) {
+      task->composers.pop_back();
+    }
+  }
+  if (task->composers.empty()) {
+    return;
+  }
+  task->segments = segments;
+  task->segments.clear_conversion_segments();
+  task->history_fingerprint = GetHistoryFingerprint(request, task->segments);
+  task->settings_fingerprint = GetSettingsFingerprint(request);
+
+  task_ = task;
+  GetThreadPool()->Schedule([task = std::move(task)] { RunTask(task); });
+}
+
+bool SpeculativeSuggester::Lookup(const ConversionRequest &request,
+                                  Segments *segments) const {
+  DCHECK(segments);
+  DCHECK_EQ(segments->conversion_segments_size(), 0);
+  if (task_ == nullptr || !request.has_composer() ||
+      task_->history_fingerprint != GetHistoryFingerprint(request, *segments) ||
+      task_->settings_fingerprint != GetSettingsFingerprint(request)) {
+    return false;
+  }
+  std::string key;
+  request.composer().GetQueryForPrediction(&key);
+
+  absl::MutexLock lock(&task_->mutex);
+  const auto it = task_->results.find(key);
+  if (it == task_->results.end()) {
+    return false;
+  }
+  *segments = it->second;
+  return true;
+}
+
+void SpeculativeSuggester::Cancel() {
+  if (task_ == nullptr) {
+    return;
+  }
+  task_->cancelled = true;
+  {
+    // Wakes up the task waiting for the foreground to finish.
+    absl::MutexLock lock(&g_foreground_mutex);
+  }
+  {
+    // Waits for the suggestion in progress, which uses the converter.
+    absl::MutexLock lock(&task_->mutex);
+    task_->mutex.Await(absl::Condition(
+        +[](bool *running) { return !*running; }, &task_->running));
+  }
+  task_.reset();
+}
+
+void SpeculativeSuggester::WaitForTesting() const {
+  if (task_ == nullptr) {
+    return;
+  }
+  absl::MutexLock lock(&task_->mutex);
+  task_->mutex.Await(absl::Condition(
+      +[](bool *finished) { return *finished; }, &task_->finished));
+}
+
+// static
+void SpeculativeSuggester::RunTask(const std::shared_ptr<Task> &task) {
+  absl::Cleanup finish = [&task] {
+    absl::MutexLock lock(&task->mutex);
+    task->finished = true;
+  };
+  for (const composer::Composer &composer : task->composers) {
+    {
+      // Yields to the foreground commands between the suggestions.
+      absl::MutexLock lock(&g_foreground_mutex);
+      g_foreground_mutex.Await(absl::Condition(
+          +[](Task *task) ABSL_EXCLUSIVE_LOCKS_REQUIRED(g_foreground_mutex) {
+            return g_foreground_count == 0 || task->cancelled;
+          },
+          task.get()));
+    }
+    {
+      absl::MutexLock lock(&task->mutex);
+      if (task->cancelled) {
+        return;
+      }
+      task->running = true;
+    }
+    std::string key;
+    composer.GetQueryForPrediction(&key);
+    ConversionRequest request = task->conversion_request;
+    request.set_composer(&composer);
+    Segments segments = task->segments;
+    const bool result =
+        task->converter->StartSuggestionForRequest(request, &segments);
+
+    absl::MutexLock lock(&task->mutex);
+    task->running = false;
+    if (result) {
+      task->results.emplace(std::move(key), std::move(segments));
+    }
+  }
+}
+
+}  // namespace session
+}  // namespace mozc
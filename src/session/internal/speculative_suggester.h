@@ -0,0 +1,106 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Precomputes the suggestions for the likely next key inputs while the
+// server is idle between keystrokes.
+
+#ifndef MOZC_SESSION_INTERNAL_SPECULATIVE_SUGGESTER_H_
+#define MOZC_SESSION_INTERNAL_SPECULATIVE_SUGGESTER_H_
+
+#include <memory>
+
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+namespace session {
+
+// Runs the suggestion for the composition followed by each input completing
+// the pending romaji (e.g. "a", "i", "u", ... after "k") on a background
+// thread, and keeps the results until the next Start().  The next Suggest()
+// takes the result from Lookup() instead of calling the converter.
+//
+// The converter passed to Start() must be safe to call from the background
+// thread, e.g. the one serialized by SerializedEngine.  The background task
+// starts a suggestion only while no ForegroundScope exists, so it uses the
+// converter while the server is idle and yields to the commands between the
+// suggestions.  The results are keyed by the prediction query, the history
+// segments and the request and config.  They may miss the user history learned
+// by the other sessions in the meantime, which is fixed on the following
+// keystroke.
+class SpeculativeSuggester {
+ public:
+  // Keeps the background tasks from starting the next suggestion while alive.
+  // Held for each command evaluation.  The scopes don't exclude each other.
+  class ForegroundScope {
+   public:
+    ForegroundScope();
+    ForegroundScope(const ForegroundScope &) = delete;
+    ForegroundScope &operator=(const ForegroundScope &) = delete;
+    ~ForegroundScope();
+  };
+
+  SpeculativeSuggester() = default;
+  SpeculativeSuggester(const SpeculativeSuggester &) = delete;
+  SpeculativeSuggester &operator=(const SpeculativeSuggester &) = delete;
+  ~SpeculativeSuggester();
+
+  // Returns true if --speculative_suggestion is set.
+  static bool IsEnabled();
+
+  // Starts precomputing the suggestions for the next inputs of the composer
+  // of |request|.  |segments| provides the history segments.  The composer,
+  // the request and the config are copied, and the previous results are
+  // discarded.  |converter| must outlive this object.
+  void Start(const ConverterInterface *converter,
+             const ConversionRequest &request, const Segments &segments);
+
+  // Replaces |segments| with the precomputed suggestion for |request| and
+  // returns true if available.  |segments| must have no conversion segment.
+  bool Lookup(const ConversionRequest &request, Segments *segments) const;
+
+  // Discards the results.  Waits for the suggestion in progress if any.
+  void Cancel();
+
+  // Waits until the task started by Start() finishes or is cancelled.
+  void WaitForTesting() const;
+
+ private:
+  struct Task;
+
+  static void RunTask(const std::shared_ptr<Task> &task);
+
+  std::shared_ptr<Task> task_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_INTERNAL_SPECULATIVE_SUGGESTER_H_
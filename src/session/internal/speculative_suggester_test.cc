@@ -0,0 +1,287 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/internal/speculative_suggester.h"
+
+#include <string>
+
+#include "base/thread2.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+using ::testing::_;
+using ::testing::Between;
+
+class SpeculativeSuggesterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    table_.AddRule("ka", "か", "");
+    table_.AddRule("ki", "き", "");
+    table_.AddRule("ku", "く", "");
+    composer_ = composer::Composer(&table_, &request_, &config_);
+  }
+
+  ConversionRequest CreateRequest(const composer::Composer &composer) {
+    return ConversionRequest(&composer, &request_, &config_);
+  }
+
+  // Expects |num_calls| suggestions, which return the query with "!".
+  void ExpectSuggestions(int num_calls, absl::BlockingCounter *counter) {
+    EXPECT_CALL(converter_, StartSuggestionForRequest(_, _))
+        .Times(num_calls)
+        .WillRepeatedly([counter](const ConversionRequest &request,
+                                  Segments *segments) {
+          std::string key;
+          request.composer().GetQueryForPrediction(&key);
+          Segment *segment = segments->add_segment();
+          segment->set_key(key);
+          segment->add_candidate()->value = absl::StrCat(key, "!");
+          counter->DecrementCount();
+          return true;
+        });
+  }
+
+  composer::Table table_;
+  commands::Request request_;
+  config::Config config_;
+  composer::Composer composer_;
+  StrictMockConverter converter_;
+};
+
+TEST_F(SpeculativeSuggesterTest, LookupPrecomputedSuggestions) {
+  absl::BlockingCounter counter(3);
+  ExpectSuggestions(3, &counter);
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+  counter.Wait();
+  suggester.WaitForTesting();
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  for (const char *input : {"a", "i", "u"}) {
+    composer::Composer next = composer_;
+    next.InsertCharacter(input);
+    std::string key;
+    next.GetQueryForPrediction(&key);
+
+    Segments segments;
+    ASSERT_TRUE(suggester.Lookup(CreateRequest(next), &segments));
+    ASSERT_EQ(segments.conversion_segments_size(), 1);
+    EXPECT_EQ(segments.conversion_segment(0).key(), key);
+    EXPECT_EQ(segments.conversion_segment(0).candidate(0).value,
+              absl::StrCat(key, "!"));
+  }
+
+  // Not precomputed.
+  composer::Composer next = composer_;
+  next.InsertCharacter("k");
+  Segments segments;
+  EXPECT_FALSE(suggester.Lookup(CreateRequest(next), &segments));
+}
+
+TEST_F(SpeculativeSuggesterTest, LookupFailsWithDifferentHistory) {
+  absl::BlockingCounter counter(3);
+  ExpectSuggestions(3, &counter);
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+  counter.Wait();
+  suggester.WaitForTesting();
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  composer::Composer next = composer_;
+  next.InsertCharacter("a");
+  Segments segments;
+  Segment *history = segments.add_segment();
+  history->set_segment_type(Segment::HISTORY);
+  history->set_key("きょう");
+  history->add_candidate()->value = "今日";
+  EXPECT_FALSE(suggester.Lookup(CreateRequest(next), &segments));
+}
+
+TEST_F(SpeculativeSuggesterTest, SameAsKeystroke) {
+  absl::BlockingCounter counter(4);
+  // Returns the preedit in addition to the query so that the composers of the
+  // speculation and the keystroke are compared.
+  EXPECT_CALL(converter_, StartSuggestionForRequest(_, _))
+      .Times(4)
+      .WillRepeatedly([&counter](const ConversionRequest &request,
+                                 Segments *segments) {
+        std::string key, preedit;
+        request.composer().GetQueryForPrediction(&key);
+        request.composer().GetStringForPreedit(&preedit);
+        Segment *segment = segments->add_segment();
+        segment->set_key(key);
+        segment->add_candidate()->value = absl::StrCat(key, ":", preedit);
+        counter.DecrementCount();
+        return true;
+      });
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+
+  // The keystroke of "a" as the session sends it to the composer.
+  composer::Composer next = composer_;
+  commands::KeyEvent key;
+  key.set_key_code('a');
+  ASSERT_TRUE(next.InsertCharacterKeyEvent(key));
+  Segments expected;
+  ASSERT_TRUE(
+      converter_.StartSuggestionForRequest(CreateRequest(next), &expected));
+  counter.Wait();
+  suggester.WaitForTesting();
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  Segments segments;
+  ASSERT_TRUE(suggester.Lookup(CreateRequest(next), &segments));
+  ASSERT_EQ(segments.conversion_segments_size(), 1);
+  EXPECT_EQ(segments.conversion_segment(0).key(),
+            expected.conversion_segment(0).key());
+  EXPECT_EQ(segments.conversion_segment(0).candidate(0).value,
+            expected.conversion_segment(0).candidate(0).value);
+}
+
+TEST_F(SpeculativeSuggesterTest, LookupFailsWithDifferentConfig) {
+  absl::BlockingCounter counter(3);
+  ExpectSuggestions(3, &counter);
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+  counter.Wait();
+  suggester.WaitForTesting();
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  composer::Composer next = composer_;
+  next.InsertCharacter("a");
+  config_.set_use_realtime_conversion(!config_.use_realtime_conversion());
+  Segments segments;
+  EXPECT_FALSE(suggester.Lookup(CreateRequest(next), &segments));
+
+  config_.set_use_realtime_conversion(!config_.use_realtime_conversion());
+  request_.set_mixed_conversion(!request_.mixed_conversion());
+  EXPECT_FALSE(suggester.Lookup(CreateRequest(next), &segments));
+}
+
+TEST_F(SpeculativeSuggesterTest, NoPendingInput) {
+  EXPECT_CALL(converter_, StartSuggestionForRequest(_, _)).Times(0);
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("ka");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  Segments segments;
+  EXPECT_FALSE(suggester.Lookup(CreateRequest(composer_), &segments));
+}
+
+TEST_F(SpeculativeSuggesterTest, Cancel) {
+  absl::BlockingCounter counter(3);
+  ExpectSuggestions(3, &counter);
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+  counter.Wait();
+  suggester.WaitForTesting();
+  suggester.Cancel();
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  composer::Composer next = composer_;
+  next.InsertCharacter("a");
+  Segments segments;
+  EXPECT_FALSE(suggester.Lookup(CreateRequest(next), &segments));
+}
+
+TEST_F(SpeculativeSuggesterTest, WaitsForForeground) {
+  absl::Notification suggested;
+  EXPECT_CALL(converter_, StartSuggestionForRequest(_, _))
+      .Times(Between(1, 3))
+      .WillRepeatedly([&suggested](const ConversionRequest &request,
+                                   Segments *segments) {
+        if (!suggested.HasBeenNotified()) {
+          suggested.Notify();
+        }
+        return false;
+      });
+
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  {
+    const SpeculativeSuggester::ForegroundScope scope;
+    suggester.Start(&converter_, CreateRequest(composer_), Segments());
+    // No suggestion starts while the scope is alive.
+    EXPECT_FALSE(suggested.WaitForNotificationWithTimeout(absl::Seconds(0.1)));
+  }
+  suggested.WaitForNotification();
+}
+
+TEST_F(SpeculativeSuggesterTest, ForegroundScopesDontExcludeEachOther) {
+  const SpeculativeSuggester::ForegroundScope scope;
+  absl::Notification done;
+  Thread2 other([&done] {
+    const SpeculativeSuggester::ForegroundScope other_scope;
+    done.Notify();
+  });
+  EXPECT_TRUE(done.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  other.Join();
+}
+
+TEST_F(SpeculativeSuggesterTest, CancelWhileWaitingForForeground) {
+  EXPECT_CALL(converter_, StartSuggestionForRequest(_, _)).Times(0);
+
+  const SpeculativeSuggester::ForegroundScope scope;
+  SpeculativeSuggester suggester;
+  composer_.InsertCharacter("k");
+  suggester.Start(&converter_, CreateRequest(composer_), Segments());
+  // Returns without waiting for the foreground to finish.
+  suggester.Cancel();
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
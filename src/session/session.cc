@@ -2743,6 +2743,12 @@ void Session::OutputFromState(commands::Command *command) {
 
 void Session::Output(commands::Command *command) {
   OutputMode(command);
+  if (context_->client_capability().candidate_window_delta()) {
+    context_->mutable_converter()->PopOutputWithCandidateWindowDelta(
+        context_->composer(), command->input().candidate_window_version(),
+        command->mutable_output());
+    return;
+  }
   context_->mutable_converter()->PopOutput(context_->composer(),
                                            command->mutable_output());
 }
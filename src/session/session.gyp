@@ -66,6 +66,7 @@
         'internal/ime_context.cc',
         'internal/session_output.cc',
         'internal/key_event_transformer.cc',
+        'internal/speculative_suggester.cc',
       ],
       'dependencies': [
         '../base/absl.gyp:absl_strings',
@@ -104,6 +105,7 @@
         '../config/config.gyp:config_handler',
         '../dictionary/dictionary_base.gyp:user_dictionary',
         '../engine/engine.gyp:engine_factory',
+        '../engine/engine.gyp:serialized_engine',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../protocol/protocol.gyp:engine_builder_proto',
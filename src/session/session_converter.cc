@@ -32,6 +32,7 @@
 #include "session/session_converter.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -50,6 +51,7 @@
 #include "request/conversion_request.h"
 #include "session/internal/candidate_list.h"
 #include "session/internal/session_output.h"
+#include "session/internal/speculative_suggester.h"
 #include "session/session_converter_interface.h"
 #include "session/session_usage_stats_util.h"
 #include "transliteration/transliteration.h"
@@ -134,7 +136,6 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
     : SessionConverterInterface(),
       converter_(converter),
       segments_(new Segments),
-      incognito_segments_(new Segments),
       segment_index_(0),
       result_(new commands::Result),
       candidate_list_(new CandidateList(true)),
@@ -142,7 +143,10 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
       state_(COMPOSITION),
       request_type_(ConversionRequest::CONVERSION),
       client_revision_(0),
-      candidate_list_visible_(false) {
+      candidate_list_visible_(false),
+      candidate_window_version_(0),
+      last_candidate_page_begin_(0),
+      last_candidate_list_visible_(false) {
   conversion_preferences_.use_history = true;
   conversion_preferences_.max_history_size = kDefaultMaxHistorySize;
   conversion_preferences_.request_suggestion = true;
@@ -482,9 +486,16 @@ bool SessionConverter::SuggestWithPreferences(
       SetRequestType(ConversionRequest::SUGGESTION, &conversion_request);
     }
   }
+  // The speculative suggestion is precomputed only for the plain suggestion.
+  const bool use_speculative_suggestion =
+      !use_prediction_candidate && !use_partial_composition &&
+      !request_->fill_incognito_candidate_words();
   // Start actual suggestion/prediction.
   bool result;
-  if (use_partial_composition) {
+  if (use_speculative_suggestion &&
+      speculative_suggester_.Lookup(conversion_request, segments_.get())) {
+    result = true;
+  } else if (use_partial_composition) {
     result = converter_->StartPartialPredictionForRequest(conversion_request,
                                                           segments_.get());
   } else {
@@ -496,6 +507,9 @@ bool SessionConverter::SuggestWithPreferences(
                                                      segments_.get());
     }
   }
+  if (use_speculative_suggestion && SpeculativeSuggester::IsEnabled()) {
+    speculative_suggester_.Start(converter_, conversion_request, *segments_);
+  }
   if (!result) {
     VLOG(1) << "Start(Partial?)(Suggestion|Prediction)ForRequest() returns no "
                "suggestions.";
@@ -510,6 +524,9 @@ bool SessionConverter::SuggestWithPreferences(
     const Config incognito_config = CreateIncognitoConfig();
     const ConversionRequest incognito_conversion_request =
         CreateIncognitoConversionRequest(conversion_request, incognito_config);
+    if (incognito_segments_ == nullptr) {
+      incognito_segments_ = std::make_unique<Segments>();
+    }
     incognito_segments_->Clear();
     if (use_partial_composition) {
       result = converter_->StartPartialSuggestionForRequest(
@@ -1083,6 +1100,21 @@ void SessionConverter::PopOutput(const composer::Composer &composer,
   ResetResult();
 }
 
+void SessionConverter::PopOutputWithCandidateWindowDelta(
+    const composer::Composer &composer,
+    uint64_t client_candidate_window_version, commands::Output *output) {
+  if (!output) {
+    LOG(ERROR) << "output is nullptr.";
+    return;
+  }
+  FillOutputInternal(composer, false, output);
+  if (IsActive() && CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
+    FillCandidateWindowWithDelta(client_candidate_window_version, output);
+  }
+  updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
+  ResetResult();
+}
+
 namespace {
 void MaybeFillConfig(Segment::Candidate::Command command,
                      const config::Config &base_config,
@@ -1118,6 +1150,13 @@ void SessionConverter::FillOutput(const composer::Composer &composer,
     LOG(ERROR) << "output is nullptr.";
     return;
   }
+  FillOutputInternal(composer, true, output);
+}
+
+void SessionConverter::FillOutputInternal(const composer::Composer &composer,
+                                          bool fill_candidate_window,
+                                          commands::Output *output) const {
+  DCHECK(output);
   if (result_->has_value()) {
     FillResult(output->mutable_result());
   }
@@ -1145,13 +1184,15 @@ void SessionConverter::FillOutput(const composer::Composer &composer,
     FillConversion(output->mutable_preedit());
   }
   // Candidate list
-  if (CheckState(SUGGESTION | PREDICTION | CONVERSION) &&
+  if (fill_candidate_window &&
+      CheckState(SUGGESTION | PREDICTION | CONVERSION) &&
       candidate_list_visible_) {
     FillCandidates(output->mutable_candidates());
   }
 
   // All candidate words
-  if (CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
+  if (fill_candidate_window &&
+      CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
     FillAllCandidateWords(output->mutable_all_candidate_words());
     if (request_->fill_incognito_candidate_words()) {
       FillIncognitoCandidateWords(output->mutable_incognito_candidate_words());
@@ -1187,7 +1228,10 @@ SessionConverter *SessionConverter::Clone() const {
   // singleton. However, we should refactor such bad design; see also the
   // comment right above.
   *session_converter->segments_ = *segments_;
-  *session_converter->incognito_segments_ = *incognito_segments_;
+  if (incognito_segments_ != nullptr) {
+    session_converter->incognito_segments_ =
+        std::make_unique<Segments>(*incognito_segments_);
+  }
   session_converter->segment_index_ = segment_index_;
   session_converter->previous_suggestions_ = previous_suggestions_;
   session_converter->conversion_preferences_ = conversion_preferences();
@@ -1217,7 +1261,7 @@ void SessionConverter::ResetState() {
   candidate_list_visible_ = false;
   candidate_list_->Clear();
   selected_candidate_indices_.clear();
-  incognito_segments_->Clear();
+  incognito_segments_.reset();
 }
 
 void SessionConverter::SegmentFocus() {
@@ -1362,6 +1406,7 @@ int GetT13nId(const transliteration::TransliterationType type) {
 
 void SessionConverter::AppendCandidateList() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
+  UpdateCandidateWindowVersion();
 
   // Meta candidates are added iff |candidate_list_| is empty.
   // This is because if |candidate_list_| is not empty we cannot decide
@@ -1472,6 +1517,74 @@ void SessionConverter::FillConversion(commands::Preedit *preedit) const {
                                 candidate_list_->focused_id(), preedit);
 }
 
+void SessionConverter::FillCandidateWindowWithDelta(
+    uint64_t client_candidate_window_version, commands::Output *output) {
+  DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
+  output->set_candidate_window_version(candidate_window_version_);
+
+  // The page of the candidate window is small enough to be filled every time.
+  // Its focus, usages and footer are what the delta consists of.
+  commands::Candidates candidates;
+  size_t page_begin = 0;
+  if (candidate_list_visible_) {
+    FillCandidates(&candidates);
+    size_t page_end = 0;
+    candidate_list_->GetPageRange(candidate_list_->focused_index(),
+                                  &page_begin, &page_end);
+  }
+
+  // Cascading windows are always sent in full as the focused sub candidate
+  // list is not tracked.
+  const bool use_delta =
+      client_candidate_window_version == candidate_window_version_ &&
+      candidate_list_visible_ == last_candidate_list_visible_ &&
+      !candidates.has_subcandidates();
+  last_candidate_list_visible_ = candidate_list_visible_;
+  if (!use_delta) {
+    last_candidate_page_begin_ = page_begin;
+    if (candidate_list_visible_) {
+      output->mutable_candidates()->Swap(&candidates);
+    }
+    FillAllCandidateWords(output->mutable_all_candidate_words());
+    if (request_->fill_incognito_candidate_words()) {
+      FillIncognitoCandidateWords(output->mutable_incognito_candidate_words());
+    }
+    return;
+  }
+
+  commands::CandidateWindowDelta *delta =
+      output->mutable_candidate_window_delta();
+  if (candidates.has_focused_index()) {
+    delta->set_focused_index(candidates.focused_index());
+  }
+  if (candidates.usages().has_focused_index()) {
+    delta->set_usages_focused_index(candidates.usages().focused_index());
+  }
+  if (candidates.has_footer()) {
+    *delta->mutable_footer() = candidates.footer();
+  }
+  const int all_candidate_words_focused_index =
+      SessionOutput::GetAllCandidateWordsFocusedIndex(*candidate_list_);
+  if (all_candidate_words_focused_index >= 0) {
+    delta->set_all_candidate_words_focused_index(
+        all_candidate_words_focused_index);
+  }
+
+  // The page is changed.  Send the new page, which the client holds from now.
+  if (candidate_list_visible_ && page_begin != last_candidate_page_begin_) {
+    last_candidate_page_begin_ = page_begin;
+    output->mutable_candidates()->Swap(&candidates);
+  }
+}
+
+void SessionConverter::UpdateCandidateWindowVersion() {
+  // Versions are unique in the process so that the lists of a cloned or
+  // restored converter are never mistaken for the ones the client holds.
+  static std::atomic<uint64_t> next_version(1);
+  candidate_window_version_ =
+      next_version.fetch_add(1, std::memory_order_relaxed);
+}
+
 void SessionConverter::FillResult(commands::Result *result) const {
   *result = *result_;
 }
@@ -1600,6 +1713,9 @@ void SessionConverter::FillAllCandidateWords(
 
 void SessionConverter::FillIncognitoCandidateWords(
     commands::CandidateList *candidates) const {
+  if (incognito_segments_ == nullptr) {
+    return;
+  }
   const Segment &segment =
       incognito_segments_->conversion_segment(segment_index_);
   for (size_t i = 0; i < segment.candidates_size(); ++i) {
@@ -1615,15 +1731,19 @@ void SessionConverter::FillIncognitoCandidateWords(
 }
 
 void SessionConverter::SetRequest(const commands::Request *request) {
+  speculative_suggester_.Cancel();
   request_ = request;
   candidate_list_->set_page_size(request->candidate_page_size());
+  UpdateCandidateWindowVersion();
 }
 
 void SessionConverter::SetConfig(const config::Config *config) {
+  speculative_suggester_.Cancel();
   config_ = config;
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   selection_shortcut_ = config->selection_shortcut();
   use_cascading_window_ = config->use_cascading_window();
+  UpdateCandidateWindowVersion();
 }
 
 void SessionConverter::OnStartComposition(const commands::Context &context) {
@@ -45,6 +45,7 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "session/internal/candidate_list.h"
+#include "session/internal/speculative_suggester.h"
 #include "session/session_converter_interface.h"
 #include "transliteration/transliteration.h"
 
@@ -227,6 +228,13 @@ class SessionConverter : public SessionConverterInterface {
   void PopOutput(const composer::Composer &composer,
                  commands::Output *output) override;
 
+  // Fills protocol buffers and update the internal status.  The candidate
+  // lists are replaced with a focus delta if the client already holds them.
+  void PopOutputWithCandidateWindowDelta(
+      const composer::Composer &composer,
+      uint64_t client_candidate_window_version,
+      commands::Output *output) override;
+
   // Fills protocol buffers
   void FillOutput(const composer::Composer &composer,
                   commands::Output *output) const override;
@@ -253,6 +261,7 @@ class SessionConverter : public SessionConverterInterface {
   void set_selection_shortcut(
       config::Config::SelectionShortcut selection_shortcut) override {
     selection_shortcut_ = selection_shortcut;
+    UpdateCandidateWindowVersion();
   }
 
   void set_use_cascading_window(bool use_cascading_window) override {
@@ -338,6 +347,21 @@ class SessionConverter : public SessionConverterInterface {
   void FillResult(commands::Result *result) const;
   void FillCandidates(commands::Candidates *candidates) const;
 
+  // Fills |output| except the candidate lists when |fill_candidate_window| is
+  // false.
+  void FillOutputInternal(const composer::Composer &composer,
+                          bool fill_candidate_window,
+                          commands::Output *output) const;
+
+  // Fills the candidate lists of |output|, or the delta from the lists of
+  // |client_candidate_window_version| if the client holds the current ones.
+  void FillCandidateWindowWithDelta(uint64_t client_candidate_window_version,
+                                    commands::Output *output);
+
+  // Assigns a new version to the candidate lists.  Called whenever the
+  // content of the candidate lists is changed.
+  void UpdateCandidateWindowVersion();
+
   // Fills protocol buffers with all flatten candidate words.
   void FillAllCandidateWords(commands::CandidateList *candidates) const;
   void FillIncognitoCandidateWords(commands::CandidateList *candidates) const;
@@ -363,12 +387,16 @@ class SessionConverter : public SessionConverterInterface {
   const ConverterInterface *converter_;
   std::unique_ptr<Segments> segments_;
 
+  // Allocated only when the incognito candidates are requested.
   std::unique_ptr<Segments> incognito_segments_;
   size_t segment_index_;
 
   // Previous suggestions to be merged with the current predictions.
   Segment previous_suggestions_;
 
+  // Suggestions precomputed for the likely next key inputs.
+  SpeculativeSuggester speculative_suggester_;
+
   std::unique_ptr<commands::Result> result_;
 
   std::unique_ptr<CandidateList> candidate_list_;
@@ -401,6 +429,13 @@ class SessionConverter : public SessionConverterInterface {
 
   bool candidate_list_visible_;
 
+  // Version of the current candidate lists, unique in the process.
+  uint64_t candidate_window_version_;
+  // Page and visibility of the candidate window last sent by
+  // PopOutputWithCandidateWindowDelta().
+  size_t last_candidate_page_begin_;
+  bool last_candidate_list_visible_;
+
   // Mutable values of |config_|.  These values may be changed temporaliry per
   // session.
   bool use_cascading_window_;
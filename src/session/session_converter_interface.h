@@ -33,6 +33,7 @@
 #define MOZC_SESSION_SESSION_CONVERTER_INTERFACE_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include "composer/composer.h"
@@ -215,6 +216,14 @@ class SessionConverterInterface {
   virtual void PopOutput(const composer::Composer &composer,
                          commands::Output *output) = 0;
 
+  // Fill protocol buffers and update internal status like PopOutput().  The
+  // candidate lists are replaced with a focus delta when the client already
+  // holds the lists of |client_candidate_window_version|.  See
+  // commands::Capability::candidate_window_delta.
+  virtual void PopOutputWithCandidateWindowDelta(
+      const composer::Composer &composer,
+      uint64_t client_candidate_window_version, commands::Output *output) = 0;
+
   // Fill protocol buffers
   virtual void FillOutput(const composer::Composer &composer,
                           commands::Output *output) const = 0;
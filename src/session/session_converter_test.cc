@@ -478,6 +478,60 @@ TEST_F(SessionConverterTest, Convert) {
   EXPECT_COUNT_STATS("ConversionCandidates0", 1);
 }
 
+TEST_F(SessionConverterTest, PopOutputWithCandidateWindowDelta) {
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+  converter.set_use_cascading_window(false);
+  {
+    Segments segments;
+    SetAiueo(&segments);
+    FillT13Ns(&segments, composer_.get());
+    EXPECT_CALL(mock_converter, StartConversionForRequest(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  }
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  converter.CandidateNext(*composer_);
+
+  // The client holds nothing.  The full candidate lists are sent.
+  commands::Output output;
+  converter.PopOutputWithCandidateWindowDelta(*composer_, 0, &output);
+  ASSERT_TRUE(output.has_candidate_window_version());
+  const uint64_t version = output.candidate_window_version();
+  EXPECT_NE(version, 0);
+  EXPECT_TRUE(output.has_candidates());
+  EXPECT_TRUE(output.has_all_candidate_words());
+  EXPECT_FALSE(output.has_candidate_window_delta());
+
+  // Only the focus change is sent while the client holds the lists.
+  converter.CandidateNext(*composer_);
+  output.Clear();
+  converter.PopOutputWithCandidateWindowDelta(*composer_, version, &output);
+  EXPECT_EQ(output.candidate_window_version(), version);
+  EXPECT_TRUE(output.has_preedit());
+  EXPECT_FALSE(output.has_candidates());
+  EXPECT_FALSE(output.has_all_candidate_words());
+  ASSERT_TRUE(output.has_candidate_window_delta());
+
+  commands::Output full_output;
+  converter.FillOutput(*composer_, &full_output);
+  const commands::CandidateWindowDelta &delta = output.candidate_window_delta();
+  EXPECT_EQ(delta.focused_index(), full_output.candidates().focused_index());
+  EXPECT_EQ(delta.all_candidate_words_focused_index(),
+            full_output.all_candidate_words().focused_index());
+  EXPECT_EQ(delta.footer().SerializeAsString(),
+            full_output.candidates().footer().SerializeAsString());
+
+  // The full lists are sent again if the client lost them.
+  output.Clear();
+  converter.PopOutputWithCandidateWindowDelta(*composer_, 0, &output);
+  EXPECT_EQ(output.candidate_window_version(), version);
+  EXPECT_TRUE(output.has_candidates());
+  EXPECT_TRUE(output.has_all_candidate_words());
+  EXPECT_FALSE(output.has_candidate_window_delta());
+}
+
 TEST_F(SessionConverterTest, ConvertWithSpellingCorrection) {
   MockConverter mock_converter;
   SessionConverter converter(&mock_converter, request_.get(), config_.get());
@@ -43,6 +43,7 @@
 #include "base/clock.h"
 #include "base/logging.h"
 #include "base/stopwatch.h"
+#include "base/thread2.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
 #include "config/config_handler.h"
@@ -56,9 +57,11 @@
 #include "protocol/user_dictionary_storage.pb.h"
 #include "session/common.h"
 #include "session/internal/keymap.h"
+#include "session/internal/speculative_suggester.h"
 #include "session/session.h"
 #include "session/session_interface.h"
 #include "session/session_observer_handler.h"
+#include "usage_stats/latency_stats.h"
 #include "usage_stats/usage_stats.h"
 #include "absl/flags/flag.h"
 #include "absl/random/random.h"
@@ -106,6 +109,11 @@ namespace {
 
 using mozc::usage_stats::UsageStats;
 
+// The number of key events after which the pages of the data set touched so
+// far are recorded for the prefetch on the next launch.  It roughly covers the
+// first few sentences.
+constexpr uint32_t kPrefetchManifestKeyCount = 200;
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   const commands::ApplicationInfo &info = session->application_info();
@@ -185,12 +193,14 @@ void SessionHandler::Init(
   if (!engine_) {
     return;
   }
+  serialized_engine_ = std::make_unique<SerializedEngine>(engine_.get());
 
   // everything is OK
   is_available_ = true;
 }
 
 SessionHandler::~SessionHandler() {
+  JoinPrefetchManifestThread();
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != nullptr; element = element->next) {
@@ -198,6 +208,7 @@ SessionHandler::~SessionHandler() {
     element->value = nullptr;
   }
   session_map_->Clear();
+  session_mutexes_.clear();
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   if (session_watch_dog_->IsRunning()) {
     session_watch_dog_->Terminate();
@@ -205,6 +216,13 @@ SessionHandler::~SessionHandler() {
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 }
 
+void SessionHandler::JoinPrefetchManifestThread() {
+  if (prefetch_manifest_thread_.has_value()) {
+    prefetch_manifest_thread_->Join();
+    prefetch_manifest_thread_.reset();
+  }
+}
+
 bool SessionHandler::IsAvailable() const { return is_available_; }
 
 bool SessionHandler::StartWatchDog() {
@@ -259,7 +277,7 @@ void SessionHandler::UpdateSessions(const config::Config &config,
 
 bool SessionHandler::SyncData(commands::Command *command) {
   VLOG(1) << "Syncing user data";
-  engine_->GetUserDataManager()->Sync();
+  serialized_engine_->GetUserDataManager()->Sync();
   return true;
 }
 
@@ -274,27 +292,27 @@ bool SessionHandler::Shutdown(commands::Command *command) {
 bool SessionHandler::Reload(commands::Command *command) {
   VLOG(1) << "Reloading server";
   UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
-  engine_->Reload();
+  serialized_engine_->Reload();
   return true;
 }
 
 bool SessionHandler::ClearUserHistory(commands::Command *command) {
   VLOG(1) << "Clearing user history";
-  engine_->GetUserDataManager()->ClearUserHistory();
+  serialized_engine_->GetUserDataManager()->ClearUserHistory();
   UsageStats::IncrementCount("ClearUserHistory");
   return true;
 }
 
 bool SessionHandler::ClearUserPrediction(commands::Command *command) {
   VLOG(1) << "Clearing user prediction";
-  engine_->GetUserDataManager()->ClearUserPrediction();
+  serialized_engine_->GetUserDataManager()->ClearUserPrediction();
   UsageStats::IncrementCount("ClearUserPrediction");
   return true;
 }
 
 bool SessionHandler::ClearUnusedUserPrediction(commands::Command *command) {
   VLOG(1) << "Clearing unused user prediction";
-  engine_->GetUserDataManager()->ClearUnusedUserPrediction();
+  serialized_engine_->GetUserDataManager()->ClearUnusedUserPrediction();
   UsageStats::IncrementCount("ClearUnusedUserPrediction");
   return true;
 }
@@ -338,10 +356,75 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     return false;
   }
 
+  // Keeps the speculative suggestion from starting while the commands run.
+  const session::SpeculativeSuggester::ForegroundScope foreground_scope;
+
   bool eval_succeeded = false;
   Stopwatch stopwatch;
   stopwatch.Start();
 
+  const commands::Input::CommandType type = command->input().type();
+  if (IsSessionCommand(type)) {
+    absl::ReaderMutexLock l(&mutex_);
+    eval_succeeded = DispatchCommand(command);
+  } else {
+    absl::WriterMutexLock l(&mutex_);
+    eval_succeeded = DispatchCommand(command);
+  }
+
+  // A key or a command to a session may update the config, which is shared by
+  // all the sessions.
+  if (eval_succeeded &&
+      (type == commands::Input::SEND_KEY ||
+       type == commands::Input::SEND_COMMAND) &&
+      command->output().has_config()) {
+    absl::WriterMutexLock l(&mutex_);
+    MaybeUpdateConfig(command);
+  }
+
+  if (eval_succeeded) {
+    UsageStats::IncrementCount("SessionAllEvent");
+    if (type != commands::Input::CREATE_SESSION) {
+      // Fill a session ID even if command->input() doesn't have a id to ensure
+      // that response size should not be 0, which causes disconnection of IPC.
+      command->mutable_output()->set_id(command->input().id());
+    }
+  } else {
+    command->mutable_output()->set_id(0);
+    command->mutable_output()->set_error_code(
+        commands::Output::SESSION_FAILURE);
+  }
+
+  if (eval_succeeded) {
+    // TODO(komatsu): Make sre if checking eval_succeeded is necessary or not.
+    absl::MutexLock l(&observer_mutex_);
+    observer_handler_->EvalCommandHandler(*command);
+  }
+
+  stopwatch.Stop();
+  UsageStats::UpdateTiming(
+      "ElapsedTimeUSec",
+      static_cast<uint32_t>(absl::ToInt64Microseconds(stopwatch.GetElapsed())));
+  static const usage_stats::LatencyStats::StageId kEvalCommandStage =
+      usage_stats::LatencyStats::RegisterStage("SessionHandler.EvalCommand");
+  usage_stats::LatencyStats::Record(kEvalCommandStage, stopwatch.GetElapsed());
+
+  return is_available_;
+}
+
+bool SessionHandler::IsSessionCommand(commands::Input::CommandType type) {
+  switch (type) {
+    case commands::Input::SEND_KEY:
+    case commands::Input::TEST_SEND_KEY:
+    case commands::Input::SEND_COMMAND:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool SessionHandler::DispatchCommand(commands::Command *command) {
+  bool eval_succeeded = false;
   switch (command->input().type()) {
     case commands::Input::CREATE_SESSION:
       eval_succeeded = CreateSession(command);
@@ -403,42 +486,22 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::RELOAD_SPELL_CHECKER:
       eval_succeeded = ReloadSpellChecker(command);
       break;
+    case commands::Input::GET_LATENCY_STATS:
+      eval_succeeded = GetLatencyStats(command);
+      break;
     default:
       eval_succeeded = false;
   }
-
-  if (eval_succeeded) {
-    UsageStats::IncrementCount("SessionAllEvent");
-    if (command->input().type() != commands::Input::CREATE_SESSION) {
-      // Fill a session ID even if command->input() doesn't have a id to ensure
-      // that response size should not be 0, which causes disconnection of IPC.
-      command->mutable_output()->set_id(command->input().id());
-    }
-  } else {
-    command->mutable_output()->set_id(0);
-    command->mutable_output()->set_error_code(
-        commands::Output::SESSION_FAILURE);
-  }
-
-  if (eval_succeeded) {
-    // TODO(komatsu): Make sre if checking eval_succeeded is necessary or not.
-    observer_handler_->EvalCommandHandler(*command);
-  }
-
-  stopwatch.Stop();
-  UsageStats::UpdateTiming(
-      "ElapsedTimeUSec",
-      static_cast<uint32_t>(absl::ToInt64Microseconds(stopwatch.GetElapsed())));
-
-  return is_available_;
+  return eval_succeeded;
 }
 
 session::SessionInterface *SessionHandler::NewSession() {
   // Session doesn't take the ownership of engine.
-  return new session::Session(engine_.get());
+  return new session::Session(serialized_engine_.get());
 }
 
 void SessionHandler::AddObserver(session::SessionObserverInterface *observer) {
+  absl::MutexLock l(&observer_mutex_);
   observer_handler_->AddObserver(observer);
 }
 
@@ -451,39 +514,66 @@ void SessionHandler::MaybeUpdateConfig(commands::Command *command) {
   Reload(command);
 }
 
-bool SessionHandler::SendKey(commands::Command *command) {
-  const SessionID id = command->input().id();
+session::SessionInterface *SessionHandler::LookupSession(
+    SessionID id, absl::Mutex **session_mutex) {
+  absl::MutexLock l(&session_map_mutex_);
   session::SessionInterface **session = session_map_->MutableLookup(id);
   if (session == nullptr || *session == nullptr) {
+    return nullptr;
+  }
+  *session_mutex = session_mutexes_.at(id).get();
+  return *session;
+}
+
+bool SessionHandler::SendKey(commands::Command *command) {
+  const SessionID id = command->input().id();
+  absl::Mutex *session_mutex = nullptr;
+  session::SessionInterface *session = LookupSession(id, &session_mutex);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendKey(command);
-  MaybeUpdateConfig(command);
+  {
+    absl::MutexLock l(session_mutex);
+    session->SendKey(command);
+  }
+  // Only one command sees the count reach the threshold, and the thread is
+  // joined only by the exclusive commands.
+  if (++send_key_count_ == kPrefetchManifestKeyCount &&
+      engine_->GetDataManager() != nullptr) {
+    // Reading the page table and writing the file take a while, so they are
+    // done in the background not to delay the response to this key.
+    prefetch_manifest_thread_.emplace(
+        [data_manager = engine_->GetDataManager()] {
+          data_manager->SavePrefetchManifest();
+        });
+  }
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == nullptr || *session == nullptr) {
+  absl::Mutex *session_mutex = nullptr;
+  session::SessionInterface *session = LookupSession(id, &session_mutex);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->TestSendKey(command);
+  absl::MutexLock l(session_mutex);
+  session->TestSendKey(command);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
-  session::SessionInterface **session =
-      const_cast<session::SessionInterface **>(session_map_->Lookup(id));
-  if (session == nullptr || *session == nullptr) {
+  absl::Mutex *session_mutex = nullptr;
+  session::SessionInterface *session = LookupSession(id, &session_mutex);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendCommand(command);
-  MaybeUpdateConfig(command);
+  absl::MutexLock l(session_mutex);
+  session->SendCommand(command);
   return true;
 }
 
@@ -513,6 +603,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
     }
     delete oldest_element->value;
     oldest_element->value = nullptr;
+    session_mutexes_.erase(oldest_element->key);
     session_map_->Erase(oldest_element->key);
     VLOG(1) << "Session is FULL, oldest SessionID " << oldest_element->key
             << " is removed";
@@ -524,12 +615,15 @@ bool SessionHandler::CreateSession(commands::Command *command) {
         command->mutable_output()->mutable_engine_reload_response();
     engine_builder_->GetResponse(response);
     if (response->status() == EngineReloadResponse::RELOAD_READY) {
-      if (engine_->GetUserDataManager()) {
-        engine_->GetUserDataManager()->Wait();
+      if (serialized_engine_->GetUserDataManager()) {
+        serialized_engine_->GetUserDataManager()->Wait();
       }
+      JoinPrefetchManifestThread();
+      serialized_engine_.reset();
       engine_.reset();
       engine_ = engine_builder_->BuildFromPreparedData();
       LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
+      serialized_engine_ = std::make_unique<SerializedEngine>(engine_.get());
       table_manager_->ClearCaches();
       response->set_status(EngineReloadResponse::RELOADED);
     }
@@ -545,6 +639,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   const SessionID new_id = CreateNewSessionID();
   SessionElement *element = session_map_->Insert(new_id);
   element->value = session;
+  session_mutexes_[new_id] = std::make_unique<absl::Mutex>();
   command->mutable_output()->set_id(new_id);
 
   // The oldes item should be reused
@@ -574,8 +669,8 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
 bool SessionHandler::DeleteSession(commands::Command *command) {
   DeleteSessionID(command->input().id());
-  if (engine_->GetUserDataManager()) {
-    engine_->GetUserDataManager()->Sync();
+  if (serialized_engine_->GetUserDataManager()) {
+    serialized_engine_->GetUserDataManager()->Sync();
   }
   return true;
 }
@@ -646,7 +741,7 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   }
 
   // Sync all data. This is a regression bug fix http://b/3033708
-  engine_->GetUserDataManager()->Sync();
+  serialized_engine_->GetUserDataManager()->Sync();
 
   // timeout is enabled.
   if (absl::GetFlag(FLAGS_timeout) > 0 &&
@@ -699,6 +794,24 @@ bool SessionHandler::ReloadSpellChecker(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetLatencyStats(commands::Command *command) {
+  using usage_stats::LatencyStats;
+  commands::LatencyStats *output =
+      command->mutable_output()->mutable_latency_stats();
+  for (const LatencyStats::StageSnapshot &snapshot :
+       LatencyStats::GetSnapshot()) {
+    commands::LatencyStats::Stage *stage = output->add_stages();
+    stage->set_name(snapshot.name);
+    stage->set_count(snapshot.count);
+    stage->set_total_usec(snapshot.total_usec);
+    stage->set_max_usec(snapshot.max_usec);
+    stage->set_p50_usec(snapshot.GetPercentileUsec(50));
+    stage->set_p90_usec(snapshot.GetPercentileUsec(90));
+    stage->set_p99_usec(snapshot.GetPercentileUsec(99));
+  }
+  return true;
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   while (true) {
@@ -722,6 +835,7 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
   }
   delete *session;
 
+  session_mutexes_.erase(id);
   session_map_->Erase(id);  // remove from LRU
 
   // if session gets empty, save the timestamp
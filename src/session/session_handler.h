@@ -32,13 +32,17 @@
 #ifndef MOZC_SESSION_SESSION_HANDLER_H_
 #define MOZC_SESSION_SESSION_HANDLER_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <optional>
 
+#include "base/thread2.h"
 #include "composer/table.h"
 #include "dictionary/user_dictionary_session_handler.h"
 #include "engine/engine_builder_interface.h"
 #include "engine/engine_interface.h"
+#include "engine/serialized_engine.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/common.h"
@@ -48,8 +52,10 @@
 #include "session/session_observer_handler.h"
 #include "storage/lru_cache.h"
 #include "testing/gunit_prod.h"  // for FRIEND_TEST()
+#include "absl/container/flat_hash_map.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
@@ -97,6 +103,20 @@ class SessionHandler : public SessionHandlerInterface {
   void Init(std::unique_ptr<EngineInterface> engine,
             std::unique_ptr<EngineBuilderInterface> engine_builder);
 
+  // Returns true if |type| is a command to a session. The commands to
+  // different sessions run in parallel, and the commands to one session are
+  // serialized. The other commands run exclusively.
+  static bool IsSessionCommand(commands::Input::CommandType type);
+
+  // Evaluates |command| for EvalCommand(), which holds |mutex_|.
+  bool DispatchCommand(commands::Command *command);
+
+  // Looks up the session of |id| and stores the mutex serializing its commands
+  // to |session_mutex|. Returns nullptr if the session doesn't exist. The
+  // caller must hold |mutex_|.
+  session::SessionInterface *LookupSession(SessionID id,
+                                           absl::Mutex **session_mutex);
+
   // Updates the config, if the |command| contains the config.
   void MaybeUpdateConfig(commands::Command *command);
 
@@ -130,21 +150,41 @@ class SessionHandler : public SessionHandlerInterface {
   bool NoOperation(commands::Command *command);
   bool CheckSpelling(commands::Command *command);
   bool ReloadSpellChecker(commands::Command *command);
+  bool GetLatencyStats(commands::Command *command);
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
+  // Waits for the prefetch manifest to be saved, if it's being saved.
+  void JoinPrefetchManifestThread();
+
+  // Held shared by the session commands, and exclusively by the other
+  // commands, which update the session map and the state shared by the
+  // sessions.
+  absl::Mutex mutex_;
+  // Guards the LRU order of |session_map_|, which is updated by the lookup in
+  // the session commands.
+  absl::Mutex session_map_mutex_;
   std::unique_ptr<SessionMap> session_map_;
+  // The mutexes serializing the commands of each session.
+  absl::flat_hash_map<SessionID, std::unique_ptr<absl::Mutex>>
+      session_mutexes_;
+  absl::Mutex observer_mutex_;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::unique_ptr<SessionWatchDog> session_watch_dog_;
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
-  bool is_available_ = false;
+  std::atomic<bool> is_available_ = false;
   uint32_t max_session_size_ = 0;
+  std::atomic<uint32_t> send_key_count_ = 0;
+  std::optional<Thread2> prefetch_manifest_thread_;
   absl::Time last_session_empty_time_ = absl::InfinitePast();
   absl::Time last_cleanup_time_ = absl::InfinitePast();
   absl::Time last_create_session_time_ = absl::InfinitePast();
 
   std::unique_ptr<EngineInterface> engine_;
+  // Shares |engine_| among the sessions running in parallel. The sessions and
+  // the commands use the engine through it.
+  std::unique_ptr<SerializedEngine> serialized_engine_;
   std::unique_ptr<EngineBuilderInterface> engine_builder_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<user_dictionary::UserDictionarySessionHandler>
@@ -50,8 +50,10 @@ SEND_KEY        Enter
 SHOW
 SHOW_LOG_BY_VALUE       ございます
 SHOW_LOG_BY_VALUE       ございました
+SHOW_LATENCY_STATS
 */
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -109,6 +111,16 @@ void ShowLog(const commands::Output &output, const int cand_id) {
   }
 }
 
+void ShowLatencyStats(const commands::LatencyStats &stats) {
+  std::cout << "stage\tcount\tavg\tp50\tp90\tp99\tmax (usec)" << std::endl;
+  for (const auto &stage : stats.stages()) {
+    std::cout << stage.name() << "\t" << stage.count() << "\t"
+              << stage.total_usec() / std::max<uint64_t>(stage.count(), 1)
+              << "\t" << stage.p50_usec() << "\t" << stage.p90_usec() << "\t"
+              << stage.p99_usec() << "\t" << stage.max_usec() << std::endl;
+  }
+}
+
 void ParseLine(session::SessionHandlerInterpreter &handler, std::string line) {
   std::vector<std::string> args = handler.Parse(line);
   if (args.empty()) {
@@ -151,6 +163,14 @@ void ParseLine(session::SessionHandlerInterpreter &handler, std::string line) {
     }
     return;
   }
+  if (command == "SHOW_LATENCY_STATS") {
+    if (!handler.Eval({"GET_LATENCY_STATS"}).ok()) {
+      std::cout << "ERROR: " << line << std::endl;
+      return;
+    }
+    ShowLatencyStats(handler.LastOutput().latency_stats());
+    return;
+  }
   if (command == "SHOW_LOG_BY_VALUE") {
     if (args.size() != 2) {
       std::cout << "ERROR: " << line << std::endl;
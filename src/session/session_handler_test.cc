@@ -40,6 +40,7 @@
 
 #include "base/clock_mock.h"
 #include "base/port.h"
+#include "base/thread2.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/converter_mock.h"
@@ -682,4 +683,39 @@ TEST_F(SessionHandlerTest, EngineReloadSessionExists) {
   EXPECT_EQ(engine_builder->num_clear_called(), 1);
 }
 
+TEST_F(SessionHandlerTest, SessionCommandsInParallel) {
+  SessionHandler handler(CreateMockDataEngine());
+
+  constexpr int kNumSessions = 4;
+  std::vector<uint64_t> ids(kNumSessions);
+  for (uint64_t &id : ids) {
+    ASSERT_TRUE(CreateSession(&handler, &id));
+  }
+
+  std::vector<Thread2> threads;
+  for (const uint64_t id : ids) {
+    threads.emplace_back([&handler, id] {
+      for (int i = 0; i < 20; ++i) {
+        commands::Command command;
+        command.mutable_input()->set_id(id);
+        command.mutable_input()->set_type(commands::Input::SEND_KEY);
+        command.mutable_input()->mutable_key()->set_key_code('a');
+        EXPECT_TRUE(handler.EvalCommand(&command));
+        EXPECT_EQ(command.output().id(), id);
+        EXPECT_EQ(command.output().error_code(),
+                  commands::Output::SESSION_SUCCESS);
+      }
+    });
+  }
+  // The exclusive commands wait for the session commands.
+  EXPECT_TRUE(CleanUp(&handler, 0));
+  for (Thread2 &thread : threads) {
+    thread.Join();
+  }
+
+  for (const uint64_t id : ids) {
+    EXPECT_TRUE(IsGoodSession(&handler, id));
+  }
+}
+
 }  // namespace mozc
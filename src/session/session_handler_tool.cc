@@ -243,6 +243,12 @@ bool SessionHandlerTool::SetConfig(const config::Config &config,
   return EvalCommand(&input, output);
 }
 
+bool SessionHandlerTool::GetLatencyStats(commands::Output *output) {
+  commands::Input input;
+  input.set_type(commands::Input::GET_LATENCY_STATS);
+  return EvalCommand(&input, output);
+}
+
 bool SessionHandlerTool::SyncData() { return data_manager_->Wait(); }
 
 void SessionHandlerTool::SetCallbackText(const std::string &text) {
@@ -672,6 +678,9 @@ absl::Status SessionHandlerInterpreter::Eval(
   } else if (command == "CLEAR_USAGE_STATS") {
     MOZC_ASSERT_EQ(1, args.size());
     ClearUsageStats();
+  } else if (command == "GET_LATENCY_STATS") {
+    MOZC_ASSERT_EQ(1, args.size());
+    MOZC_ASSERT_TRUE(client_->GetLatencyStats(last_output_.get()));
   } else {
     return absl::Status(absl::StatusCode::kUnimplemented, "");
   }
@@ -81,6 +81,7 @@ class SessionHandlerTool {
   bool SwitchInputMode(commands::CompositionMode composition_mode);
   bool SetRequest(const commands::Request &request, commands::Output *output);
   bool SetConfig(const config::Config &config, commands::Output *output);
+  bool GetLatencyStats(commands::Output *output);
   bool SyncData();
   void SetCallbackText(const std::string &text);
 
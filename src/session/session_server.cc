@@ -33,8 +33,10 @@
 
 #include "session/session_server.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/logging.h"
 #include "engine/engine_factory.h"
@@ -43,9 +45,14 @@
 #include "protocol/commands.pb.h"
 #include "session/session_handler.h"
 #include "session/session_usage_observer.h"
+#include "absl/flags/flag.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 
+ABSL_FLAG(int32_t, ipc_workers, 0,
+          "number of threads to process the IPC requests. When it is 0, the "
+          "requests are processed in the thread accepting the connections.");
+
 namespace {
 
 #ifdef _WIN32
@@ -70,6 +77,8 @@ SessionServer::SessionServer()
       usage_observer_(std::make_unique<session::SessionUsageObserver>()),
       session_handler_(
           std::make_unique<SessionHandler>(EngineFactory::Create().value())) {
+  SetNumWorkers(absl::GetFlag(FLAGS_ipc_workers));
+
   // start session watch dog timer
   session_handler_->StartWatchDog();
   session_handler_->AddObserver(usage_observer_.get());
@@ -87,33 +96,62 @@ bool SessionServer::Connected() const {
 }
 
 bool SessionServer::Process(absl::string_view request, std::string *response) {
-  if (!session_handler_) {
-    LOG(WARNING) << "handler is not available";
-    return false;  // shutdown the server if handler doesn't exist
+  ParsedCommand parsed;
+  if (!parsed.command.mutable_input()->ParseFromArray(request.data(),
+                                                      request.size())) {
+    LOG(WARNING) << "Invalid request";
+    response->clear();
+    return true;
+  }
+  return EvalCommand(&parsed.command, response);
+}
+
+uint64_t SessionServer::ParseRequest(
+    absl::string_view request, std::unique_ptr<ParsedRequest> *parsed) const {
+  auto command = std::make_unique<ParsedCommand>();
+  if (!command->command.mutable_input()->ParseFromArray(request.data(),
+                                                        request.size())) {
+    // ProcessParsedRequest() responds to the invalid request.
+    return 0;
   }
+  const uint64_t key = command->command.input().id();
+  *parsed = std::move(command);
+  return key;
+}
 
-  commands::Command command;
-  if (!command.mutable_input()->ParseFromArray(request.data(),
-                                               request.size())) {
+bool SessionServer::ProcessParsedRequest(absl::string_view request,
+                                         ParsedRequest *parsed,
+                                         std::string *response) {
+  if (parsed == nullptr) {
     LOG(WARNING) << "Invalid request";
     response->clear();
     return true;
   }
+  return EvalCommand(&static_cast<ParsedCommand *>(parsed)->command, response);
+}
+
+bool SessionServer::EvalCommand(commands::Command *command,
+                                std::string *response) {
+  if (!session_handler_) {
+    LOG(WARNING) << "handler is not available";
+    return false;  // shutdown the server if handler doesn't exist
+  }
 
-  if (!session_handler_->EvalCommand(&command)) {
+  // SessionHandler runs the commands to different sessions in parallel.
+  if (!session_handler_->EvalCommand(command)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
     response->clear();
     return false;
   }
 
-  if (!command.output().SerializeToString(response)) {
+  if (!command->output().SerializeToString(response)) {
     LOG(WARNING) << "SerializeToString() failed";
     response->clear();
     return true;
   }
 
   // debug message
-  VLOG(2) << MOZC_LOG_PROTOBUF(command);
+  VLOG(2) << MOZC_LOG_PROTOBUF(*command);
 
   return true;
 }
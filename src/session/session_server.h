@@ -32,10 +32,12 @@
 #ifndef MOZC_SESSION_SESSION_SERVER_H_
 #define MOZC_SESSION_SESSION_SERVER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
 #include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
 #include "session/session_handler_interface.h"
 #include "session/session_usage_observer.h"
 #include "absl/strings/string_view.h"
@@ -62,7 +64,21 @@ class SessionServer : public IPCServer {
 
   bool Process(absl::string_view request, std::string *response) override;
 
+  // Parses the request once and returns its session ID so that the commands
+  // of a session are processed in order.
+  uint64_t ParseRequest(absl::string_view request,
+                        std::unique_ptr<ParsedRequest> *parsed) const override;
+  bool ProcessParsedRequest(absl::string_view request, ParsedRequest *parsed,
+                            std::string *response) override;
+
  private:
+  struct ParsedCommand : public ParsedRequest {
+    commands::Command command;
+  };
+
+  // Evaluates |command| and serializes its output to |response|.
+  bool EvalCommand(commands::Command *command, std::string *response);
+
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
 };
@@ -29,6 +29,7 @@
 
 #include "storage/existence_filter.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -46,6 +47,20 @@ namespace mozc {
 namespace storage {
 namespace {
 
+// The layout is stored in the upper bits of the 'k' field of the header, so
+// that the readers of the classic layout reject a blocked filter.
+constexpr int kLayoutShift = 8;
+constexpr int kNumHashesMask = (1 << kLayoutShift) - 1;
+
+// The classic header consists of m, n and k. The blocked header is padded to
+// 64 bytes so that the blocks are aligned to cache lines if the data is.
+constexpr uint32_t kClassicHeaderBytes = 12;
+constexpr uint32_t kBlockedHeaderBytes = 64;
+
+constexpr uint32_t kBlockBits = ExistenceFilter::kBlockBits;
+constexpr int kBlockBitsShift = 55;  // 64 - log2(kBlockBits)
+constexpr int kBlockBitsPerHash = 9;
+
 // Rotate the value in 'original' by 'num_bits'
 inline uint64_t RotateLeft64(uint64_t original, int num_bits) {
   // TODO(team): we may want to use rotl64 depending on the platform.
@@ -53,6 +68,48 @@ inline uint64_t RotateLeft64(uint64_t original, int num_bits) {
   return (original << (64 - num_bits)) | (original >> num_bits);
 }
 
+uint32_t GetVectorSize(uint32_t m, ExistenceFilter::Layout layout) {
+  if (layout == ExistenceFilter::CLASSIC) {
+    return m ? m : 1;
+  }
+  const uint64_t num_blocks =
+      std::max<uint64_t>((static_cast<uint64_t>(m) + kBlockBits - 1) /
+                             kBlockBits,
+                         1);
+  CHECK_LE(num_blocks * kBlockBits, UINT32_MAX) << "Requested size is too big";
+  return num_blocks * kBlockBits;
+}
+
+// Returns the first bit of the block for the hash. The upper 32 bits of the
+// hash are mapped to [0, num_blocks) by multiplication instead of division.
+inline uint32_t GetBlockOffset(uint64_t hash, uint32_t vec_size) {
+  const uint64_t num_blocks = vec_size / kBlockBits;
+  return static_cast<uint32_t>(((hash >> 32) * num_blocks) >> 32) * kBlockBits;
+}
+
+// Returns the seed of the bit positions in a block. The hash is mixed again
+// so that the positions are independent from the block selected by
+// GetBlockOffset(). Each position is taken from the top 9 bits, i.e., [0, 512).
+inline uint64_t GetBlockBitsSeed(uint64_t hash) {
+  return (hash ^ (hash >> 31)) * 0x9E3779B97F4A7C15ULL;
+}
+
+// Estimates the false positive rate of the blocked layout. The number of
+// elements in a block follows the Poisson distribution of mean 'lambda'.
+double BlockedFalsePositiveRate(double num_bits, double num_elements,
+                                int num_hashes) {
+  const double lambda = num_elements * kBlockBits / num_bits;
+  const int max_elements = static_cast<int>(lambda + 20 * sqrt(lambda) + 20);
+  double probability = exp(-lambda);
+  double rate = 0;
+  for (int i = 0; i <= max_elements; ++i) {
+    const double bit_set = 1.0 - pow(1.0 - 1.0 / kBlockBits, num_hashes * i);
+    rate += probability * pow(bit_set, num_hashes);
+    probability *= lambda / (i + 1);
+  }
+  return rate;
+}
+
 }  // namespace
 
 namespace internal {
@@ -129,22 +186,31 @@ using internal::BitsToWords;
 using internal::BlockBitmap;
 
 ExistenceFilter::ExistenceFilter(uint32_t m, uint32_t n, int k)
-    : vec_size_(m ? m : 1), expected_nelts_(n), num_hashes_(k) {
-  CHECK_LT(num_hashes_, 8);
-  rep_ = std::make_unique<BlockBitmap>(m ? m : 1, true);
-  rep_->Clear();
-}
+    : ExistenceFilter(m, n, k, CLASSIC, true) {}
+
+ExistenceFilter::ExistenceFilter(uint32_t m, uint32_t n, int k, Layout layout)
+    : ExistenceFilter(m, n, k, layout, true) {}
 
 // this is private constructor
-ExistenceFilter::ExistenceFilter(uint32_t m, uint32_t n, int k, bool is_mutable)
-    : vec_size_(m ? m : 1), expected_nelts_(n), num_hashes_(k) {
+ExistenceFilter::ExistenceFilter(uint32_t m, uint32_t n, int k, Layout layout,
+                                 bool is_mutable)
+    : vec_size_(GetVectorSize(m, layout)),
+      expected_nelts_(n),
+      num_hashes_(k),
+      layout_(layout) {
   CHECK_LT(num_hashes_, 8);
-  rep_ = std::make_unique<BlockBitmap>(m ? m : 1, is_mutable);
+  rep_ = std::make_unique<BlockBitmap>(vec_size_, is_mutable);
   rep_->Clear();
 }
 
 ExistenceFilter ExistenceFilter::CreateOptimal(size_t size_in_bytes,
                                                uint32_t estimated_insertions) {
+  return CreateOptimal(size_in_bytes, estimated_insertions, CLASSIC);
+}
+
+ExistenceFilter ExistenceFilter::CreateOptimal(size_t size_in_bytes,
+                                               uint32_t estimated_insertions,
+                                               Layout layout) {
   CHECK_LT(size_in_bytes, (1 << 29)) << "Requested size is too big";
   CHECK_GT(estimated_insertions, 0);
   const uint32_t m = size_in_bytes * 8;
@@ -161,12 +227,15 @@ ExistenceFilter ExistenceFilter::CreateOptimal(size_t size_in_bytes,
 
   VLOG(1) << "optimal_k: " << optimal_k;
 
-  return ExistenceFilter(m, n, optimal_k);
+  return ExistenceFilter(m, n, optimal_k, layout);
 }
 
 void ExistenceFilter::Clear() { rep_->Clear(); }
 
 bool ExistenceFilter::Exists(uint64_t hash) const {
+  if (layout_ == BLOCKED) {
+    return ExistsInBlock(hash);
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32_t index = hash % vec_size_;
@@ -178,6 +247,10 @@ bool ExistenceFilter::Exists(uint64_t hash) const {
 }
 
 void ExistenceFilter::Insert(uint64_t hash) {
+  if (layout_ == BLOCKED) {
+    InsertInBlock(hash);
+    return;
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32_t index = hash % vec_size_;
@@ -185,6 +258,30 @@ void ExistenceFilter::Insert(uint64_t hash) {
   }
 }
 
+bool ExistenceFilter::ExistsInBlock(uint64_t hash) const {
+  // All the bits are in one cache line, so the loop exits at the first unset
+  // bit without another cache miss.
+  const uint32_t *block = rep_->GetWord(GetBlockOffset(hash, vec_size_));
+  uint64_t bits = GetBlockBitsSeed(hash);
+  for (int i = 0; i < num_hashes_; ++i) {
+    const uint32_t pos = bits >> kBlockBitsShift;
+    if (((block[pos >> 5] >> (pos & 31)) & 1) == 0) {
+      return false;
+    }
+    bits <<= kBlockBitsPerHash;
+  }
+  return true;
+}
+
+void ExistenceFilter::InsertInBlock(uint64_t hash) {
+  const uint32_t offset = GetBlockOffset(hash, vec_size_);
+  uint64_t bits = GetBlockBitsSeed(hash);
+  for (int i = 0; i < num_hashes_; ++i) {
+    rep_->Set(offset + (bits >> kBlockBitsShift));
+    bits <<= kBlockBitsPerHash;
+  }
+}
+
 size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
                                                          size_t num_elements) {
   // (-num_hashes * num_elements) / log(1 - error_rate^(1/num_hashes))
@@ -199,23 +296,48 @@ size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
   return static_cast<size_t>(ceil(min_bits / 8));
 }
 
+size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
+                                                         size_t num_elements,
+                                                         Layout layout) {
+  size_t bytes = MinFilterSizeInBytesForErrorRate(error_rate, num_elements);
+  if (layout == CLASSIC || num_elements == 0) {
+    return bytes;
+  }
+  // The blocks are not evenly loaded, so the blocked layout needs more bits.
+  // Grows the size by 1/32 until the estimated error rate is low enough.
+  while (true) {
+    const double num_bits = static_cast<double>(bytes) * 8;
+    const int k = std::clamp(
+        static_cast<int>(num_bits / num_elements * log(2.0) + 0.5), 1, 7);
+    if (BlockedFalsePositiveRate(num_bits, num_elements, k) <= error_rate) {
+      return bytes;
+    }
+    bytes += std::max<size_t>(bytes / 32, 1);
+  }
+}
+
 std::string ExistenceFilter::Write() {
-  const int require_bytes = sizeof(Header) + Size();
+  const uint32_t header_bytes =
+      layout_ == BLOCKED ? kBlockedHeaderBytes : kClassicHeaderBytes;
+  const int require_bytes = header_bytes + Size();
   std::string buf;
   buf.resize(require_bytes);
 
   absl::Span<char> span(buf);
 
   // write header
+  const int32_t k = num_hashes_ | (layout_ << kLayoutShift);
   memcpy(span.data(), &vec_size_, sizeof(vec_size_));
   span = span.subspan(sizeof(vec_size_));
   memcpy(span.data(), &expected_nelts_, sizeof(expected_nelts_));
   span = span.subspan(sizeof(expected_nelts_));
-  memcpy(span.data(), &num_hashes_, sizeof(num_hashes_));
-  span = span.subspan(sizeof(num_hashes_));
+  memcpy(span.data(), &k, sizeof(k));
+  span = span.subspan(header_bytes - sizeof(vec_size_) -
+                      sizeof(expected_nelts_));  // includes the padding
   // This method is called on data generation and we can call LOG(INFO) here.
   LOG(INFO) << "Write header : vec_size " << vec_size_ << ", expected_nelts "
-            << expected_nelts_ << ", num_hashes " << num_hashes_;
+            << expected_nelts_ << ", num_hashes " << num_hashes_
+            << ", layout " << layout_;
 
   // write bitmap
   char **fragment_ptr = nullptr;
@@ -242,19 +364,36 @@ absl::StatusOr<ExistenceFilter::Header> ExistenceFilter::ReadHeader(
   buf = buf.subspan(sizeof(header.n));
   memcpy(&(header.k), buf.data(), sizeof(header.k));
   buf = buf.subspan(sizeof(header.k));
+  const int layout = header.k >> kLayoutShift;
+  header.k &= kNumHashesMask;
   if (header.k >= 8 || header.k <= 0) {
     LOG(ERROR) << "Bad number of hashes (header.k)";
     return absl::InvalidArgumentError("Bad number of hashes (header.k)");
   }
+  switch (layout) {
+    case CLASSIC:
+      header.layout = CLASSIC;
+      break;
+    case BLOCKED:
+      if (header.m == 0 || header.m % kBlockBits != 0) {
+        LOG(ERROR) << "Bad size of the blocked filter (header.m)";
+        return absl::InvalidArgumentError(
+            "Bad size of the blocked filter (header.m)");
+      }
+      header.layout = BLOCKED;
+      break;
+    default:
+      LOG(ERROR) << "Unknown layout: " << layout;
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unknown layout: ", layout));
+  }
   return header;
 }
 
 absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
     absl::Span<const char> buf) {
   Header header;
-  const uint32_t header_bytes =
-      sizeof(header.m) + sizeof(header.n) + sizeof(header.k);
-  if (buf.size() < header_bytes) {
+  if (buf.size() < kClassicHeaderBytes) {
     LOG(ERROR) << "Not enough bufsize: could not read header";
     return absl::InvalidArgumentError(
         "Not enough bufsize: could not read header");
@@ -266,12 +405,20 @@ absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
     LOG(ERROR) << "Invalid format: could not read header";
     return absl::InvalidArgumentError("Invalid format: could not read header");
   }
+  const uint32_t header_bytes =
+      header.layout == BLOCKED ? kBlockedHeaderBytes : kClassicHeaderBytes;
+  if (buf.size() < header_bytes) {
+    LOG(ERROR) << "Not enough bufsize: could not read header";
+    return absl::InvalidArgumentError(
+        "Not enough bufsize: could not read header");
+  }
   buf = buf.subspan(header_bytes);
 
   const uint32_t filter_size = BitsToWords(header.m);
   const uint32_t filter_bytes = filter_size * sizeof(uint32_t);
   VLOG(1) << "Reading bloom filter with size: " << filter_bytes << " bytes, "
-          << "estimated insertions: " << header.n << " (k: " << header.k << ")";
+          << "estimated insertions: " << header.n << " (k: " << header.k
+          << ", layout: " << header.layout << ")";
 
   if (buf.size() < filter_bytes) {
     LOG(ERROR) << "Not enough bufsize: could not read filter";
@@ -279,7 +426,7 @@ absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
   }
 
   // Create a mutable existence filter.
-  ExistenceFilter filter(header.m, header.n, header.k, false);
+  ExistenceFilter filter(header.m, header.n, header.k, header.layout, false);
   char **ptr = nullptr;
   size_t n = 0;
   size_t read = 0;
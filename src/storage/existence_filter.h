@@ -48,12 +48,25 @@ constexpr uint32_t BitsToWords(uint32_t bits);
 }  // namespace internal
 
 // Bloom filter
+//
+// Two bitmap layouts are supported. The classic layout sets k bits anywhere
+// in the bitmap, so a lookup costs up to k random cache misses. The blocked
+// layout first selects a 64-byte block with the hash and sets all the k bits
+// in that block, so a lookup reads a single cache line at the cost of a
+// slightly higher false positive rate for the same size.
 class ExistenceFilter {
  public:
+  // Layout of the bitmap, which is serialized as the version of the header.
+  enum Layout {
+    CLASSIC = 0,
+    BLOCKED = 1,
+  };
+
   struct Header {
     uint32_t m;
     uint32_t n;
     int k;
+    Layout layout = CLASSIC;
   };
 
   // 'm' is the number of bits in the bit vector
@@ -61,12 +74,17 @@ class ExistenceFilter {
   // 'k' is the number of hash values to use per insert/lookup
   // k must be less than 8
   ExistenceFilter(uint32_t m, uint32_t n, int k);
+  // 'm' is rounded up to a multiple of kBlockBits for the blocked layout.
+  ExistenceFilter(uint32_t m, uint32_t n, int k, Layout layout);
   ExistenceFilter(ExistenceFilter &&) = default;
   ExistenceFilter &operator=(ExistenceFilter &&) = default;
   ~ExistenceFilter() = default;
 
   static ExistenceFilter CreateOptimal(size_t size_in_bytes,
                                        uint32_t estimated_insertions);
+  static ExistenceFilter CreateOptimal(size_t size_in_bytes,
+                                       uint32_t estimated_insertions,
+                                       Layout layout);
 
   void Clear();
 
@@ -87,6 +105,14 @@ class ExistenceFilter {
   // under the given error rate and number of elements
   static size_t MinFilterSizeInBytesForErrorRate(float error_rate,
                                                  size_t num_elements);
+  static size_t MinFilterSizeInBytesForErrorRate(float error_rate,
+                                                 size_t num_elements,
+                                                 Layout layout);
+
+  Layout layout() const { return layout_; }
+
+  // Number of bits in a block of the blocked layout (one cache line).
+  static constexpr uint32_t kBlockBits = 512;
 
   // Writes the existence filter to a buffer and returns it.
   std::string Write();
@@ -100,12 +126,17 @@ class ExistenceFilter {
 
  private:
   // Private constructor for ExistenceFilter::Read().
-  ExistenceFilter(uint32_t m, uint32_t n, int k, bool is_mutable);
+  ExistenceFilter(uint32_t m, uint32_t n, int k, Layout layout,
+                  bool is_mutable);
+
+  bool ExistsInBlock(uint64_t hash) const;
+  void InsertInBlock(uint64_t hash);
 
   std::unique_ptr<internal::BlockBitmap> rep_;  // points to bitmap
   uint32_t vec_size_;                           // size of bitmap (in bits)
   uint32_t expected_nelts_;                     // expected number of inserts
   int32_t num_hashes_;                          // number of hashes per lookup
+  Layout layout_;
 };
 
 namespace internal {
@@ -133,6 +164,12 @@ class BlockBitmap {
     block_[bindex][windex] |= (static_cast<uint32_t>(1) << bitpos);
   }
 
+  // Returns the word containing the bit at 'index'. The following words up to
+  // the next multiple of 2^kBlockShift bits are contiguous in memory.
+  constexpr const uint32_t *GetWord(uint32_t index) const {
+    return &block_[index >> kBlockShift][(index & kBlockMask) >> 5];
+  }
+
   // REQUIRES: "iter" is zero, or was set by a preceding call
   // to GetMutableFragment().
   //
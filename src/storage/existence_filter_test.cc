@@ -39,6 +39,7 @@
 #include "testing/googletest.h"
 #include "testing/gunit.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 namespace storage {
@@ -62,9 +63,9 @@ void CheckValues(const ExistenceFilter &filter, int m, int n) {
   LOG(INFO) << "false_positives: " << false_positives;
 }
 
-void RunTest(int m, int n) {
-  LOG(INFO) << "Test " << m << " " << n;
-  ExistenceFilter filter = ExistenceFilter::CreateOptimal(m, n);
+void RunTest(int m, int n, ExistenceFilter::Layout layout) {
+  LOG(INFO) << "Test " << m << " " << n << " " << layout;
+  ExistenceFilter filter = ExistenceFilter::CreateOptimal(m, n, layout);
 
   for (int i = 0; i < n; ++i) {
     int val = i * 2;
@@ -78,6 +79,7 @@ void RunTest(int m, int n) {
   LOG(INFO) << "write size: " << buf.size();
   absl::StatusOr<ExistenceFilter> filter2 = ExistenceFilter::Read(buf);
   EXPECT_OK(filter2);
+  EXPECT_EQ(filter2->layout(), layout);
   CheckValues(*filter2, m, n);
 }
 
@@ -86,7 +88,14 @@ void RunTest(int m, int n) {
 TEST(ExistenceFilterTest, RunTest) {
   int n = 50000;
   int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
-  RunTest(m, n);
+  RunTest(m, n, ExistenceFilter::CLASSIC);
+}
+
+TEST(ExistenceFilterTest, RunBlockedTest) {
+  int n = 50000;
+  int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+      0.01, 50000, ExistenceFilter::BLOCKED);
+  RunTest(m, n, ExistenceFilter::BLOCKED);
 }
 
 TEST(ExistenceFilterTest, MinFilterSizeEstimateTest) {
@@ -94,6 +103,35 @@ TEST(ExistenceFilterTest, MinFilterSizeEstimateTest) {
   EXPECT_EQ(ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 100), 120);
   EXPECT_EQ(ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.05, 100), 79);
   EXPECT_EQ(ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.05, 1000), 781);
+
+  // The blocked layout needs more bits for the same error rate.
+  for (const float error_rate : {0.1f, 0.01f, 0.00001f}) {
+    EXPECT_GT(ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+                  error_rate, 100000, ExistenceFilter::BLOCKED),
+              ExistenceFilter::MinFilterSizeInBytesForErrorRate(error_rate,
+                                                                100000));
+  }
+}
+
+TEST(ExistenceFilterTest, BlockedFalsePositiveRate) {
+  constexpr int kNumElements = 100000;
+  constexpr float kErrorRate = 0.001;
+  ExistenceFilter filter = ExistenceFilter::CreateOptimal(
+      ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+          kErrorRate, kNumElements, ExistenceFilter::BLOCKED),
+      kNumElements, ExistenceFilter::BLOCKED);
+  EXPECT_EQ(filter.Size() % 64, 0);
+  for (int i = 0; i < kNumElements; ++i) {
+    filter.Insert(Hash::Fingerprint(i));
+  }
+  int false_positives = 0;
+  for (int i = kNumElements; i < 2 * kNumElements; ++i) {
+    if (filter.Exists(Hash::Fingerprint(i))) {
+      ++false_positives;
+    }
+  }
+  // Allows some margin over the estimated error rate.
+  EXPECT_LT(false_positives, 2 * kErrorRate * kNumElements);
 }
 
 TEST(ExistenceFilterTest, ReadWriteTest) {
@@ -119,6 +157,32 @@ TEST(ExistenceFilterTest, ReadWriteTest) {
   }
 }
 
+TEST(ExistenceFilterTest, ReadWriteBlockedTest) {
+  const std::vector<std::string> words = {"a", "b", "c"};
+
+  ExistenceFilter filter(ExistenceFilter::CreateOptimal(
+      100, words.size(), ExistenceFilter::BLOCKED));
+  for (const std::string &word : words) {
+    filter.Insert(Hash::Fingerprint(word));
+  }
+
+  const std::string buf = filter.Write();
+  // The header is padded to 64 bytes and followed by two blocks.
+  EXPECT_EQ(buf.size(), 64 + 128);
+
+  absl::StatusOr<ExistenceFilter> filter_read(ExistenceFilter::Read(buf));
+  EXPECT_OK(filter_read);
+  EXPECT_EQ(filter_read->layout(), ExistenceFilter::BLOCKED);
+  for (const std::string &word : words) {
+    EXPECT_TRUE(filter_read->Exists(Hash::Fingerprint(word)));
+  }
+
+  // A truncated blocked filter is rejected.
+  const absl::string_view data = buf;
+  EXPECT_FALSE(ExistenceFilter::Read(data.substr(0, 32)).ok());
+  EXPECT_FALSE(ExistenceFilter::Read(data.substr(0, 128)).ok());
+}
+
 TEST(ExistenceFilterTest, InsertAndExistsTest) {
   const std::vector<std::string> words = {"a", "b", "c", "d", "e",
                                           "f", "g", "h", "i"};
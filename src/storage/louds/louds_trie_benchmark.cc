@@ -0,0 +1,295 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmarks for LoudsTrie traversal and SimpleSuccinctBitVectorIndex.
+//
+// The trie is built from the readings in data/dictionary_oss/evaluation.tsv
+// and data/test/quality_regression_test/oss.tsv: every substring of up to
+// kMaxKeyChars characters becomes a key, which gives a trie of kana keys
+// similar to the key trie of the system dictionary.  The traversal benchmarks
+// cycle through the suffixes of the readings, which is the key shape that
+// lattice construction passes to SystemDictionary::LookupPrefix.
+//
+// Usage:
+//   bazel run -c opt //storage/louds:louds_trie_benchmark -- \
+//       --benchmark_filter=PrefixSearch
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/status.h"
+#include "base/util.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/louds_trie_builder.h"
+#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "testing/benchmark_util.h"
+#include "testing/googletest.h"
+#include "testing/mozctest.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+using ::benchmark::Counter;
+using ::mozc::testing::MakeSuffixes;
+
+constexpr size_t kMaxKeyChars = 8;
+
+// Appends the non-empty values at |column| of a TSV file.
+void LoadTsvColumn(const std::vector<absl::string_view> &path_components,
+                   int column, std::vector<std::string> *readings) {
+  absl::StatusOr<std::vector<std::string>> values =
+      testing::ReadTsvColumn(testing::GetSourceFileOrDie(path_components),
+                             column);
+  CHECK_OK(values);
+  readings->insert(readings->end(), std::make_move_iterator(values->begin()),
+                   std::make_move_iterator(values->end()));
+}
+
+const std::vector<std::string> &GetReadings() {
+  static const std::vector<std::string> *readings = [] {
+    auto *readings = new std::vector<std::string>();
+    // status, input, output, command, argument, version
+    LoadTsvColumn({"data", "dictionary_oss", "evaluation.tsv"}, 1, readings);
+    // label, key, value, command
+    LoadTsvColumn({"data", "test", "quality_regression_test", "oss.tsv"}, 1,
+                  readings);
+    CHECK(!readings->empty()) << "No benchmark corpus is loaded";
+    return readings;
+  }();
+  return *readings;
+}
+
+// Returns the sorted distinct prefixes of up to |max_chars| characters of
+// |keys|.
+std::vector<std::string> MakeTrieKeys(const std::vector<std::string> &keys,
+                                      size_t max_chars) {
+  std::vector<std::string> prefixes;
+  for (const std::string &key : keys) {
+    const size_t len = std::min(Util::CharsLen(key), max_chars);
+    for (size_t i = 1; i <= len; ++i) {
+      prefixes.emplace_back(Util::Utf8SubString(key, 0, i));
+    }
+  }
+  std::sort(prefixes.begin(), prefixes.end());
+  prefixes.erase(std::unique(prefixes.begin(), prefixes.end()),
+                 prefixes.end());
+  return prefixes;
+}
+
+class TrieBenchmark {
+ public:
+  TrieBenchmark()
+      : suffixes_(MakeSuffixes(GetReadings())),
+        keys_(MakeTrieKeys(suffixes_, kMaxKeyChars)) {
+    LoudsTrieBuilder builder;
+    for (const std::string &key : keys_) {
+      builder.Add(key);
+    }
+    builder.Build();
+    image_ = builder.image();
+    // Same cache sizes as the key trie of SystemDictionary.
+    CHECK(trie_.Open(reinterpret_cast<const uint8_t *>(image_.data()), 1024,
+                     1024, 1024, 1024, 0));
+  }
+
+  const LoudsTrie &trie() const { return trie_; }
+  const std::vector<std::string> &suffixes() const { return suffixes_; }
+  const std::vector<std::string> &keys() const { return keys_; }
+
+ private:
+  std::vector<std::string> suffixes_;
+  std::vector<std::string> keys_;
+  std::string image_;
+  LoudsTrie trie_;
+};
+
+const TrieBenchmark &GetTrieBenchmark() {
+  static const TrieBenchmark *bm = new TrieBenchmark();
+  return *bm;
+}
+
+// Reports the number of the processed keys and bytes per second.
+void SetKeyCounters(benchmark::State &state, int64_t num_bytes,
+                    size_t num_keys) {
+  state.counters["bytes/s"] = Counter(num_bytes, Counter::kIsRate);
+  state.counters["keys"] = num_keys;
+}
+
+void BM_PrefixSearch(benchmark::State &state) {
+  const TrieBenchmark &bm = GetTrieBenchmark();
+  const std::vector<std::string> &keys = bm.suffixes();
+  size_t index = 0;
+  int64_t num_matches = 0;
+  int64_t num_bytes = 0;
+  for (auto s : state) {
+    const std::string &key = keys[index];
+    bm.trie().PrefixSearch(
+        key, [&num_matches](absl::string_view, size_t, const LoudsTrie &,
+                            LoudsTrie::Node) { ++num_matches; });
+    num_bytes += key.size();
+    if (++index == keys.size()) {
+      index = 0;
+    }
+  }
+  benchmark::DoNotOptimize(num_matches);
+  state.counters["matches"] = Counter(num_matches, Counter::kAvgIterations);
+  SetKeyCounters(state, num_bytes, keys.size());
+}
+BENCHMARK(BM_PrefixSearch);
+
+void BM_ExactSearch(benchmark::State &state) {
+  const TrieBenchmark &bm = GetTrieBenchmark();
+  // Shuffles the keys not to walk the trie in the order of the key IDs.
+  std::vector<std::string> keys = bm.keys();
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  size_t index = 0;
+  int64_t num_bytes = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(bm.trie().ExactSearch(keys[index]));
+    num_bytes += keys[index].size();
+    if (++index == keys.size()) {
+      index = 0;
+    }
+  }
+  SetKeyCounters(state, num_bytes, keys.size());
+}
+BENCHMARK(BM_ExactSearch);
+
+void BM_RestoreKeyString(benchmark::State &state) {
+  const TrieBenchmark &bm = GetTrieBenchmark();
+  const int num_keys = bm.keys().size();
+  char buf[LoudsTrie::kMaxDepth + 1];
+  int key_id = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(bm.trie().RestoreKeyString(key_id, buf));
+    // Strides over the key IDs to spread the accesses.
+    key_id = (key_id + 7919) % num_keys;
+  }
+  state.counters["keys"] = num_keys;
+}
+BENCHMARK(BM_RestoreKeyString);
+
+// Random bit vector with the density of 1-bits of state.range(0) percent.
+class BitVectorBenchmark {
+ public:
+  explicit BitVectorBenchmark(int density_percent) : data_(1 << 20, '\0') {
+    std::mt19937 gen(0);
+    std::bernoulli_distribution dist(density_percent / 100.0);
+    for (size_t i = 0; i < data_.size() * 8; ++i) {
+      if (dist(gen)) {
+        data_[i / 8] |= 1 << (i % 8);
+      }
+    }
+    index_.Init(reinterpret_cast<const uint8_t *>(data_.data()),
+                data_.size());
+  }
+
+  const SimpleSuccinctBitVectorIndex &index() const { return index_; }
+
+  // Returns |size| random integers in [min, max].
+  static std::vector<int> RandomInts(int min, int max, size_t size) {
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> dist(min, max);
+    std::vector<int> ints(size);
+    for (int &i : ints) {
+      i = dist(gen);
+    }
+    return ints;
+  }
+
+ private:
+  std::string data_;
+  SimpleSuccinctBitVectorIndex index_;
+};
+
+constexpr size_t kNumQueries = 1 << 16;
+
+void BM_Rank1(benchmark::State &state) {
+  const BitVectorBenchmark bm(state.range(0));
+  const std::vector<int> queries =
+      BitVectorBenchmark::RandomInts(0, (1 << 23) - 1, kNumQueries);
+  size_t index = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(bm.index().Rank1(queries[index]));
+    index = (index + 1) % kNumQueries;
+  }
+}
+BENCHMARK(BM_Rank1)->ArgName("density")->Arg(10)->Arg(50)->Arg(90);
+
+void BM_Select0(benchmark::State &state) {
+  const BitVectorBenchmark bm(state.range(0));
+  const std::vector<int> queries = BitVectorBenchmark::RandomInts(
+      1, bm.index().GetNum0Bits(), kNumQueries);
+  size_t index = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(bm.index().Select0(queries[index]));
+    index = (index + 1) % kNumQueries;
+  }
+}
+BENCHMARK(BM_Select0)->ArgName("density")->Arg(10)->Arg(50)->Arg(90);
+
+void BM_Select1(benchmark::State &state) {
+  const BitVectorBenchmark bm(state.range(0));
+  const std::vector<int> queries = BitVectorBenchmark::RandomInts(
+      1, bm.index().GetNum1Bits(), kNumQueries);
+  size_t index = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(bm.index().Select1(queries[index]));
+    index = (index + 1) % kNumQueries;
+  }
+}
+BENCHMARK(BM_Select1)->ArgName("density")->Arg(10)->Arg(50)->Arg(90);
+
+}  // namespace
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  // Benchmark flags are consumed first so that the rest can be parsed as
+  // absl flags.
+  benchmark::Initialize(&argc, argv);
+  mozc::InitMozc(argv[0], &argc, &argv);
+  mozc::InitTestFlags();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -39,6 +39,10 @@
 #include "absl/base/internal/endian.h"
 #include "absl/numeric/bits.h"
 
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif  // __BMI2__
+
 namespace mozc {
 namespace storage {
 namespace louds {
@@ -82,20 +86,49 @@ class ZeroBitIndexIterator {
   const int *ptr_;
 };
 
-inline int BitCount0(uint32_t x) {
-  // Flip all bits, and count 1-bits.
-  return absl::popcount(~x);
-}
-
 // Returns 1-bits in the data to length words.
 int Count1Bits(const uint8_t *data, int length) {
   int num_bits = 0;
-  for (; length > 0; data += 4, --length) {
+  for (; length >= 2; data += 8, length -= 2) {
+    num_bits += absl::popcount(absl::little_endian::Load64(data));
+  }
+  if (length > 0) {
     num_bits += absl::popcount(absl::little_endian::Load32(data));
   }
   return num_bits;
 }
 
+// Loads the 64-bit word at |ptr|. The data is a sequence of 32-bit words, so
+// only the lower 32-bits are loaded at the last word of the data.
+inline uint64_t LoadWord(const uint8_t *ptr, const uint8_t *end) {
+  DCHECK_GE(end - ptr, 4);
+  return end - ptr >= 8 ? absl::little_endian::Load64(ptr)
+                        : absl::little_endian::Load32(ptr);
+}
+
+// Returns the position of the n-th 1-bit (n is 1-origin) in |word|.
+// REQUIRES: 0 < n <= popcount(word).
+inline int SelectInWord(uint64_t word, int n) {
+  DCHECK_GT(n, 0);
+  DCHECK_LE(n, absl::popcount(word));
+#if defined(__BMI2__)
+  return absl::countr_zero(_pdep_u64(uint64_t{1} << (n - 1), word));
+#else   // __BMI2__
+  // Skip the bytes before the target, and then clear the preceding 1-bits.
+  int index = 0;
+  for (int count = absl::popcount(word & 0xFF); count < n;
+       count = absl::popcount(word & 0xFF)) {
+    n -= count;
+    word >>= 8;
+    index += 8;
+  }
+  for (; n > 1; --n) {
+    word &= word - 1;
+  }
+  return index + absl::countr_zero(word);
+#endif  // __BMI2__
+}
+
 // Stores index (the cumulative number of the 1-bits from begin of each chunk).
 void InitIndex(const uint8_t *data, int length, int chunk_size,
                std::vector<int> *index) {
@@ -241,24 +274,18 @@ int SimpleSuccinctBitVectorIndex::Select0(int n) const {
   // Linear search on remaining "words"
   const int offset = (chunk_index * chunk_size_) & ~int{3};
   const uint8_t *ptr = data_ + offset;
+  const uint8_t *const end = data_ + length_;
   while (true) {
-    const int bit_count = BitCount0(absl::little_endian::Load32(ptr));
+    // The padding of the last word is counted as 0-bits, which doesn't matter
+    // as the target bit is in the data.
+    const uint64_t word = ~LoadWord(ptr, end);
+    const int bit_count = absl::popcount(word);
     if (bit_count >= n) {
-      break;
+      return (ptr - data_) * 8 + SelectInWord(word, n);
     }
     n -= bit_count;
-    ptr += 4;
-  }
-
-  int index = (ptr - data_) * 8;
-  for (uint32_t word = ~absl::little_endian::Load32(ptr); n > 0;
-       word >>= 1, ++index) {
-    n -= (word & 1);
+    ptr += 8;
   }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
 }
 
 int SimpleSuccinctBitVectorIndex::Select1(int n) const {
@@ -281,24 +308,16 @@ int SimpleSuccinctBitVectorIndex::Select1(int n) const {
   // Linear search on remaining "words"
   const int offset = (chunk_index * chunk_size_) & ~int{3};
   const uint8_t *ptr = data_ + offset;
+  const uint8_t *const end = data_ + length_;
   while (true) {
-    const int bit_count = absl::popcount(absl::little_endian::Load32(ptr));
+    const uint64_t word = LoadWord(ptr, end);
+    const int bit_count = absl::popcount(word);
     if (bit_count >= n) {
-      break;
+      return (ptr - data_) * 8 + SelectInWord(word, n);
     }
     n -= bit_count;
-    ptr += 4;
-  }
-
-  int index = (ptr - data_) * 8;
-  for (uint32_t word = absl::little_endian::Load32(ptr); n > 0;
-       word >>= 1, ++index) {
-    n -= (word & 1);
+    ptr += 8;
   }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
 }
 
 }  // namespace louds
@@ -30,6 +30,7 @@
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
 #include <cstdint>
+#include <random>
 #include <string>
 #include <utility>
 
@@ -191,4 +192,36 @@ TEST_P(SimpleSuccinctBitVectorIndexTest, Pattern2) {
 }
 INSTANTIATE_TEST_CASE(GenPattern2Test);
 
+TEST_P(SimpleSuccinctBitVectorIndexTest, RandomBits) {
+  const CacheSizeParam &param = GetParam();
+
+  // 4 * 257 bytes, so that the last 32-bit word doesn't form a 64-bit word.
+  std::mt19937 gen(0);
+  std::string data(4 * 257, '\0');
+  for (char &c : data) {
+    c = static_cast<char>(gen() & 0xFF);
+  }
+
+  SimpleSuccinctBitVectorIndex bit_vector;
+  bit_vector.Init(reinterpret_cast<const uint8_t *>(data.data()), data.length(),
+                  param.first, param.second);
+
+  int num0 = 0;
+  int num1 = 0;
+  for (size_t i = 0; i < data.length() * 8; ++i) {
+    EXPECT_EQ(bit_vector.Rank0(i), num0) << i;
+    EXPECT_EQ(bit_vector.Rank1(i), num1) << i;
+    if (bit_vector.Get(i)) {
+      ++num1;
+      EXPECT_EQ(bit_vector.Select1(num1), i) << i;
+    } else {
+      ++num0;
+      EXPECT_EQ(bit_vector.Select0(num0), i) << i;
+    }
+  }
+  EXPECT_EQ(bit_vector.GetNum0Bits(), num0);
+  EXPECT_EQ(bit_vector.GetNum1Bits(), num1);
+}
+INSTANTIATE_TEST_CASE(GenRandomBitsTest);
+
 }  // namespace
@@ -35,8 +35,7 @@
 #include <cstring>
 #include <ctime>
 #include <ios>
-#include <iterator>
-#include <list>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -73,6 +72,8 @@ constexpr size_t kFileHeaderSize = 12;
 
 constexpr uint64_t k62DaysInSec = 62 * 24 * 60 * 60;
 
+constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
 template <class T>
 inline void ReadValue(char **ptr, T *value) {
   memcpy(value, *ptr, sizeof(*value));
@@ -111,6 +112,29 @@ class CompareByTimeStamp {
   }
 };
 
+// Sorts |keys| by their upper 32 bits with LSD radix sort, which is stable.
+// Passes whose byte is the same for all the keys are skipped; timestamps
+// usually share their upper bytes.
+void RadixSortByUpper32Bits(std::vector<uint64_t> *keys) {
+  std::vector<uint64_t> buf(keys->size());
+  for (int shift = 32; shift < 64; shift += 8) {
+    size_t offsets[257] = {};
+    for (const uint64_t key : *keys) {
+      ++offsets[((key >> shift) & 0xFF) + 1];
+    }
+    if (std::find(offsets + 1, offsets + 257, keys->size()) != offsets + 257) {
+      continue;
+    }
+    for (int i = 1; i < 257; ++i) {
+      offsets[i] += offsets[i - 1];
+    }
+    for (const uint64_t key : *keys) {
+      buf[offsets[(key >> shift) & 0xFF]++] = key;
+    }
+    keys->swap(buf);
+  }
+}
+
 }  // namespace
 
 LruStorage *LruStorage::Create(const char *filename) {
@@ -180,7 +204,7 @@ bool LruStorage::CreateStorageFile(const char *filename, size_t value_size,
 // Reopen file after initializing mapped page.
 bool LruStorage::Clear() {
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.empty() || lru_list_.empty()) {
+  if (mmap_.empty() || num_items_ == 0) {
     return true;
   }
   const size_t offset = sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
@@ -188,8 +212,6 @@ bool LruStorage::Clear() {
     return false;
   }
   memset(mmap_.begin() + offset, '\0', mmap_.size() - offset);
-  lru_list_.clear();
-  lru_map_.clear();
   Open(mmap_.begin(), mmap_.size());
   return true;
 }
@@ -264,7 +286,9 @@ LruStorage::LruStorage()
       seed_(0),
       next_item_(nullptr),
       begin_(nullptr),
-      end_(nullptr) {}
+      end_(nullptr),
+      num_items_(0),
+      table_mask_(0) {}
 
 LruStorage::~LruStorage() { Close(); }
 
@@ -346,6 +370,9 @@ bool LruStorage::Open(const char *filename) {
 }
 
 bool LruStorage::Open(char *ptr, size_t ptr_size) {
+  num_items_ = 0;
+  nodes_.clear();
+  table_.clear();
   begin_ = ptr;
   end_ = ptr + ptr_size;
 
@@ -379,25 +406,42 @@ bool LruStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  std::vector<char *> ary;
-  for (char *begin = begin_; begin < end_; begin += item_size()) {
-    ary.push_back(begin);
-  }
-  std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
-
-  lru_list_.clear();
-  lru_map_.clear();
-  char *next = nullptr;
-  for (size_t i = 0; i < ary.size(); ++i) {
-    if (GetTimeStamp(ary[i]) != 0) {
-      lru_list_.push_back(ary[i]);
-      lru_map_[GetFP(ary[i])] = std::prev(lru_list_.end());
-    } else if (next == nullptr) {
-      next = ary[i];
+  // Items are ordered from new to old by the timestamp.  Each key holds the
+  // complement of the timestamp in the upper 32 bits and the item index in the
+  // lower 32 bits, so the stable radix sort keeps the items with the same
+  // timestamp in the order of the mapped region.
+  std::vector<uint64_t> keys;
+  keys.reserve(size_);
+  next_item_ = nullptr;
+  for (char *item = begin_; item < end_; item += item_size()) {
+    const uint32_t timestamp = GetTimeStamp(item);
+    if (timestamp != 0) {
+      keys.push_back(static_cast<uint64_t>(~timestamp) << 32 | GetIndex(item));
+    } else if (next_item_ == nullptr) {
+      next_item_ = item;
     }
   }
-  next_item_ = (next != nullptr) ? next : end_;
+  if (next_item_ == nullptr) {
+    next_item_ = end_;
+  }
   DCHECK_LE(next_item_, end_);
+  RadixSortByUpper32Bits(&keys);
+
+  ResetIndex();
+  for (const uint64_t key : keys) {
+    const uint32_t index = static_cast<uint32_t>(key);
+    const uint64_t fp = GetFP(GetItem(index));
+    // Keeps the newer one if the fingerprint is duplicated.
+    if (Find(fp) == kInvalidIndex) {
+      AddToTable(fp, index);
+    }
+    // Appends to the back.
+    const uint32_t last = nodes_[size_].prev;
+    nodes_[index] = {last, static_cast<uint32_t>(size_)};
+    nodes_[last].next = index;
+    nodes_[size_].prev = index;
+    ++num_items_;
+  }
 
   // At the time file is opened, perform clean up.
   DeleteElementsUntouchedFor62Days();
@@ -411,8 +455,98 @@ void LruStorage::Close() {
 
   filename_.clear();
   mmap_.Close();
-  lru_list_.clear();
-  lru_map_.clear();
+  num_items_ = 0;
+  nodes_ = std::vector<Node>();
+  table_ = std::vector<Bucket>();
+  table_mask_ = 0;
+}
+
+void LruStorage::ResetIndex() {
+  // The sentinel is linked to itself and the other nodes are not linked.
+  nodes_.assign(size_ + 1, Node{kInvalidIndex, kInvalidIndex});
+  nodes_[size_] = {static_cast<uint32_t>(size_), static_cast<uint32_t>(size_)};
+  num_items_ = 0;
+
+  // Keeps the load factor under 2/3.
+  size_t table_size = 1;
+  while (table_size < size_ + size_ / 2) {
+    table_size *= 2;
+  }
+  table_.assign(table_size, Bucket{0, kInvalidIndex});
+  table_mask_ = table_size - 1;
+}
+
+uint32_t LruStorage::Find(uint64_t fp) const {
+  if (table_.empty()) {
+    return kInvalidIndex;
+  }
+  for (size_t i = fp & table_mask_;; i = (i + 1) & table_mask_) {
+    const Bucket &bucket = table_[i];
+    if (bucket.index == kInvalidIndex || bucket.fp == fp) {
+      return bucket.index;
+    }
+  }
+}
+
+void LruStorage::AddToTable(uint64_t fp, uint32_t index) {
+  DCHECK_EQ(Find(fp), kInvalidIndex);
+  size_t i = fp & table_mask_;
+  while (table_[i].index != kInvalidIndex) {
+    i = (i + 1) & table_mask_;
+  }
+  table_[i] = {fp, index};
+}
+
+void LruStorage::RemoveFromTable(uint64_t fp, uint32_t index) {
+  size_t i = fp & table_mask_;
+  while (table_[i].fp != fp || table_[i].index != index) {
+    if (table_[i].index == kInvalidIndex) {
+      return;
+    }
+    i = (i + 1) & table_mask_;
+  }
+  // Backward shift deletion: moves the following buckets of the probe
+  // sequence into the hole so that no tombstone is needed.
+  for (size_t j = (i + 1) & table_mask_; table_[j].index != kInvalidIndex;
+       j = (j + 1) & table_mask_) {
+    const size_t home = table_[j].fp & table_mask_;
+    if (((j - home) & table_mask_) >= ((j - i) & table_mask_)) {
+      table_[i] = table_[j];
+      i = j;
+    }
+  }
+  table_[i].index = kInvalidIndex;
+}
+
+bool LruStorage::IsLinked(uint32_t index) const {
+  return nodes_[index].prev != kInvalidIndex;
+}
+
+void LruStorage::LinkToFront(uint32_t index) {
+  const uint32_t first = nodes_[size_].next;
+  nodes_[index] = {static_cast<uint32_t>(size_), first};
+  nodes_[first].prev = index;
+  nodes_[size_].next = index;
+  ++num_items_;
+}
+
+void LruStorage::Unlink(uint32_t index) {
+  const Node node = nodes_[index];
+  nodes_[node.prev].next = node.next;
+  nodes_[node.next].prev = node.prev;
+  nodes_[index] = {kInvalidIndex, kInvalidIndex};
+  --num_items_;
+}
+
+void LruStorage::MoveToFront(uint32_t index) {
+  if (nodes_[size_].next != index) {
+    Unlink(index);
+    LinkToFront(index);
+  }
+}
+
+uint32_t LruStorage::Back() const {
+  return num_items_ == 0 ? kInvalidIndex : nodes_[size_].prev;
 }
 
 const char *LruStorage::Lookup(const std::string &key) const {
@@ -422,17 +556,49 @@ const char *LruStorage::Lookup(const std::string &key) const {
 
 const char *LruStorage::Lookup(const std::string &key,
                                uint32_t *last_access_time) const {
-  const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  const auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t index = Find(Hash::FingerprintWithSeed(key, seed_));
+  if (index == kInvalidIndex) {
     return nullptr;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const char *item = GetItem(index);
+  const uint32_t timestamp = GetTimeStamp(item);
   if (IsOlderThan62Days(timestamp)) {
     return nullptr;
   }
   *last_access_time = timestamp;
-  return GetValue(*it->second);
+  return GetValue(item);
+}
+
+void LruStorage::LookupBatch(absl::Span<const uint64_t> fps,
+                             absl::Span<const char *> values,
+                             absl::Span<uint32_t> last_access_times) const {
+  DCHECK_EQ(fps.size(), values.size());
+  DCHECK_EQ(fps.size(), last_access_times.size());
+  if (table_.empty()) {
+    std::fill(values.begin(), values.end(), nullptr);
+    return;
+  }
+#if defined(__GNUC__)
+  // Issues the loads of the first buckets before probing any of them.
+  for (const uint64_t fp : fps) {
+    __builtin_prefetch(&table_[fp & table_mask_]);
+  }
+#endif  // __GNUC__
+  const uint64_t now = Clock::GetTime();
+  for (size_t i = 0; i < fps.size(); ++i) {
+    values[i] = nullptr;
+    const uint32_t index = Find(fps[i]);
+    if (index == kInvalidIndex) {
+      continue;
+    }
+    const char *item = GetItem(index);
+    const uint32_t timestamp = GetTimeStamp(item);
+    if (timestamp + k62DaysInSec < now) {
+      continue;
+    }
+    values[i] = GetValue(item);
+    last_access_times[i] = timestamp;
+  }
 }
 
 void LruStorage::GetAllValues(std::vector<std::string> *values) const {
@@ -440,7 +606,12 @@ void LruStorage::GetAllValues(std::vector<std::string> *values) const {
   values->clear();
   // Iterate data from the most recently used element to the least recently used
   // element.
-  for (const char *ptr : lru_list_) {
+  if (nodes_.empty()) {
+    return;
+  }
+  values->reserve(num_items_);
+  for (uint32_t i = nodes_[size_].next; i != size_; i = nodes_[i].next) {
+    const char *ptr = GetItem(i);
     const uint32_t timestamp = GetTimeStamp(ptr);
     if (IsOlderThan62Days(timestamp)) {
       break;
@@ -453,18 +624,16 @@ void LruStorage::GetAllValues(std::vector<std::string> *values) const {
 }
 
 bool LruStorage::Touch(const std::string &key) {
-  const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t index = Find(Hash::FingerprintWithSeed(key, seed_));
+  if (index == kInvalidIndex) {
     return false;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
-  if (IsOlderThan62Days(timestamp)) {
+  char *item = GetItem(index);
+  if (IsOlderThan62Days(GetTimeStamp(item))) {
     return false;
   }
-  Update(*it->second);
-  // Move the node pointed to by it->second to the front.
-  lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  Update(item);
+  MoveToFront(index);
   return true;
 }
 
@@ -475,34 +644,40 @@ bool LruStorage::Insert(const std::string &key, const char *value) {
   const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
 
   // If the data corresponding to |key| already exists in LRU, update it.
-  {
-    auto it = lru_map_.find(fp);
-    if (it != lru_map_.end()) {
-      // Overwrite the data pointed to by it->second and move it to the front.
-      Update(*it->second, fp, value, value_size_);
-      lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
-      return true;
-    }
+  if (const uint32_t index = Find(fp); index != kInvalidIndex) {
+    // Overwrite the data and move it to the front.
+    Update(GetItem(index), fp, value, value_size_);
+    MoveToFront(index);
+    return true;
   }
 
   // If the LRU is full or we run out of the mmap region, drop the least
   // recently used element (actually, the least recently used element is
   // overwritten with new data).
-  if (lru_map_.size() >= size_ || next_item_ == end_) {
-    auto it = std::prev(lru_list_.end());  // Least recently used data.
-    const uint64_t old_fp = GetFP(*it);
-    lru_map_.erase(old_fp);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it);  // Move to front.
-    Update(*it, fp, value, value_size_);
-    lru_map_[fp] = it;
-    return true;
+  if (num_items_ >= size_ || next_item_ == end_) {
+    const uint32_t index = Back();  // Least recently used data.
+    if (index != kInvalidIndex) {
+      char *item = GetItem(index);
+      RemoveFromTable(GetFP(item), index);
+      MoveToFront(index);
+      Update(item, fp, value, value_size_);
+      AddToTable(fp, index);
+      return true;
+    }
   }
 
   // A new item can be assigned in the mmap region.
   if (next_item_ < end_) {
+    const uint32_t index = GetIndex(next_item_);
+    if (IsLinked(index)) {
+      // Can happen only when the used items are not packed at the beginning
+      // of the region, e.g., the file was written by Write().
+      RemoveFromTable(GetFP(next_item_), index);
+      Unlink(index);
+    }
     Update(next_item_, fp, value, value_size_);
-    lru_list_.push_front(next_item_);
-    lru_map_[fp] = lru_list_.begin();
+    LinkToFront(index);
+    AddToTable(fp, index);
     // Advance next_item_ for next item.
     next_item_ += item_size();
     DCHECK_LE(next_item_, end_);
@@ -515,10 +690,9 @@ bool LruStorage::Insert(const std::string &key, const char *value) {
 
 bool LruStorage::TryInsert(const std::string &key, const char *value) {
   const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it != lru_map_.end()) {
-    Update(*it->second, fp, value, value_size_);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  if (const uint32_t index = Find(fp); index != kInvalidIndex) {
+    Update(GetItem(index), fp, value, value_size_);
+    MoveToFront(index);
   }
   return true;
 }
@@ -529,15 +703,11 @@ bool LruStorage::Delete(const std::string &key) {
 }
 
 bool LruStorage::Delete(uint64_t fp) {
-  auto it = lru_map_.find(fp);
-  return (it == lru_map_.end() || Delete(fp, it->second));
+  const uint32_t index = Find(fp);
+  return (index == kInvalidIndex || DeleteItem(index));
 }
 
-bool LruStorage::Delete(std::list<char *>::iterator it) {
-  return (it == lru_list_.end() || Delete(GetFP(*it), it));
-}
-
-bool LruStorage::Delete(uint64_t fp, std::list<char *>::iterator it) {
+bool LruStorage::DeleteItem(uint32_t index) {
   // Determine the last element in the mmap region.
   if (next_item_ < begin_ + item_size()) {
     LOG(ERROR) << "next_item_ points to invalid location (broken?)";
@@ -545,20 +715,29 @@ bool LruStorage::Delete(uint64_t fp, std::list<char *>::iterator it) {
   }
   next_item_ -= item_size();
 
-  // Backup the location of mmap region to which another element will be moved.
-  char *deleted_item_pos = *it;
+  // Erase the LRU structure for the item.
+  char *deleted_item_pos = GetItem(index);
+  RemoveFromTable(GetFP(deleted_item_pos), index);
+  Unlink(index);
 
-  // Erase the LRU structure for (fp, it).
-  lru_map_.erase(fp);
-  lru_list_.erase(it);
-
-  if (next_item_ != deleted_item_pos) {
+  const uint32_t last = GetIndex(next_item_);
+  if (last != index) {
     // Move the region for the last element to the deleted location.  Then,
-    // update the LRU structure for the moved element (the pointer to mmap
-    // region in the list node is updated.)
+    // update the LRU structure for the moved element (its node and table entry
+    // take over the deleted index.)
     std::memcpy(deleted_item_pos, next_item_, item_size());
-    const uint64_t fp = GetFP(next_item_);
-    *lru_map_[fp] = deleted_item_pos;
+    if (IsLinked(last)) {
+      const Node node = nodes_[last];
+      nodes_[index] = node;
+      nodes_[node.prev].next = index;
+      nodes_[node.next].prev = index;
+      nodes_[last] = {kInvalidIndex, kInvalidIndex};
+      const uint64_t fp = GetFP(next_item_);
+      RemoveFromTable(fp, last);
+      if (Find(fp) == kInvalidIndex) {
+        AddToTable(fp, index);
+      }
+    }
   }
 
   // Clear the region for the next_item_.
@@ -572,13 +751,13 @@ int LruStorage::DeleteElementsBefore(uint32_t timestamp) {
     return 0;
   }
   int num_deleted = 0;
-  while (!lru_list_.empty()) {
-    auto it = std::prev(lru_list_.end());
-    const uint32_t last_access_time = GetTimeStamp(*it);
+  while (num_items_ > 0) {
+    const uint32_t index = Back();
+    const uint32_t last_access_time = GetTimeStamp(GetItem(index));
     if (last_access_time >= timestamp) {
       break;
     }
-    if (Delete(it)) {
+    if (DeleteItem(index)) {
       ++num_deleted;
       continue;
     }
@@ -601,7 +780,7 @@ size_t LruStorage::value_size() const { return value_size_; }
 
 size_t LruStorage::size() const { return size_; }
 
-size_t LruStorage::used_size() const { return lru_list_.size(); }
+size_t LruStorage::used_size() const { return num_items_; }
 
 uint32_t LruStorage::seed() const { return seed_; }
 
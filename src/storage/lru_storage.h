@@ -30,15 +30,15 @@
 #ifndef MOZC_STORAGE_LRU_STORAGE_H_
 #define MOZC_STORAGE_LRU_STORAGE_H_
 
+#include <cstddef>
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "base/mmap.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace storage {
@@ -65,6 +65,14 @@ class LruStorage {
   const char *Lookup(const std::string &key, uint32_t *last_access_time) const;
   const char *Lookup(const std::string &key) const;
 
+  // Looks up elements by the fingerprints of keys computed with seed().  For
+  // each fps[i], values[i] is set to the value or nullptr if not found, and
+  // last_access_times[i] is set to its last access time if found.  Looking
+  // up many keys at once lets the probes of the table overlap.
+  void LookupBatch(absl::Span<const uint64_t> fps,
+                   absl::Span<const char *> values,
+                   absl::Span<uint32_t> last_access_times) const;
+
   // A safer lookup for string values (the pointers returned by above Lookup()'s
   // are not null terminated.)
   absl::string_view LookupAsString(const std::string &key) const {
@@ -149,15 +157,48 @@ class LruStorage {
                                 size_t size, uint32_t seed);
 
  private:
+  // Doubly linked list node of the LRU order.  Node i corresponds to the i-th
+  // item in the mapped region, and nodes_[size_] is the sentinel whose next is
+  // the most recently used item.
+  struct Node {
+    uint32_t prev;
+    uint32_t next;
+  };
+
+  // Bucket of the open-addressed (linear probing) table from fingerprint to
+  // item index.  The fingerprint is kept in the bucket so that a probe doesn't
+  // touch the mapped region.
+  struct Bucket {
+    uint64_t fp;
+    uint32_t index;
+  };
+
   // Initializes this LRU from memory buffer.
   bool Open(char *ptr, size_t ptr_size);
 
-  // Deletes the element from |fp| or |it|.
+  // Deletes the element from |fp| or the item |index|.
   bool Delete(uint64_t fp);
-  bool Delete(std::list<char *>::iterator it);
 
   // Actual implementation of Delete() methods.
-  bool Delete(uint64_t fp, std::list<char *>::iterator it);
+  bool DeleteItem(uint32_t index);
+
+  char *GetItem(uint32_t index) const { return begin_ + index * item_size(); }
+  uint32_t GetIndex(const char *item) const {
+    return static_cast<uint32_t>((item - begin_) / item_size());
+  }
+
+  // Returns the index of the item for |fp|, or kInvalidIndex.
+  uint32_t Find(uint64_t fp) const;
+  void AddToTable(uint64_t fp, uint32_t index);
+  // Removes |fp| from the table only when it points to |index|.
+  void RemoveFromTable(uint64_t fp, uint32_t index);
+  void ResetIndex();
+
+  bool IsLinked(uint32_t index) const;
+  void LinkToFront(uint32_t index);
+  void Unlink(uint32_t index);
+  void MoveToFront(uint32_t index);
+  uint32_t Back() const;
 
   size_t value_size_;
   size_t size_;
@@ -166,8 +207,10 @@ class LruStorage {
   char *begin_;
   char *end_;
   std::string filename_;
-  std::list<char *> lru_list_;  // Front is the most recently used data.
-  absl::flat_hash_map<uint64_t, std::list<char *>::iterator> lru_map_;
+  size_t num_items_;
+  std::vector<Node> nodes_;
+  std::vector<Bucket> table_;
+  size_t table_mask_;
   Mmap mmap_;
 };
 
@@ -41,6 +41,7 @@
 
 #include "base/clock_mock.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/random.h"
@@ -50,6 +51,9 @@
 #include "testing/gunit.h"
 #include "absl/flags/flag.h"
 #include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace storage {
@@ -578,5 +582,117 @@ TEST_F(LruStorageTest, OldDataAreNotLookedUp) {
   EXPECT_TRUE(storage.Touch("4444"));
 }
 
+TEST_F(LruStorageTest, RandomOperationsAndReopen) {
+  ScopedClockMock clock(1, 0);
+  clock->SetAutoPutClockForward(1, 0);
+
+  constexpr size_t kValueSize = 4;
+  constexpr size_t kNumElements = 64;
+  const std::string filename = GetTemporaryFilePath();
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(filename.c_str(), kValueSize, kNumElements,
+                                   kSeed));
+
+  // Front is the most recently used key.
+  std::vector<std::string> expected_keys;
+  auto move_to_front = [&expected_keys](const std::string &key) {
+    expected_keys.erase(
+        std::remove(expected_keys.begin(), expected_keys.end(), key),
+        expected_keys.end());
+    expected_keys.insert(expected_keys.begin(), key);
+  };
+  auto value_of = [](const std::string &key) {
+    std::string value = key;
+    value.resize(kValueSize, ' ');
+    return value;
+  };
+
+  absl::BitGen gen;
+  for (int i = 0; i < 5000; ++i) {
+    const std::string key = absl::StrCat(absl::Uniform(gen, 0, 200));
+    switch (absl::Uniform(gen, 0, 4)) {
+      case 0:
+      case 1:
+        ASSERT_TRUE(storage.Insert(key, value_of(key).data()));
+        move_to_front(key);
+        if (expected_keys.size() > kNumElements) {
+          expected_keys.pop_back();
+        }
+        break;
+      case 2: {
+        const bool found = std::find(expected_keys.begin(),
+                                     expected_keys.end(),
+                                     key) != expected_keys.end();
+        EXPECT_EQ(storage.Touch(key), found);
+        if (found) {
+          move_to_front(key);
+        }
+        break;
+      }
+      default:
+        ASSERT_TRUE(storage.Delete(key));
+        expected_keys.erase(
+            std::remove(expected_keys.begin(), expected_keys.end(), key),
+            expected_keys.end());
+        break;
+    }
+    ASSERT_EQ(storage.used_size(), expected_keys.size());
+  }
+
+  std::vector<std::string> expected_values;
+  for (const std::string &key : expected_keys) {
+    EXPECT_EQ(storage.LookupAsString(key), value_of(key));
+    expected_values.push_back(value_of(key));
+  }
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_EQ(values, expected_values);
+
+  // The LRU order is restored from the timestamps.
+  storage.Close();
+  ASSERT_TRUE(storage.Open(filename.c_str()));
+  EXPECT_EQ(storage.used_size(), expected_keys.size());
+  for (const std::string &key : expected_keys) {
+    EXPECT_EQ(storage.LookupAsString(key), value_of(key));
+  }
+  storage.GetAllValues(&values);
+  EXPECT_EQ(values, expected_values);
+}
+
+TEST_F(LruStorageTest, LookupBatch) {
+  ScopedClockMock clock(1, 0);
+
+  constexpr size_t kValueSize = 4;
+  constexpr size_t kNumElements = 4;
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(GetTemporaryFilePath().c_str(), kValueSize,
+                                   kNumElements, kSeed));
+  EXPECT_TRUE(storage.Insert("1111", "aaaa"));
+  clock->PutClockForward(63 * 24 * 60 * 60, 0);
+  EXPECT_TRUE(storage.Insert("2222", "bbbb"));
+  EXPECT_TRUE(storage.Insert("3333", "cccc"));
+
+  const std::vector<uint64_t> fps = {
+      Hash::FingerprintWithSeed("3333", kSeed),
+      Hash::FingerprintWithSeed("1111", kSeed),  // Older than 62 days.
+      Hash::FingerprintWithSeed("4444", kSeed),  // Not inserted.
+      Hash::FingerprintWithSeed("2222", kSeed),
+  };
+  std::vector<const char *> values(fps.size());
+  std::vector<uint32_t> last_access_times(fps.size());
+  storage.LookupBatch(fps, absl::MakeSpan(values),
+                      absl::MakeSpan(last_access_times));
+  ASSERT_NE(values[0], nullptr);
+  EXPECT_EQ(absl::string_view(values[0], kValueSize), "cccc");
+  EXPECT_EQ(values[1], nullptr);
+  EXPECT_EQ(values[2], nullptr);
+  ASSERT_NE(values[3], nullptr);
+  EXPECT_EQ(absl::string_view(values[3], kValueSize), "bbbb");
+
+  uint32_t last_access_time = 0;
+  storage.Lookup("2222", &last_access_time);
+  EXPECT_EQ(last_access_times[3], last_access_time);
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -0,0 +1,129 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "testing/benchmark_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/util.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+namespace {
+
+std::atomic<int64_t> g_allocation_count{0};
+
+}  // namespace
+
+// Counts the allocations of the whole binary.  The default implementations of
+// the other forms of operator new (array, nothrow, aligned) don't necessarily
+// call this one, so the array forms are replaced too.
+void *operator new(size_t size) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size); ptr != nullptr) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return ::operator new(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace mozc {
+namespace testing {
+
+int64_t GetAllocationCount() {
+  return g_allocation_count.load(std::memory_order_relaxed);
+}
+
+absl::StatusOr<std::vector<std::vector<std::string>>> ReadTsv(
+    const std::string &filename) {
+  InputFileStream ifs(filename);
+  if (!ifs.good()) {
+    return absl::UnavailableError(absl::StrCat("Failed to read: ", filename));
+  }
+  std::vector<std::vector<std::string>> rows;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    rows.push_back(absl::StrSplit(line, '\t'));
+  }
+  return rows;
+}
+
+absl::StatusOr<std::vector<std::string>> ReadTsvColumn(
+    const std::string &filename, int column) {
+  absl::StatusOr<std::vector<std::vector<std::string>>> rows =
+      ReadTsv(filename);
+  if (!rows.ok()) {
+    return rows.status();
+  }
+  std::vector<std::string> values;
+  for (std::vector<std::string> &row : *rows) {
+    if (row.size() > static_cast<size_t>(column) && !row[column].empty()) {
+      values.push_back(std::move(row[column]));
+    }
+  }
+  return values;
+}
+
+std::vector<std::string> MakeSuffixes(
+    const std::vector<std::string> &sentences) {
+  std::vector<std::string> suffixes;
+  for (const std::string &sentence : sentences) {
+    absl::string_view rest = sentence;
+    while (!rest.empty()) {
+      suffixes.emplace_back(rest);
+      rest.remove_prefix(
+          std::min<size_t>(Util::OneCharLen(rest.data()), rest.size()));
+    }
+  }
+  return suffixes;
+}
+
+}  // namespace testing
+}  // namespace mozc
@@ -0,0 +1,70 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_TESTING_BENCHMARK_UTIL_H_
+#define MOZC_TESTING_BENCHMARK_UTIL_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+
+namespace mozc {
+namespace testing {
+
+// Utilities shared by the benchmark binaries.
+//
+// Note: linking this library replaces the global operator new and delete of
+// the binary to count the allocations, so only benchmark binaries and their
+// tests should depend on it.
+
+// Returns the number of the calls of operator new in the process so far.
+int64_t GetAllocationCount();
+
+// Reads the rows of a TSV file.  Empty lines and lines starting with '#' are
+// skipped, and the trailing CR/LF of each line is removed.
+absl::StatusOr<std::vector<std::vector<std::string>>> ReadTsv(
+    const std::string &filename);
+
+// Reads the non-empty values at |column| of a TSV file in the same way as
+// ReadTsv().  Rows without |column| are skipped.
+absl::StatusOr<std::vector<std::string>> ReadTsvColumn(
+    const std::string &filename, int column);
+
+// Returns all the suffixes of |sentences| starting at character boundaries,
+// which is the key shape that lattice construction passes to
+// SystemDictionary::LookupPrefix.
+std::vector<std::string> MakeSuffixes(
+    const std::vector<std::string> &sentences);
+
+}  // namespace testing
+}  // namespace mozc
+
+#endif  // MOZC_TESTING_BENCHMARK_UTIL_H_
@@ -0,0 +1,95 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "testing/benchmark_util.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "testing/gmock.h"
+#include "testing/googletest.h"
+#include "testing/gunit.h"
+#include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
+
+namespace mozc {
+namespace testing {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(BenchmarkUtilTest, GetAllocationCount) {
+  const int64_t before = GetAllocationCount();
+  auto value = std::make_unique<int>(1);
+  auto array = std::make_unique<int[]>(10);
+  EXPECT_GE(GetAllocationCount() - before, 2);
+}
+
+TEST(BenchmarkUtilTest, ReadTsv) {
+  const std::string filename = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "benchmark_util_test.tsv");
+  ASSERT_OK(FileUtil::SetContents(filename,
+                                  "# comment\n"
+                                  "a\tb\tc\r\n"
+                                  "\n"
+                                  "d\te\n"));
+  const absl::StatusOr<std::vector<std::vector<std::string>>> rows =
+      ReadTsv(filename);
+  ASSERT_OK(rows);
+  EXPECT_THAT(*rows, ElementsAre(ElementsAre("a", "b", "c"),
+                                 ElementsAre("d", "e")));
+  EXPECT_FALSE(ReadTsv(filename + ".missing").ok());
+}
+
+TEST(BenchmarkUtilTest, ReadTsvColumn) {
+  const std::string filename = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "benchmark_util_test_column.tsv");
+  ASSERT_OK(FileUtil::SetContents(filename,
+                                  "a\tb\tc\n"
+                                  "d\n"
+                                  "e\t\tf\n"
+                                  "g\th\n"));
+  const absl::StatusOr<std::vector<std::string>> values =
+      ReadTsvColumn(filename, 1);
+  ASSERT_OK(values);
+  EXPECT_THAT(*values, ElementsAre("b", "h"));
+  EXPECT_FALSE(ReadTsvColumn(filename + ".missing", 1).ok());
+}
+
+TEST(BenchmarkUtilTest, MakeSuffixes) {
+  EXPECT_THAT(MakeSuffixes({"あいう", "ab", ""}),
+              ElementsAre("あいう", "いう", "う", "ab", "b"));
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace mozc
@@ -112,6 +112,20 @@
         }],
       ],
     },
+    {
+      # Replaces the global operator new and delete to count the allocations.
+      # Only the benchmark binaries should depend on this.
+      'target_name': 'benchmark_util',
+      'type': 'static_library',
+      'sources': [
+        'benchmark_util.cc',
+      ],
+      'dependencies': [
+        '../base/absl.gyp:absl_status',
+        '../base/absl.gyp:absl_strings',
+        '../base/base.gyp:base',
+      ],
+    },
     {
       'target_name': 'gen_mozc_data_dir_header',
       'type': 'none',
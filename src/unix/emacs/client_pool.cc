@@ -33,11 +33,26 @@
 
 #include <memory>
 
+#include "protocol/commands.pb.h"
+
 namespace mozc {
 namespace emacs {
 
 static constexpr int kMaxClients = 64;  // max number of parallel clients
 
+namespace {
+
+std::shared_ptr<ClientPool::Client> NewClient() {
+  auto client = std::make_shared<ClientPool::Client>();
+  // The client library restores the candidate lists omitted by the server.
+  commands::Capability capability;
+  capability.set_candidate_window_delta(true);
+  client->set_client_capability(capability);
+  return client;
+}
+
+}  // namespace
+
 ClientPool::ClientPool() : lru_cache_(kMaxClients), next_id_(1) {}
 
 int ClientPool::CreateClient() {
@@ -48,7 +63,7 @@ int ClientPool::CreateClient() {
       next_id_ = 1;  // Keep next_id_ to be a positive 28-bit integer.
     }
   }
-  lru_cache_.Insert(next_id_, std::make_shared<Client>());
+  lru_cache_.Insert(next_id_, NewClient());
   return next_id_++;
 }
 
@@ -60,7 +75,7 @@ std::shared_ptr<ClientPool::Client> ClientPool::GetClient(int id) {
     lru_cache_.Insert(id, *value);  // Put id at the head of LRU.
     return *value;
   } else {
-    std::shared_ptr<Client> client_ptr = std::make_shared<Client>();
+    std::shared_ptr<Client> client_ptr = NewClient();
     lru_cache_.Insert(id, client_ptr);
     return client_ptr;
   }
@@ -177,10 +177,22 @@ std::unique_ptr<client::ClientInterface> CreateAndConfigureClient() {
   // Currently client capability is fixed.
   commands::Capability capability;
   capability.set_text_deletion(commands::Capability::DELETE_PRECEDING_TEXT);
+  // The client library restores the candidate lists omitted by the server.
+  capability.set_candidate_window_delta(true);
   client->set_client_capability(capability);
   return client;
 }
 
+renderer::RendererClient *CreateRendererClient(bool use_mozc_renderer) {
+  auto *renderer_client = new renderer::RendererClient();
+  // Key events must not wait for the renderer to draw the candidate window.
+  // The sender thread is not needed when the renderer is never used.
+  if (use_mozc_renderer) {
+    renderer_client->EnableAsyncUpdate();
+  }
+  return renderer_client;
+}
+
 bool UseMozcCandidateWindow() {
   if (!absl::GetFlag(FLAGS_use_mozc_renderer)) {
     return false;
@@ -223,7 +235,8 @@ MozcEngine::MozcEngine()
 #endif  // MOZC_ENABLE_X11_SELECTION_MONITOR
       preedit_handler_(new PreeditHandler()),
       use_mozc_candidate_window_(UseMozcCandidateWindow()),
-      mozc_candidate_window_handler_(new renderer::RendererClient()),
+      mozc_candidate_window_handler_(
+          CreateRendererClient(use_mozc_candidate_window_)),
       preedit_method_(config::Config::ROMAN) {
   if (selection_monitor_ != nullptr) {
     selection_monitor_->StartMonitoring();
@@ -0,0 +1,274 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "usage_stats/latency_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace usage_stats {
+namespace {
+
+using StageId = LatencyStats::StageId;
+
+// Histogram of a stage written by a single thread.  The fields are atomic
+// only so that snapshots can read them while the thread is writing.
+struct Histogram {
+  std::atomic<uint64_t> count = 0;
+  std::atomic<uint64_t> total_usec = 0;
+  std::atomic<uint64_t> max_usec = 0;
+  std::atomic<uint64_t> buckets[LatencyStats::kNumBuckets] = {};
+};
+
+// Histograms owned by a thread.  A shard is reused by another thread after its
+// owner exits, and is never deleted.
+struct Shard {
+  std::atomic<Histogram *> histograms[LatencyStats::kMaxStages] = {};
+};
+
+// Adds |n| to a value written only by the owner thread, which doesn't need an
+// atomic read-modify-write.
+inline void Add(std::atomic<uint64_t> *value, uint64_t n) {
+  value->store(value->load(std::memory_order_relaxed) + n,
+               std::memory_order_relaxed);
+}
+
+class Registry {
+ public:
+  StageId Register(absl::string_view name) {
+    absl::MutexLock lock(&mutex_);
+    for (size_t i = 0; i < names_.size(); ++i) {
+      if (names_[i] == name) {
+        return static_cast<StageId>(i);
+      }
+    }
+    if (names_.size() >= LatencyStats::kMaxStages) {
+      return LatencyStats::kInvalidStage;
+    }
+    names_.emplace_back(name);
+    return static_cast<StageId>(names_.size() - 1);
+  }
+
+  Shard *AcquireShard() {
+    absl::MutexLock lock(&mutex_);
+    if (!free_shards_.empty()) {
+      Shard *shard = free_shards_.back();
+      free_shards_.pop_back();
+      return shard;
+    }
+    shards_.push_back(std::make_unique<Shard>());
+    return shards_.back().get();
+  }
+
+  void ReleaseShard(Shard *shard) {
+    absl::MutexLock lock(&mutex_);
+    free_shards_.push_back(shard);
+  }
+
+  std::vector<LatencyStats::StageSnapshot> GetSnapshot() {
+    absl::MutexLock lock(&mutex_);
+    std::vector<LatencyStats::StageSnapshot> result;
+    for (size_t stage = 0; stage < names_.size(); ++stage) {
+      LatencyStats::StageSnapshot snapshot;
+      snapshot.buckets.resize(LatencyStats::kNumBuckets);
+      for (const std::unique_ptr<Shard> &shard : shards_) {
+        const Histogram *histogram =
+            shard->histograms[stage].load(std::memory_order_acquire);
+        if (histogram == nullptr) {
+          continue;
+        }
+        snapshot.count += histogram->count.load(std::memory_order_relaxed);
+        snapshot.total_usec +=
+            histogram->total_usec.load(std::memory_order_relaxed);
+        snapshot.max_usec =
+            std::max(snapshot.max_usec,
+                     histogram->max_usec.load(std::memory_order_relaxed));
+        for (int i = 0; i < LatencyStats::kNumBuckets; ++i) {
+          snapshot.buckets[i] +=
+              histogram->buckets[i].load(std::memory_order_relaxed);
+        }
+      }
+      if (snapshot.count > 0) {
+        snapshot.name = names_[stage];
+        result.push_back(std::move(snapshot));
+      }
+    }
+    return result;
+  }
+
+  void ClearAll() {
+    absl::MutexLock lock(&mutex_);
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+      for (std::atomic<Histogram *> &entry : shard->histograms) {
+        Histogram *histogram = entry.load(std::memory_order_acquire);
+        if (histogram == nullptr) {
+          continue;
+        }
+        histogram->count.store(0, std::memory_order_relaxed);
+        histogram->total_usec.store(0, std::memory_order_relaxed);
+        histogram->max_usec.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint64_t> &bucket : histogram->buckets) {
+          bucket.store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::string> names_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<Shard>> shards_ ABSL_GUARDED_BY(mutex_);
+  std::vector<Shard *> free_shards_ ABSL_GUARDED_BY(mutex_);
+};
+
+// The registry is intentionally leaked so that threads exiting after the
+// static destructors can still release their shards.
+Registry &GetRegistry() {
+  static Registry *registry = new Registry();
+  return *registry;
+}
+
+// Holds the shard of the current thread and returns it on thread exit.
+class ThreadShard {
+ public:
+  ThreadShard() = default;
+  ThreadShard(const ThreadShard &) = delete;
+  ThreadShard &operator=(const ThreadShard &) = delete;
+
+  ~ThreadShard() {
+    if (shard_ != nullptr) {
+      GetRegistry().ReleaseShard(shard_);
+    }
+  }
+
+  Shard *Get() {
+    if (shard_ == nullptr) {
+      shard_ = GetRegistry().AcquireShard();
+    }
+    return shard_;
+  }
+
+ private:
+  Shard *shard_ = nullptr;
+};
+
+thread_local ThreadShard thread_shard;
+
+}  // namespace
+
+uint64_t LatencyStats::StageSnapshot::GetPercentileUsec(
+    double percentile) const {
+  uint64_t total = 0;
+  for (const uint64_t bucket : buckets) {
+    total += bucket;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t rank = std::clamp<uint64_t>(
+      static_cast<uint64_t>(std::ceil(total * percentile / 100.0)), 1, total);
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    accumulated += buckets[i];
+    if (accumulated >= rank) {
+      return std::min(GetBucketUpperBoundUsec(static_cast<int>(i)), max_usec);
+    }
+  }
+  return max_usec;
+}
+
+StageId LatencyStats::RegisterStage(absl::string_view name) {
+  return GetRegistry().Register(name);
+}
+
+void LatencyStats::Record(StageId stage, absl::Duration latency) {
+  if (stage < 0 || stage >= kMaxStages) {
+    return;
+  }
+  const uint64_t usec = static_cast<uint64_t>(
+      std::max<int64_t>(absl::ToInt64Microseconds(latency), 0));
+
+  Shard *shard = thread_shard.Get();
+  Histogram *histogram =
+      shard->histograms[stage].load(std::memory_order_relaxed);
+  if (histogram == nullptr) {
+    histogram = new Histogram();
+    shard->histograms[stage].store(histogram, std::memory_order_release);
+  }
+  Add(&histogram->count, 1);
+  Add(&histogram->total_usec, usec);
+  if (usec > histogram->max_usec.load(std::memory_order_relaxed)) {
+    histogram->max_usec.store(usec, std::memory_order_relaxed);
+  }
+  Add(&histogram->buckets[GetBucketIndex(usec)], 1);
+}
+
+std::vector<LatencyStats::StageSnapshot> LatencyStats::GetSnapshot() {
+  return GetRegistry().GetSnapshot();
+}
+
+void LatencyStats::ClearAll() { GetRegistry().ClearAll(); }
+
+int LatencyStats::GetBucketIndex(uint64_t usec) {
+  constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+  if (usec < kSubBuckets) {
+    return static_cast<int>(usec);
+  }
+  if (usec > std::numeric_limits<uint32_t>::max()) {
+    return kNumBuckets - 1;
+  }
+  const int shift = absl::bit_width(usec) - 1 - kSubBucketBits;
+  return ((shift + 1) << kSubBucketBits) +
+         static_cast<int>((usec >> shift) & (kSubBuckets - 1));
+}
+
+uint64_t LatencyStats::GetBucketUpperBoundUsec(int index) {
+  constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const int shift = (index >> kSubBucketBits) - 1;
+  const uint64_t sub_bucket = index & (kSubBuckets - 1);
+  return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+}
+
+}  // namespace usage_stats
+}  // namespace mozc
@@ -0,0 +1,129 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_USAGE_STATS_LATENCY_STATS_H_
+#define MOZC_USAGE_STATS_LATENCY_STATS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/clock.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace usage_stats {
+
+// Latency histograms of the stages of the conversion pipeline.
+//
+// Unlike UsageStats, the histograms are kept only in memory and are never
+// written to disk.  Recording doesn't take any lock: each thread records to
+// its own histograms, which are summed up only when a snapshot is taken.  A
+// record costs two clock reads and a few relaxed atomic stores, so it is
+// always enabled.
+//
+// Usage:
+//   static const LatencyStats::StageId kStage =
+//       LatencyStats::RegisterStage("ImmutableConverter.Viterbi");
+//   ScopedLatencyRecorder recorder(kStage);
+class LatencyStats {
+ public:
+  using StageId = int;
+
+  // Returned by RegisterStage() when no more stage can be registered.
+  static constexpr StageId kInvalidStage = -1;
+  static constexpr int kMaxStages = 128;
+
+  // Latencies are recorded in microseconds.  Each power of two range is split
+  // into 2^kSubBucketBits buckets like HDR histograms, so a percentile is
+  // reported with a relative error of less than 1/2^kSubBucketBits.
+  // Latencies longer than 2^32 usec go to the last bucket.
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kNumBuckets = (32 - kSubBucketBits + 1)
+                                     << kSubBucketBits;
+
+  struct StageSnapshot {
+    // Returns the upper bound of the bucket in which the |percentile| (0, 100]
+    // latency falls, in microseconds.  Returns 0 if nothing is recorded.
+    uint64_t GetPercentileUsec(double percentile) const;
+
+    std::string name;
+    uint64_t count = 0;
+    uint64_t total_usec = 0;
+    uint64_t max_usec = 0;
+    std::vector<uint64_t> buckets;  // kNumBuckets elements.
+  };
+
+  LatencyStats() = delete;
+  LatencyStats(const LatencyStats &) = delete;
+  LatencyStats &operator=(const LatencyStats &) = delete;
+
+  // Returns the ID of the stage |name|.  The same ID is returned for the same
+  // name.  This takes a lock, so call sites should cache the ID.
+  static StageId RegisterStage(absl::string_view name);
+
+  // Records the latency of the stage.  It's no-op for kInvalidStage.
+  static void Record(StageId stage, absl::Duration latency);
+
+  // Returns the histograms of the stages that have any record, merged over
+  // all the threads.
+  static std::vector<StageSnapshot> GetSnapshot();
+
+  // Clears all the records.  Records made concurrently may be lost.
+  static void ClearAll();
+
+  // Returns the index of the bucket for |usec|, and the largest latency that
+  // falls in the bucket |index|.
+  static int GetBucketIndex(uint64_t usec);
+  static uint64_t GetBucketUpperBoundUsec(int index);
+};
+
+// Records the time from the construction to the destruction to the stage.
+class ScopedLatencyRecorder {
+ public:
+  explicit ScopedLatencyRecorder(LatencyStats::StageId stage)
+      : stage_(stage), start_(Clock::GetAbslTime()) {}
+
+  ScopedLatencyRecorder(const ScopedLatencyRecorder &) = delete;
+  ScopedLatencyRecorder &operator=(const ScopedLatencyRecorder &) = delete;
+
+  ~ScopedLatencyRecorder() {
+    LatencyStats::Record(stage_, Clock::GetAbslTime() - start_);
+  }
+
+ private:
+  const LatencyStats::StageId stage_;
+  const absl::Time start_;
+};
+
+}  // namespace usage_stats
+}  // namespace mozc
+
+#endif  // MOZC_USAGE_STATS_LATENCY_STATS_H_
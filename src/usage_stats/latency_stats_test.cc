@@ -0,0 +1,167 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "usage_stats/latency_stats.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "base/thread2.h"
+#include "testing/gunit.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace usage_stats {
+namespace {
+
+const LatencyStats::StageSnapshot *FindStage(
+    const std::vector<LatencyStats::StageSnapshot> &snapshot,
+    const std::string &name) {
+  for (const LatencyStats::StageSnapshot &stage : snapshot) {
+    if (stage.name == name) {
+      return &stage;
+    }
+  }
+  return nullptr;
+}
+
+class LatencyStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override { LatencyStats::ClearAll(); }
+  void TearDown() override { LatencyStats::ClearAll(); }
+};
+
+TEST_F(LatencyStatsTest, Buckets) {
+  EXPECT_EQ(LatencyStats::GetBucketIndex(0), 0);
+  int prev_index = 0;
+  for (uint64_t usec = 1; usec < (1 << 20); ++usec) {
+    const int index = LatencyStats::GetBucketIndex(usec);
+    ASSERT_LT(index, LatencyStats::kNumBuckets);
+    // Buckets are contiguous and the bounds are consistent with the index.
+    ASSERT_TRUE(index == prev_index || index == prev_index + 1) << usec;
+    ASSERT_LE(usec, LatencyStats::GetBucketUpperBoundUsec(index));
+    if (index > 0) {
+      ASSERT_GT(usec, LatencyStats::GetBucketUpperBoundUsec(index - 1));
+    }
+    // The width of a bucket is at most 1/8 of the values in it.
+    ASSERT_LE(LatencyStats::GetBucketUpperBoundUsec(index) - usec, usec / 8);
+    prev_index = index;
+  }
+  EXPECT_EQ(LatencyStats::GetBucketIndex(uint64_t{1} << 40),
+            LatencyStats::kNumBuckets - 1);
+  EXPECT_EQ(LatencyStats::GetBucketIndex(UINT32_MAX),
+            LatencyStats::kNumBuckets - 1);
+}
+
+TEST_F(LatencyStatsTest, RegisterStage) {
+  const LatencyStats::StageId stage1 = LatencyStats::RegisterStage("Stage1");
+  const LatencyStats::StageId stage2 = LatencyStats::RegisterStage("Stage2");
+  EXPECT_NE(stage1, LatencyStats::kInvalidStage);
+  EXPECT_NE(stage1, stage2);
+  EXPECT_EQ(LatencyStats::RegisterStage("Stage1"), stage1);
+
+  // Invalid stage is ignored.
+  LatencyStats::Record(LatencyStats::kInvalidStage, absl::Milliseconds(1));
+}
+
+TEST_F(LatencyStatsTest, Record) {
+  const LatencyStats::StageId stage = LatencyStats::RegisterStage("Record");
+  EXPECT_EQ(FindStage(LatencyStats::GetSnapshot(), "Record"), nullptr);
+
+  for (int i = 1; i <= 100; ++i) {
+    LatencyStats::Record(stage, absl::Microseconds(i * 10));
+  }
+  const std::vector<LatencyStats::StageSnapshot> snapshot =
+      LatencyStats::GetSnapshot();
+  const LatencyStats::StageSnapshot *stats = FindStage(snapshot, "Record");
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->count, 100);
+  EXPECT_EQ(stats->total_usec, 50500);
+  EXPECT_EQ(stats->max_usec, 1000);
+  // Percentiles are precise within the bucket width.
+  EXPECT_GE(stats->GetPercentileUsec(50), 500);
+  EXPECT_LE(stats->GetPercentileUsec(50), 500 + 500 / 8);
+  EXPECT_GE(stats->GetPercentileUsec(90), 900);
+  EXPECT_LE(stats->GetPercentileUsec(90), 900 + 900 / 8);
+  EXPECT_EQ(stats->GetPercentileUsec(100), 1000);
+
+  LatencyStats::ClearAll();
+  EXPECT_EQ(FindStage(LatencyStats::GetSnapshot(), "Record"), nullptr);
+}
+
+TEST_F(LatencyStatsTest, ScopedLatencyRecorder) {
+  ClockMock clock(absl::FromUnixSeconds(10000));
+  Clock::SetClockForUnitTest(&clock);
+  const LatencyStats::StageId stage = LatencyStats::RegisterStage("Scoped");
+  {
+    ScopedLatencyRecorder recorder(stage);
+    clock.Advance(absl::Milliseconds(3));
+  }
+  Clock::SetClockForUnitTest(nullptr);
+
+  const std::vector<LatencyStats::StageSnapshot> snapshot =
+      LatencyStats::GetSnapshot();
+  const LatencyStats::StageSnapshot *stats = FindStage(snapshot, "Scoped");
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->count, 1);
+  EXPECT_EQ(stats->total_usec, 3000);
+}
+
+TEST_F(LatencyStatsTest, MultipleThreads) {
+  const LatencyStats::StageId stage = LatencyStats::RegisterStage("Threads");
+  constexpr int kNumThreads = 4;
+  constexpr int kNumRecords = 10000;
+  for (int round = 0; round < 2; ++round) {
+    // Threads of the second round reuse the shards of the first round.
+    std::vector<Thread2> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([stage] {
+        for (int j = 0; j < kNumRecords; ++j) {
+          LatencyStats::Record(stage, absl::Microseconds(j % 100));
+        }
+      });
+    }
+    for (Thread2 &thread : threads) {
+      thread.Join();
+    }
+  }
+  const std::vector<LatencyStats::StageSnapshot> snapshot =
+      LatencyStats::GetSnapshot();
+  const LatencyStats::StageSnapshot *stats = FindStage(snapshot, "Threads");
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->count, 2 * kNumThreads * kNumRecords);
+  EXPECT_EQ(stats->max_usec, 99);
+}
+
+}  // namespace
+}  // namespace usage_stats
+}  // namespace mozc
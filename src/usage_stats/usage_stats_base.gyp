@@ -103,6 +103,19 @@
         '../protobuf/genproto.gypi',
       ],
     },
+    {
+      'target_name': 'latency_stats',
+      'type': 'static_library',
+      'sources': [
+        'latency_stats.cc',
+      ],
+      'dependencies': [
+        '../base/absl.gyp:absl_strings',
+        '../base/absl.gyp:absl_synchronization',
+        '../base/absl.gyp:absl_time',
+        '../base/base.gyp:base',
+      ],
+    },
     {
       'target_name': 'usage_stats_uploader',
       'type': 'static_library',